@@ -0,0 +1,55 @@
+# - Check for the presence of liburing
+#
+# The following variables are set when liburing is found:
+#  HAVE_URING       = Set to true, if all components of liburing
+#                          have been found.
+#  URING_INCLUDES   = Include path for the header files of liburing
+#  URING_LIBRARIES  = Link these to use liburing
+
+## -----------------------------------------------------------------------------
+## Check for the header files
+
+find_path (URING_INCLUDES liburing.h
+  PATHS ${DSN_THIRDPARTY_ROOT}/include /usr/local/include /usr/include ${CMAKE_EXTRA_INCLUDES}
+  )
+
+## -----------------------------------------------------------------------------
+## Check for the library
+
+find_library (URING_LIBRARIES NAMES liburing.a uring
+  PATHS ${DSN_THIRDPARTY_ROOT}/lib /usr/local/lib64 /usr/lib64 /lib64 ${CMAKE_EXTRA_LIBRARIES}
+  )
+
+## -----------------------------------------------------------------------------
+## Actions taken when all components have been found
+
+if (URING_INCLUDES AND URING_LIBRARIES)
+  set (HAVE_URING TRUE)
+else (URING_INCLUDES AND URING_LIBRARIES)
+  if (NOT URING_FIND_QUIETLY)
+    if (NOT URING_INCLUDES)
+      message (STATUS "Unable to find liburing header files!")
+    endif (NOT URING_INCLUDES)
+    if (NOT URING_LIBRARIES)
+      message (STATUS "Unable to find liburing library files!")
+    endif (NOT URING_LIBRARIES)
+  endif (NOT URING_FIND_QUIETLY)
+endif (URING_INCLUDES AND URING_LIBRARIES)
+
+if (HAVE_URING)
+  if (NOT URING_FIND_QUIETLY)
+    message (STATUS "Found components for liburing")
+    message (STATUS "URING_INCLUDES = ${URING_INCLUDES}")
+    message (STATUS "URING_LIBRARIES = ${URING_LIBRARIES}")
+  endif (NOT URING_FIND_QUIETLY)
+else (HAVE_URING)
+  if (URING_FIND_REQUIRED)
+    message (FATAL_ERROR "Could not find liburing!")
+  endif (URING_FIND_REQUIRED)
+endif (HAVE_URING)
+
+mark_as_advanced (
+  HAVE_URING
+  URING_LIBRARIES
+  URING_INCLUDES
+  )
@@ -224,6 +224,8 @@ function(dsn_setup_compiler_flags)
         message(STATUS "Running cmake with sanitizer=${SANITIZER}")
         set(CMAKE_C_FLAGS "${CMAKE_C_FLAGS} -fsanitize=${SANITIZER}" CACHE STRING "" FORCE)
         set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -fsanitize=${SANITIZER}" CACHE STRING "" FORCE)
+        # let the sanitizer see every allocation of tasks and messages
+        add_definitions(-DDSN_OBJECT_POOL_DISABLED)
     endif()
 
     set(CMAKE_EXE_LINKER_FLAGS
@@ -256,6 +258,14 @@ function(dsn_setup_system_libs)
     find_package(AIO REQUIRED)
     set(DSN_SYSTEM_LIBS ${DSN_SYSTEM_LIBS} ${AIO_LIBRARIES})
 
+    # io_uring is optional, the io_uring_aio_provider is only built when liburing is found
+    find_package(URING)
+    if(HAVE_URING)
+        set(DSN_SYSTEM_LIBS ${DSN_SYSTEM_LIBS} ${URING_LIBRARIES})
+        include_directories(${URING_INCLUDES})
+        add_definitions(-DDSN_HAVE_IO_URING)
+    endif()
+
     find_package(DL REQUIRED)
     set(DSN_SYSTEM_LIBS ${DSN_SYSTEM_LIBS} ${DL_LIBRARIES})
 
@@ -237,16 +237,24 @@ typedef dsn::ref_ptr<write_future> write_future_ptr;
 /**
  * @brief The upload_request struct
  *  input_local_name: a local filesystem path, you can use a relative or absolute path.
+ *  part_size: transfer the file in parts of part_size bytes, 0 means in a single stream.
+ *  max_concurrent_parts: the max count of parts in flight at the same time.
+ *
+ * Notice: part_size and max_concurrent_parts are only hints, implementations may ignore them.
  */
 struct upload_request
 {
     std::string input_local_name;
+    uint64_t part_size = 0;
+    int32_t max_concurrent_parts = 1;
 };
 
 /**
  * @brief The upload_response struct
  *  similar to write_response with more errors in err:
  *     ERR_FILE_OPERATION_FAILED: open the local file for read failed.
+ *  md5: md5 of the uploaded data, which is calculated while transferring.
+ *       empty if the implementation doesn't calculate it.
  *
  * Notice: user can call get_size/get_md5sum to get the metadata of the file
  */
@@ -254,6 +262,7 @@ struct upload_response
 {
     dsn::error_code err;
     uint64_t uploaded_size;
+    std::string md5;
 };
 typedef std::function<void(const upload_response &)> upload_callback;
 typedef future_task<upload_response> upload_future;
@@ -262,12 +271,15 @@ typedef dsn::ref_ptr<upload_future> upload_future_ptr;
 /**
  * @brief The download_request struct
  *  output_local_file: a local filesystem path, you can use a relative or absolute path.
+ *  part_size, max_concurrent_parts: same as upload_request
  */
 struct download_request
 {
     std::string output_local_name;
     uint64_t remote_pos;
     int64_t remote_length;
+    uint64_t part_size = 0;
+    int32_t max_concurrent_parts = 1;
 };
 /**
  * @brief The download_response struct
@@ -275,11 +287,13 @@ struct download_request
  *    ERR_FILE_OPERATION_FAILED: open output_local_name for write failed.
  *    if try to download a non-exist file and with an invalid output_local_name,
  *    it's up to implementation to return which error.
+ *  md5: same as upload_response
  */
 struct download_response
 {
     dsn::error_code err;
     uint64_t downloaded_size;
+    std::string md5;
 };
 typedef std::function<void(const download_response &)> download_callback;
 typedef future_task<download_response> download_future;
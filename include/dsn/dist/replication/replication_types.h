@@ -1789,12 +1789,21 @@ inline std::ostream &operator<<(std::ostream &out, const replica_server_info &ob
 
 typedef struct _configuration_query_by_node_request__isset
 {
-    _configuration_query_by_node_request__isset() : node(false), stored_replicas(false), info(false)
+    _configuration_query_by_node_request__isset()
+        : node(false),
+          stored_replicas(false),
+          info(false),
+          config_epoch(false),
+          config_version(false),
+          refresh_partitions(false)
     {
     }
     bool node : 1;
     bool stored_replicas : 1;
     bool info : 1;
+    bool config_epoch : 1;
+    bool config_version : 1;
+    bool refresh_partitions : 1;
 } _configuration_query_by_node_request__isset;
 
 class configuration_query_by_node_request
@@ -1804,12 +1813,15 @@ public:
     configuration_query_by_node_request(configuration_query_by_node_request &&);
     configuration_query_by_node_request &operator=(const configuration_query_by_node_request &);
     configuration_query_by_node_request &operator=(configuration_query_by_node_request &&);
-    configuration_query_by_node_request() {}
+    configuration_query_by_node_request() : config_epoch(0), config_version(0) {}
 
     virtual ~configuration_query_by_node_request() throw();
     ::dsn::rpc_address node;
     std::vector<replica_info> stored_replicas;
     replica_server_info info;
+    int64_t config_epoch;
+    int64_t config_version;
+    std::vector<::dsn::gpid> refresh_partitions;
 
     _configuration_query_by_node_request__isset __isset;
 
@@ -1819,6 +1831,12 @@ public:
 
     void __set_info(const replica_server_info &val);
 
+    void __set_config_epoch(const int64_t val);
+
+    void __set_config_version(const int64_t val);
+
+    void __set_refresh_partitions(const std::vector<::dsn::gpid> &val);
+
     bool operator==(const configuration_query_by_node_request &rhs) const
     {
         if (!(node == rhs.node))
@@ -1831,6 +1849,18 @@ public:
             return false;
         else if (__isset.info && !(info == rhs.info))
             return false;
+        if (__isset.config_epoch != rhs.__isset.config_epoch)
+            return false;
+        else if (__isset.config_epoch && !(config_epoch == rhs.config_epoch))
+            return false;
+        if (__isset.config_version != rhs.__isset.config_version)
+            return false;
+        else if (__isset.config_version && !(config_version == rhs.config_version))
+            return false;
+        if (__isset.refresh_partitions != rhs.__isset.refresh_partitions)
+            return false;
+        else if (__isset.refresh_partitions && !(refresh_partitions == rhs.refresh_partitions))
+            return false;
         return true;
     }
     bool operator!=(const configuration_query_by_node_request &rhs) const
@@ -1857,12 +1887,20 @@ inline std::ostream &operator<<(std::ostream &out, const configuration_query_by_
 typedef struct _configuration_query_by_node_response__isset
 {
     _configuration_query_by_node_response__isset()
-        : err(false), partitions(false), gc_replicas(false)
+        : err(false),
+          partitions(false),
+          gc_replicas(false),
+          config_epoch(false),
+          config_version(false),
+          unchanged_partitions(false)
     {
     }
     bool err : 1;
     bool partitions : 1;
     bool gc_replicas : 1;
+    bool config_epoch : 1;
+    bool config_version : 1;
+    bool unchanged_partitions : 1;
 } _configuration_query_by_node_response__isset;
 
 class configuration_query_by_node_response
@@ -1872,12 +1910,15 @@ public:
     configuration_query_by_node_response(configuration_query_by_node_response &&);
     configuration_query_by_node_response &operator=(const configuration_query_by_node_response &);
     configuration_query_by_node_response &operator=(configuration_query_by_node_response &&);
-    configuration_query_by_node_response() {}
+    configuration_query_by_node_response() : config_epoch(0), config_version(0) {}
 
     virtual ~configuration_query_by_node_response() throw();
     ::dsn::error_code err;
     std::vector<configuration_update_request> partitions;
     std::vector<replica_info> gc_replicas;
+    int64_t config_epoch;
+    int64_t config_version;
+    std::vector<::dsn::gpid> unchanged_partitions;
 
     _configuration_query_by_node_response__isset __isset;
 
@@ -1887,6 +1928,12 @@ public:
 
     void __set_gc_replicas(const std::vector<replica_info> &val);
 
+    void __set_config_epoch(const int64_t val);
+
+    void __set_config_version(const int64_t val);
+
+    void __set_unchanged_partitions(const std::vector<::dsn::gpid> &val);
+
     bool operator==(const configuration_query_by_node_response &rhs) const
     {
         if (!(err == rhs.err))
@@ -1897,6 +1944,19 @@ public:
             return false;
         else if (__isset.gc_replicas && !(gc_replicas == rhs.gc_replicas))
             return false;
+        if (__isset.config_epoch != rhs.__isset.config_epoch)
+            return false;
+        else if (__isset.config_epoch && !(config_epoch == rhs.config_epoch))
+            return false;
+        if (__isset.config_version != rhs.__isset.config_version)
+            return false;
+        else if (__isset.config_version && !(config_version == rhs.config_version))
+            return false;
+        if (__isset.unchanged_partitions != rhs.__isset.unchanged_partitions)
+            return false;
+        else if (__isset.unchanged_partitions &&
+                 !(unchanged_partitions == rhs.unchanged_partitions))
+            return false;
         return true;
     }
     bool operator!=(const configuration_query_by_node_response &rhs) const
@@ -84,6 +84,11 @@ public:
     virtual int64_t get_integer_value() = 0;
     virtual double get_percentile(dsn_perf_counter_percentile_type_t type) = 0;
 
+    // for NUMBER, the current value. for VOLATILE_NUMBER and RATE, the sum of all the values
+    // added since the counter is created, which is never reset. unlike get_value, reading it has
+    // no side effect, so any number of collectors can read it at the same time.
+    virtual int64_t get_cumulative_value() { return get_integer_value(); }
+
     typedef std::vector<std::pair<int64_t *, int>> samples_t;
 
     // return actual sample count, must <= required_sample_count
@@ -95,6 +100,21 @@ public:
     // return the latest sample value
     virtual int64_t get_latest_sample() const { return 0; }
 
+    struct histogram_bucket
+    {
+        int64_t lower_bound; // inclusive
+        int64_t upper_bound; // inclusive
+        uint64_t count;
+    };
+
+    // get the non-empty buckets and the sum of all the values set since the counter is created,
+    // return false if the counter isn't backed by a histogram
+    virtual bool get_histogram(/*out*/ std::vector<histogram_bucket> &buckets,
+                               /*out*/ int64_t &sum) const
+    {
+        return false;
+    }
+
     const char *full_name() const { return _full_name.c_str(); }
     const char *app() const { return _app.c_str(); }
     const char *section() const { return _section.c_str(); }
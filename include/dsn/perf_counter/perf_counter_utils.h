@@ -34,4 +34,30 @@ struct perf_counter_info
     DEFINE_JSON_SERIALIZATION(result, timestamp, timestamp_str, counters)
 };
 
+struct perf_counter_histogram_bucket
+{
+    int64_t lower; // inclusive
+    int64_t upper; // inclusive
+    uint64_t count;
+    DEFINE_JSON_SERIALIZATION(lower, upper, count)
+};
+
+struct perf_counter_histogram
+{
+    std::string name;
+    uint64_t count;
+    int64_t sum;
+    std::vector<perf_counter_histogram_bucket> buckets;
+    perf_counter_histogram() : count(0), sum(0) {}
+    DEFINE_JSON_SERIALIZATION(name, count, sum, buckets)
+};
+
+/// used for command of querying the histograms of perf counter
+struct perf_counter_histogram_info
+{
+    std::string result; // OK or ERROR
+    std::vector<perf_counter_histogram> histograms;
+    DEFINE_JSON_SERIALIZATION(result, histograms)
+};
+
 } // namespace dsn
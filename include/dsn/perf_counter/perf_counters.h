@@ -29,7 +29,9 @@
 #include <dsn/utility/singleton.h>
 #include <dsn/utility/synchronize.h>
 #include <dsn/perf_counter/perf_counter.h>
+#include <atomic>
 #include <map>
+#include <memory>
 #include <sstream>
 #include <queue>
 #include <functional>
@@ -83,8 +85,23 @@ public:
     private:
         friend class perf_counters;
         bool updated_recently{false};
+        // the counter which the snapshot is taken from, to find out that it's removed and
+        // registered again since the last snapshot
+        perf_counter_ptr counter;
+        // the value of VOLATILE_NUMBER and RATE is derived from the cumulative value
+        int64_t last_cumulative_value{0};
+        uint64_t last_time_ns{0};
     };
 
+    ///
+    /// visit all the counters without any lock, the counters registered or removed during the
+    /// visiting may be missed or visited. Reading get_cumulative_value, get_percentile and
+    /// get_histogram of the counters has no side effect, so any number of collectors can
+    /// visit the counters at the same time.
+    ///
+    typedef std::function<void(const perf_counter_ptr &)> counter_visitor;
+    void iterate_counters(const counter_visitor &v) const;
+
     ///
     /// Some types of perf counters(rate, volatile_number) may change it's value after you visit
     /// it, so we'd better take a snapshot of all counters before the visiting in case that
@@ -105,8 +122,9 @@ public:
     /// when you read the snapshot, you should provide a callback called "snapshot_visitor".
     /// this callback will be called once for each requested counter.
     ///
-    /// TODO: totally eliminate this stupid snapshot feature with a better metrics library
-    /// (a metric library which doesn't have SIDE EFFECT when you visit metric!!!)
+    /// the value of VOLATILE_NUMBER and RATE counters in the snapshot is derived from the
+    /// cumulative value, so taking snapshot doesn't affect the other collectors. The RATE is 0
+    /// in the first snapshot which contains the counter.
     ///
     typedef std::function<void(const counter_snapshot &)> snapshot_iterator;
     void take_snapshot();
@@ -133,6 +151,12 @@ public:
         const std::vector<std::string> &args,
         std::function<bool(const std::string &arg, const counter_snapshot &cs)> filter) const;
 
+    // this function collects the histograms of all the counters backed by histogram which match
+    // any of the regular expressions in args, and returns the json representation of
+    // perf_counter_histogram_info. Unlike the snapshot, the histograms are read from the
+    // counters directly, which has no side effect.
+    std::string list_histogram_by_regexp(const std::vector<std::string> &args) const;
+
 private:
     // full_name = perf_counter::build_full_name(...);
     perf_counter *new_counter(const char *app,
@@ -141,7 +165,14 @@ private:
                               dsn_perf_counter_type_t type,
                               const char *dsptr);
 
-    void get_all_counters(std::vector<perf_counter_ptr> *all) const;
+    // the counters published for the lock-free iteration, which is rebuilt by the first reader
+    // after the counters are changed, so registering a counter only bumps _counters_version
+    struct counter_list
+    {
+        uint64_t version;
+        std::vector<perf_counter_ptr> counters;
+    };
+    std::shared_ptr<const counter_list> get_all_counters() const;
 
     mutable utils::rw_lock_nr _lock;
     // keep counter as a refptr to make the counter can be safely accessed
@@ -155,6 +186,10 @@ private:
         int user_reference;
     };
     std::unordered_map<std::string, counter_object> _counters;
+    // bumped with _lock held when any counter is added or removed
+    std::atomic<uint64_t> _counters_version;
+    // accessed by std::atomic_load/std::atomic_compare_exchange
+    mutable std::shared_ptr<const counter_list> _published_counters;
 
     mutable utils::rw_lock_nr _snapshot_lock;
     std::unordered_map<std::string, counter_snapshot> _snapshots;
@@ -38,17 +38,23 @@
 
 namespace dsn {
 
+class message_block_pool;
+
 // TODO(wutao1): call it read_buffer, and make it an utility
 // Not-Thread-Safe.
 class message_reader
 {
 public:
     explicit message_reader(int buffer_block_size)
-        : _buffer_occupied(0), _buffer_block_size(buffer_block_size)
+        : _buffer_occupied(0), _buffer_block_size(buffer_block_size), _copied_bytes(0)
     {
     }
 
-    // called before read to extend read buffer
+    // called before read to extend read buffer.
+    // the buffer is a block of `_buffer_block_size` bytes from the reader's own pool of the
+    // blocks released by its messages, or a buffer of its own when
+    // the message under parsing is larger than a block, so that the rest of the message is
+    // received in place. only the part of the message received before the switch is copied.
     DSN_API char *read_buffer_ptr(unsigned int read_next);
 
     // get remaining buffer capacity
@@ -69,11 +75,21 @@ public:
 
     blob buffer() const { return _buffer.range(0, _buffer_occupied); }
 
+    // get and reset the count of bytes copied by read_buffer_ptr
+    uint64_t take_copied_bytes()
+    {
+        uint64_t copied = _copied_bytes;
+        _copied_bytes = 0;
+        return copied;
+    }
+
 public:
     // TODO(wutao1): make them private members
     blob _buffer;
     unsigned int _buffer_occupied;
     const unsigned int _buffer_block_size;
+    uint64_t _copied_bytes;
+    std::shared_ptr<message_block_pool> _block_pool;
 };
 
 class message_parser;
@@ -29,6 +29,7 @@
 #include <dsn/tool-api/task.h>
 #include <dsn/utility/synchronize.h>
 #include <dsn/tool-api/message_parser.h>
+#include <dsn/perf_counter/perf_counter_wrapper.h>
 #include <dsn/tool-api/rpc_address.h>
 #include <dsn/utility/exp_delay.h>
 #include <dsn/utility/dlib.h>
@@ -165,6 +166,12 @@ public:
     DSN_API void on_client_session_connected(rpc_session_ptr &s);
     DSN_API void on_client_session_disconnected(rpc_session_ptr &s);
 
+    // account the bytes received by a session, and the bytes its message_reader copied meanwhile
+    DSN_API void on_bytes_received(uint64_t received, uint64_t copied);
+
+    // account the messages merged into one write by a session
+    DSN_API void on_write_prepared(size_t msg_count, uint64_t bytes);
+
     // called upon RPC call, rpc client session is created on demand
     DSN_API virtual void send_message(message_ex *request) override;
 
@@ -176,16 +183,51 @@ public:
 
 protected:
     typedef std::unordered_map<::dsn::rpc_address, rpc_session_ptr> client_sessions;
-    client_sessions _clients; // to_address => rpc_session
-    utils::rw_lock_nr _clients_lock;
-
     typedef std::unordered_map<::dsn::rpc_address, rpc_session_ptr> server_sessions;
-    server_sessions _servers; // from_address => rpc_session
     typedef std::unordered_map<uint32_t, uint32_t> ip_connection_count;
-    ip_connection_count _ip_conn_count; // from_ip => connection count
-    utils::rw_lock_nr _servers_lock;
+
+    // the sessions are put into shards by the remote address (ip:port), so that the sessions of
+    // the peers on the same host are spread over the shards. the connection count of an ip is
+    // kept in the shard picked by the ip alone, under its own lock
+    struct session_shard
+    {
+        client_sessions clients; // to_address => rpc_session
+        utils::rw_lock_nr clients_lock;
+
+        server_sessions servers; // from_address => rpc_session
+        utils::rw_lock_nr servers_lock;
+
+        ip_connection_count ip_conn_count; // from_ip => connection count
+        utils::rw_lock_nr ip_conn_count_lock;
+    };
+
+    // there is one shard by default, call it before the network is started to have more
+    DSN_API void init_session_shards(int count);
+    session_shard &get_session_shard(::dsn::rpc_address addr)
+    {
+        return _session_shards[std::hash<::dsn::rpc_address>()(addr) % _session_shard_count];
+    }
+    session_shard &get_ip_conn_count_shard(uint32_t ip)
+    {
+        return _session_shards[ip % _session_shard_count];
+    }
+
+    std::unique_ptr<session_shard[]> _session_shards;
+    int _session_shard_count;
+    std::atomic<int> _client_count;
+    std::atomic<int> _server_count;
 
     uint32_t _cfg_conn_threshold_per_ip;
+
+    perf_counter_wrapper _recv_bytes;
+    perf_counter_wrapper _recv_copied_bytes;
+    // bytes copied per 1000 bytes received, updated every RECV_COPY_WINDOW_BYTES received
+    perf_counter_wrapper _recv_copy_permille;
+    std::atomic<uint64_t> _window_recv_bytes;
+    std::atomic<uint64_t> _window_copied_bytes;
+
+    perf_counter_wrapper _send_msgs_per_write;
+    perf_counter_wrapper _send_bytes_per_write;
 };
 
 /*!
@@ -249,6 +291,11 @@ public:
     virtual void send(uint64_t signature) = 0;
     void on_send_completed(uint64_t signature = 0);
 
+    // hold the sending of the queued messages for `delay_us`, then call send_corked().
+    // sessions without a timer send them at once.
+    virtual void cork(int delay_us) { send_corked(); }
+    void send_corked();
+
 protected:
     ///
     /// fields related to sending messages
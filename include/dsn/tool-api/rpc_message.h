@@ -125,7 +125,7 @@ typedef struct message_header
 
 class message_ex : public ref_counter,
                    public extensible_object<message_ex, 4>,
-                   public transient_object
+                   public pooled_object
 {
 public:
     message_header *header;
@@ -178,7 +178,7 @@ extern __thread struct __tls_dsn__ tls_dsn;
 /// functions for different purposes on these hook points, you may want to refer to
 /// "tracer", "profiler" and "fault_injector" for details.
 ///
-class task : public ref_counter, public extensible_object<task, 4>, public transient_object
+class task : public ref_counter, public extensible_object<task, 4>, public pooled_object
 {
 public:
     task(task_code code, int hash = 0, service_node *node = nullptr);
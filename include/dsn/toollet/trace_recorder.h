@@ -0,0 +1,57 @@
+// Copyright (c) 2019, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include <dsn/tool_api.h>
+
+/*!
+@defgroup trace_recorder Trace Recorder
+@ingroup tools
+
+Trace recorder toollet
+
+Unlike the tracer, which logs each event as a text line, this toollet records the task events as
+fixed-size binary records into a ring buffer of each thread, so it's cheap enough to be always on.
+The latest records are dumped on demand as the JSON of chrome trace event format, which can be
+loaded by chrome://tracing, via the remote command "trace-recorder.dump" or the http path
+"ip:port/trace".
+
+The events are sampled by trace. A task enqueued by another task, including an aio task, joins the
+trace of that one, while an rpc sent by them starts a new trace.
+
+<PRE>
+
+[core]
+toollets = trace_recorder
+
+[tools.trace_recorder]
+; count of the trace records kept for each thread
+ring_size = 4096
+; record the events of one in every sample_interval traces, 0 to record nothing,
+; which can be changed by the remote command "trace-recorder.sample-interval"
+sample_interval = 1
+
+[task..default]
+is_trace_record = true
+
+[task.RPC_PING]
+is_trace_record = false
+
+</PRE>
+*/
+namespace dsn {
+namespace tools {
+
+class trace_recorder : public toollet
+{
+public:
+    trace_recorder(const char *name);
+    virtual void install(service_spec &spec);
+
+    // dump the records of all the threads in the chrome trace event format
+    static std::string dump_chrome_trace();
+};
+}
+}
@@ -27,6 +27,7 @@
 #pragma once
 
 #include <dsn/utility/transient_memory.h>
+#include <dsn/utility/object_pool.h>
 
 namespace dsn {
 
@@ -53,4 +54,9 @@ public:
 /// are derived from transient_objects,
 /// so that their memory can be mamanged by trans_memory_allocator
 typedef callocator_object<tls_trans_malloc, tls_trans_free> transient_object;
+
+/// pooled_object uses object_pool_malloc/object_pool_free as custom memory allocate.
+/// it is used by the objects allocated and freed on every rpc (task, message_ex, etc.), which
+/// are often freed by another thread, please refer to object_pool.h for details
+typedef callocator_object<object_pool_malloc, object_pool_free> pooled_object;
 }
@@ -0,0 +1,54 @@
+// Copyright (c) 2019, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace dsn {
+
+/// object pool is a size-class allocator for the small objects allocated on every rpc, e.g. task,
+/// rpc_response_task, message_ex and the message header.
+///
+/// each thread owns a cache holding one free list per size class. an allocation pops from the
+/// free list of the current thread, and falls back to carving a new slab only when both the local
+/// list and the remote list are empty. a piece freed by its owner thread goes back to the local
+/// list, while a piece freed by any other thread is pushed onto a lock-free stack of the owner,
+/// which will be taken back in a whole on the owner's next miss:
+///
+/// |-- header --|------------ object ------------|
+///  owner cache, size class
+///
+/// slabs are never returned to the system, the cache of an exited thread is adopted by the next
+/// new thread. pieces larger than the largest size class are served by malloc.
+///
+/// define DSN_OBJECT_POOL_DISABLED (automatically set in sanitizer builds) to make the pool a
+/// plain malloc/free, or call object_pool_init(false) to do the same at runtime.
+
+struct object_pool_stats
+{
+    // allocations served by the free lists
+    uint64_t hit_count;
+    // allocations served by new slabs
+    uint64_t miss_count;
+    // bytes of all the slabs
+    uint64_t resident_bytes;
+};
+
+// enable or disable the pool, should call this at the beginning of the process.
+// memory allocated before it is still freed correctly afterwards.
+void object_pool_init(bool enabled);
+
+void *object_pool_malloc(size_t sz);
+
+void object_pool_free(void *ptr);
+
+// sum up the statistics of all the thread caches
+object_pool_stats object_pool_get_stats();
+
+// the statistics of the cache owned by the calling thread
+object_pool_stats object_pool_get_thread_stats();
+
+} // namespace dsn
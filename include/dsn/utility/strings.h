@@ -5,6 +5,9 @@
 #include <list>
 #include <map>
 #include <iostream>
+#include <memory>
+
+struct MD5state_st;
 
 namespace dsn {
 namespace utils {
@@ -49,5 +52,21 @@ char *trim_string(char *s);
 
 // calculate the md5 checksum of buffer
 std::string string_md5(const char *buffer, unsigned int length);
+
+// calculate the md5 checksum of the data fed piece by piece, in the same format as string_md5
+class md5_hasher
+{
+public:
+    md5_hasher();
+    ~md5_hasher();
+
+    void update(const char *buffer, size_t length);
+
+    // the hasher can't be updated any more after finalized
+    std::string finalize();
+
+private:
+    std::unique_ptr<MD5state_st> _ctx;
+};
 }
 }
@@ -28,6 +28,7 @@
 #include <dsn/tool-api/aio_task.h>
 #include "disk_engine.h"
 #include "sim_aio_provider.h"
+#include "io_uring_aio_provider.h"
 #include "core/core/service_engine.h"
 
 using namespace dsn::utils;
@@ -40,6 +41,9 @@ DEFINE_TASK_CODE_AIO(LPC_AIO_BATCH_WRITE, TASK_PRIORITY_COMMON, THREAD_POOL_DEFA
 const char *native_aio_provider = "dsn::tools::native_aio_provider";
 DSN_REGISTER_COMPONENT_PROVIDER(native_linux_aio_provider, native_aio_provider);
 DSN_REGISTER_COMPONENT_PROVIDER(sim_aio_provider, "dsn::tools::sim_aio_provider");
+#ifdef DSN_HAVE_IO_URING
+DSN_REGISTER_COMPONENT_PROVIDER(io_uring_aio_provider, "dsn::tools::io_uring_aio_provider");
+#endif
 
 //----------------- disk_file ------------------------
 aio_task *disk_write_queue::unlink_next_workload(void *plength)
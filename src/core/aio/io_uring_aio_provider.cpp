@@ -0,0 +1,532 @@
+// Copyright (c) 2019, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#include "io_uring_aio_provider.h"
+
+#ifdef DSN_HAVE_IO_URING
+
+#include <algorithm>
+#include <chrono>
+#include <dsn/tool_api.h>
+#include <dsn/utility/flags.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+namespace dsn {
+
+DSN_DEFINE_uint32("core", io_uring_queue_depth, 256, "entries of the io_uring submission ring");
+DSN_DEFINE_bool("core",
+                io_uring_sqpoll,
+                false,
+                "whether to let a kernel thread poll the io_uring submission ring, so that "
+                "submitting io needs no syscall");
+DSN_DEFINE_uint32("core",
+                  io_uring_sqpoll_idle_ms,
+                  1000,
+                  "how long the sqpoll kernel thread spins before going to sleep");
+DSN_DEFINE_uint32("core",
+                  io_uring_max_registered_files,
+                  1024,
+                  "max files registered to io_uring as fixed files, 0 means disabled");
+DSN_DEFINE_uint32("core",
+                  io_uring_fixed_buffer_count,
+                  0,
+                  "how many fixed buffers are registered to io_uring, 0 means disabled");
+DSN_DEFINE_uint32("core",
+                  io_uring_fixed_buffer_size,
+                  65536,
+                  "size of each fixed buffer registered to io_uring, only the io not larger "
+                  "than it goes through the fixed buffers");
+DSN_DEFINE_validator(io_uring_queue_depth, [](uint32_t value) -> bool { return value > 0; });
+
+// how many times the submission is retried on the transient errors, with a short sleep
+static const int MAX_SUBMIT_RETRIES = 1000;
+
+// the completion target of the nop which stops the reaper, any other completion carries the
+// target of an io
+static io_uring_aio_provider::completion s_stop_completion;
+
+bool io_uring_aio_provider_supported()
+{
+    struct io_uring ring;
+    if (io_uring_queue_init(8, &ring, 0) != 0) {
+        return false;
+    }
+
+    bool supported = false;
+    struct io_uring_probe *probe = io_uring_get_probe_ring(&ring);
+    if (probe != nullptr) {
+        supported = true;
+        for (int op : {IORING_OP_NOP,
+                       IORING_OP_READ,
+                       IORING_OP_WRITE,
+                       IORING_OP_WRITEV,
+                       IORING_OP_READ_FIXED,
+                       IORING_OP_WRITE_FIXED,
+                       IORING_OP_FSYNC}) {
+            supported = supported && io_uring_opcode_supported(probe, op);
+        }
+        io_uring_free_probe(probe);
+    }
+    io_uring_queue_exit(&ring);
+    return supported;
+}
+
+io_uring_aio_provider::io_uring_aio_provider(disk_engine *disk) : aio_provider(disk)
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    if (FLAGS_io_uring_sqpoll) {
+        params.flags |= IORING_SETUP_SQPOLL;
+        params.sq_thread_idle = FLAGS_io_uring_sqpoll_idle_ms;
+    }
+    auto ret = io_uring_queue_init_params(FLAGS_io_uring_queue_depth, &_ring, &params);
+    dassert(ret == 0, "io_uring_queue_init error, ret = %d", ret);
+    // the completion ring is twice as large as the submission ring by default
+    _cq_entries = params.cq_entries;
+    _max_inflight = std::max<uint32_t>(_cq_entries / 2, 1);
+
+    if (FLAGS_io_uring_max_registered_files > 0) {
+        // register a sparse table, the slots are filled on open
+        std::vector<int> fds(FLAGS_io_uring_max_registered_files, -1);
+        ret = io_uring_register_files(&_ring, fds.data(), fds.size());
+        if (ret == 0) {
+            for (int i = static_cast<int>(fds.size()) - 1; i >= 0; --i) {
+                _free_file_slots.push_back(i);
+            }
+        } else {
+            dwarn("io_uring_register_files error, fixed files are disabled, ret = %d", ret);
+        }
+    }
+
+    if (FLAGS_io_uring_fixed_buffer_count > 0) {
+        for (uint32_t i = 0; i < FLAGS_io_uring_fixed_buffer_count; ++i) {
+            void *buf = nullptr;
+            ret = posix_memalign(&buf, 4096, FLAGS_io_uring_fixed_buffer_size);
+            dassert(ret == 0, "posix_memalign error, ret = %d", ret);
+            _fixed_buffers.push_back({buf, FLAGS_io_uring_fixed_buffer_size});
+        }
+        ret = io_uring_register_buffers(&_ring, _fixed_buffers.data(), _fixed_buffers.size());
+        if (ret == 0) {
+            for (int i = static_cast<int>(_fixed_buffers.size()) - 1; i >= 0; --i) {
+                _free_fixed_buffers.push_back(i);
+            }
+        } else {
+            dwarn("io_uring_register_buffers error, fixed buffers are disabled, ret = %d", ret);
+        }
+    }
+
+    _completion_batch_size.init_global_counter(::dsn::tools::get_service_node_name(node()),
+                                               "engine",
+                                               "io_uring.completion.batch.size",
+                                               COUNTER_TYPE_NUMBER_PERCENTILES,
+                                               "cqes harvested per wakeup of the io_uring reaper");
+
+    _is_running = true;
+    _worker = std::thread([this]() {
+        task::set_tls_dsn_context(node(), nullptr);
+        get_event();
+    });
+}
+
+io_uring_aio_provider::~io_uring_aio_provider()
+{
+    if (!_is_running) {
+        return;
+    }
+    _is_running = false;
+
+    // wake up the reaper with a nop
+    acquire_inflight_slot();
+    {
+        utils::auto_lock<utils::ex_lock_nr_spin> l(_sq_lock);
+        struct io_uring_sqe *sqe = get_sqe_locked();
+        dassert(sqe != nullptr, "cannot get sqe to stop the io_uring reaper");
+        io_uring_prep_nop(sqe);
+        io_uring_sqe_set_data(sqe, &s_stop_completion);
+        int ret = submit_locked();
+        dassert(ret >= 0, "cannot stop the io_uring reaper, ret = %d", ret);
+    }
+    _worker.join();
+
+    io_uring_queue_exit(&_ring);
+    for (auto &buf : _fixed_buffers) {
+        free(buf.iov_base);
+    }
+}
+
+dsn_handle_t io_uring_aio_provider::open(const char *file_name, int flag, int pmode)
+{
+    int fd = ::open(file_name, flag, pmode);
+    if (fd < 0) {
+        derror("create file failed, err = %s", strerror(errno));
+        return DSN_INVALID_FILE_HANDLE;
+    }
+
+    utils::auto_write_lock l(_files_lock);
+    if (!_free_file_slots.empty()) {
+        int slot = _free_file_slots.back();
+        int ret = io_uring_register_files_update(&_ring, slot, &fd, 1);
+        if (ret == 1) {
+            _free_file_slots.pop_back();
+            _fixed_files[fd] = slot;
+        } else {
+            dwarn("io_uring_register_files_update error, ret = %d", ret);
+        }
+    }
+    return (dsn_handle_t)(uintptr_t)fd;
+}
+
+error_code io_uring_aio_provider::close(dsn_handle_t fh)
+{
+    if (fh == DSN_INVALID_FILE_HANDLE) {
+        return ERR_OK;
+    }
+
+    int fd = (int)(uintptr_t)(fh);
+    {
+        utils::auto_write_lock l(_files_lock);
+        auto iter = _fixed_files.find(fd);
+        if (iter != _fixed_files.end()) {
+            int removed = -1;
+            int ret = io_uring_register_files_update(&_ring, iter->second, &removed, 1);
+            dassert(ret == 1, "io_uring_register_files_update error, ret = %d", ret);
+            _free_file_slots.push_back(iter->second);
+            _fixed_files.erase(iter);
+        }
+    }
+
+    if (::close(fd) == 0) {
+        return ERR_OK;
+    } else {
+        derror("close file failed, err = %s", strerror(errno));
+        return ERR_FILE_OPERATION_FAILED;
+    }
+}
+
+error_code io_uring_aio_provider::flush(dsn_handle_t fh)
+{
+    if (fh == DSN_INVALID_FILE_HANDLE) {
+        return ERR_OK;
+    }
+
+    utils::notify_event evt;
+    completion c;
+    c.tsk = nullptr;
+    c.evt = &evt;
+    c.res = 0;
+    if (!acquire_inflight_slot()) {
+        derror("flush file failed, too many in-flight io");
+        return ERR_FILE_OPERATION_FAILED;
+    }
+    {
+        utils::auto_lock<utils::ex_lock_nr_spin> l(_sq_lock);
+        struct io_uring_sqe *sqe = get_sqe_locked();
+        if (sqe == nullptr) {
+            release_inflight_slots(1);
+            derror("flush file failed, cannot get an sqe of io_uring");
+            return ERR_FILE_OPERATION_FAILED;
+        }
+        io_uring_prep_fsync(sqe, 0, 0);
+        set_sqe_file(sqe, (int)(uintptr_t)(fh));
+        io_uring_sqe_set_data(sqe, &c);
+        // even if the kernel is not entered, the sqe is published and it completes later
+        submit_locked();
+    }
+    evt.wait();
+
+    if (c.res == 0) {
+        return ERR_OK;
+    } else {
+        derror("flush file failed, err = %s", strerror(-c.res));
+        return ERR_FILE_OPERATION_FAILED;
+    }
+}
+
+aio_context *io_uring_aio_provider::prepare_aio_context(aio_task *tsk)
+{
+    return new io_uring_aio_context(tsk);
+}
+
+bool io_uring_aio_provider::acquire_inflight_slot()
+{
+    std::unique_lock<std::mutex> l(_inflight_lock);
+    if (std::this_thread::get_id() == _worker.get_id()) {
+        // the reaper can't wait, as the slots are released by itself, so it uses the rest of
+        // the completion ring
+        if (_inflight_count >= _cq_entries) {
+            return false;
+        }
+    } else {
+        _inflight_cond.wait(l, [this]() { return _inflight_count < _max_inflight; });
+    }
+    ++_inflight_count;
+    return true;
+}
+
+void io_uring_aio_provider::release_inflight_slots(unsigned count)
+{
+    if (count == 0) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> l(_inflight_lock);
+        _inflight_count -= count;
+    }
+    _inflight_cond.notify_all();
+}
+
+static inline bool is_transient_submit_error(int ret)
+{
+    // -EBUSY means the completions are backlogged, which are drained by the reaper
+    return ret == -EAGAIN || ret == -EBUSY || ret == -EINTR;
+}
+
+struct io_uring_sqe *io_uring_aio_provider::get_sqe_locked()
+{
+    // the in-flight io is bounded, so the submission ring is full only if the kernel hasn't
+    // consumed the submitted entries yet, e.g. the sqpoll thread is waking up
+    for (int retry = 0; retry < MAX_SUBMIT_RETRIES; ++retry) {
+        struct io_uring_sqe *sqe = io_uring_get_sqe(&_ring);
+        if (sqe != nullptr) {
+            return sqe;
+        }
+        int ret = io_uring_submit(&_ring);
+        if (ret < 0 && !is_transient_submit_error(ret)) {
+            derror("io_uring_submit error, ret = %d", ret);
+            return nullptr;
+        }
+        if (ret <= 0) {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    }
+    derror("the io_uring submission ring keeps full");
+    return nullptr;
+}
+
+int io_uring_aio_provider::submit_locked()
+{
+    int ret = 0;
+    for (int retry = 0; retry < MAX_SUBMIT_RETRIES; ++retry) {
+        ret = io_uring_submit(&_ring);
+        if (ret >= 0 || !is_transient_submit_error(ret)) {
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    if (ret < 0) {
+        // the sqes are published to the submission ring before entering the kernel, so they
+        // can't be taken back or modified any more, as the sqpoll thread may be reading them.
+        // they stay in flight, and are submitted along with the next ones
+        derror("io_uring_submit error, the sqes are left to the next submission, ret = %d", ret);
+    }
+    return ret;
+}
+
+void io_uring_aio_provider::fail_aio(aio_task *tsk)
+{
+    auto aio = static_cast<io_uring_aio_context *>(tsk->get_aio_context());
+    if (aio->fixed_buffer_index >= 0) {
+        release_fixed_buffer(aio->fixed_buffer_index);
+        aio->fixed_buffer_index = -1;
+    }
+    complete_io(tsk, ERR_FILE_OPERATION_FAILED, 0);
+}
+
+void io_uring_aio_provider::set_sqe_file(struct io_uring_sqe *sqe, int fd)
+{
+    utils::auto_read_lock l(_files_lock);
+    auto iter = _fixed_files.find(fd);
+    if (iter != _fixed_files.end()) {
+        sqe->fd = iter->second;
+        io_uring_sqe_set_flags(sqe, IOSQE_FIXED_FILE);
+    } else {
+        sqe->fd = fd;
+    }
+}
+
+int io_uring_aio_provider::acquire_fixed_buffer(uint32_t size)
+{
+    if (size > FLAGS_io_uring_fixed_buffer_size) {
+        return -1;
+    }
+    utils::auto_lock<utils::ex_lock_nr_spin> l(_buffers_lock);
+    if (_free_fixed_buffers.empty()) {
+        return -1;
+    }
+    int index = _free_fixed_buffers.back();
+    _free_fixed_buffers.pop_back();
+    return index;
+}
+
+void io_uring_aio_provider::release_fixed_buffer(int index)
+{
+    utils::auto_lock<utils::ex_lock_nr_spin> l(_buffers_lock);
+    _free_fixed_buffers.push_back(index);
+}
+
+void io_uring_aio_provider::submit_aio_task(aio_task *aio_tsk)
+{
+    auto aio = static_cast<io_uring_aio_context *>(aio_tsk->get_aio_context());
+    int fd = static_cast<int>((ssize_t)aio->file);
+
+    aio->fixed_buffer_index = -1;
+    if (!acquire_inflight_slot()) {
+        derror("aio error, too many in-flight io submitted by the callbacks on the reaper");
+        fail_aio(aio_tsk);
+        return;
+    }
+    if (aio->buffer != nullptr) {
+        aio->fixed_buffer_index = acquire_fixed_buffer(aio->buffer_size);
+    }
+    void *fixed_buf = aio->fixed_buffer_index >= 0
+                          ? _fixed_buffers[aio->fixed_buffer_index].iov_base
+                          : nullptr;
+
+    if (aio->type == AIO_Write && aio->buffer == nullptr) {
+        int iovcnt = aio->write_buffer_vec->size();
+        aio->iovs.resize(iovcnt);
+        for (int i = 0; i < iovcnt; i++) {
+            const dsn_file_buffer_t &buf = aio->write_buffer_vec->at(i);
+            aio->iovs[i].iov_base = buf.buffer;
+            aio->iovs[i].iov_len = buf.size;
+        }
+    } else if (aio->type == AIO_Write && fixed_buf != nullptr) {
+        memcpy(fixed_buf, aio->buffer, aio->buffer_size);
+    }
+
+    {
+        utils::auto_lock<utils::ex_lock_nr_spin> l(_sq_lock);
+        struct io_uring_sqe *sqe = get_sqe_locked();
+        if (sqe != nullptr) {
+            prep_sqe(sqe, aio, fd, fixed_buf);
+            // even if the kernel is not entered, the sqe is published and it completes later
+            submit_locked();
+            return;
+        }
+    }
+    // nothing is published, so the io can be failed right away
+    release_inflight_slots(1);
+    fail_aio(aio_tsk);
+}
+
+void io_uring_aio_provider::prep_sqe(struct io_uring_sqe *sqe,
+                                     io_uring_aio_context *aio,
+                                     int fd,
+                                     void *fixed_buf)
+{
+    switch (aio->type) {
+    case AIO_Read:
+        if (fixed_buf != nullptr) {
+            io_uring_prep_read_fixed(
+                sqe, 0, fixed_buf, aio->buffer_size, aio->file_offset, aio->fixed_buffer_index);
+        } else {
+            io_uring_prep_read(sqe, 0, aio->buffer, aio->buffer_size, aio->file_offset);
+        }
+        break;
+    case AIO_Write:
+        if (aio->buffer == nullptr) {
+            io_uring_prep_writev(sqe, 0, aio->iovs.data(), aio->iovs.size(), aio->file_offset);
+        } else if (fixed_buf != nullptr) {
+            io_uring_prep_write_fixed(
+                sqe, 0, fixed_buf, aio->buffer_size, aio->file_offset, aio->fixed_buffer_index);
+        } else {
+            io_uring_prep_write(sqe, 0, aio->buffer, aio->buffer_size, aio->file_offset);
+        }
+        break;
+    default:
+        dassert(false, "unknown aio type %u", static_cast<int>(aio->type));
+    }
+    set_sqe_file(sqe, fd);
+    io_uring_sqe_set_data(sqe, &aio->comp);
+}
+
+void io_uring_aio_provider::get_event()
+{
+    const char *name = ::dsn::tools::get_service_node_name(node());
+    char buffer[128];
+    sprintf(buffer, "%s.aio", name);
+    task_worker::set_name(buffer);
+
+    struct io_uring_cqe *cqes[64];
+    while (true) {
+        struct io_uring_cqe *cqe = nullptr;
+        int ret = io_uring_wait_cqe(&_ring, &cqe);
+        if (ret < 0) {
+            if (ret != -EINTR) {
+                dwarn("io_uring_wait_cqe returns %d", ret);
+            }
+            continue;
+        }
+
+        unsigned count = io_uring_peek_batch_cqe(&_ring, cqes, 64);
+        _completion_batch_size->set(count);
+        completion *targets[64];
+        int results[64];
+        for (unsigned i = 0; i < count; ++i) {
+            targets[i] = static_cast<completion *>(io_uring_cqe_get_data(cqes[i]));
+            results[i] = cqes[i]->res;
+        }
+        io_uring_cq_advance(&_ring, count);
+        // release the slots before the callbacks, which may submit io inline
+        release_inflight_slots(count);
+
+        bool stopped = false;
+        for (unsigned i = 0; i < count; ++i) {
+            if (targets[i] == &s_stop_completion) {
+                stopped = true;
+            } else if (targets[i] == nullptr) {
+                derror("io_uring completion without target, res = %d", results[i]);
+            } else {
+                complete_aio(targets[i], results[i]);
+            }
+        }
+
+        if (stopped && !_is_running.load(std::memory_order_relaxed)) {
+            break;
+        }
+    }
+}
+
+void io_uring_aio_provider::complete_aio(completion *c, int res)
+{
+    if (c->tsk == nullptr) {
+        c->res = res;
+        c->evt->notify();
+        return;
+    }
+
+    auto aio = static_cast<io_uring_aio_context *>(c->tsk->get_aio_context());
+    error_code ec;
+    uint32_t bytes = 0;
+    if (res < 0) {
+        derror("aio error, err = %s", strerror(-res));
+        ec = ERR_FILE_OPERATION_FAILED;
+    } else {
+        bytes = static_cast<uint32_t>(res);
+        ec = bytes > 0 ? ERR_OK : ERR_HANDLE_EOF;
+    }
+
+    if (aio->fixed_buffer_index >= 0) {
+        if (aio->type == AIO_Read && bytes > 0) {
+            memcpy(aio->buffer, _fixed_buffers[aio->fixed_buffer_index].iov_base, bytes);
+        }
+        release_fixed_buffer(aio->fixed_buffer_index);
+        aio->fixed_buffer_index = -1;
+    }
+
+    complete_io(c->tsk, ec, bytes);
+}
+
+} // namespace dsn
+
+#else // DSN_HAVE_IO_URING
+
+namespace dsn {
+bool io_uring_aio_provider_supported() { return false; }
+} // namespace dsn
+
+#endif // DSN_HAVE_IO_URING
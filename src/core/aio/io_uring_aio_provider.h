@@ -0,0 +1,126 @@
+// Copyright (c) 2019, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+namespace dsn {
+// whether io_uring_aio_provider is built, and io_uring is supported by the kernel
+bool io_uring_aio_provider_supported();
+} // namespace dsn
+
+#ifdef DSN_HAVE_IO_URING
+
+#include "aio_provider.h"
+
+#include <dsn/perf_counter/perf_counter_wrapper.h>
+#include <dsn/utility/synchronize.h>
+#include <liburing.h>
+#include <condition_variable>
+#include <mutex>
+#include <sys/uio.h>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace dsn {
+
+// io_uring_aio_provider performs all the disk io, including fsync, through one io_uring
+// submission ring:
+// - files opened by this provider are registered to the ring as fixed files, so that the
+//   kernel doesn't have to look up and ref-count the file on each io.
+// - optionally, a pool of fixed buffers is registered, small reads and writes are bounced
+//   through them, which saves the page pinning of each io at the cost of a memcpy.
+// - with `io_uring_sqpoll` on, a kernel thread polls the submission ring and submitting an
+//   io needs no syscall at all.
+// - the in-flight io is bounded by the size of the completion ring, so the kernel never has to
+//   drop or backlog a completion. the submitters wait for the free slots, except the reaper
+//   thread, which may submit io from the inline callbacks.
+class io_uring_aio_provider : public aio_provider
+{
+public:
+    explicit io_uring_aio_provider(disk_engine *disk);
+    ~io_uring_aio_provider() override;
+
+    dsn_handle_t open(const char *file_name, int flag, int pmode) override;
+    error_code close(dsn_handle_t fh) override;
+    error_code flush(dsn_handle_t fh) override;
+    void submit_aio_task(aio_task *aio) override;
+    aio_context *prepare_aio_context(aio_task *tsk) override;
+
+    // The completion target of an sqe, passed through sqe->user_data.
+    struct completion
+    {
+        aio_task *tsk;            // nullptr for the synchronous operations, such as fsync
+        utils::notify_event *evt; // only for the synchronous operations
+        int res;
+    };
+
+    class io_uring_aio_context : public aio_context
+    {
+    public:
+        completion comp;
+        std::vector<struct iovec> iovs;
+        int fixed_buffer_index; // -1 if no fixed buffer is used
+
+        explicit io_uring_aio_context(aio_task *tsk) : fixed_buffer_index(-1)
+        {
+            comp.tsk = tsk;
+            comp.evt = nullptr;
+            comp.res = 0;
+        }
+    };
+
+private:
+    void get_event();
+    void complete_aio(completion *c, int res);
+
+    // Takes a slot of the in-flight io, returns false if there is none and the caller is the
+    // reaper thread, which must not wait for the slots released by itself.
+    bool acquire_inflight_slot();
+    void release_inflight_slots(unsigned count);
+
+    // Returns an sqe from the ring, or nullptr if the ring keeps full. _sq_lock must be held.
+    struct io_uring_sqe *get_sqe_locked();
+    // Submits the sqes to the kernel, retrying on the transient errors. _sq_lock must be held.
+    // The sqes are published even if it fails, and they are submitted with the next ones.
+    int submit_locked();
+    // Fails the aio task without submitting it.
+    void fail_aio(aio_task *tsk);
+    void prep_sqe(struct io_uring_sqe *sqe, io_uring_aio_context *aio, int fd, void *fixed_buf);
+    // Sets the file of the sqe, using the fixed file slot if the file is registered.
+    void set_sqe_file(struct io_uring_sqe *sqe, int fd);
+
+    int acquire_fixed_buffer(uint32_t size);
+    void release_fixed_buffer(int index);
+
+private:
+    struct io_uring _ring;
+    std::atomic<bool> _is_running{false};
+    std::thread _worker;
+
+    // io_uring doesn't support concurrent submitters
+    ::dsn::utils::ex_lock_nr_spin _sq_lock;
+
+    std::mutex _inflight_lock;
+    std::condition_variable _inflight_cond;
+    uint32_t _inflight_count{0};
+    // the limit for the normal submitters, the rest of the completion ring is left to the reaper
+    uint32_t _max_inflight{0};
+    uint32_t _cq_entries{0};
+
+    // fd -> fixed file slot
+    ::dsn::utils::rw_lock_nr _files_lock;
+    std::unordered_map<int, int> _fixed_files;
+    std::vector<int> _free_file_slots;
+
+    ::dsn::utils::ex_lock_nr_spin _buffers_lock;
+    std::vector<struct iovec> _fixed_buffers;
+    std::vector<int> _free_fixed_buffers;
+
+    perf_counter_wrapper _completion_batch_size;
+};
+
+} // namespace dsn
+
+#endif // DSN_HAVE_IO_URING
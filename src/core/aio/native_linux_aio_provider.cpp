@@ -28,20 +28,58 @@
 
 #include <fcntl.h>
 #include <cstdlib>
+#include <dsn/utility/flags.h>
 
 namespace dsn {
 
-native_linux_aio_provider::native_linux_aio_provider(disk_engine *disk) : aio_provider(disk)
+DSN_DEFINE_uint32("core",
+                  aio_queue_depth,
+                  128,
+                  "max concurrent io events of the native aio context");
+DSN_DEFINE_uint32("core",
+                  aio_reaper_thread_count,
+                  1,
+                  "how many threads are harvesting io completions of the native aio context");
+DSN_DEFINE_uint32("core",
+                  aio_max_completion_batch_size,
+                  1,
+                  "max io completions harvested by one io_getevents, 1 means no batching");
+DSN_DEFINE_uint32("core",
+                  aio_max_submit_batch_size,
+                  1,
+                  "max aio tasks coalesced into one io_submit, 1 means no batching");
+DSN_DEFINE_validator(aio_queue_depth, [](uint32_t value) -> bool { return value > 0; });
+DSN_DEFINE_validator(aio_reaper_thread_count, [](uint32_t value) -> bool { return value > 0; });
+DSN_DEFINE_validator(aio_max_completion_batch_size,
+                     [](uint32_t value) -> bool { return value > 0; });
+DSN_DEFINE_validator(aio_max_submit_batch_size, [](uint32_t value) -> bool { return value > 0; });
+
+native_linux_aio_provider::native_linux_aio_provider(disk_engine *disk)
+    : aio_provider(disk), _submitting(false)
 {
     memset(&_ctx, 0, sizeof(_ctx));
-    auto ret = io_setup(128, &_ctx); // 128 concurrent events
+    auto ret = io_setup(FLAGS_aio_queue_depth, &_ctx);
     dassert(ret == 0, "io_setup error, ret = %d", ret);
 
+    const char *node_name = ::dsn::tools::get_service_node_name(node());
+    _submit_batch_size.init_global_counter(node_name,
+                                           "engine",
+                                           "aio.submit.batch.size",
+                                           COUNTER_TYPE_NUMBER_PERCENTILES,
+                                           "aio tasks submitted per io_submit");
+    _completion_batch_size.init_global_counter(node_name,
+                                               "engine",
+                                               "aio.completion.batch.size",
+                                               COUNTER_TYPE_NUMBER_PERCENTILES,
+                                               "io events harvested per io_getevents");
+
     _is_running = true;
-    _worker = std::thread([this, disk]() {
-        task::set_tls_dsn_context(node(), nullptr);
-        get_event();
-    });
+    for (uint32_t i = 0; i < FLAGS_aio_reaper_thread_count; ++i) {
+        _workers.emplace_back([this, i]() {
+            task::set_tls_dsn_context(node(), nullptr);
+            get_event(static_cast<int>(i));
+        });
+    }
 }
 
 native_linux_aio_provider::~native_linux_aio_provider()
@@ -54,7 +92,9 @@ native_linux_aio_provider::~native_linux_aio_provider()
     auto ret = io_destroy(_ctx);
     dassert(ret == 0, "io_destroy error, ret = %d", ret);
 
-    _worker.join();
+    for (auto &worker : _workers) {
+        worker.join();
+    }
 }
 
 dsn_handle_t native_linux_aio_provider::open(const char *file_name, int flag, int pmode)
@@ -93,28 +133,34 @@ aio_context *native_linux_aio_provider::prepare_aio_context(aio_task *tsk)
 
 void native_linux_aio_provider::submit_aio_task(aio_task *aio_tsk) { aio_internal(aio_tsk, true); }
 
-void native_linux_aio_provider::get_event()
+void native_linux_aio_provider::get_event(int index)
 {
-    struct io_event events[1];
+    std::vector<struct io_event> events(FLAGS_aio_max_completion_batch_size);
     int ret;
 
     task::set_tls_dsn_context(node(), nullptr);
 
     const char *name = ::dsn::tools::get_service_node_name(node());
     char buffer[128];
-    sprintf(buffer, "%s.aio", name);
+    if (index == 0) {
+        sprintf(buffer, "%s.aio", name);
+    } else {
+        sprintf(buffer, "%s.aio.%d", name, index);
+    }
     task_worker::set_name(buffer);
 
     while (true) {
         if (dsn_unlikely(!_is_running.load(std::memory_order_relaxed))) {
             break;
         }
-        ret = io_getevents(_ctx, 1, 1, events, NULL);
-        if (ret > 0) // should be 1
-        {
-            dassert(ret == 1, "io_getevents returns %d", ret);
-            struct iocb *io = events[0].obj;
-            complete_aio(io, static_cast<int>(events[0].res), static_cast<int>(events[0].res2));
+        ret = io_getevents(_ctx, 1, static_cast<long>(events.size()), events.data(), NULL);
+        if (ret > 0) {
+            _completion_batch_size->set(ret);
+            for (int i = 0; i < ret; ++i) {
+                struct iocb *io = events[i].obj;
+                complete_aio(
+                    io, static_cast<int>(events[i].res), static_cast<int>(events[i].res2));
+            }
         } else {
             // on error it returns a negated error number (the negative of one of the values listed
             // in ERRORS
@@ -174,15 +220,20 @@ error_code native_linux_aio_provider::aio_internal(aio_task *aio_tsk,
                            aio->buffer_size,
                            aio->file_offset);
         } else {
+            // the iovecs must outlive this call because the iocb may be submitted later
+            // by another thread in batched mode
             int iovcnt = aio->write_buffer_vec->size();
-            struct iovec *iov = (struct iovec *)alloca(sizeof(struct iovec) * iovcnt);
+            aio->iovs.resize(iovcnt);
             for (int i = 0; i < iovcnt; i++) {
                 const dsn_file_buffer_t &buf = aio->write_buffer_vec->at(i);
-                iov[i].iov_base = buf.buffer;
-                iov[i].iov_len = buf.size;
+                aio->iovs[i].iov_base = buf.buffer;
+                aio->iovs[i].iov_len = buf.size;
             }
-            io_prep_pwritev(
-                &aio->cb, static_cast<int>((ssize_t)aio->file), iov, iovcnt, aio->file_offset);
+            io_prep_pwritev(&aio->cb,
+                            static_cast<int>((ssize_t)aio->file),
+                            aio->iovs.data(),
+                            iovcnt,
+                            aio->file_offset);
         }
         break;
     default:
@@ -195,8 +246,14 @@ error_code native_linux_aio_provider::aio_internal(aio_task *aio_tsk,
         aio->bytes = 0;
     }
 
+    if (async && FLAGS_aio_max_submit_batch_size > 1) {
+        submit_batched(&aio->cb);
+        return ERR_IO_PENDING;
+    }
+
     cbs[0] = &aio->cb;
     ret = io_submit(_ctx, 1, cbs);
+    _submit_batch_size->set(1);
 
     if (ret != 1) {
         if (ret < 0)
@@ -226,4 +283,59 @@ error_code native_linux_aio_provider::aio_internal(aio_task *aio_tsk,
     }
 }
 
+void native_linux_aio_provider::submit_batched(struct iocb *cb)
+{
+    {
+        utils::auto_lock<utils::ex_lock_nr_spin> l(_pending_lock);
+        _pending_iocbs.push_back(cb);
+        // someone else is submitting, it will pick up our iocb in its next round
+        if (_submitting) {
+            return;
+        }
+        _submitting = true;
+    }
+
+    std::vector<struct iocb *> batch;
+    batch.reserve(FLAGS_aio_max_submit_batch_size);
+    while (true) {
+        batch.clear();
+        {
+            utils::auto_lock<utils::ex_lock_nr_spin> l(_pending_lock);
+            if (_pending_iocbs.empty()) {
+                _submitting = false;
+                return;
+            }
+            size_t count =
+                std::min<size_t>(_pending_iocbs.size(), FLAGS_aio_max_submit_batch_size);
+            batch.assign(_pending_iocbs.begin(), _pending_iocbs.begin() + count);
+            _pending_iocbs.erase(_pending_iocbs.begin(), _pending_iocbs.begin() + count);
+        }
+        submit_iocbs(batch.data(), static_cast<int>(batch.size()));
+    }
+}
+
+void native_linux_aio_provider::submit_iocbs(struct iocb **cbs, int count)
+{
+    _submit_batch_size->set(count);
+
+    int submitted = 0;
+    while (submitted < count) {
+        int ret = io_submit(_ctx, count - submitted, cbs + submitted);
+        if (ret <= 0) {
+            if (ret < 0)
+                derror("io_submit error, ret = %d", ret);
+            else
+                derror("could not sumbit IOs, ret = %d", ret);
+            break;
+        }
+        submitted += ret;
+    }
+
+    // io_submit stops at the first iocb it fails to queue, fail all the remaining ones
+    for (int i = submitted; i < count; ++i) {
+        linux_disk_aio_context *aio = CONTAINING_RECORD(cbs[i], linux_disk_aio_context, cb);
+        complete_io(aio->tsk, ERR_FILE_OPERATION_FAILED, 0);
+    }
+}
+
 } // namespace dsn
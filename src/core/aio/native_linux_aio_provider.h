@@ -29,6 +29,7 @@
 #include "aio_provider.h"
 
 #include <dsn/tool_api.h>
+#include <dsn/perf_counter/perf_counter_wrapper.h>
 #include <dsn/utility/synchronize.h>
 #include <queue>
 #include <stdio.h>       /* for perror() */
@@ -56,6 +57,7 @@ public:
     {
     public:
         struct iocb cb;
+        std::vector<struct iovec> iovs;
         aio_task *tsk;
         native_linux_aio_provider *this_;
         utils::notify_event *evt;
@@ -71,12 +73,25 @@ public:
 protected:
     error_code aio_internal(aio_task *aio, bool async, /*out*/ uint32_t *pbytes = nullptr);
     void complete_aio(struct iocb *io, int bytes, int err);
-    void get_event();
+    void get_event(int index);
+
+    // Queues the iocb and submits it, together with all the iocbs queued by other threads
+    // meanwhile, in as few io_submit calls as possible.
+    void submit_batched(struct iocb *cb);
+    // Submits cbs[0, count) and fails the ones which can not be submitted.
+    void submit_iocbs(struct iocb **cbs, int count);
 
 private:
     io_context_t _ctx;
     std::atomic<bool> _is_running{false};
-    std::thread _worker;
+    std::vector<std::thread> _workers;
+
+    ::dsn::utils::ex_lock_nr_spin _pending_lock;
+    std::vector<struct iocb *> _pending_iocbs; // protected by _pending_lock
+    bool _submitting;                          // protected by _pending_lock
+
+    perf_counter_wrapper _submit_batch_size;
+    perf_counter_wrapper _completion_batch_size;
 };
 
 } // namespace dsn
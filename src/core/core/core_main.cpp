@@ -42,6 +42,7 @@
 #include <dsn/toollet/profiler.h>
 #include <dsn/toollet/fault_injector.h>
 #include <dsn/toollet/explorer.h>
+#include <dsn/toollet/trace_recorder.h>
 
 #include <dsn/tool/providers.common.h>
 #include <dsn/utility/singleton.h>
@@ -58,6 +59,7 @@ void dsn_core_init()
     dsn::tools::register_toollet<dsn::tools::profiler>("profiler");
     dsn::tools::register_toollet<dsn::tools::fault_injector>("fault_injector");
     dsn::tools::register_toollet<dsn::tools::explorer>("explorer");
+    dsn::tools::register_toollet<dsn::tools::trace_recorder>("trace_recorder");
 }
 
 #if defined(__linux__)
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+namespace dsn {
+namespace utils {
+namespace crc_internal {
+
+// All the crc engines behind dsn::utils::crc32_calc / crc64_calc. They produce identical results,
+// the fastest one supported by the running cpu is picked once at the first call. Exposed for
+// testing and benchmarking only.
+
+uint32_t crc32_calc_bytewise(const void *ptr, size_t size, uint32_t init_crc);
+uint32_t crc32_calc_slicing8(const void *ptr, size_t size, uint32_t init_crc);
+
+// Fall back to slicing-by-8 on non-x86 platforms, check the *_supported() before calling.
+uint32_t crc32_calc_sse42(const void *ptr, size_t size, uint32_t init_crc);
+uint32_t crc32_calc_pclmul(const void *ptr, size_t size, uint32_t init_crc);
+bool crc32_sse42_supported();
+bool crc32_pclmul_supported();
+
+uint64_t crc64_calc_bytewise(const void *ptr, size_t size, uint64_t init_crc);
+uint64_t crc64_calc_slicing8(const void *ptr, size_t size, uint64_t init_crc);
+
+// Name of the engine used by crc32_calc, e.g. "pclmul".
+const char *crc32_engine_name();
+
+} // namespace crc_internal
+} // namespace utils
+} // namespace dsn
@@ -0,0 +1,269 @@
+// Copyright (c) 2019, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#include <atomic>
+#include <cstdlib>
+#include <vector>
+
+#include <dsn/c/api_utilities.h>
+#include <dsn/utility/object_pool.h>
+#include <dsn/utility/synchronize.h>
+
+namespace dsn {
+
+#ifndef DSN_OBJECT_POOL_DISABLED
+
+namespace {
+
+static const size_t CLASS_GRANULARITY = 16;
+static const size_t CLASS_COUNT = 64;
+static const size_t MAX_POOLED_BYTES = CLASS_GRANULARITY * CLASS_COUNT;
+static const size_t SLAB_BYTES = 64 * 1024;
+static const uint32_t MALLOC_CLASS = 0xffffffff;
+static const uint32_t PIECE_MAGIC = 0xdeadbeef;
+
+struct thread_cache;
+
+// keeps the object behind it aligned as malloc does
+struct piece_header
+{
+    thread_cache *owner;
+    uint32_t size_class;
+    uint32_t magic;
+};
+static_assert(sizeof(piece_header) == 16, "piece_header should keep 16-byte alignment");
+
+// a free piece reuses its object area as the link
+struct free_piece
+{
+    free_piece *next;
+};
+
+struct thread_cache
+{
+    thread_cache()
+    {
+        for (size_t i = 0; i < CLASS_COUNT; ++i) {
+            local[i] = nullptr;
+            remote[i].store(nullptr, std::memory_order_relaxed);
+        }
+        hit_count.store(0, std::memory_order_relaxed);
+        miss_count.store(0, std::memory_order_relaxed);
+        resident_bytes.store(0, std::memory_order_relaxed);
+    }
+
+    // only touched by the owner thread
+    free_piece *local[CLASS_COUNT];
+    // written by the owner only, read by object_pool_get_stats
+    std::atomic<uint64_t> hit_count;
+    std::atomic<uint64_t> miss_count;
+    std::atomic<uint64_t> resident_bytes;
+
+    // keep the lists pushed by other threads off the cache lines of the owner
+    char padding[64];
+    std::atomic<free_piece *> remote[CLASS_COUNT];
+};
+
+struct pool_registry
+{
+    utils::ex_lock_nr lock;
+    std::vector<thread_cache *> caches;
+    // caches of exited threads, waiting for adoption
+    std::vector<thread_cache *> orphans;
+};
+
+// leaked on purpose, as objects may be freed during static destruction
+static pool_registry &registry()
+{
+    static pool_registry *r = new pool_registry();
+    return *r;
+}
+
+static bool s_pool_enabled = true;
+
+static thread_local thread_cache *tls_cache = nullptr;
+static thread_local bool tls_cache_released = false;
+
+struct cache_releaser
+{
+    ~cache_releaser()
+    {
+        if (tls_cache != nullptr) {
+            pool_registry &r = registry();
+            utils::auto_lock<utils::ex_lock_nr> l(r.lock);
+            r.orphans.push_back(tls_cache);
+        }
+        tls_cache = nullptr;
+        tls_cache_released = true;
+    }
+};
+static thread_local cache_releaser tls_releaser;
+
+// returns nullptr if the thread is exiting
+static thread_cache *get_thread_cache()
+{
+    if (tls_cache != nullptr) {
+        return tls_cache;
+    }
+    if (tls_cache_released) {
+        return nullptr;
+    }
+
+    thread_cache *c = nullptr;
+    {
+        pool_registry &r = registry();
+        utils::auto_lock<utils::ex_lock_nr> l(r.lock);
+        if (!r.orphans.empty()) {
+            c = r.orphans.back();
+            r.orphans.pop_back();
+        } else {
+            c = new thread_cache();
+            r.caches.push_back(c);
+        }
+    }
+    tls_cache = c;
+    // odr-use the releaser so that it will be destructed on thread exit
+    (void)&tls_releaser;
+    return c;
+}
+
+static inline void counter_inc(std::atomic<uint64_t> &counter)
+{
+    counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+static inline void *piece_object(piece_header *h) { return h + 1; }
+
+static void *malloc_piece(size_t sz)
+{
+    piece_header *h = static_cast<piece_header *>(::malloc(sizeof(piece_header) + sz));
+    h->owner = nullptr;
+    h->size_class = MALLOC_CLASS;
+    h->magic = PIECE_MAGIC;
+    return piece_object(h);
+}
+
+// carve a new slab into pieces of the size class, keep the first one and put the others into
+// the local list
+static void *refill(thread_cache *c, uint32_t size_class)
+{
+    size_t stride = sizeof(piece_header) + (size_class + 1) * CLASS_GRANULARITY;
+    size_t count = SLAB_BYTES / stride;
+    char *slab = static_cast<char *>(::malloc(stride * count));
+    c->resident_bytes.store(c->resident_bytes.load(std::memory_order_relaxed) + stride * count,
+                            std::memory_order_relaxed);
+
+    for (size_t i = 0; i < count; ++i) {
+        piece_header *h = reinterpret_cast<piece_header *>(slab + i * stride);
+        h->owner = c;
+        h->size_class = size_class;
+        h->magic = PIECE_MAGIC;
+    }
+    for (size_t i = count - 1; i > 0; --i) {
+        free_piece *p = static_cast<free_piece *>(
+            piece_object(reinterpret_cast<piece_header *>(slab + i * stride)));
+        p->next = c->local[size_class];
+        c->local[size_class] = p;
+    }
+    return piece_object(reinterpret_cast<piece_header *>(slab));
+}
+
+} // anonymous namespace
+
+void object_pool_init(bool enabled) { s_pool_enabled = enabled; }
+
+void *object_pool_malloc(size_t sz)
+{
+    if (!s_pool_enabled || sz > MAX_POOLED_BYTES) {
+        return malloc_piece(sz);
+    }
+    thread_cache *c = get_thread_cache();
+    if (c == nullptr) {
+        return malloc_piece(sz);
+    }
+
+    uint32_t size_class = sz == 0 ? 0 : static_cast<uint32_t>((sz - 1) / CLASS_GRANULARITY);
+    free_piece *p = c->local[size_class];
+    if (p == nullptr) {
+        // take back all the pieces freed by other threads at once
+        p = c->remote[size_class].exchange(nullptr, std::memory_order_acquire);
+    }
+    if (p != nullptr) {
+        c->local[size_class] = p->next;
+        counter_inc(c->hit_count);
+        return p;
+    }
+
+    counter_inc(c->miss_count);
+    return refill(c, size_class);
+}
+
+void object_pool_free(void *ptr)
+{
+    if (ptr == nullptr) {
+        return;
+    }
+    piece_header *h = static_cast<piece_header *>(ptr) - 1;
+    dassert(h->magic == PIECE_MAGIC, "invalid object pool piece %p", ptr);
+
+    if (h->size_class == MALLOC_CLASS) {
+        ::free(h);
+        return;
+    }
+
+    free_piece *p = static_cast<free_piece *>(ptr);
+    thread_cache *owner = h->owner;
+    if (owner == tls_cache) {
+        p->next = owner->local[h->size_class];
+        owner->local[h->size_class] = p;
+        return;
+    }
+
+    std::atomic<free_piece *> &head = owner->remote[h->size_class];
+    p->next = head.load(std::memory_order_relaxed);
+    while (!head.compare_exchange_weak(
+        p->next, p, std::memory_order_release, std::memory_order_relaxed)) {
+    }
+}
+
+object_pool_stats object_pool_get_stats()
+{
+    object_pool_stats stats = {0, 0, 0};
+    pool_registry &r = registry();
+    utils::auto_lock<utils::ex_lock_nr> l(r.lock);
+    for (thread_cache *c : r.caches) {
+        stats.hit_count += c->hit_count.load(std::memory_order_relaxed);
+        stats.miss_count += c->miss_count.load(std::memory_order_relaxed);
+        stats.resident_bytes += c->resident_bytes.load(std::memory_order_relaxed);
+    }
+    return stats;
+}
+
+object_pool_stats object_pool_get_thread_stats()
+{
+    object_pool_stats stats = {0, 0, 0};
+    thread_cache *c = tls_cache;
+    if (c != nullptr) {
+        stats.hit_count = c->hit_count.load(std::memory_order_relaxed);
+        stats.miss_count = c->miss_count.load(std::memory_order_relaxed);
+        stats.resident_bytes = c->resident_bytes.load(std::memory_order_relaxed);
+    }
+    return stats;
+}
+
+#else // DSN_OBJECT_POOL_DISABLED
+
+void object_pool_init(bool enabled) {}
+
+void *object_pool_malloc(size_t sz) { return ::malloc(sz); }
+
+void object_pool_free(void *ptr) { ::free(ptr); }
+
+object_pool_stats object_pool_get_stats() { return object_pool_stats{0, 0, 0}; }
+
+object_pool_stats object_pool_get_thread_stats() { return object_pool_stats{0, 0, 0}; }
+
+#endif // DSN_OBJECT_POOL_DISABLED
+
+} // namespace dsn
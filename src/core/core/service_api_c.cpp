@@ -29,6 +29,7 @@
 #include <dsn/cpp/serialization.h>
 #include <dsn/utility/filesystem.h>
 #include <dsn/utility/process_utils.h>
+#include <dsn/utility/object_pool.h>
 #include <dsn/utility/flags.h>
 #include <dsn/tool-api/command_manager.h>
 #include <fstream>
@@ -375,6 +376,14 @@ bool run(const char *config_file,
         "thread local transient memory buffer size (KB), default is 1024");
     ::dsn::tls_trans_mem_init(tls_trans_memory_KB * 1024);
 
+    bool object_pool_enabled = dsn_config_get_value_bool(
+        "core",
+        "object_pool_enabled",
+        true,
+        "whether to allocate tasks and messages from the thread local object pool, "
+        "disable it to use plain malloc, e.g. in memory-checking runs");
+    ::dsn::object_pool_init(object_pool_enabled);
+
 #ifdef DSN_ENABLE_GPERF
     double_t tcmalloc_release_rate =
         (double_t)dsn_config_get_value_double("core",
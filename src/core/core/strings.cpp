@@ -168,7 +168,7 @@ std::string string_md5(const char *buffer, unsigned length)
         int block = length - offset;
         if (block > 4096)
             block = 4096;
-        MD5_Update(&c, buffer, block);
+        MD5_Update(&c, buffer + offset, block);
         offset += block;
     }
     MD5_Final(out, &c);
@@ -183,5 +183,28 @@ std::string string_md5(const char *buffer, unsigned length)
 
     return result;
 }
+
+md5_hasher::md5_hasher() : _ctx(new MD5_CTX()) { MD5_Init(_ctx.get()); }
+
+md5_hasher::~md5_hasher() = default;
+
+void md5_hasher::update(const char *buffer, size_t length)
+{
+    if (length > 0) {
+        MD5_Update(_ctx.get(), buffer, length);
+    }
+}
+
+std::string md5_hasher::finalize()
+{
+    unsigned char out[MD5_DIGEST_LENGTH];
+    MD5_Final(out, _ctx.get());
+
+    char str[MD5_DIGEST_LENGTH * 2 + 1];
+    str[MD5_DIGEST_LENGTH * 2] = 0;
+    for (int n = 0; n < MD5_DIGEST_LENGTH; n++)
+        sprintf(str + n + n, "%02x", out[n]);
+    return std::string(str);
+}
 }
 }
@@ -3,12 +3,13 @@
 // can be found in the LICENSE file in the root directory of this source tree.
 
 #include <dsn/utility/utils.h>
+#include <dsn/utility/object_pool.h>
 #include <dsn/c/api_utilities.h>
 #include "builtin_counters.h"
 
 namespace dsn {
 
-builtin_counters::builtin_counters()
+builtin_counters::builtin_counters() : _last_pool_hit_count(0), _last_pool_miss_count(0)
 {
     _memused_virt.init_global_counter("replica",
                                       "server",
@@ -20,6 +21,17 @@ builtin_counters::builtin_counters()
                                      "memused.res(MB)",
                                      COUNTER_TYPE_NUMBER,
                                      "physically memory usages in MB");
+    _object_pool_hit_ratio.init_global_counter(
+        "replica",
+        "server",
+        "object_pool.hit.ratio(%)",
+        COUNTER_TYPE_NUMBER,
+        "hit ratio of the object pool free lists since the last update");
+    _object_pool_resident.init_global_counter("replica",
+                                              "server",
+                                              "object_pool.resident(KB)",
+                                              COUNTER_TYPE_NUMBER,
+                                              "memory held by the object pool slabs in KB");
 }
 
 builtin_counters::~builtin_counters() {}
@@ -34,5 +46,13 @@ void builtin_counters::update_counters()
     _memused_virt->set(memused_virt);
     _memused_res->set(memused_res);
     ddebug("memused_virt = %" PRIu64 " MB, memused_res = %" PRIu64 "MB", memused_virt, memused_res);
+
+    object_pool_stats stats = object_pool_get_stats();
+    uint64_t hits = stats.hit_count - _last_pool_hit_count;
+    uint64_t total = hits + stats.miss_count - _last_pool_miss_count;
+    _last_pool_hit_count = stats.hit_count;
+    _last_pool_miss_count = stats.miss_count;
+    _object_pool_hit_ratio->set(total == 0 ? 100 : hits * 100 / total);
+    _object_pool_resident->set(stats.resident_bytes / 1024);
 }
 }
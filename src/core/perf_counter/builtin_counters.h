@@ -15,5 +15,10 @@ public:
 private:
     dsn::perf_counter_wrapper _memused_virt;
     dsn::perf_counter_wrapper _memused_res;
+    dsn::perf_counter_wrapper _object_pool_hit_ratio;
+    dsn::perf_counter_wrapper _object_pool_resident;
+
+    uint64_t _last_pool_hit_count;
+    uint64_t _last_pool_miss_count;
 };
 }
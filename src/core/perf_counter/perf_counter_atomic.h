@@ -2,7 +2,9 @@
 // This source code is licensed under the Apache License Version 2.0, which
 // can be found in the LICENSE file in the root directory of this source tree.
 
+#include <algorithm>
 #include <atomic>
+#include <memory>
 #include <boost/make_shared.hpp>
 #include <dsn/utility/utils.h>
 #include <dsn/utility/config_api.h>
@@ -13,12 +15,32 @@
 
 namespace dsn {
 
+// the values of NUMBER, VOLATILE_NUMBER and RATE counters are spread over the slots, each of
+// which takes a whole cache line, so that the threads updating a counter don't false-share
+#define COUNTER_SLOTS 16
+#define CACHELINE_SIZE 64
+
+struct counter_slot
+{
+    std::atomic<int64_t> val;
+    char padding[CACHELINE_SIZE - sizeof(std::atomic<int64_t>)];
+};
+
+// the slot of the current thread, which is assigned in round-robin when the thread updates any
+// counter for the first time, so that the first COUNTER_SLOTS threads never share a slot
+inline int current_counter_slot()
+{
+    static std::atomic<int> next_slot(0);
+    static thread_local int slot =
+        next_slot.fetch_add(1, std::memory_order_relaxed) % COUNTER_SLOTS;
+    return slot;
+}
+
 #pragma pack(push)
 #pragma pack(8)
 
 // -----------   NUMBER perf counter ---------------------------------
 
-#define DIVIDE_CONTAINER 107
 class perf_counter_number_atomic : public perf_counter
 {
 public:
@@ -29,49 +51,46 @@ public:
                                const char *dsptr)
         : perf_counter(app, section, name, type, dsptr)
     {
-        for (int i = 0; i < DIVIDE_CONTAINER; i++) {
-            _val[i].store(0);
+        for (int i = 0; i < COUNTER_SLOTS; i++) {
+            _val[i].val.store(0);
         }
     }
     ~perf_counter_number_atomic(void) {}
 
     virtual void increment()
     {
-        uint64_t task_id = static_cast<int>(utils::get_current_tid());
-        _val[task_id % DIVIDE_CONTAINER].fetch_add(1, std::memory_order_relaxed);
+        _val[current_counter_slot()].val.fetch_add(1, std::memory_order_relaxed);
     }
     virtual void decrement()
     {
-        uint64_t task_id = static_cast<int>(utils::get_current_tid());
-        _val[task_id % DIVIDE_CONTAINER].fetch_sub(1, std::memory_order_relaxed);
+        _val[current_counter_slot()].val.fetch_sub(1, std::memory_order_relaxed);
     }
     virtual void add(int64_t val)
     {
-        uint64_t task_id = static_cast<int>(utils::get_current_tid());
-        _val[task_id % DIVIDE_CONTAINER].fetch_add(val, std::memory_order_relaxed);
+        _val[current_counter_slot()].val.fetch_add(val, std::memory_order_relaxed);
     }
     virtual void set(int64_t val)
     {
         // the set-op of number is reset the number to zero.
         // for simplicity, only set other zero, not add the lock to protect, if needed, should add
         // lock.
-        for (int i = 0; i < DIVIDE_CONTAINER; i++)
-            _val[i].store(0, std::memory_order_relaxed);
-        _val[0].store(val, std::memory_order_relaxed);
+        for (int i = 0; i < COUNTER_SLOTS; i++)
+            _val[i].val.store(0, std::memory_order_relaxed);
+        _val[0].val.store(val, std::memory_order_relaxed);
     }
     virtual double get_value()
     {
         double val = 0;
-        for (int i = 0; i < DIVIDE_CONTAINER; i++) {
-            val += static_cast<double>(_val[i].load(std::memory_order_relaxed));
+        for (int i = 0; i < COUNTER_SLOTS; i++) {
+            val += static_cast<double>(_val[i].val.load(std::memory_order_relaxed));
         }
         return val;
     }
     virtual int64_t get_integer_value()
     {
         int64_t val = 0;
-        for (int i = 0; i < DIVIDE_CONTAINER; i++) {
-            val += _val[i].load(std::memory_order_relaxed);
+        for (int i = 0; i < COUNTER_SLOTS; i++) {
+            val += _val[i].val.load(std::memory_order_relaxed);
         }
         return val;
     }
@@ -82,11 +101,13 @@ public:
     }
 
 protected:
-    std::atomic<int64_t> _val[DIVIDE_CONTAINER];
+    counter_slot _val[COUNTER_SLOTS];
 };
 
 // -----------   VOLATILE_NUMBER perf counter ---------------------------------
 
+// the values are accumulated without reset, and get_value returns the increment since last
+// get_value, so reading the cumulative value has no side effect
 class perf_counter_volatile_number_atomic : public perf_counter_number_atomic
 {
 public:
@@ -95,27 +116,36 @@ public:
                                         const char *name,
                                         dsn_perf_counter_type_t type,
                                         const char *dsptr)
-        : perf_counter_number_atomic(app, section, name, type, dsptr)
+        : perf_counter_number_atomic(app, section, name, type, dsptr), _last_total(0)
     {
     }
     ~perf_counter_volatile_number_atomic(void) {}
 
-    virtual double get_value()
+    virtual void set(int64_t val)
     {
-        double val = 0;
-        for (int i = 0; i < DIVIDE_CONTAINER; i++) {
-            val += static_cast<double>(_val[i].exchange(0, std::memory_order_relaxed));
+        // the increment got by next get_value is val, while the cumulative value never goes
+        // backwards: the pending increments are topped up to val, or partly skipped by get_value
+        int64_t total = get_cumulative_value();
+        int64_t pending = total - _last_total.load(std::memory_order_relaxed);
+        if (val >= pending) {
+            perf_counter_number_atomic::add(val - pending);
+        } else {
+            _last_total.store(total - val, std::memory_order_relaxed);
         }
-        return val;
     }
+    virtual double get_value() { return static_cast<double>(get_integer_value()); }
     virtual int64_t get_integer_value()
     {
-        int64_t val = 0;
-        for (int i = 0; i < DIVIDE_CONTAINER; i++) {
-            val += _val[i].exchange(0, std::memory_order_relaxed);
-        }
-        return val;
+        int64_t total = get_cumulative_value();
+        return total - _last_total.exchange(total, std::memory_order_relaxed);
     }
+    virtual int64_t get_cumulative_value()
+    {
+        return perf_counter_number_atomic::get_integer_value();
+    }
+
+private:
+    std::atomic<int64_t> _last_total;
 };
 
 // -----------   RATE perf counter ---------------------------------
@@ -128,31 +158,30 @@ public:
                              const char *name,
                              dsn_perf_counter_type_t type,
                              const char *dsptr)
-        : perf_counter(app, section, name, type, dsptr), _rate(0)
+        : perf_counter(app, section, name, type, dsptr), _rate(0), _last_total(0)
     {
         _last_time = utils::get_current_physical_time_ns();
-        for (int i = 0; i < DIVIDE_CONTAINER; i++) {
-            _val[i].store(0, std::memory_order_relaxed);
+        for (int i = 0; i < COUNTER_SLOTS; i++) {
+            _val[i].val.store(0, std::memory_order_relaxed);
         }
     }
     ~perf_counter_rate_atomic(void) {}
 
     virtual void increment()
     {
-        uint64_t task_id = static_cast<int>(utils::get_current_tid());
-        _val[task_id % DIVIDE_CONTAINER].fetch_add(1, std::memory_order_relaxed);
+        _val[current_counter_slot()].val.fetch_add(1, std::memory_order_relaxed);
     }
     virtual void decrement()
     {
-        uint64_t task_id = static_cast<int>(utils::get_current_tid());
-        _val[task_id % DIVIDE_CONTAINER].fetch_sub(1, std::memory_order_relaxed);
+        _val[current_counter_slot()].val.fetch_sub(1, std::memory_order_relaxed);
     }
     virtual void add(int64_t val)
     {
-        uint64_t task_id = static_cast<int>(utils::get_current_tid());
-        _val[task_id % DIVIDE_CONTAINER].fetch_add(val, std::memory_order_relaxed);
+        _val[current_counter_slot()].val.fetch_add(val, std::memory_order_relaxed);
     }
     virtual void set(int64_t val) { dassert(false, "invalid execution flow"); }
+    // the rate since last get_value, the values are accumulated without reset, so that the
+    // collectors can derive the rate from get_cumulative_value without affecting each other
     virtual double get_value()
     {
         uint64_t now = utils::get_current_physical_time_ns();
@@ -160,16 +189,20 @@ public:
         if (interval <= 0.1)
             return _rate;
 
-        double val = 0;
-        for (int i = 0; i < DIVIDE_CONTAINER; i++) {
-            val += _val[i].fetch_and(0, std::memory_order_relaxed);
-        }
-
-        _rate = val / interval;
+        int64_t total = get_cumulative_value();
+        _rate = (total - _last_total.exchange(total, std::memory_order_relaxed)) / interval;
         _last_time = now;
         return _rate;
     }
     virtual int64_t get_integer_value() { return (int64_t)get_value(); }
+    virtual int64_t get_cumulative_value()
+    {
+        int64_t val = 0;
+        for (int i = 0; i < COUNTER_SLOTS; i++) {
+            val += _val[i].val.load(std::memory_order_relaxed);
+        }
+        return val;
+    }
     virtual double get_percentile(dsn_perf_counter_percentile_type_t type)
     {
         dassert(false, "invalid execution flow");
@@ -179,7 +212,8 @@ public:
 private:
     std::atomic<double> _rate;
     std::atomic<uint64_t> _last_time;
-    std::atomic<int64_t> _val[DIVIDE_CONTAINER];
+    std::atomic<int64_t> _last_total;
+    counter_slot _val[COUNTER_SLOTS];
 };
 
 // -----------   NUMBER_PERCENTILE perf counter ---------------------------------
@@ -436,5 +470,248 @@ private:
     int _counter_computation_interval_seconds;
 };
 
+// -----------   NUMBER_PERCENTILE perf counter backed by histogram -------------------------
+
+// The values are counted in a log-linear histogram: the values less than HISTOGRAM_SUB_BUCKETS
+// have a bucket for each, and every power-of-two range above is split into HISTOGRAM_SUB_BUCKETS
+// linear buckets, so the relative error of a percentile is bounded by 1/HISTOGRAM_SUB_BUCKETS.
+// The values not less than 2^HISTOGRAM_MAX_VALUE_BITS are counted in the last bucket.
+#define HISTOGRAM_SUB_BUCKET_BITS 4
+#define HISTOGRAM_SUB_BUCKETS (1 << HISTOGRAM_SUB_BUCKET_BITS)
+#define HISTOGRAM_MAX_VALUE_BITS 48
+#define HISTOGRAM_BUCKETS                                                                          \
+    ((HISTOGRAM_MAX_VALUE_BITS - HISTOGRAM_SUB_BUCKET_BITS + 1) * HISTOGRAM_SUB_BUCKETS)
+#define HISTOGRAM_SHARDS 8
+
+class perf_counter_number_histogram_atomic : public perf_counter
+{
+public:
+    perf_counter_number_histogram_atomic(const char *app,
+                                         const char *section,
+                                         const char *name,
+                                         dsn_perf_counter_type_t type,
+                                         const char *dsptr)
+        : perf_counter(app, section, name, type, dsptr), _last_value(0)
+    {
+        for (int i = 0; i < HISTOGRAM_SHARDS; i++) {
+            _shards[i].store(nullptr);
+        }
+        for (int i = 0; i < COUNTER_PERCENTILE_COUNT; i++) {
+            _results[i].store(0);
+        }
+
+        _counter_computation_interval_seconds = (int)dsn_config_get_value_uint64(
+            "components.pegasus_perf_counter_number_percentile_atomic",
+            "counter_computation_interval_seconds",
+            10,
+            "period (seconds) the system computes the percentiles of the "
+            "pegasus_perf_counter_number_percentile_atomic counters");
+        _timer.reset(new boost::asio::deadline_timer(tools::shared_io_service::instance().ios));
+        _timer->expires_from_now(
+            boost::posix_time::seconds(rand() % _counter_computation_interval_seconds + 1));
+        _timer->async_wait(std::bind(
+            &perf_counter_number_histogram_atomic::on_timer, this, _timer, std::placeholders::_1));
+    }
+
+    ~perf_counter_number_histogram_atomic(void)
+    {
+        _timer->cancel();
+        for (int i = 0; i < HISTOGRAM_SHARDS; i++) {
+            delete _shards[i].load();
+        }
+    }
+
+    virtual void increment() { dassert(false, "invalid execution flow"); }
+    virtual void decrement() { dassert(false, "invalid execution flow"); }
+    virtual void add(int64_t val) { dassert(false, "invalid execution flow"); }
+    virtual void set(int64_t val)
+    {
+        histogram_shard *shard = get_shard();
+        shard->buckets[bucket_index(val)].fetch_add(1, std::memory_order_relaxed);
+        shard->sum.fetch_add(val, std::memory_order_relaxed);
+        _last_value.store(val, std::memory_order_relaxed);
+    }
+
+    virtual double get_value()
+    {
+        dassert(false, "invalid execution flow");
+        return 0.0;
+    }
+    virtual int64_t get_integer_value() { return (int64_t)get_value(); }
+
+    // the percentiles of the values set in the latest computation interval which has values
+    virtual double get_percentile(dsn_perf_counter_percentile_type_t type)
+    {
+        if ((type < 0) || (type >= COUNTER_PERCENTILE_COUNT)) {
+            dassert(false, "send a wrong counter percentile type");
+            return 0.0;
+        }
+        return (double)_results[type].load(std::memory_order_relaxed);
+    }
+
+    virtual int64_t get_latest_sample() const override
+    {
+        return _last_value.load(std::memory_order_relaxed);
+    }
+
+    virtual bool get_histogram(/*out*/ std::vector<histogram_bucket> &buckets,
+                               /*out*/ int64_t &sum) const override
+    {
+        uint64_t counts[HISTOGRAM_BUCKETS];
+        merge_shards(counts, sum);
+
+        buckets.clear();
+        for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+            if (counts[i] != 0) {
+                buckets.push_back(histogram_bucket{
+                    bucket_lower_bound(i), bucket_lower_bound(i) + bucket_width(i) - 1, counts[i]});
+            }
+        }
+        return true;
+    }
+
+    // compute the percentiles of the values set since last computation, it's called by the
+    // timer periodically
+    void calc()
+    {
+        uint64_t counts[HISTOGRAM_BUCKETS];
+        int64_t sum;
+        if (!merge_shards(counts, sum)) {
+            return;
+        }
+
+        if (_last_counts == nullptr) {
+            _last_counts.reset(new uint64_t[HISTOGRAM_BUCKETS]());
+        }
+        uint64_t num = 0;
+        for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+            std::swap(counts[i], _last_counts[i]);
+            counts[i] = _last_counts[i] - counts[i];
+            num += counts[i];
+        }
+        if (num == 0) {
+            return;
+        }
+
+        // the ranks of the percentiles are the same as perf_counter_number_percentile_atomic
+        static const double percentiles[COUNTER_PERCENTILE_COUNT] = {0.5, 0.9, 0.95, 0.99, 0.999};
+        int type = 0;
+        uint64_t accumulated = 0;
+        for (int i = 0; i < HISTOGRAM_BUCKETS && type < COUNTER_PERCENTILE_COUNT; i++) {
+            accumulated += counts[i];
+            while (type < COUNTER_PERCENTILE_COUNT &&
+                   accumulated >= (uint64_t)(num * percentiles[type]) + 1) {
+                _results[type].store(bucket_lower_bound(i) + bucket_width(i) / 2,
+                                     std::memory_order_relaxed);
+                type++;
+            }
+        }
+    }
+
+    static int bucket_index(int64_t val)
+    {
+        if (val < HISTOGRAM_SUB_BUCKETS) {
+            return val < 0 ? 0 : (int)val;
+        }
+        int highest_bit = 63 - __builtin_clzll((uint64_t)val);
+        if (highest_bit >= HISTOGRAM_MAX_VALUE_BITS) {
+            return HISTOGRAM_BUCKETS - 1;
+        }
+        int shift = highest_bit - HISTOGRAM_SUB_BUCKET_BITS;
+        return (shift + 1) * HISTOGRAM_SUB_BUCKETS + (int)(val >> shift) - HISTOGRAM_SUB_BUCKETS;
+    }
+
+    static int64_t bucket_lower_bound(int index)
+    {
+        if (index < HISTOGRAM_SUB_BUCKETS) {
+            return index;
+        }
+        int shift = index / HISTOGRAM_SUB_BUCKETS - 1;
+        return (int64_t)(HISTOGRAM_SUB_BUCKETS + index % HISTOGRAM_SUB_BUCKETS) << shift;
+    }
+
+    static int64_t bucket_width(int index)
+    {
+        if (index < HISTOGRAM_SUB_BUCKETS) {
+            return 1;
+        }
+        return (int64_t)1 << (index / HISTOGRAM_SUB_BUCKETS - 1);
+    }
+
+private:
+    struct histogram_shard
+    {
+        std::atomic<uint64_t> buckets[HISTOGRAM_BUCKETS];
+        std::atomic<int64_t> sum;
+
+        histogram_shard() : sum(0)
+        {
+            for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+                buckets[i].store(0, std::memory_order_relaxed);
+            }
+        }
+    };
+
+    // the shards are allocated on first use, so the counters never set cost little memory
+    histogram_shard *get_shard()
+    {
+        std::atomic<histogram_shard *> &slot = _shards[current_counter_slot() % HISTOGRAM_SHARDS];
+        histogram_shard *shard = slot.load(std::memory_order_acquire);
+        if (dsn_unlikely(shard == nullptr)) {
+            histogram_shard *new_shard = new histogram_shard();
+            if (slot.compare_exchange_strong(shard, new_shard, std::memory_order_acq_rel)) {
+                shard = new_shard;
+            } else {
+                delete new_shard;
+            }
+        }
+        return shard;
+    }
+
+    // return false if no value is ever set
+    bool merge_shards(/*out*/ uint64_t *counts, /*out*/ int64_t &sum) const
+    {
+        bool has_shard = false;
+        sum = 0;
+        std::fill(counts, counts + HISTOGRAM_BUCKETS, 0);
+        for (int i = 0; i < HISTOGRAM_SHARDS; i++) {
+            histogram_shard *shard = _shards[i].load(std::memory_order_acquire);
+            if (shard != nullptr) {
+                has_shard = true;
+                for (int j = 0; j < HISTOGRAM_BUCKETS; j++) {
+                    counts[j] += shard->buckets[j].load(std::memory_order_relaxed);
+                }
+                sum += shard->sum.load(std::memory_order_relaxed);
+            }
+        }
+        return has_shard;
+    }
+
+    void on_timer(std::shared_ptr<boost::asio::deadline_timer> timer,
+                  const boost::system::error_code &ec)
+    {
+        if (!ec) {
+            calc();
+
+            timer->expires_from_now(
+                boost::posix_time::seconds(_counter_computation_interval_seconds));
+            timer->async_wait(std::bind(&perf_counter_number_histogram_atomic::on_timer,
+                                        this,
+                                        timer,
+                                        std::placeholders::_1));
+        } else if (boost::system::errc::operation_canceled != ec) {
+            dassert(false, "on_timer error!!!");
+        }
+    }
+
+    std::shared_ptr<boost::asio::deadline_timer> _timer;
+    std::atomic<histogram_shard *> _shards[HISTOGRAM_SHARDS];
+    // the merged counts when the percentiles are computed last time
+    std::unique_ptr<uint64_t[]> _last_counts;
+    std::atomic<int64_t> _results[COUNTER_PERCENTILE_COUNT];
+    std::atomic<int64_t> _last_value;
+    int _counter_computation_interval_seconds;
+};
+
 #pragma pack(pop)
 } // namespace
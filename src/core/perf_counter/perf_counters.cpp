@@ -35,6 +35,7 @@
 
 #include <dsn/tool-api/command_manager.h>
 #include <dsn/tool-api/task.h>
+#include <dsn/utility/flags.h>
 #include <dsn/utility/string_view.h>
 #include <dsn/utility/time_utils.h>
 
@@ -44,7 +45,13 @@
 
 namespace dsn {
 
-perf_counters::perf_counters()
+DSN_DEFINE_bool("perf_counter",
+                percentile_counter_use_histogram,
+                true,
+                "whether the percentile counters are computed from a histogram of all the values, "
+                "rather than from the latest 5000 samples");
+
+perf_counters::perf_counters() : _counters_version(0)
 {
     command_manager::instance().register_command(
         {"perf-counters"},
@@ -87,6 +94,14 @@ perf_counters::perf_counters()
                                     arg.size()) == 0;
                 });
         });
+    command_manager::instance().register_command(
+        {"perf-counters-histogram"},
+        "perf-counters-histogram - query the buckets of the percentile perf counters, filtered by "
+        "OR of POSIX basic regular expressions",
+        "perf-counters-histogram [regexp]...",
+        [](const std::vector<std::string> &args) {
+            return perf_counters::instance().list_histogram_by_regexp(args);
+        });
 }
 
 perf_counters::~perf_counters() = default;
@@ -118,6 +133,7 @@ perf_counter_ptr perf_counters::get_global_counter(const char *app,
         if (it == _counters.end()) {
             perf_counter_ptr counter = new_counter(app, section, name, flags, dsptr);
             _counters.emplace(full_name, counter_object{counter, 1});
+            _counters_version.fetch_add(1, std::memory_order_release);
             return counter;
         } else {
             dassert(it->second.counter->type() == flags,
@@ -152,6 +168,7 @@ bool perf_counters::remove_counter(const char *full_name)
             remain_ref = (--c.user_reference);
             if (remain_ref == 0) {
                 _counters.erase(it);
+                _counters_version.fetch_add(1, std::memory_order_release);
             }
         }
     }
@@ -182,21 +199,50 @@ perf_counter *perf_counters::new_counter(const char *app,
         return new perf_counter_volatile_number_atomic(app, section, name, type, dsptr);
     else if (type == dsn_perf_counter_type_t::COUNTER_TYPE_RATE)
         return new perf_counter_rate_atomic(app, section, name, type, dsptr);
-    else if (type == dsn_perf_counter_type_t::COUNTER_TYPE_NUMBER_PERCENTILES)
+    else if (type == dsn_perf_counter_type_t::COUNTER_TYPE_NUMBER_PERCENTILES) {
+        if (FLAGS_percentile_counter_use_histogram)
+            return new perf_counter_number_histogram_atomic(app, section, name, type, dsptr);
         return new perf_counter_number_percentile_atomic(app, section, name, type, dsptr);
+    }
     else {
         dassert(false, "invalid type(%d)", type);
         return nullptr;
     }
 }
 
-void perf_counters::get_all_counters(std::vector<perf_counter_ptr> *all) const
+std::shared_ptr<const perf_counters::counter_list> perf_counters::get_all_counters() const
 {
-    all->clear();
-    utils::auto_read_lock l(_lock);
-    all->reserve(_counters.size());
-    for (auto &p : _counters) {
-        all->push_back(p.second.counter);
+    std::shared_ptr<const counter_list> current = std::atomic_load(&_published_counters);
+    if (current != nullptr &&
+        current->version == _counters_version.load(std::memory_order_acquire)) {
+        return current;
+    }
+
+    auto list = std::make_shared<counter_list>();
+    {
+        utils::auto_read_lock l(_lock);
+        list->version = _counters_version.load(std::memory_order_relaxed);
+        list->counters.reserve(_counters.size());
+        for (auto &p : _counters) {
+            list->counters.push_back(p.second.counter);
+        }
+    }
+
+    // never replace a newer list built by another reader concurrently
+    std::shared_ptr<const counter_list> result = list;
+    while (current == nullptr || current->version < result->version) {
+        if (std::atomic_compare_exchange_weak(&_published_counters, &current, result)) {
+            break;
+        }
+    }
+    return result;
+}
+
+void perf_counters::iterate_counters(const counter_visitor &v) const
+{
+    std::shared_ptr<const counter_list> all_counters = get_all_counters();
+    for (const perf_counter_ptr &c : all_counters->counters) {
+        v(c);
     }
 }
 
@@ -282,12 +328,60 @@ std::string perf_counters::list_snapshot_by_literal(
     return ss.str();
 }
 
+std::string perf_counters::list_histogram_by_regexp(const std::vector<std::string> &args) const
+{
+    perf_counter_histogram_info info;
+
+    std::vector<std::regex> regs;
+    regs.reserve(args.size());
+    for (auto &arg : args) {
+        try {
+            regs.emplace_back(arg, std::regex_constants::basic);
+        } catch (...) {
+            info.result = "ERROR: invalid filter: " + arg;
+            break;
+        }
+    }
+
+    if (info.result.empty()) {
+        std::shared_ptr<const counter_list> all_counters = get_all_counters();
+        std::vector<perf_counter::histogram_bucket> buckets;
+        for (const perf_counter_ptr &c : all_counters->counters) {
+            std::string name = c->full_name();
+            bool matched = regs.empty();
+            for (auto &reg : regs) {
+                if (std::regex_match(name, reg)) {
+                    matched = true;
+                    break;
+                }
+            }
+
+            perf_counter_histogram h;
+            if (!matched || !c->get_histogram(buckets, h.sum)) {
+                continue;
+            }
+            h.name = std::move(name);
+            h.buckets.reserve(buckets.size());
+            for (const auto &b : buckets) {
+                h.count += b.count;
+                h.buckets.push_back(
+                    perf_counter_histogram_bucket{b.lower_bound, b.upper_bound, b.count});
+            }
+            info.histograms.emplace_back(std::move(h));
+        }
+        info.result = "OK";
+    }
+
+    std::stringstream ss;
+    info.encode_json_state(ss);
+    return ss.str();
+}
+
 void perf_counters::take_snapshot()
 {
     builtin_counters::instance().update_counters();
 
-    std::vector<perf_counter_ptr> all_counters;
-    get_all_counters(&all_counters);
+    std::shared_ptr<const counter_list> all_counters = get_all_counters();
 
     utils::auto_write_lock l(_snapshot_lock);
     for (auto &p : _snapshots) {
@@ -295,15 +389,32 @@ void perf_counters::take_snapshot()
     }
 
     // updated counters from current value
-    for (const perf_counter_ptr &c : all_counters) {
+    uint64_t now_ns = dsn_now_ns();
+    for (const perf_counter_ptr &c : all_counters->counters) {
         counter_snapshot &cs = _snapshots[c->full_name()];
-        if (cs.name.empty()) {
-            // recently created counter, which wasn't in snapshot before
+        // recently created counter, which wasn't in snapshot before, or which is removed and
+        // registered again since the last snapshot
+        bool is_new = cs.counter.get() != c.get();
+        if (is_new) {
             cs.name = c->full_name();
             cs.type = c->type();
+            cs.counter = c;
+            cs.last_cumulative_value = 0;
         }
         cs.updated_recently = true;
-        if (c->type() != COUNTER_TYPE_NUMBER_PERCENTILES) {
+        if (c->type() == COUNTER_TYPE_VOLATILE_NUMBER || c->type() == COUNTER_TYPE_RATE) {
+            int64_t cumulative_value = c->get_cumulative_value();
+            int64_t increment = cumulative_value - cs.last_cumulative_value;
+            if (c->type() == COUNTER_TYPE_VOLATILE_NUMBER) {
+                cs.value = increment;
+            } else if (is_new || now_ns <= cs.last_time_ns) {
+                cs.value = 0;
+            } else {
+                cs.value = increment * 1e9 / (now_ns - cs.last_time_ns);
+            }
+            cs.last_cumulative_value = cumulative_value;
+            cs.last_time_ns = now_ns;
+        } else if (c->type() != COUNTER_TYPE_NUMBER_PERCENTILES) {
             cs.value = c->get_value();
         } else {
             cs.value = c->get_percentile(COUNTER_PERCENTILE_99);
@@ -34,7 +34,7 @@ namespace dsn {
 namespace tools {
 
 asio_network_provider::asio_network_provider(rpc_engine *srv, network *inner_provider)
-    : connection_oriented_network(srv, inner_provider)
+    : connection_oriented_network(srv, inner_provider), _next_accept_shard(0)
 {
     _acceptor = nullptr;
 }
@@ -44,7 +44,9 @@ asio_network_provider::~asio_network_provider()
     if (_acceptor) {
         _acceptor->close();
     }
-    _io_service.stop();
+    for (auto &ios : _io_services) {
+        ios->stop();
+    }
     for (auto &w : _workers) {
         w->join();
     }
@@ -61,22 +63,58 @@ error_code asio_network_provider::start(rpc_channel channel, int port, bool clie
                                          1,
                                          "thread number for io service (timer and boost network)");
 
+    bool io_service_sharded = dsn_config_get_value_bool(
+        "network",
+        "io_service_sharded",
+        false,
+        "whether each io service worker runs its own io service, with the sessions spread over "
+        "them, rather than all the workers sharing one io service");
+
+    uint64_t io_service_worker_affinity_mask = dsn_config_get_value_uint64(
+        "network",
+        "io_service_worker_affinity_mask",
+        0,
+        "cpu mask the io service workers are pinned to, each worker to one of the cores in turn, "
+        "0 means not to pin them");
+
     // get connection threshold from config, default value 0 means no threshold
     _cfg_conn_threshold_per_ip = (uint32_t)dsn_config_get_value_uint64(
         "network", "conn_threshold_per_ip", 0, "max connection count to each server per ip");
 
+    int io_service_count = io_service_sharded ? io_service_worker_count : 1;
+    for (int i = 0; i < io_service_count; i++) {
+        _io_services.emplace_back(new boost::asio::io_service());
+    }
+    if (io_service_sharded) {
+        init_session_shards(io_service_count);
+    }
+
     for (int i = 0; i < io_service_worker_count; i++) {
-        _workers.push_back(std::make_shared<std::thread>([this, i]() {
+        boost::asio::io_service &ios = *_io_services[i % io_service_count];
+        // the same as the task workers of a pool not sharing cores, the i-th worker is pinned to
+        // the i-th core in the mask
+        uint64_t affinity = io_service_worker_affinity_mask;
+        for (int j = 0; affinity != 0 && j < i; ++j) {
+            affinity &= (affinity - 1);
+            if (0 == affinity) {
+                affinity = io_service_worker_affinity_mask;
+            }
+        }
+        affinity -= (affinity & (affinity - 1));
+        _workers.push_back(std::make_shared<std::thread>([this, i, &ios, affinity]() {
             task::set_tls_dsn_context(node(), nullptr);
 
             const char *name = ::dsn::tools::get_service_node_name(node());
             char buffer[128];
             sprintf(buffer, "%s.asio.%d", name, i);
             task_worker::set_name(buffer);
+            if (affinity != 0) {
+                task_worker::set_affinity(affinity);
+            }
 
-            boost::asio::io_service::work work(_io_service);
+            boost::asio::io_service::work work(ios);
             boost::system::error_code ec;
-            _io_service.run(ec);
+            ios.run(ec);
             if (ec) {
                 dassert(false, "boost::asio::io_service run failed: err(%s)", ec.message().data());
             }
@@ -95,7 +133,7 @@ error_code asio_network_provider::start(rpc_channel channel, int port, bool clie
         auto v4_addr = boost::asio::ip::address_v4::any(); //(ntohl(_address.ip));
         ::boost::asio::ip::tcp::endpoint endpoint(v4_addr, _address.port());
         boost::system::error_code ec;
-        _acceptor.reset(new boost::asio::ip::tcp::acceptor(_io_service));
+        _acceptor.reset(new boost::asio::ip::tcp::acceptor(*_io_services[0]));
         _acceptor->open(endpoint.protocol(), ec);
         if (ec) {
             derror("asio tcp acceptor open failed, error = %s", ec.message().c_str());
@@ -124,18 +162,36 @@ error_code asio_network_provider::start(rpc_channel channel, int port, bool clie
     return ERR_OK;
 }
 
+boost::asio::io_service &
+asio_network_provider::get_client_io_service(::dsn::rpc_address server_addr)
+{
+    // the same shard as the session map of server_addr
+    return *_io_services[std::hash<::dsn::rpc_address>()(server_addr) % _io_services.size()];
+}
+
+boost::asio::io_service &asio_network_provider::get_server_io_service()
+{
+    // the remote address is unknown until the socket is accepted, and a socket can not move to
+    // another io_service afterwards, so the accepted sessions are spread round-robin. unlike the
+    // client sessions, the io_service of an accepted session is not the one of its session map
+    // shard, which is still picked by the remote address
+    return *_io_services[_next_accept_shard++ % _io_services.size()];
+}
+
 rpc_session_ptr asio_network_provider::create_client_session(::dsn::rpc_address server_addr)
 {
-    auto sock = std::make_shared<boost::asio::ip::tcp::socket>(_io_service);
+    boost::asio::io_service &ios = get_client_io_service(server_addr);
+    auto sock = std::make_shared<boost::asio::ip::tcp::socket>(ios);
     message_parser_ptr parser(new_message_parser(_client_hdr_format));
-    return rpc_session_ptr(new asio_rpc_session(*this, server_addr, sock, parser, true));
+    return rpc_session_ptr(new asio_rpc_session(*this, server_addr, sock, ios, parser, true));
 }
 
 void asio_network_provider::do_accept()
 {
-    auto socket = std::make_shared<boost::asio::ip::tcp::socket>(_io_service);
+    boost::asio::io_service &ios = get_server_io_service();
+    auto socket = std::make_shared<boost::asio::ip::tcp::socket>(ios);
 
-    _acceptor->async_accept(*socket, [this, socket](boost::system::error_code ec) {
+    _acceptor->async_accept(*socket, [this, socket, &ios](boost::system::error_code ec) {
         if (!ec) {
             auto remote = socket->remote_endpoint(ec);
             if (ec) {
@@ -150,6 +206,7 @@ void asio_network_provider::do_accept()
                     new asio_rpc_session(*this,
                                          client_addr,
                                          (std::shared_ptr<boost::asio::ip::tcp::socket> &)socket,
+                                         ios,
                                          null_parser,
                                          false);
 
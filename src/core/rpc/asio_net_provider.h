@@ -46,12 +46,20 @@ public:
 private:
     void do_accept();
 
+    // the io_service a new client session to `server_addr` runs on
+    boost::asio::io_service &get_client_io_service(::dsn::rpc_address server_addr);
+    // the io_service a newly accepted session runs on
+    boost::asio::io_service &get_server_io_service();
+
 private:
     friend class asio_rpc_session;
     friend class asio_network_provider_test;
 
     std::shared_ptr<boost::asio::ip::tcp::acceptor> _acceptor;
-    boost::asio::io_service _io_service;
+    // one io_service run by all the workers, or one per worker in the sharded mode, where each
+    // session stays on the io_service it is assigned to
+    std::vector<std::unique_ptr<boost::asio::io_service>> _io_services;
+    unsigned int _next_accept_shard;
     std::vector<std::shared_ptr<std::thread>> _workers;
     ::dsn::rpc_address _address;
 };
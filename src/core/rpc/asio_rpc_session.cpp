@@ -101,6 +101,7 @@ void asio_rpc_session::do_read(int read_next)
                 on_failure();
             } else {
                 _reader.mark_read(length);
+                _net.on_bytes_received(length, _reader.take_copied_bytes());
 
                 int read_next = -1;
 
@@ -157,12 +158,25 @@ void asio_rpc_session::send(uint64_t signature)
         });
 }
 
+void asio_rpc_session::cork(int delay_us)
+{
+    add_ref();
+
+    _cork_timer.expires_from_now(boost::posix_time::microseconds(delay_us));
+    _cork_timer.async_wait([this](const boost::system::error_code &ec) {
+        // the timer is never cancelled, send the queued messages in any case
+        send_corked();
+        release_ref();
+    });
+}
+
 asio_rpc_session::asio_rpc_session(asio_network_provider &net,
                                    ::dsn::rpc_address remote_addr,
                                    std::shared_ptr<boost::asio::ip::tcp::socket> &socket,
+                                   boost::asio::io_service &ios,
                                    message_parser_ptr &parser,
                                    bool is_client)
-    : rpc_session(net, remote_addr, parser, is_client), _socket(socket)
+    : rpc_session(net, remote_addr, parser, is_client), _socket(socket), _cork_timer(ios)
 {
     set_options();
 }
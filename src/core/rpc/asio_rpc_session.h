@@ -43,6 +43,7 @@ public:
     asio_rpc_session(asio_network_provider &net,
                      ::dsn::rpc_address remote_addr,
                      std::shared_ptr<boost::asio::ip::tcp::socket> &socket,
+                     boost::asio::io_service &ios,
                      message_parser_ptr &parser,
                      bool is_client);
 
@@ -50,6 +51,8 @@ public:
 
     void send(uint64_t signature) override;
 
+    void cork(int delay_us) override;
+
     void close() override;
 
     void connect() override;
@@ -70,6 +73,9 @@ private:
     // reading/writing socket being modified or closed concurrently.
     std::shared_ptr<boost::asio::ip::tcp::socket> _socket;
     ::dsn::utils::rw_lock_nr _socket_lock;
+
+    // at most one cork is pending, as it holds the sending slot of the session
+    boost::asio::deadline_timer _cork_timer;
 };
 
 } // namespace tools
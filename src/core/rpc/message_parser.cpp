@@ -35,6 +35,8 @@
 
 #include "message_parser_manager.h"
 #include <dsn/service_api_c.h>
+#include <dsn/utility/synchronize.h>
+#include <memory>
 
 namespace dsn {
 
@@ -132,6 +134,62 @@ std::string header_type::debug_string() const
 }
 
 //-------------------- msg reader --------------------
+// message_block_pool keeps the blocks of one message_reader which are no longer referenced by any
+// message, so that the reader reuses them instead of allocating a new block each time. The
+// messages may be released on any thread, but the lock is only shared by the reader and the
+// messages it has read, not by all the sessions.
+class message_block_pool : public std::enable_shared_from_this<message_block_pool>
+{
+public:
+    explicit message_block_pool(unsigned int block_size) : _block_size(block_size) {}
+
+    ~message_block_pool()
+    {
+        for (char *block : _free_blocks) {
+            delete[] block;
+        }
+    }
+
+    std::shared_ptr<char> acquire()
+    {
+        char *block = nullptr;
+        {
+            utils::auto_lock<utils::ex_lock_nr_spin> l(_lock);
+            if (!_free_blocks.empty()) {
+                block = _free_blocks.back();
+                _free_blocks.pop_back();
+            }
+        }
+        if (block == nullptr) {
+            block = new char[_block_size];
+        }
+        // the pool lives as long as any of its blocks, even after the reader is destroyed
+        std::shared_ptr<message_block_pool> pool = shared_from_this();
+        return std::shared_ptr<char>(block, [pool](char *b) { pool->release(b); });
+    }
+
+private:
+    void release(char *block)
+    {
+        {
+            utils::auto_lock<utils::ex_lock_nr_spin> l(_lock);
+            if (_free_blocks.size() < MAX_FREE_BLOCKS) {
+                _free_blocks.push_back(block);
+                return;
+            }
+        }
+        delete[] block;
+    }
+
+    // a reader only switches to a new block when the current one is full, so a couple of free
+    // blocks are enough, and an idle session holds little memory
+    static const size_t MAX_FREE_BLOCKS = 2;
+
+    const unsigned int _block_size;
+    utils::ex_lock_nr_spin _lock;
+    std::vector<char *> _free_blocks;
+};
+
 char *message_reader::read_buffer_ptr(unsigned int read_next)
 {
     if (read_next + _buffer_occupied > _buffer.length()) {
@@ -141,20 +199,24 @@ char *message_reader::read_buffer_ptr(unsigned int read_next)
             rb = _buffer.range(0, _buffer_occupied);
 
         // switch to next
-        unsigned int sz =
-            (read_next + _buffer_occupied > _buffer_block_size ? read_next + _buffer_occupied
-                                                               : _buffer_block_size);
-        // TODO(wutao1): make it a buffer queue like what sofa-pbrpc does
-        //               (https://github.com/baidu/sofa-pbrpc/blob/master/src/sofa/pbrpc/buffer.h)
-        //               to reduce memory copy.
-        _buffer.assign(dsn::utils::make_shared_array<char>(sz), 0, sz);
+        unsigned int sz = read_next + _buffer_occupied;
+        if (sz <= _buffer_block_size) {
+            if (_block_pool == nullptr) {
+                _block_pool = std::make_shared<message_block_pool>(_buffer_block_size);
+            }
+            _buffer.assign(_block_pool->acquire(), 0, _buffer_block_size);
+        } else {
+            _buffer.assign(dsn::utils::make_shared_array<char>(sz), 0, sz);
+        }
         _buffer_occupied = 0;
 
         // copy
         if (rb.length() > 0) {
-            // every read buffer_block_size data may cause one copy
+            // only the unparsed part of the current message is copied, which is at most
+            // one block for a message that is larger than a block
             memcpy((void *)_buffer.data(), (const void *)rb.data(), rb.length());
             _buffer_occupied = rb.length();
+            _copied_bytes += rb.length();
         }
 
         dassert(read_next + _buffer_occupied <= _buffer.length(),
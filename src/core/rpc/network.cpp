@@ -25,11 +25,29 @@
  */
 
 #include <dsn/tool-api/network.h>
+#include <dsn/tool_api.h>
 #include <dsn/utility/factory_store.h>
+#include <dsn/utility/flags.h>
 #include "message_parser_manager.h"
 #include "core/rpc/rpc_engine.h"
 
 namespace dsn {
+DSN_DEFINE_uint32("network",
+                  send_coalesce_max_bytes,
+                  1 << 20,
+                  "max bytes of the queued messages merged into one write of a session, "
+                  "a message larger than it is still sent alone");
+DSN_DEFINE_uint32("network",
+                  send_cork_delay_us,
+                  0,
+                  "how long a session holds a tiny message sent to it when idle, to merge it "
+                  "with the following ones into one write; 0 means no corking");
+DSN_DEFINE_uint32("network",
+                  send_cork_max_bytes,
+                  4096,
+                  "messages no larger than this are tiny messages for send_cork_delay_us");
+DSN_DEFINE_validator(send_coalesce_max_bytes, [](uint32_t value) -> bool { return value > 0; });
+
 /*static*/ join_point<void, rpc_session *>
     rpc_session::on_rpc_session_connected("rpc.session.connected");
 /*static*/ join_point<void, rpc_session *>
@@ -169,6 +187,9 @@ inline bool rpc_session::unlink_message_for_send()
                 "sending_msgs should be empty, but size = %d",
                 (int)_sending_msgs.size());
 
+    // merge all the queued messages into one write, as long as the buffer count and the bytes
+    // are in budget; the first message is always taken
+    uint64_t bytes = 0;
     while (n != &_messages) {
         auto lmsg = CONTAINING_RECORD(n, message_ex, dl);
         auto lcount = _parser->get_buffer_count_on_send(lmsg);
@@ -176,12 +197,18 @@ inline bool rpc_session::unlink_message_for_send()
             break;
         }
 
+        uint64_t lbytes = lmsg->header->body_length + sizeof(message_header);
+        if (bcount > 0 && bytes + lbytes > FLAGS_send_coalesce_max_bytes) {
+            break;
+        }
+
         _sending_buffers.resize(bcount + lcount);
         auto rcount = _parser->get_buffers_on_send(lmsg, &_sending_buffers[bcount]);
         dassert(lcount >= rcount, "%d VS %d", lcount, rcount);
         if (lcount != rcount)
             _sending_buffers.resize(bcount + rcount);
         bcount += rcount;
+        bytes += lbytes;
         _sending_msgs.push_back(lmsg);
 
         n = n->next();
@@ -190,7 +217,12 @@ inline bool rpc_session::unlink_message_for_send()
 
     // added in send_message
     _message_count -= (int)_sending_msgs.size();
-    return _sending_msgs.size() > 0;
+    if (_sending_msgs.empty()) {
+        return false;
+    }
+
+    _net.on_write_prepared(_sending_msgs.size(), bytes);
+    return true;
 }
 
 DEFINE_TASK_CODE(LPC_DELAY_RPC_REQUEST_RATE, TASK_PRIORITY_COMMON, THREAD_POOL_DEFAULT)
@@ -250,7 +282,7 @@ void rpc_session::send_message(message_ex *msg)
     dassert(_parser, "parser should not be null when send");
     _parser->prepare_on_send(msg);
 
-    uint64_t sig;
+    uint64_t sig = 0;
     {
         utils::auto_lock<utils::ex_lock_nr> l(_lock);
         msg->dl.insert_before(&_messages);
@@ -258,13 +290,39 @@ void rpc_session::send_message(message_ex *msg)
 
         if (SS_CONNECTED == _connect_state && !_is_sending_next) {
             _is_sending_next = true;
-            sig = _message_sent + 1;
-            unlink_message_for_send();
+            // a tiny message to an idle session waits a little for the following ones,
+            // the messages queued meanwhile are sent together by send_corked
+            if (FLAGS_send_cork_delay_us == 0 ||
+                msg->header->body_length + sizeof(message_header) > FLAGS_send_cork_max_bytes) {
+                sig = _message_sent + 1;
+                unlink_message_for_send();
+            }
         } else {
             return;
         }
     }
 
+    if (sig != 0) {
+        this->send(sig);
+    } else {
+        this->cork(FLAGS_send_cork_delay_us);
+    }
+}
+
+void rpc_session::send_corked()
+{
+    uint64_t sig;
+    {
+        utils::auto_lock<utils::ex_lock_nr> l(_lock);
+        dassert(_is_sending_next, "the sending slot must be held by the cork");
+        if (SS_CONNECTED != _connect_state || !unlink_message_for_send()) {
+            // the queue has been cleared as the session is closed
+            _is_sending_next = false;
+            return;
+        }
+        sig = _message_sent + 1;
+    }
+
     this->send(sig);
 }
 
@@ -499,9 +557,70 @@ uint32_t network::get_local_ipv4()
 }
 
 connection_oriented_network::connection_oriented_network(rpc_engine *srv, network *inner_provider)
-    : network(srv, inner_provider)
+    : network(srv, inner_provider),
+      _client_count(0),
+      _server_count(0),
+      _window_recv_bytes(0),
+      _window_copied_bytes(0)
 {
     _cfg_conn_threshold_per_ip = 0;
+    init_session_shards(1);
+
+    const char *app = tools::get_service_node_name(node());
+    _recv_bytes.init_global_counter(
+        app, "network", "recv.bytes", COUNTER_TYPE_RATE, "bytes received by the sessions");
+    _recv_copied_bytes.init_global_counter(app,
+                                           "network",
+                                           "recv.copied.bytes",
+                                           COUNTER_TYPE_RATE,
+                                           "received bytes copied by the message readers");
+    _recv_copy_permille.init_global_counter(app,
+                                            "network",
+                                            "recv.copy.permille",
+                                            COUNTER_TYPE_NUMBER,
+                                            "bytes copied per 1000 bytes received");
+    _send_msgs_per_write.init_global_counter(app,
+                                             "network",
+                                             "send.msgs.per.write",
+                                             COUNTER_TYPE_NUMBER_PERCENTILES,
+                                             "messages merged into one write of a session");
+    _send_bytes_per_write.init_global_counter(app,
+                                              "network",
+                                              "send.bytes.per.write",
+                                              COUNTER_TYPE_NUMBER_PERCENTILES,
+                                              "bytes of the messages merged into one write");
+}
+
+void connection_oriented_network::init_session_shards(int count)
+{
+    dassert(count > 0, "invalid session shard count %d", count);
+    _session_shards.reset(new session_shard[count]);
+    _session_shard_count = count;
+}
+
+void connection_oriented_network::on_write_prepared(size_t msg_count, uint64_t bytes)
+{
+    _send_msgs_per_write->set(msg_count);
+    _send_bytes_per_write->set(bytes);
+}
+
+// the copy ratio is computed over windows of this many bytes received
+static const uint64_t RECV_COPY_WINDOW_BYTES = 64 << 20;
+
+void connection_oriented_network::on_bytes_received(uint64_t received, uint64_t copied)
+{
+    _recv_bytes->add(received);
+    if (copied > 0) {
+        _recv_copied_bytes->add(copied);
+        _window_copied_bytes.fetch_add(copied, std::memory_order_relaxed);
+    }
+
+    uint64_t window = _window_recv_bytes.fetch_add(received, std::memory_order_relaxed) + received;
+    if (window >= RECV_COPY_WINDOW_BYTES &&
+        _window_recv_bytes.compare_exchange_strong(window, 0, std::memory_order_relaxed)) {
+        uint64_t window_copied = _window_copied_bytes.exchange(0, std::memory_order_relaxed);
+        _recv_copy_permille->set(window_copied * 1000 / window);
+    }
 }
 
 void connection_oriented_network::inject_drop_message(message_ex *msg, bool is_send)
@@ -513,9 +632,10 @@ void connection_oriented_network::inject_drop_message(message_ex *msg, bool is_s
         //   normal (not forwarding) reply message from server to client, in which case
         //   the io_session has also been set.
         dassert(is_send, "received message should always has io_session set");
-        utils::auto_read_lock l(_clients_lock);
-        auto it = _clients.find(msg->to_address);
-        if (it != _clients.end()) {
+        session_shard &shard = get_session_shard(msg->to_address);
+        utils::auto_read_lock l(shard.clients_lock);
+        auto it = shard.clients.find(msg->to_address);
+        if (it != shard.clients.end()) {
             s = it->second;
         }
     }
@@ -529,12 +649,13 @@ void connection_oriented_network::send_message(message_ex *request)
 {
     rpc_session_ptr client = nullptr;
     auto &to = request->to_address;
+    session_shard &shard = get_session_shard(to);
 
     // TODO: thread-local client ptr cache
     {
-        utils::auto_read_lock l(_clients_lock);
-        auto it = _clients.find(to);
-        if (it != _clients.end()) {
+        utils::auto_read_lock l(shard.clients_lock);
+        auto it = shard.clients.find(to);
+        if (it != shard.clients.end()) {
             client = it->second;
         }
     }
@@ -542,16 +663,16 @@ void connection_oriented_network::send_message(message_ex *request)
     int scount = 0;
     bool new_client = false;
     if (nullptr == client.get()) {
-        utils::auto_write_lock l(_clients_lock);
-        auto it = _clients.find(to);
-        if (it != _clients.end()) {
+        utils::auto_write_lock l(shard.clients_lock);
+        auto it = shard.clients.find(to);
+        if (it != shard.clients.end()) {
             client = it->second;
         } else {
             client = create_client_session(to);
-            _clients.insert(client_sessions::value_type(to, client));
+            shard.clients.insert(client_sessions::value_type(to, client));
             new_client = true;
+            scount = ++_client_count;
         }
-        scount = (int)_clients.size();
     }
 
     // init connection if necessary
@@ -568,30 +689,35 @@ void connection_oriented_network::send_message(message_ex *request)
 
 rpc_session_ptr connection_oriented_network::get_server_session(::dsn::rpc_address ep)
 {
-    utils::auto_read_lock l(_servers_lock);
-    auto it = _servers.find(ep);
-    return it != _servers.end() ? it->second : nullptr;
+    session_shard &shard = get_session_shard(ep);
+    utils::auto_read_lock l(shard.servers_lock);
+    auto it = shard.servers.find(ep);
+    return it != shard.servers.end() ? it->second : nullptr;
 }
 
 void connection_oriented_network::on_server_session_accepted(rpc_session_ptr &s)
 {
     int scount = 0;
     int ecount = 1;
+    session_shard &shard = get_session_shard(s->remote_address());
     {
-        utils::auto_write_lock l(_servers_lock);
+        utils::auto_write_lock l(shard.servers_lock);
 
-        auto pr = _servers.insert(server_sessions::value_type(s->remote_address(), s));
+        auto pr = shard.servers.insert(server_sessions::value_type(s->remote_address(), s));
         if (pr.second) {
-            // nothing to do
+            scount = ++_server_count;
         } else {
             pr.first->second = s;
+            scount = _server_count.load();
             dwarn("server session already exists, remote_client = %s, preempted",
                   s->remote_address().to_string());
         }
-        scount = (int)_servers.size();
-
-        auto pr2 =
-            _ip_conn_count.insert(ip_connection_count::value_type(s->remote_address().ip(), 1));
+    }
+    {
+        session_shard &ip_shard = get_ip_conn_count_shard(s->remote_address().ip());
+        utils::auto_write_lock l(ip_shard.ip_conn_count_lock);
+        auto pr2 = ip_shard.ip_conn_count.insert(
+            ip_connection_count::value_type(s->remote_address().ip(), 1));
         if (!pr2.second) {
             ecount = ++pr2.first->second;
         }
@@ -612,22 +738,28 @@ void connection_oriented_network::on_server_session_disconnected(rpc_session_ptr
     int ip_count = 0;      // how many unique client IPs
     int ip_conn_count = 0; // how many connections bound to the IP of `s`
     bool session_removed = false;
+    session_shard &shard = get_session_shard(s->remote_address());
     {
-        utils::auto_write_lock l(_servers_lock);
-        auto it = _servers.find(s->remote_address());
-        if (it != _servers.end() && it->second.get() == s.get()) {
-            _servers.erase(it);
+        utils::auto_write_lock l(shard.servers_lock);
+        auto it = shard.servers.find(s->remote_address());
+        if (it != shard.servers.end() && it->second.get() == s.get()) {
+            shard.servers.erase(it);
             session_removed = true;
+            ip_count = --_server_count;
+        } else {
+            ip_count = _server_count.load();
         }
-        ip_count = (int)_servers.size();
-
-        auto it2 = _ip_conn_count.find(s->remote_address().ip());
-        if (it2 != _ip_conn_count.end()) {
+    }
+    {
+        session_shard &ip_shard = get_ip_conn_count_shard(s->remote_address().ip());
+        utils::auto_write_lock l(ip_shard.ip_conn_count_lock);
+        auto it2 = ip_shard.ip_conn_count.find(s->remote_address().ip());
+        if (it2 != ip_shard.ip_conn_count.end()) {
             if (it2->second > 1) {
                 it2->second -= 1;
                 ip_conn_count = it2->second;
             } else {
-                _ip_conn_count.erase(it2);
+                ip_shard.ip_conn_count.erase(it2);
             }
         }
     }
@@ -660,9 +792,10 @@ bool connection_oriented_network::check_if_conn_threshold_exceeded(::dsn::rpc_ad
     bool exceeded = false;
     int ip_conn_count = 0; // the amount of connections from this ip address.
     {
-        utils::auto_read_lock l(_servers_lock);
-        auto it = _ip_conn_count.find(ep.ip());
-        if (it != _ip_conn_count.end()) {
+        session_shard &ip_shard = get_ip_conn_count_shard(ep.ip());
+        utils::auto_read_lock l(ip_shard.ip_conn_count_lock);
+        auto it = ip_shard.ip_conn_count.find(ep.ip());
+        if (it != ip_shard.ip_conn_count.end()) {
             ip_conn_count = it->second;
         }
     }
@@ -685,12 +818,13 @@ void connection_oriented_network::on_client_session_connected(rpc_session_ptr &s
     int scount = 0;
     bool r = false;
     {
-        utils::auto_read_lock l(_clients_lock);
-        auto it = _clients.find(s->remote_address());
-        if (it != _clients.end() && it->second.get() == s.get()) {
+        session_shard &shard = get_session_shard(s->remote_address());
+        utils::auto_read_lock l(shard.clients_lock);
+        auto it = shard.clients.find(s->remote_address());
+        if (it != shard.clients.end() && it->second.get() == s.get()) {
             r = true;
         }
-        scount = (int)_clients.size();
+        scount = _client_count.load();
     }
 
     if (r) {
@@ -705,13 +839,16 @@ void connection_oriented_network::on_client_session_disconnected(rpc_session_ptr
     int scount = 0;
     bool r = false;
     {
-        utils::auto_write_lock l(_clients_lock);
-        auto it = _clients.find(s->remote_address());
-        if (it != _clients.end() && it->second.get() == s.get()) {
-            _clients.erase(it);
+        session_shard &shard = get_session_shard(s->remote_address());
+        utils::auto_write_lock l(shard.clients_lock);
+        auto it = shard.clients.find(s->remote_address());
+        if (it != shard.clients.end() && it->second.get() == s.get()) {
+            shard.clients.erase(it);
             r = true;
+            scount = --_client_count;
+        } else {
+            scount = _client_count.load();
         }
-        scount = (int)_clients.size();
     }
 
     if (r) {
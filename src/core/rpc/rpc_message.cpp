@@ -36,6 +36,7 @@
 #include <dsn/utility/ports.h>
 #include <dsn/utility/crc.h>
 #include <dsn/utility/transient_memory.h>
+#include <dsn/utility/object_pool.h>
 #include <dsn/tool-api/rpc_message.h>
 #include <dsn/tool-api/network.h>
 #include <dsn/tool-api/message_parser.h>
@@ -158,8 +159,8 @@ message_ex *message_ex::create_receive_message_with_standalone_header(const blob
 {
     message_ex *msg = new message_ex();
     std::shared_ptr<char> header_holder(
-        static_cast<char *>(dsn::tls_trans_malloc(sizeof(message_header))),
-        [](char *c) { dsn::tls_trans_free(c); });
+        static_cast<char *>(dsn::object_pool_malloc(sizeof(message_header))),
+        [](char *c) { dsn::object_pool_free(c); });
     msg->header = reinterpret_cast<message_header *>(header_holder.get());
     memset(static_cast<void *>(msg->header), 0, sizeof(message_header));
 
@@ -178,8 +179,8 @@ message_ex *message_ex::copy_message_no_reply(const message_ex &old_msg)
 {
     message_ex *msg = new message_ex();
     std::shared_ptr<char> header_holder(
-        static_cast<char *>(dsn::tls_trans_malloc(sizeof(message_header))),
-        [](char *c) { dsn::tls_trans_free(c); });
+        static_cast<char *>(dsn::object_pool_malloc(sizeof(message_header))),
+        [](char *c) { dsn::object_pool_free(c); });
     msg->header = reinterpret_cast<message_header *>(header_holder.get());
     memset(msg->header, 0, sizeof(message_header));
     msg->buffers.emplace_back(blob(std::move(header_holder), sizeof(message_header)));
@@ -0,0 +1,273 @@
+// Copyright (c) 2019, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#include "timing_wheel_timer_service.h"
+
+#include <cstring>
+
+#include <dsn/tool_api.h>
+#include <dsn/utility/flags.h>
+
+namespace dsn {
+namespace tools {
+
+DSN_DEFINE_uint32("core",
+                  timer_wheel_tick_ms,
+                  1,
+                  "tick of dsn::tools::timing_wheel_timer_service in milliseconds");
+DSN_DEFINE_validator(timer_wheel_tick_ms, [](uint32_t value) -> bool { return value > 0; });
+
+timing_wheel_timer_service::timing_wheel_timer_service(service_node *node,
+                                                       timer_service *inner_provider)
+    : timer_service(node, inner_provider),
+      _tick_ms(FLAGS_timer_wheel_tick_ms),
+      _current_tick(0),
+      _wheel_count(0),
+      _incoming(nullptr),
+      _sleeping(false),
+      _stopped(false)
+{
+    memset(_root, 0, sizeof(_root));
+    memset(_levels, 0, sizeof(_levels));
+
+    const char *app = get_service_node_name(node);
+    _pending_count.init_global_counter(app,
+                                       "engine",
+                                       "timer.pending.count",
+                                       COUNTER_TYPE_NUMBER,
+                                       "count of the delayed tasks waiting in the timer wheel");
+    _fired_qps.init_global_counter(app,
+                                   "engine",
+                                   "timer.fired.qps",
+                                   COUNTER_TYPE_RATE,
+                                   "delayed tasks fired by the timer wheel per second");
+    _fire_lag_ms.init_global_counter(app,
+                                     "engine",
+                                     "timer.fire.lag.ms",
+                                     COUNTER_TYPE_NUMBER_PERCENTILES,
+                                     "time between the expected and the real fire time, in ms");
+}
+
+timing_wheel_timer_service::~timing_wheel_timer_service()
+{
+    _stopped.store(true);
+    _wakeup.signal();
+    if (_worker.joinable()) {
+        _worker.join();
+    }
+}
+
+void timing_wheel_timer_service::start()
+{
+    _start_time = std::chrono::steady_clock::now();
+    _worker = std::thread([this]() {
+        task::set_tls_dsn_context(node(), nullptr);
+
+        char buffer[128];
+        sprintf(buffer, "%s.timer", get_service_node_name(node()));
+
+        task_worker::set_name(buffer);
+        task_worker::set_priority(worker_priority_t::THREAD_xPRIORITY_ABOVE_NORMAL);
+
+        run();
+    });
+}
+
+void timing_wheel_timer_service::add_timer(task *task)
+{
+    _pending_count->increment();
+
+    // the delay is converted to ticks by the timer thread
+    dsn::task *head = _incoming.load(std::memory_order_relaxed);
+    do {
+        task->next = head;
+    } while (!_incoming.compare_exchange_weak(head, task));
+
+    // pairs with the check of _incoming in run()
+    if (_sleeping.load() && _sleeping.exchange(false)) {
+        _wakeup.signal();
+    }
+}
+
+int64_t timing_wheel_timer_service::elapsed_ms() const
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() -
+                                                                 _start_time)
+        .count();
+}
+
+int64_t timing_wheel_timer_service::elapsed_us() const
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() -
+                                                                 _start_time)
+        .count();
+}
+
+void timing_wheel_timer_service::run()
+{
+    while (!_stopped.load()) {
+        uint64_t now = elapsed_ms() / _tick_ms;
+        if (_wheel_count == 0) {
+            // nothing to cascade or fire, skip the ticks passed while idle
+            _current_tick = now + 1;
+        } else {
+            while (_current_tick <= now) {
+                advance();
+            }
+        }
+        drain_incoming(now);
+
+        int wait_ms = -1;
+        if (_wheel_count != 0) {
+            int64_t due_ms = static_cast<int64_t>(next_due_tick() * _tick_ms);
+            wait_ms = static_cast<int>(std::max<int64_t>(due_ms - elapsed_ms(), 0));
+            if (wait_ms == 0) {
+                continue;
+            }
+        }
+
+        _sleeping.store(true);
+        if (_incoming.load() == nullptr && !_stopped.load()) {
+            if (wait_ms < 0) {
+                _wakeup.wait();
+            } else {
+                _wakeup.wait(wait_ms);
+            }
+        }
+        _sleeping.store(false);
+    }
+}
+
+void timing_wheel_timer_service::drain_incoming(uint64_t now)
+{
+    task *t = _incoming.exchange(nullptr);
+    if (t == nullptr) {
+        return;
+    }
+
+    // a tick is fired once the elapsed time reaches its beginning, so the expire tick is rounded
+    // up from the exact time, or the task added late in a tick would fire before its delay
+    uint64_t tick_us = static_cast<uint64_t>(_tick_ms) * 1000;
+    uint64_t elapsed = static_cast<uint64_t>(elapsed_us());
+    while (t != nullptr) {
+        task *next = t->next;
+        t->next = nullptr;
+
+        int delay_ms = t->delay_milliseconds();
+        uint64_t expire = now;
+        if (delay_ms > 0) {
+            uint64_t expire_us = elapsed + static_cast<uint64_t>(delay_ms) * 1000;
+            expire = (expire_us + tick_us - 1) / tick_us;
+        }
+        t->set_delay(static_cast<int>(static_cast<uint32_t>(expire)));
+        place(t);
+
+        t = next;
+    }
+}
+
+void timing_wheel_timer_service::place(task *t)
+{
+    // the delay field holds the lower 32 bits of the expire tick, which is never more than
+    // INT_MAX ticks away from the current tick as delays are ints in milliseconds
+    uint32_t expire = static_cast<uint32_t>(t->delay_milliseconds());
+    int32_t diff = static_cast<int32_t>(expire - static_cast<uint32_t>(_current_tick));
+    if (diff < 0) {
+        fire(t, _current_tick + diff);
+        return;
+    }
+
+    // tasks beyond the span of the wheel are parked in the farthest slot, and placed again
+    // when that slot is cascaded
+    uint32_t distance = std::min(static_cast<uint32_t>(diff), WHEEL_SPAN - 1);
+    uint64_t position = _current_tick + distance;
+
+    task **slot;
+    if (distance < ROOT_SIZE) {
+        slot = &_root[position & (ROOT_SIZE - 1)];
+    } else {
+        int level = 0;
+        while (distance >= (1u << (ROOT_BITS + LEVEL_BITS * (level + 1)))) {
+            ++level;
+        }
+        slot = &_levels[level][(position >> (ROOT_BITS + LEVEL_BITS * level)) & (LEVEL_SIZE - 1)];
+    }
+
+    t->next = *slot;
+    *slot = t;
+    ++_wheel_count;
+}
+
+void timing_wheel_timer_service::cascade(int level, uint32_t index)
+{
+    task *t = _levels[level][index];
+    _levels[level][index] = nullptr;
+    while (t != nullptr) {
+        task *next = t->next;
+        --_wheel_count;
+        place(t);
+        t = next;
+    }
+}
+
+void timing_wheel_timer_service::advance()
+{
+    uint32_t index = _current_tick & (ROOT_SIZE - 1);
+    if (index == 0) {
+        // move the tasks which expire in the next ROOT_SIZE ticks down, a level is cascaded
+        // when the level below it wraps around
+        for (int level = 0; level < LEVEL_COUNT; ++level) {
+            uint32_t i = (_current_tick >> (ROOT_BITS + LEVEL_BITS * level)) & (LEVEL_SIZE - 1);
+            cascade(level, i);
+            if (i != 0) {
+                break;
+            }
+        }
+    }
+
+    task *t = _root[index];
+    _root[index] = nullptr;
+    while (t != nullptr) {
+        task *next = t->next;
+        --_wheel_count;
+        fire(t, _current_tick);
+        t = next;
+    }
+
+    ++_current_tick;
+}
+
+uint64_t timing_wheel_timer_service::next_due_tick() const
+{
+    // the root level is cascaded into at every wrap around, so it is enough to look at the
+    // remaining root slots before the next wrap around
+    uint64_t tick = _current_tick;
+    if ((tick & (ROOT_SIZE - 1)) == 0) {
+        return tick;
+    }
+    do {
+        if (_root[tick & (ROOT_SIZE - 1)] != nullptr) {
+            return tick;
+        }
+        ++tick;
+    } while ((tick & (ROOT_SIZE - 1)) != 0);
+    return tick;
+}
+
+void timing_wheel_timer_service::fire(task *t, uint64_t expire_tick)
+{
+    t->next = nullptr;
+    _pending_count->decrement();
+    _fired_qps->increment();
+    _fire_lag_ms->set(std::max<int64_t>(elapsed_ms() - expire_tick * _tick_ms, 0));
+
+    t->set_delay(0);
+    t->enqueue();
+
+    // to consume the added ref count by task::enqueue for add_timer
+    t->release_ref();
+}
+
+} // namespace tools
+} // namespace dsn
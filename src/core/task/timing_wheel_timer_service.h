@@ -0,0 +1,83 @@
+// Copyright (c) 2019, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include <dsn/perf_counter/perf_counter_wrapper.h>
+#include <dsn/tool-api/timer_service.h>
+#include <dsn/utility/synchronize.h>
+
+namespace dsn {
+namespace tools {
+
+// timing_wheel_timer_service keeps the delayed tasks in a hierarchical timing wheel which is
+// driven by one thread, as simple_timer_service does with its io_service.
+//
+// The wheel has a 256-slot level for the near ticks and 3 64-slot levels above it, so it covers
+// 2^26 ticks; a task further away is parked in the last slot and re-hashed when it is cascaded.
+// Tasks are linked through task::next, which is unused while a task is waiting in the timer, so
+// add_timer is O(1) and needs no allocation. A task is cancelled by its state as usual and is
+// simply dropped by task::exec_internal when it fires.
+class timing_wheel_timer_service : public timer_service
+{
+public:
+    timing_wheel_timer_service(service_node *node, timer_service *inner_provider);
+
+    ~timing_wheel_timer_service() override;
+
+    // after milliseconds, the provider should call task->enqueue()
+    void add_timer(task *task) override;
+
+    void start() override;
+
+private:
+    static const int ROOT_BITS = 8;
+    static const int LEVEL_BITS = 6;
+    static const int LEVEL_COUNT = 3;
+    static const uint32_t ROOT_SIZE = 1u << ROOT_BITS;
+    static const uint32_t LEVEL_SIZE = 1u << LEVEL_BITS;
+    static const uint32_t WHEEL_SPAN = 1u << (ROOT_BITS + LEVEL_BITS * LEVEL_COUNT);
+
+    void run();
+    int64_t elapsed_ms() const;
+    int64_t elapsed_us() const;
+    // move the tasks added by add_timer into the wheel
+    void drain_incoming(uint64_t now);
+    // the expire tick of the task is kept in its delay field while it is in the wheel
+    void place(task *t);
+    void cascade(int level, uint32_t index);
+    // process the current tick, and move to the next one
+    void advance();
+    // the first tick which has something to cascade or fire
+    uint64_t next_due_tick() const;
+    void fire(task *t, uint64_t expire_tick);
+
+private:
+    const uint32_t _tick_ms;
+    std::chrono::steady_clock::time_point _start_time;
+
+    // only accessed by the timer thread
+    task *_root[ROOT_SIZE];
+    task *_levels[LEVEL_COUNT][LEVEL_SIZE];
+    uint64_t _current_tick;
+    uint64_t _wheel_count;
+
+    // tasks added by add_timer, linked by task::next
+    std::atomic<task *> _incoming;
+    std::atomic<bool> _sleeping;
+    utils::semaphore _wakeup;
+    std::atomic<bool> _stopped;
+    std::thread _worker;
+
+    perf_counter_wrapper _pending_count;
+    perf_counter_wrapper _fired_qps;
+    perf_counter_wrapper _fire_lag_ms;
+};
+
+} // namespace tools
+} // namespace dsn
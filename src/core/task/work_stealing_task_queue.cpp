@@ -0,0 +1,154 @@
+// Copyright (c) 2019, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#include "work_stealing_task_queue.h"
+#include "task_engine.h"
+
+#include <boost/function_output_iterator.hpp>
+#include <dsn/tool-api/task_worker.h>
+#include <dsn/utility/rand.h>
+
+namespace dsn {
+namespace tools {
+
+work_stealing_task_queue::work_stealing_task_queue(task_worker_pool *pool,
+                                                   int index,
+                                                   task_queue *inner_provider)
+    : task_queue(pool, index, inner_provider), _sleeping_count(0), _next_slot(0)
+{
+    const threadpool_spec &spec = pool->spec();
+    _slot_count = spec.partitioned ? 1 : std::max(spec.worker_count, 1);
+    _slots.reset(new worker_slot[_slot_count]);
+}
+
+int work_stealing_task_queue::current_slot() const
+{
+    task_worker *worker = task::get_current_worker2();
+    if (worker == nullptr || worker->queue() != this) {
+        return -1;
+    }
+    return _slot_count == 1 ? 0 : worker->index() % _slot_count;
+}
+
+void work_stealing_task_queue::enqueue(task *task)
+{
+    int target = current_slot();
+    if (target == -1) {
+        target = static_cast<int>(_next_slot.fetch_add(1, std::memory_order_relaxed) %
+                                  static_cast<unsigned>(_slot_count));
+    }
+
+    worker_slot &slot = _slots[target];
+    slot.queues[task->spec().priority].enqueue(task);
+
+    // pairs with the fence in dequeue, so that either the sleeper sees the task in its last
+    // check, or we see the sleeper here
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (slot.sleeping.load(std::memory_order_relaxed)) {
+        slot.sema.signal();
+    } else if (_sleeping_count.load(std::memory_order_relaxed) > 0) {
+        wake_up_sleeper(target);
+    }
+}
+
+void work_stealing_task_queue::wake_up_sleeper(int except)
+{
+    int start = static_cast<int>(rand::next_u32(0, _slot_count - 1));
+    for (int i = 0; i < _slot_count; ++i) {
+        int victim = (start + i) % _slot_count;
+        if (victim != except && _slots[victim].sleeping.load(std::memory_order_relaxed)) {
+            _slots[victim].sema.signal();
+            return;
+        }
+    }
+}
+
+int work_stealing_task_queue::take(worker_slot &slot, int batch_size, task *&head, task *&last)
+{
+    auto out = boost::make_function_output_iterator([&head, &last](task *in) {
+        if (last) {
+            last->next = in;
+        } else {
+            head = in;
+        }
+
+        last = in;
+        last->next = nullptr;
+    });
+
+    int count = 0;
+    for (int pri = TASK_PRIORITY_COUNT - 1; pri >= 0 && count < batch_size; --pri) {
+        count += static_cast<int>(slot.queues[pri].try_dequeue_bulk(out, batch_size - count));
+    }
+    return count;
+}
+
+int work_stealing_task_queue::steal(int self, int batch_size, task *&head, task *&last)
+{
+    if (_slot_count == 1) {
+        return 0;
+    }
+
+    int start = static_cast<int>(rand::next_u32(0, _slot_count - 1));
+    for (int i = 0; i < _slot_count; ++i) {
+        int victim = (start + i) % _slot_count;
+        if (victim == self) {
+            continue;
+        }
+        int count = take(_slots[victim], batch_size, head, last);
+        if (count > 0) {
+            return count;
+        }
+    }
+    return 0;
+}
+
+task *work_stealing_task_queue::dequeue(/*inout*/ int &batch_size)
+{
+    int self = current_slot();
+    if (self == -1) {
+        // not called from a worker of this queue, e.g. a test thread, use the first slot
+        self = 0;
+    }
+    worker_slot &slot = _slots[self];
+
+    task *head = nullptr, *last = nullptr;
+    int count = take(slot, batch_size, head, last);
+    if (count == 0) {
+        count = steal(self, batch_size, head, last);
+    }
+
+    if (count == 0) {
+        slot.sleeping.store(true, std::memory_order_relaxed);
+        _sleeping_count.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        // check again, a task may have been queued before we were marked as sleeping
+        count = take(slot, batch_size, head, last);
+        if (count == 0) {
+            count = steal(self, batch_size, head, last);
+        }
+        if (count == 0) {
+            // an idle worker sleeps until a task is queued to it, or to a busy worker, see
+            // enqueue()
+            slot.sema.wait();
+        }
+
+        _sleeping_count.fetch_sub(1, std::memory_order_relaxed);
+        slot.sleeping.store(false, std::memory_order_relaxed);
+
+        if (count == 0) {
+            count = take(slot, batch_size, head, last);
+            if (count == 0) {
+                count = steal(self, batch_size, head, last);
+            }
+        }
+    }
+
+    batch_size = count;
+    return head;
+}
+
+} // namespace tools
+} // namespace dsn
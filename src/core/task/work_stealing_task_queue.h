@@ -0,0 +1,63 @@
+// Copyright (c) 2019, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include <concurrentqueue/concurrentqueue.h>
+
+#include <dsn/tool-api/task_queue.h>
+#include <dsn/utility/synchronize.h>
+
+namespace dsn {
+namespace tools {
+
+// work_stealing_task_queue gives each worker sharing the queue its own local queues and its own
+// semaphore, instead of the one semaphore which all the workers of the pool contend on in
+// hpc_concurrent_task_queue.
+//
+// - enqueue from a worker of this queue goes to the worker's local queue, otherwise to the
+//   local queue of a worker chosen round-robin, then the owner is woken up.
+// - dequeue takes at most `batch_size` tasks from the local queue, from high priority to low
+//   priority. If it is empty, the worker steals from the other workers starting at a random
+//   victim, and only sleeps when there is nothing to steal.
+// - a sleeping worker is also woken up when a task is queued to a busy worker, so the task can
+//   be stolen instead of waiting for the busy one.
+//
+// It is only useful when `partitioned = false`, otherwise each queue has exactly one worker.
+class work_stealing_task_queue : public task_queue
+{
+public:
+    work_stealing_task_queue(task_worker_pool *pool, int index, task_queue *inner_provider);
+
+    void enqueue(task *task) override;
+
+    task *dequeue(/*inout*/ int &batch_size) override;
+
+private:
+    struct worker_slot
+    {
+        moodycamel::ConcurrentQueue<task *> queues[TASK_PRIORITY_COUNT];
+        utils::semaphore sema;
+        std::atomic<bool> sleeping{false};
+        // keep the sleeping flag and the queues of the next slot off the same cache line
+        char padding[64];
+    };
+
+    // index of the calling worker in _slots, -1 if the caller is not a worker of this queue
+    int current_slot() const;
+
+    // take at most batch_size tasks from slot, and link them to the tail of [head, last]
+    int take(worker_slot &slot, int batch_size, task *&head, task *&last);
+    int steal(int self, int batch_size, task *&head, task *&last);
+    void wake_up_sleeper(int except);
+
+private:
+    std::unique_ptr<worker_slot[]> _slots;
+    int _slot_count;
+    std::atomic<int> _sleeping_count;
+    std::atomic<unsigned> _next_slot;
+};
+
+} // namespace tools
+} // namespace dsn
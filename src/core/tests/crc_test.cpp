@@ -0,0 +1,153 @@
+// Copyright (c) 2019, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#include "core/core/crc_internal.h"
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+#include <dsn/utility/crc.h>
+#include <dsn/utility/rand.h>
+#include <gtest/gtest.h>
+
+namespace dsn {
+namespace utils {
+namespace crc_internal {
+
+typedef uint32_t (*crc32_func)(const void *, size_t, uint32_t);
+typedef uint64_t (*crc64_func)(const void *, size_t, uint64_t);
+
+struct crc32_engine_case
+{
+    const char *name;
+    crc32_func func;
+    bool supported;
+};
+
+static std::vector<crc32_engine_case> crc32_engines()
+{
+    return {{"bytewise", crc32_calc_bytewise, true},
+            {"slicing8", crc32_calc_slicing8, true},
+            {"sse42", crc32_calc_sse42, crc32_sse42_supported()},
+            {"pclmul", crc32_calc_pclmul, crc32_pclmul_supported()}};
+}
+
+static std::vector<char> random_buffer(size_t size)
+{
+    std::vector<char> buffer(size);
+    for (size_t i = 0; i < size; ++i) {
+        buffer[i] = static_cast<char>(rand::next_u32(0, 255));
+    }
+    return buffer;
+}
+
+TEST(crc_test, crc32_known_value)
+{
+    // the standard check value of CRC-32C
+    const char *data = "123456789";
+    for (const auto &e : crc32_engines()) {
+        if (e.supported) {
+            ASSERT_EQ(0xe3069283, e.func(data, 9, 0)) << e.name;
+        }
+    }
+    ASSERT_EQ(0xe3069283, crc32_calc(data, 9, 0));
+}
+
+TEST(crc_test, crc32_engines_consistent)
+{
+    // cover unaligned heads, all the tail lengths, and both the short and long 3-way blocks
+    std::vector<char> buffer = random_buffer(3 * 8192 * 2 + 3 * 256 + 100);
+    std::vector<size_t> sizes = {0, 1, 7, 8, 9, 63, 255, 767, 768, 769, 3000, 24575, 24576};
+    sizes.push_back(buffer.size() - 16);
+    for (size_t offset = 0; offset < 8; ++offset) {
+        for (size_t size : sizes) {
+            const char *ptr = buffer.data() + offset;
+            uint32_t init = rand::next_u32();
+            uint32_t expect = crc32_calc_bytewise(ptr, size, init);
+            for (const auto &e : crc32_engines()) {
+                if (e.supported) {
+                    ASSERT_EQ(expect, e.func(ptr, size, init))
+                        << e.name << ", offset = " << offset << ", size = " << size;
+                }
+            }
+            ASSERT_EQ(expect, crc32_calc(ptr, size, init));
+        }
+    }
+}
+
+TEST(crc_test, crc64_engines_consistent)
+{
+    std::vector<char> buffer = random_buffer(4096 + 16);
+    for (size_t offset = 0; offset < 8; ++offset) {
+        for (size_t size : {0, 1, 7, 8, 9, 255, 4096}) {
+            const char *ptr = buffer.data() + offset;
+            uint64_t init = rand::next_u64();
+            uint64_t expect = crc64_calc_bytewise(ptr, size, init);
+            ASSERT_EQ(expect, crc64_calc_slicing8(ptr, size, init));
+            ASSERT_EQ(expect, crc64_calc(ptr, size, init));
+        }
+    }
+}
+
+TEST(crc_test, crc_concat)
+{
+    std::vector<char> buffer = random_buffer(100000);
+    size_t x_size = 30000;
+    size_t y_size = buffer.size() - x_size;
+
+    uint32_t x32 = crc32_calc(buffer.data(), x_size, 0);
+    uint32_t y32 = crc32_calc(buffer.data() + x_size, y_size, 0);
+    ASSERT_EQ(crc32_calc(buffer.data(), buffer.size(), 0),
+              crc32_concat(0, 0, x32, x_size, 0, y32, y_size));
+
+    uint64_t x64 = crc64_calc(buffer.data(), x_size, 0);
+    uint64_t y64 = crc64_calc(buffer.data() + x_size, y_size, 0);
+    ASSERT_EQ(crc64_calc(buffer.data(), buffer.size(), 0),
+              crc64_concat(0, 0, x64, x_size, 0, y64, y_size));
+}
+
+template <typename T>
+static double
+throughput_mb_per_sec(T (*func)(const void *, size_t, T), const std::vector<char> &buf, int rounds)
+{
+    volatile T sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; ++i) {
+        sink = func(buf.data(), buf.size(), sink);
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return buf.size() * static_cast<double>(rounds) / elapsed.count() / (1 << 20);
+}
+
+// a benchmark rather than a unit test, run it with --gtest_also_run_disabled_tests
+TEST(crc_test, DISABLED_benchmark)
+{
+    const size_t bytes_per_case = 16 << 20;
+    std::printf("crc32_calc uses engine: %s\n", crc32_engine_name());
+    for (size_t size = 4 << 10; size <= (4 << 20); size <<= 2) {
+        std::vector<char> buffer = random_buffer(size);
+        int rounds = static_cast<int>(bytes_per_case / size);
+        for (const auto &e : crc32_engines()) {
+            if (e.supported) {
+                std::printf("crc32 %-8s size = %8zu: %10.1f MB/s\n",
+                            e.name,
+                            size,
+                            throughput_mb_per_sec<uint32_t>(e.func, buffer, rounds));
+            }
+        }
+        std::printf("crc64 %-8s size = %8zu: %10.1f MB/s\n",
+                    "bytewise",
+                    size,
+                    throughput_mb_per_sec<uint64_t>(crc64_calc_bytewise, buffer, rounds));
+        std::printf("crc64 %-8s size = %8zu: %10.1f MB/s\n",
+                    "slicing8",
+                    size,
+                    throughput_mb_per_sec<uint64_t>(crc64_calc_slicing8, buffer, rounds));
+    }
+}
+
+} // namespace crc_internal
+} // namespace utils
+} // namespace dsn
@@ -34,8 +34,10 @@
  */
 
 #include "core/tools/common/simple_logger.h"
+#include "core/tools/common/async_logger.h"
 #include <gtest/gtest.h>
 #include <dsn/utility/filesystem.h>
+#include <fstream>
 
 using namespace dsn;
 using namespace dsn::tools;
@@ -130,3 +132,50 @@ TEST(tools_common, simple_logger)
     clear_files(index);
     finish_test_dir();
 }
+
+static int count_log_lines(const std::vector<int> &log_index, const char *pattern)
+{
+    int lines = 0;
+    char file[256];
+    for (auto i : log_index) {
+        snprintf_p(file, 256, "log.%d.txt", i);
+        std::ifstream in(file);
+        std::string line;
+        while (std::getline(in, line)) {
+            if (line.find(pattern) != std::string::npos)
+                ++lines;
+        }
+    }
+    return lines;
+}
+
+TEST(tools_common, async_logger)
+{
+    prepare_test_dir();
+
+    const int thread_count = 8;
+    const int lines_per_thread = 10000;
+    async_logger *logger = new async_logger("./");
+    std::vector<std::thread> threads;
+    for (int t = 0; t < thread_count; ++t) {
+        threads.emplace_back([logger, t]() {
+            for (int i = 0; i < lines_per_thread; ++i)
+                log_print(logger, "async_logger_test thread %d line %d", t, i);
+        });
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+    // records of the exited threads are still in the rings
+    logger->flush();
+    int dropped = static_cast<int>(logger->dropped_count());
+    delete logger;
+
+    std::vector<int> index;
+    get_log_file_index(index);
+    ASSERT_FALSE(index.empty());
+    ASSERT_EQ(thread_count * lines_per_thread - dropped,
+              count_log_lines(index, "async_logger_test"));
+    clear_files(index);
+    finish_test_dir();
+}
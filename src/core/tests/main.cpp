@@ -34,8 +34,10 @@
  */
 
 #include <iostream>
+#include <dsn/utility/configuration.h>
 #include "gtest/gtest.h"
 #include "test_utils.h"
+#include "core/aio/io_uring_aio_provider.h"
 
 extern void task_engine_module_init();
 extern void command_manager_module_init();
@@ -47,6 +49,16 @@ GTEST_API_ int main(int argc, char **argv)
 {
     testing::InitGoogleTest(&argc, argv);
 
+    // the io_uring config can only run where the kernel supports it
+    dsn::configuration config;
+    if (argc > 1 && config.load(argv[1]) &&
+        strcmp("dsn::tools::io_uring_aio_provider",
+               config.get_string_value("core", "aio_factory_name", "", "")) == 0 &&
+        !dsn::io_uring_aio_provider_supported()) {
+        std::cout << "io_uring is not supported, skip the tests of " << argv[1] << std::endl;
+        return 0;
+    }
+
     // register all tools
     task_engine_module_init();
     command_manager_module_init();
@@ -86,6 +86,59 @@ public:
         ASSERT_EQ(reader._buffer.length(), 4500);
         ASSERT_EQ(reader._buffer_occupied, 500);
     }
+
+    void test_copied_bytes()
+    {
+        message_reader reader(4096);
+
+        reader.read_buffer_ptr(4000);
+        reader.mark_read(4000);
+        ASSERT_EQ(reader.take_copied_bytes(), 0);
+
+        // the first 3000 bytes are a consumed message, the remaining 1000 bytes are the prefix
+        // of a 10000 bytes message, which is moved once to a buffer of the message's size
+        reader.consume_buffer(3000);
+        reader.read_buffer_ptr(9000);
+        ASSERT_EQ(reader._buffer.length(), 10000);
+        ASSERT_EQ(reader.take_copied_bytes(), 1000);
+        reader.mark_read(9000);
+        ASSERT_EQ(reader.take_copied_bytes(), 0);
+
+        // the rest of the message is received in place
+        reader.consume_buffer(10000);
+        reader.read_buffer_ptr(100);
+        ASSERT_EQ(reader._buffer.length(), 4096);
+        ASSERT_EQ(reader.take_copied_bytes(), 0);
+    }
+
+    void test_block_reuse()
+    {
+        message_reader reader(8192);
+        const char *first_block = reader.read_buffer_ptr(100);
+        reader.mark_read(100);
+        {
+            // a message keeps the block alive after the reader switches to a new one
+            blob msg = reader.buffer();
+            reader.consume_buffer(100);
+            const char *second_block = reader.read_buffer_ptr(8192);
+            ASSERT_NE(first_block, second_block);
+            ASSERT_EQ(first_block, msg.data());
+        }
+
+        // the first block is back to the reader's own pool once the message is released, and
+        // it's reused when the reader switches to the next block
+        reader.mark_read(8192);
+        reader.consume_buffer(8192);
+        ASSERT_EQ(first_block, reader.read_buffer_ptr(100));
+
+        // the blocks outlive the reader
+        reader.mark_read(100);
+        blob msg = reader.buffer();
+        {
+            message_reader reader2(std::move(reader));
+        }
+        ASSERT_EQ(first_block, msg.data());
+    }
 };
 
 TEST_F(message_reader_test, init) { test_init(); }
@@ -96,4 +149,8 @@ TEST_F(message_reader_test, read_data) { test_read_data(); }
 
 TEST_F(message_reader_test, consume_buffer) { test_consume_buffer(); }
 
+TEST_F(message_reader_test, copied_bytes) { test_copied_bytes(); }
+
+TEST_F(message_reader_test, block_reuse) { test_block_reuse(); }
+
 } // namespace dsn
@@ -0,0 +1,107 @@
+// Copyright (c) 2019, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include <dsn/utility/object_pool.h>
+#include <gtest/gtest.h>
+
+namespace dsn {
+
+TEST(object_pool_test, reuse_on_same_thread)
+{
+    void *p = object_pool_malloc(100);
+    memset(p, 0xff, 100);
+    object_pool_free(p);
+
+#ifndef DSN_OBJECT_POOL_DISABLED
+    // the runtime threads allocate from the pool concurrently, so only the cache of this thread
+    // is checked
+    object_pool_stats before = object_pool_get_thread_stats();
+    // same size class
+    void *q = object_pool_malloc(97);
+    ASSERT_EQ(p, q);
+    object_pool_stats after = object_pool_get_thread_stats();
+    ASSERT_EQ(before.hit_count + 1, after.hit_count);
+    ASSERT_EQ(before.miss_count, after.miss_count);
+    ASSERT_GT(after.resident_bytes, 0);
+    object_pool_free(q);
+#endif
+}
+
+TEST(object_pool_test, large_and_empty)
+{
+    void *p = object_pool_malloc(64 * 1024);
+    memset(p, 0, 64 * 1024);
+    object_pool_free(p);
+
+    p = object_pool_malloc(0);
+    ASSERT_NE(nullptr, p);
+    object_pool_free(p);
+    object_pool_free(nullptr);
+}
+
+TEST(object_pool_test, cross_thread_free)
+{
+    const int count = 10000;
+    std::vector<void *> ptrs;
+    for (int i = 0; i < count; ++i) {
+        ptrs.push_back(object_pool_malloc(200));
+        memset(ptrs.back(), i & 0xff, 200);
+    }
+
+    // free the objects on other threads, they should go back to this thread
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&ptrs, t]() {
+            for (int i = t; i < count; i += 4) {
+                object_pool_free(ptrs[i]);
+            }
+        });
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+
+#ifndef DSN_OBJECT_POOL_DISABLED
+    object_pool_stats before = object_pool_get_thread_stats();
+    std::vector<void *> again;
+    for (int i = 0; i < count; ++i) {
+        again.push_back(object_pool_malloc(200));
+    }
+    object_pool_stats after = object_pool_get_thread_stats();
+    ASSERT_EQ(before.miss_count, after.miss_count);
+    ASSERT_EQ(before.resident_bytes, after.resident_bytes);
+    for (void *p : again) {
+        object_pool_free(p);
+    }
+#endif
+}
+
+TEST(object_pool_test, concurrent_alloc_free)
+{
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([]() {
+            std::vector<void *> ptrs;
+            for (int round = 0; round < 100; ++round) {
+                for (size_t sz = 8; sz <= 1024; sz += 40) {
+                    ptrs.push_back(object_pool_malloc(sz));
+                    memset(ptrs.back(), 0xab, sz);
+                }
+                for (void *p : ptrs) {
+                    object_pool_free(p);
+                }
+                ptrs.clear();
+            }
+        });
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+}
+
+} // namespace dsn
@@ -0,0 +1,96 @@
+// Copyright (c) 2019, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#include "core/perf_counter/perf_counter_atomic.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include <dsn/utility/process_utils.h>
+#include <gtest/gtest.h>
+
+namespace dsn {
+
+// the layout of the NUMBER counter before the slots were padded: adjacent atomics indexed by
+// the tid modulo a prime, kept here as the baseline of the benchmark
+class tid_modulo_counter
+{
+public:
+    tid_modulo_counter()
+    {
+        for (int i = 0; i < 107; i++) {
+            _val[i].store(0);
+        }
+    }
+    void increment()
+    {
+        uint64_t task_id = static_cast<int>(utils::get_current_tid());
+        _val[task_id % 107].fetch_add(1, std::memory_order_relaxed);
+    }
+    int64_t get_integer_value()
+    {
+        int64_t val = 0;
+        for (int i = 0; i < 107; i++) {
+            val += _val[i].load(std::memory_order_relaxed);
+        }
+        return val;
+    }
+
+private:
+    std::atomic<int64_t> _val[107];
+};
+
+// run `thread_count` threads which increment the counter concurrently, and return the
+// increments per second
+template <typename TCounter>
+static double run_counter_benchmark(TCounter &counter, int thread_count, int increments_per_thread)
+{
+    std::atomic<bool> start_flag(false);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < thread_count; ++i) {
+        threads.emplace_back([&]() {
+            while (!start_flag.load()) {
+                std::this_thread::yield();
+            }
+            for (int j = 0; j < increments_per_thread; ++j) {
+                counter.increment();
+            }
+        });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    start_flag.store(true);
+    for (auto &t : threads) {
+        t.join();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    EXPECT_EQ((int64_t)thread_count * increments_per_thread, counter.get_integer_value());
+    return (double)thread_count * increments_per_thread / elapsed.count();
+}
+
+// a benchmark rather than a unit test, run it with --gtest_also_run_disabled_tests
+TEST(perf_counter, DISABLED_increment_benchmark)
+{
+    const int increments_per_thread = 1000000;
+    for (int thread_count : {1, 2, 4, 8, 16, 32, 64}) {
+        tid_modulo_counter old_counter;
+        double old_ops = run_counter_benchmark(old_counter, thread_count, increments_per_thread);
+
+        perf_counter_number_atomic new_counter(
+            "", "", "", dsn_perf_counter_type_t::COUNTER_TYPE_NUMBER, "");
+        double new_ops = run_counter_benchmark(new_counter, thread_count, increments_per_thread);
+
+        std::printf("perf_counter threads = %2d: tid modulo %12.0f ops/s, "
+                    "padded slots %12.0f ops/s\n",
+                    thread_count,
+                    old_ops,
+                    new_ops);
+    }
+}
+
+} // namespace dsn
@@ -125,6 +125,45 @@ TEST(perf_counter, perf_counter_atomic)
     }
 }
 
+TEST(perf_counter, cumulative_value)
+{
+    perf_counter_ptr counter = new perf_counter_volatile_number_atomic(
+        "", "", "", dsn_perf_counter_type_t::COUNTER_TYPE_VOLATILE_NUMBER, "");
+    counter->add(10);
+    counter->increment();
+    ASSERT_EQ(11, counter->get_cumulative_value());
+    // reading the volatile value resets it, but the cumulative value is not affected
+    ASSERT_EQ(11, counter->get_integer_value());
+    ASSERT_EQ(0, counter->get_integer_value());
+    ASSERT_EQ(11, counter->get_cumulative_value());
+    counter->add(5);
+    ASSERT_EQ(5, counter->get_integer_value());
+    ASSERT_EQ(16, counter->get_cumulative_value());
+    counter->set(3);
+    ASSERT_EQ(3, counter->get_integer_value());
+    ASSERT_EQ(19, counter->get_cumulative_value());
+    // setting a value smaller than the pending increments never decreases the cumulative value
+    counter->add(10);
+    counter->set(4);
+    ASSERT_EQ(29, counter->get_cumulative_value());
+    ASSERT_EQ(4, counter->get_integer_value());
+    ASSERT_EQ(0, counter->get_integer_value());
+    ASSERT_EQ(29, counter->get_cumulative_value());
+
+    counter =
+        new perf_counter_rate_atomic("", "", "", dsn_perf_counter_type_t::COUNTER_TYPE_RATE, "");
+    counter->add(100);
+    ASSERT_EQ(100, counter->get_cumulative_value());
+    counter->get_value();
+    counter->add(20);
+    ASSERT_EQ(120, counter->get_cumulative_value());
+
+    counter = new perf_counter_number_atomic(
+        "", "", "", dsn_perf_counter_type_t::COUNTER_TYPE_NUMBER, "");
+    counter->set(42);
+    ASSERT_EQ(42, counter->get_cumulative_value());
+}
+
 TEST(perf_counter, print_type)
 {
     ASSERT_STREQ("NUMBER", dsn_counter_type_to_string(COUNTER_TYPE_NUMBER));
@@ -169,3 +208,77 @@ TEST(perf_counter, print_type)
         dsn_percentile_type_from_string(dsn_percentile_type_to_string(COUNTER_PERCENTILE_999)));
     ASSERT_EQ(COUNTER_PERCENTILE_INVALID, dsn_percentile_type_from_string("afafda"));
 }
+
+TEST(perf_counter, perf_counter_number_histogram)
+{
+    typedef perf_counter_number_histogram_atomic histogram_counter;
+
+    // the buckets are continuous, and the relative error is bounded
+    for (int i = 0; i < HISTOGRAM_BUCKETS; ++i) {
+        int64_t lower = histogram_counter::bucket_lower_bound(i);
+        int64_t upper = lower + histogram_counter::bucket_width(i) - 1;
+        ASSERT_EQ(i, histogram_counter::bucket_index(lower));
+        ASSERT_EQ(i, histogram_counter::bucket_index(upper));
+        if (i + 1 < HISTOGRAM_BUCKETS) {
+            ASSERT_EQ(upper + 1, histogram_counter::bucket_lower_bound(i + 1));
+        }
+        ASSERT_LE(histogram_counter::bucket_width(i) * HISTOGRAM_SUB_BUCKETS,
+                  std::max(lower, (int64_t)HISTOGRAM_SUB_BUCKETS));
+    }
+    ASSERT_EQ(0, histogram_counter::bucket_index(-1));
+    ASSERT_EQ(HISTOGRAM_BUCKETS - 1, histogram_counter::bucket_index(INT64_MAX));
+
+    ref_ptr<histogram_counter> counter = new histogram_counter(
+        "", "", "", dsn_perf_counter_type_t::COUNTER_TYPE_NUMBER_PERCENTILES, "");
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([counter, t]() {
+            for (int i = t + 1; i <= 10000; i += 4) {
+                counter->set(i);
+            }
+        });
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+    counter->calc();
+
+    struct
+    {
+        dsn_perf_counter_percentile_type_t type;
+        double expected;
+    } tests[] = {{COUNTER_PERCENTILE_50, 5001},
+                 {COUNTER_PERCENTILE_90, 9001},
+                 {COUNTER_PERCENTILE_95, 9501},
+                 {COUNTER_PERCENTILE_99, 9901},
+                 {COUNTER_PERCENTILE_999, 9991}};
+    for (const auto &test : tests) {
+        double value = counter->get_percentile(test.type);
+        ASSERT_LE(std::abs(value - test.expected), test.expected / HISTOGRAM_SUB_BUCKETS)
+            << dsn_percentile_type_to_string(test.type) << " = " << value;
+    }
+
+    std::vector<perf_counter::histogram_bucket> buckets;
+    int64_t sum = 0;
+    ASSERT_TRUE(counter->get_histogram(buckets, sum));
+    ASSERT_EQ(10000LL * 10001 / 2, sum);
+    uint64_t count = 0;
+    for (const auto &b : buckets) {
+        count += b.count;
+    }
+    ASSERT_EQ(10000, count);
+
+    // the percentiles are kept if nothing is set during the interval
+    double p99 = counter->get_percentile(COUNTER_PERCENTILE_99);
+    counter->calc();
+    ASSERT_EQ(p99, counter->get_percentile(COUNTER_PERCENTILE_99));
+
+    // only the values set since last computation are taken into account
+    for (int i = 0; i < 100; ++i) {
+        counter->set(7);
+    }
+    counter->calc();
+    ASSERT_EQ(7, counter->get_percentile(COUNTER_PERCENTILE_50));
+    ASSERT_EQ(7, counter->get_percentile(COUNTER_PERCENTILE_999));
+    ASSERT_EQ(7, counter->get_latest_sample());
+}
@@ -37,6 +37,9 @@
 #include <dsn/perf_counter/perf_counter_wrapper.h>
 #include <dsn/perf_counter/perf_counter_utils.h>
 #include <gtest/gtest.h>
+#include <chrono>
+#include <cstring>
+#include <thread>
 
 using namespace ::dsn;
 
@@ -318,6 +321,139 @@ TEST(perf_counters_test, query_snapshot_by_regexp)
     ASSERT_TRUE(info.counters.empty());
 }
 
+TEST(perf_counters_test, query_histogram_by_regexp)
+{
+    dsn::perf_counter_wrapper c1;
+    c1.init_global_counter("h", "s", "test_counter", COUNTER_TYPE_NUMBER_PERCENTILES, "");
+    dsn::perf_counter_wrapper c2;
+    c2.init_global_counter("h", "s", "test_counter_number", COUNTER_TYPE_NUMBER, "");
+    for (int i = 0; i < 10; ++i) {
+        c1->set(100);
+    }
+    c1->set(1);
+
+    std::string result = perf_counters::instance().list_histogram_by_regexp({"h\\*s\\*.*"});
+    dsn::perf_counter_histogram_info info;
+    dsn::json::json_forwarder<dsn::perf_counter_histogram_info>::decode(
+        dsn::blob(result.c_str(), 0, result.size()), info);
+    ASSERT_STREQ("OK", info.result.c_str());
+
+    // the counters not backed by histogram are skipped
+    ASSERT_EQ(1, info.histograms.size());
+    const dsn::perf_counter_histogram &h = info.histograms[0];
+    ASSERT_EQ("h*s*test_counter", h.name);
+    ASSERT_EQ(11, h.count);
+    ASSERT_EQ(1001, h.sum);
+    ASSERT_EQ(2, h.buckets.size());
+    ASSERT_EQ(1, h.buckets[0].lower);
+    ASSERT_EQ(1, h.buckets[0].upper);
+    ASSERT_EQ(1, h.buckets[0].count);
+    ASSERT_LE(h.buckets[1].lower, 100);
+    ASSERT_GE(h.buckets[1].upper, 100);
+    ASSERT_EQ(10, h.buckets[1].count);
+
+    result = perf_counters::instance().list_histogram_by_regexp({"\\"});
+    dsn::json::json_forwarder<dsn::perf_counter_histogram_info>::decode(
+        dsn::blob(result.c_str(), 0, result.size()), info);
+    ASSERT_NE("OK", info.result);
+}
+
+TEST(perf_counters_test, snapshot_without_side_effect)
+{
+    dsn::perf_counter_wrapper c1;
+    c1.init_global_counter("e", "s", "test_volatile", COUNTER_TYPE_VOLATILE_NUMBER, "");
+    dsn::perf_counter_wrapper c2;
+    c2.init_global_counter("e", "s", "test_rate", COUNTER_TYPE_RATE, "");
+
+    std::map<std::string, double> values;
+    perf_counters::snapshot_iterator iter = [&values](const perf_counters::counter_snapshot &cs) {
+        values[cs.name] = cs.value;
+    };
+
+    c1->add(10);
+    c2->add(10);
+    perf_counters::instance().take_snapshot();
+    perf_counters::instance().iterate_snapshot(iter);
+    ASSERT_EQ(10, values["e*s*test_volatile"]);
+    // the rate is unknown in the first snapshot
+    ASSERT_EQ(0, values["e*s*test_rate"]);
+
+    // reading the counters somewhere else doesn't affect the snapshot
+    c1->add(5);
+    c2->add(5);
+    ASSERT_EQ(5, c1->get_integer_value());
+    c2->get_value();
+    ASSERT_EQ(15, c1->get_cumulative_value());
+    ASSERT_EQ(15, c2->get_cumulative_value());
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    perf_counters::instance().take_snapshot();
+    perf_counters::instance().iterate_snapshot(iter);
+    ASSERT_EQ(5, values["e*s*test_volatile"]);
+    ASSERT_GT(values["e*s*test_rate"], 0);
+
+    perf_counters::instance().take_snapshot();
+    perf_counters::instance().iterate_snapshot(iter);
+    ASSERT_EQ(0, values["e*s*test_volatile"]);
+    ASSERT_EQ(0, values["e*s*test_rate"]);
+}
+
+TEST(perf_counters_test, snapshot_of_counter_registered_again)
+{
+    std::map<std::string, double> values;
+    perf_counters::snapshot_iterator iter = [&values](const perf_counters::counter_snapshot &cs) {
+        values[cs.name] = cs.value;
+    };
+
+    {
+        dsn::perf_counter_wrapper c;
+        c.init_global_counter("e", "s", "test_rereg", COUNTER_TYPE_VOLATILE_NUMBER, "");
+        c->add(10);
+        perf_counters::instance().take_snapshot();
+        perf_counters::instance().iterate_snapshot(iter);
+        ASSERT_EQ(10, values["e*s*test_rereg"]);
+    }
+
+    // the new counter of the same name is not mistaken for the old one, even if its cumulative
+    // value is larger
+    dsn::perf_counter_wrapper c;
+    c.init_global_counter("e", "s", "test_rereg", COUNTER_TYPE_VOLATILE_NUMBER, "");
+    c->add(20);
+    perf_counters::instance().take_snapshot();
+    perf_counters::instance().iterate_snapshot(iter);
+    ASSERT_EQ(20, values["e*s*test_rereg"]);
+
+    c->add(3);
+    perf_counters::instance().take_snapshot();
+    perf_counters::instance().iterate_snapshot(iter);
+    ASSERT_EQ(3, values["e*s*test_rereg"]);
+}
+
+TEST(perf_counters_test, iterate_counters)
+{
+    auto count_counters = [](const char *app) {
+        int count = 0;
+        perf_counters::instance().iterate_counters([&count, app](const perf_counter_ptr &c) {
+            if (strcmp(c->app(), app) == 0) {
+                ++count;
+            }
+        });
+        return count;
+    };
+
+    ASSERT_EQ(0, count_counters("iter"));
+    {
+        dsn::perf_counter_wrapper c1;
+        c1.init_global_counter("iter", "s", "test_counter1", COUNTER_TYPE_NUMBER, "");
+        ASSERT_EQ(1, count_counters("iter"));
+        dsn::perf_counter_wrapper c2;
+        c2.init_global_counter("iter", "s", "test_counter2", COUNTER_TYPE_NUMBER, "");
+        ASSERT_EQ(2, count_counters("iter"));
+    }
+    // the published list is rebuilt after the counters are removed
+    ASSERT_EQ(0, count_counters("iter"));
+}
+
 TEST(perf_counters_test, get_by_fullname)
 {
     struct test_case
@@ -0,0 +1,141 @@
+// Copyright (c) 2019, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#include "core/core/service_engine.h"
+#include "core/task/task_engine.h"
+#include "core/task/hpc_task_queue.h"
+#include "core/task/simple_task_queue.h"
+#include "core/task/work_stealing_task_queue.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+#include <dsn/tool-api/task_worker.h>
+#include <gtest/gtest.h>
+
+namespace dsn {
+
+DEFINE_TASK_CODE(LPC_TASK_QUEUE_BENCHMARK, TASK_PRIORITY_COMMON, THREAD_POOL_DEFAULT)
+// tells the consumer which dequeues it to quit
+DEFINE_TASK_CODE(LPC_TASK_QUEUE_BENCHMARK_QUIT, TASK_PRIORITY_LOW, THREAD_POOL_DEFAULT)
+
+typedef task_queue *(*queue_creator)(task_worker_pool *, int, task_queue *);
+
+struct queue_case
+{
+    const char *name;
+    queue_creator create;
+};
+
+// run `worker_count` consumers and `producer_count` producers on one queue shared by all the
+// consumers, which is the `partitioned = false` setup, and return the tasks passed per second
+static double run_queue_benchmark(const queue_case &qc,
+                                  int worker_count,
+                                  int producer_count,
+                                  int tasks_per_producer)
+{
+    service_node *node = task::get_current_node2();
+    threadpool_spec spec = node->computation()->get_pool(THREAD_POOL_DEFAULT)->spec();
+    spec.name = std::string("THREAD_POOL_BENCHMARK_") + qc.name;
+    spec.worker_count = worker_count;
+    spec.partitioned = false;
+    task_worker_pool pool(spec, node->computation());
+    std::unique_ptr<task_queue> q(qc.create(&pool, 0, nullptr));
+
+    const int total = producer_count * tasks_per_producer;
+    std::vector<task_ptr> tasks;
+    tasks.reserve(total + worker_count);
+    for (int i = 0; i < total; ++i) {
+        tasks.emplace_back(new raw_task(LPC_TASK_QUEUE_BENCHMARK, []() {}));
+    }
+    for (int i = 0; i < worker_count; ++i) {
+        tasks.emplace_back(new raw_task(LPC_TASK_QUEUE_BENCHMARK_QUIT, []() {}));
+    }
+
+    std::atomic<int> consumed(0);
+    std::vector<std::thread> consumers;
+    std::vector<std::unique_ptr<task_worker>> workers;
+    for (int i = 0; i < worker_count; ++i) {
+        workers.emplace_back(new task_worker(&pool, q.get(), i, nullptr));
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < worker_count; ++i) {
+        consumers.emplace_back([&, i]() {
+            task::set_tls_dsn_context(node, workers[i].get());
+            int batch_size = spec.dequeue_batch_size;
+            bool quit = false;
+            while (!quit) {
+                int count = batch_size;
+                task *t = q->dequeue(count);
+                while (t != nullptr) {
+                    task *next = t->next;
+                    t->next = nullptr;
+                    if (t->code() == LPC_TASK_QUEUE_BENCHMARK_QUIT) {
+                        if (quit) {
+                            // leave the extra quit task to another consumer
+                            q->enqueue(t);
+                        }
+                        quit = true;
+                    } else {
+                        consumed.fetch_add(1, std::memory_order_relaxed);
+                    }
+                    t = next;
+                }
+            }
+        });
+    }
+
+    std::vector<std::thread> producers;
+    for (int i = 0; i < producer_count; ++i) {
+        producers.emplace_back([&, i]() {
+            task::set_tls_dsn_context(node, nullptr);
+            for (int j = 0; j < tasks_per_producer; ++j) {
+                q->enqueue(tasks[i * tasks_per_producer + j].get());
+            }
+        });
+    }
+    for (auto &t : producers) {
+        t.join();
+    }
+    while (consumed.load() < total) {
+        std::this_thread::yield();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    for (int i = 0; i < worker_count; ++i) {
+        q->enqueue(tasks[total + i].get());
+    }
+    for (auto &t : consumers) {
+        t.join();
+    }
+    return total / elapsed.count();
+}
+
+// a benchmark rather than a unit test, run it with --gtest_also_run_disabled_tests
+TEST(core, DISABLED_task_queue_benchmark)
+{
+    if (dsn::service_engine::instance().spec().tool == "simulator")
+        return;
+
+    std::vector<queue_case> cases = {
+        {"simple", task_queue::create<tools::simple_task_queue>},
+        {"hpc", task_queue::create<tools::hpc_concurrent_task_queue>},
+        {"work_stealing", task_queue::create<tools::work_stealing_task_queue>}};
+    const int producer_count = 4;
+    const int tasks_per_producer = 50000;
+    for (int worker_count : {1, 4, 16, 64}) {
+        for (const auto &qc : cases) {
+            double tps = run_queue_benchmark(qc, worker_count, producer_count, tasks_per_producer);
+            std::printf("task_queue %-14s workers = %2d: %12.0f tasks/s\n",
+                        qc.name,
+                        worker_count,
+                        tps);
+        }
+    }
+}
+
+} // namespace dsn
@@ -0,0 +1,68 @@
+// Copyright (c) 2019, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#include "core/core/service_engine.h"
+#include "core/task/timing_wheel_timer_service.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include <dsn/tool-api/task.h>
+#include <dsn/utility/defer.h>
+#include <dsn/utility/flags.h>
+#include <gtest/gtest.h>
+
+namespace dsn {
+namespace tools {
+
+DEFINE_TASK_CODE(LPC_TIMING_WHEEL_TEST, TASK_PRIORITY_COMMON, THREAD_POOL_DEFAULT)
+
+DSN_DECLARE_uint32(timer_wheel_tick_ms);
+
+TEST(core, timing_wheel_timer_service)
+{
+    if (dsn::service_engine::instance().spec().tool == "simulator")
+        return;
+
+    uint32_t old_tick_ms = FLAGS_timer_wheel_tick_ms;
+    auto cleanup = dsn::defer([old_tick_ms]() { FLAGS_timer_wheel_tick_ms = old_tick_ms; });
+    // a coarse tick makes a task added late in a tick more likely to fire early
+    for (uint32_t tick_ms : {1, 10}) {
+        FLAGS_timer_wheel_tick_ms = tick_ms;
+        timing_wheel_timer_service svc(task::get_current_node2(), nullptr);
+        svc.start();
+
+        // cover the root level, a cascade from the first level, and tasks of the same slot
+        std::vector<int> delays = {1, 2, 5, 5, 20, 100, 255, 256, 300, 600};
+        std::atomic<int> fired(0);
+        std::atomic<bool> too_early(false);
+        for (int delay : delays) {
+            // the tasks are added late in a tick as well
+            std::this_thread::sleep_for(std::chrono::microseconds(900));
+            auto start = std::chrono::steady_clock::now();
+            task *t = new raw_task(LPC_TIMING_WHEEL_TEST, [delay, start, &fired, &too_early]() {
+                auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - start);
+                if (elapsed.count() < delay * 1000) {
+                    too_early.store(true);
+                }
+                fired.fetch_add(1);
+            });
+            t->set_delay(delay);
+            // released by the timer service after it fires, as task::enqueue does for add_timer
+            t->add_ref();
+            svc.add_timer(t);
+        }
+
+        for (int i = 0; i < 100 && fired.load() < delays.size(); ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+        ASSERT_EQ(delays.size(), fired.load()) << "tick_ms = " << tick_ms;
+        ASSERT_FALSE(too_early.load()) << "tick_ms = " << tick_ms;
+    }
+}
+
+} // namespace tools
+} // namespace dsn
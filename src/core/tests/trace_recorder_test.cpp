@@ -0,0 +1,211 @@
+// Copyright (c) 2019, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#include "core/tools/common/trace_ring.h"
+
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <thread>
+
+#include <dsn/tool-api/async_calls.h>
+#include <dsn/tool-api/command_manager.h>
+#include <dsn/toollet/trace_recorder.h>
+#include <gtest/gtest.h>
+
+namespace dsn {
+namespace tools {
+
+DEFINE_TASK_CODE(LPC_TRACE_RECORDER_TEST, TASK_PRIORITY_COMMON, THREAD_POOL_DEFAULT)
+
+static std::string format_task_id(uint64_t task_id)
+{
+    char buf[32];
+    snprintf(buf, sizeof(buf), "\"task_id\":\"%016" PRIx64 "\"", task_id);
+    return buf;
+}
+
+TEST(trace_recorder, ring_overwrite)
+{
+    trace_ring ring(3);
+    ASSERT_EQ(4, ring.capacity());
+
+    std::vector<trace_record> records;
+    ring.copy_to(records);
+    ASSERT_TRUE(records.empty());
+
+    for (uint64_t i = 0; i < 10; ++i) {
+        trace_record r;
+        r.task_id = i;
+        ring.append(r);
+    }
+    // only the latest records are kept, in the order they are appended
+    ring.copy_to(records);
+    ASSERT_EQ(4, records.size());
+    for (uint64_t i = 0; i < 4; ++i) {
+        ASSERT_EQ(6 + i, records[i].task_id);
+    }
+
+    ASSERT_FALSE(ring.try_acquire());
+    ring.release();
+    ASSERT_TRUE(ring.try_acquire());
+}
+
+TEST(trace_recorder, ring_copy_with_concurrent_writer)
+{
+    trace_ring ring(64);
+    std::atomic<bool> stopped(false);
+    std::thread writer([&]() {
+        for (uint64_t i = 0; !stopped.load(std::memory_order_relaxed); ++i) {
+            trace_record r;
+            r.ts_ns = i;
+            r.task_id = i;
+            r.trace_id = i;
+            r.arg = i;
+            ring.append(r);
+        }
+    });
+
+    // the records which might be overwritten during the copy are dropped, so the copied ones are
+    // never torn and always the consecutive latest ones
+    std::string error;
+    int dropped_copies = 0;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    for (int i = 0; error.empty() && (i < 100000 || dropped_copies == 0); ++i) {
+        if (i >= 100000 && std::chrono::steady_clock::now() > deadline) {
+            break;
+        }
+        std::vector<trace_record> records;
+        ring.copy_to(records);
+        if (records.size() > ring.capacity()) {
+            error = "too many records: " + std::to_string(records.size());
+        }
+        for (size_t j = 0; error.empty() && j < records.size(); ++j) {
+            const trace_record &r = records[j];
+            if (r.ts_ns != r.task_id || r.trace_id != r.task_id || r.arg != r.task_id) {
+                error = "torn record: " + std::to_string(r.task_id);
+            } else if (j > 0 && records[j - 1].task_id + 1 != r.task_id) {
+                error = "missing record after " + std::to_string(records[j - 1].task_id);
+            }
+        }
+        if (!records.empty() && records.front().task_id > 0 &&
+            records.size() < ring.capacity()) {
+            ++dropped_copies;
+        }
+    }
+    stopped.store(true);
+    writer.join();
+    ASSERT_TRUE(error.empty()) << error;
+
+    // the records can only be overwritten during the copy if the writer runs at the same time
+    if (std::thread::hardware_concurrency() > 1) {
+        ASSERT_GT(dropped_copies, 0);
+    }
+}
+
+// find the event of the task in the given phase, each event is dumped in a line
+static std::string find_event(const std::string &trace, const char *phase, uint64_t task_id)
+{
+    std::string prefix = std::string("{\"name\":\"LPC_TRACE_RECORDER_TEST\",\"ph\":\"") + phase;
+    std::string id = format_task_id(task_id);
+    size_t begin = 0;
+    while (begin < trace.size()) {
+        size_t end = trace.find('\n', begin);
+        if (end == std::string::npos) {
+            end = trace.size();
+        }
+        std::string line = trace.substr(begin, end - begin);
+        if (line.find(prefix) != std::string::npos && line.find(id) != std::string::npos) {
+            return line;
+        }
+        begin = end + 1;
+    }
+    return std::string();
+}
+
+TEST(trace_recorder, dump_chrome_trace)
+{
+    task_ptr t = tasking::enqueue(LPC_TRACE_RECORDER_TEST, nullptr, []() {});
+    t->wait();
+
+    // the toollet is enabled in config-test.ini. wait() returns once the task is finished, which
+    // is before the end hooks are executed, so the end event may be recorded a little later.
+    std::string trace;
+    std::string end_event;
+    for (int i = 0; i < 1000 && end_event.empty(); ++i) {
+        if (i > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        trace = trace_recorder::dump_chrome_trace();
+        end_event = find_event(trace, "E", t->id());
+    }
+    ASSERT_EQ(0, trace.find("{\"traceEvents\":["));
+    ASSERT_FALSE(find_event(trace, "B", t->id()).empty());
+    ASSERT_FALSE(end_event.empty());
+    ASSERT_NE(std::string::npos, end_event.find("\"err\":\"ERR_OK\"")) << end_event;
+
+    // nothing is recorded if the sample interval is 0
+    std::string output;
+    ASSERT_TRUE(command_manager::instance().run_command(
+        "trace-recorder.sample-interval", {"0"}, output));
+    ASSERT_EQ("OK", output);
+    t = tasking::enqueue(LPC_TRACE_RECORDER_TEST, nullptr, []() {});
+    t->wait();
+    trace = trace_recorder::dump_chrome_trace();
+    ASSERT_EQ(std::string::npos, trace.find(format_task_id(t->id())));
+
+    ASSERT_TRUE(command_manager::instance().run_command(
+        "trace-recorder.sample-interval", {"1"}, output));
+    ASSERT_TRUE(command_manager::instance().run_command(
+        "trace-recorder.sample-interval", {}, output));
+    ASSERT_EQ("1", output);
+}
+
+TEST(trace_recorder, sample_interval)
+{
+    std::string output;
+    ASSERT_TRUE(command_manager::instance().run_command(
+        "trace-recorder.sample-interval", {"4"}, output));
+    ASSERT_EQ("OK", output);
+
+    // each parent task enqueues a child task, which is sampled along with its parent
+    const int count = 64;
+    std::vector<task_ptr> parents;
+    std::vector<task_ptr> children(count);
+    for (int i = 0; i < count; ++i) {
+        parents.push_back(tasking::enqueue(LPC_TRACE_RECORDER_TEST, nullptr, [&children, i]() {
+            children[i] = tasking::enqueue(LPC_TRACE_RECORDER_TEST, nullptr, []() {});
+        }));
+    }
+    for (int i = 0; i < count; ++i) {
+        parents[i]->wait();
+        children[i]->wait();
+    }
+
+    std::string trace = trace_recorder::dump_chrome_trace();
+    int sampled = 0;
+    for (int i = 0; i < count; ++i) {
+        std::string parent_event = find_event(trace, "B", parents[i]->id());
+        std::string child_event = find_event(trace, "B", children[i]->id());
+        ASSERT_EQ(parent_event.empty(), child_event.empty()) << parent_event << child_event;
+        if (!parent_event.empty()) {
+            ++sampled;
+            // the child joins the trace of the parent
+            char trace_id[64];
+            snprintf(
+                trace_id, sizeof(trace_id), "\"trace_id\":\"%016" PRIx64 "\"", parents[i]->id());
+            ASSERT_NE(std::string::npos, child_event.find(trace_id)) << child_event;
+        }
+    }
+    // each parent is sampled with a probability of 1/4
+    ASSERT_GT(sampled, 0);
+    ASSERT_LT(sampled, count);
+
+    ASSERT_TRUE(command_manager::instance().run_command(
+        "trace-recorder.sample-interval", {"1"}, output));
+    ASSERT_EQ("OK", output);
+}
+
+} // namespace tools
+} // namespace dsn
@@ -165,6 +165,25 @@ TEST(core, trim_string)
     EXPECT_EQ(std::string(r), "x x x x");
 }
 
+TEST(core, md5_hasher)
+{
+    std::string value;
+    for (int i = 0; i < 1000; ++i) {
+        value.push_back(static_cast<char>('a' + i % 26));
+    }
+
+    md5_hasher hasher;
+    for (size_t offset = 0; offset < value.size(); offset += 333) {
+        hasher.update(value.data() + offset, std::min<size_t>(333, value.size() - offset));
+    }
+    std::string md5 = hasher.finalize();
+    EXPECT_EQ(32, md5.size());
+    EXPECT_EQ(string_md5(value.data(), value.size()), md5);
+
+    md5_hasher empty_hasher;
+    EXPECT_EQ("d41d8cd98f00b204e9800998ecf8427e", empty_hasher.finalize());
+}
+
 TEST(core, dlink)
 {
     dlink links[10];
@@ -0,0 +1,177 @@
+// Copyright (c) 2019, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#include "core/core/service_engine.h"
+#include "core/task/task_engine.h"
+#include "core/task/work_stealing_task_queue.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include <dsn/tool-api/task_worker.h>
+#include <gtest/gtest.h>
+
+namespace dsn {
+
+DEFINE_TASK_CODE(LPC_WORK_STEALING_TEST_LOW, TASK_PRIORITY_LOW, THREAD_POOL_DEFAULT)
+DEFINE_TASK_CODE(LPC_WORK_STEALING_TEST_COMMON, TASK_PRIORITY_COMMON, THREAD_POOL_DEFAULT)
+DEFINE_TASK_CODE(LPC_WORK_STEALING_TEST_HIGH, TASK_PRIORITY_HIGH, THREAD_POOL_DEFAULT)
+
+class work_stealing_task_queue_test : public ::testing::Test
+{
+public:
+    void SetUp() override
+    {
+        if (service_engine::instance().spec().tool == "simulator") {
+            _skipped = true;
+        }
+    }
+
+    // a queue shared by `worker_count` workers, which are not started so that the tests
+    // dequeue on behalf of them
+    void create_queue(int worker_count)
+    {
+        _node = task::get_current_node2();
+        threadpool_spec spec = _node->computation()->get_pool(THREAD_POOL_DEFAULT)->spec();
+        spec.name = "THREAD_POOL_WORK_STEALING_TEST";
+        spec.worker_count = worker_count;
+        spec.partitioned = false;
+        _pool.reset(new task_worker_pool(spec, _node->computation()));
+        _queue.reset(task_queue::create<tools::work_stealing_task_queue>(_pool.get(), 0, nullptr));
+        for (int i = 0; i < worker_count; ++i) {
+            _workers.emplace_back(new task_worker(_pool.get(), _queue.get(), i, nullptr));
+        }
+    }
+
+    task *create_task(task_code code)
+    {
+        _tasks.emplace_back(new raw_task(code, []() {}));
+        return _tasks.back().get();
+    }
+
+    // run `f` on a thread acting as the worker of `index`
+    template <typename F>
+    void run_as_worker(int index, F &&f)
+    {
+        std::thread t([this, index, &f]() {
+            task::set_tls_dsn_context(_node, _workers[index].get());
+            f();
+        });
+        t.join();
+    }
+
+    static std::vector<task *> to_vector(task *head)
+    {
+        std::vector<task *> result;
+        for (task *t = head; t != nullptr; t = t->next) {
+            result.push_back(t);
+        }
+        return result;
+    }
+
+    bool _skipped{false};
+    service_node *_node{nullptr};
+    std::unique_ptr<task_worker_pool> _pool;
+    std::unique_ptr<task_queue> _queue;
+    std::vector<std::unique_ptr<task_worker>> _workers;
+    std::vector<task_ptr> _tasks;
+};
+
+TEST_F(work_stealing_task_queue_test, priority_order)
+{
+    if (_skipped)
+        return;
+
+    create_queue(1);
+    task *low = create_task(LPC_WORK_STEALING_TEST_LOW);
+    task *common = create_task(LPC_WORK_STEALING_TEST_COMMON);
+    task *high = create_task(LPC_WORK_STEALING_TEST_HIGH);
+    _queue->enqueue(low);
+    _queue->enqueue(common);
+    _queue->enqueue(high);
+
+    int batch_size = 3;
+    task *head = _queue->dequeue(batch_size);
+    ASSERT_EQ(3, batch_size);
+    ASSERT_EQ(std::vector<task *>({high, common, low}), to_vector(head));
+}
+
+TEST_F(work_stealing_task_queue_test, batch_size)
+{
+    if (_skipped)
+        return;
+
+    create_queue(1);
+    std::vector<task *> tasks;
+    for (int i = 0; i < 5; ++i) {
+        tasks.push_back(create_task(LPC_WORK_STEALING_TEST_COMMON));
+        _queue->enqueue(tasks.back());
+    }
+
+    // no more than batch_size tasks are dequeued at once, in the order they are queued
+    for (int start : {0, 2, 4}) {
+        int batch_size = 2;
+        task *head = _queue->dequeue(batch_size);
+        std::vector<task *> expected(tasks.begin() + start,
+                                     tasks.begin() + std::min(start + 2, 5));
+        ASSERT_EQ(static_cast<int>(expected.size()), batch_size);
+        ASSERT_EQ(expected, to_vector(head));
+    }
+}
+
+TEST_F(work_stealing_task_queue_test, steal)
+{
+    if (_skipped)
+        return;
+
+    create_queue(2);
+    task *t1 = create_task(LPC_WORK_STEALING_TEST_COMMON);
+    task *t2 = create_task(LPC_WORK_STEALING_TEST_COMMON);
+
+    // queued to the local queue of worker 1
+    run_as_worker(1, [this, t1, t2]() {
+        _queue->enqueue(t1);
+        _queue->enqueue(t2);
+    });
+
+    // worker 0 has nothing in its own queue, so it steals from worker 1
+    std::vector<task *> stolen;
+    run_as_worker(0, [this, &stolen]() {
+        int batch_size = 2;
+        task *head = _queue->dequeue(batch_size);
+        ASSERT_EQ(2, batch_size);
+        stolen = to_vector(head);
+    });
+    ASSERT_EQ(std::vector<task *>({t1, t2}), stolen);
+}
+
+TEST_F(work_stealing_task_queue_test, wake_up_sleeping_worker)
+{
+    if (_skipped)
+        return;
+
+    create_queue(2);
+    task *t = create_task(LPC_WORK_STEALING_TEST_COMMON);
+
+    std::atomic<bool> dequeued(false);
+    std::thread worker([this, t, &dequeued]() {
+        task::set_tls_dsn_context(_node, _workers[0].get());
+        // sleeps until the task is queued, without polling
+        int batch_size = 1;
+        task *head = _queue->dequeue(batch_size);
+        EXPECT_EQ(1, batch_size);
+        EXPECT_EQ(t, head);
+        dequeued.store(true);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    ASSERT_FALSE(dequeued.load());
+
+    // queued to worker 1, which is busy, so the sleeping worker 0 is woken up to steal it
+    run_as_worker(1, [this, t]() { _queue->enqueue(t); });
+    worker.join();
+    ASSERT_TRUE(dequeued.load());
+}
+
+} // namespace dsn
@@ -0,0 +1,364 @@
+// Copyright (c) 2019, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#include "async_logger.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include <dsn/utility/flags.h>
+
+namespace dsn {
+namespace tools {
+
+DSN_DECLARE_bool(short_header);
+DSN_DECLARE_bool(fast_flush);
+
+DSN_DEFINE_uint32("tools.async_logger",
+                  ring_buffer_kb,
+                  256,
+                  "size of the per-thread log ring buffer in KB, rounded up to a power of 2");
+DSN_DEFINE_validator(ring_buffer_kb, [](uint32_t kb) -> bool { return kb > 0; });
+
+DSN_DEFINE_string("tools.async_logger",
+                  overload_policy,
+                  "drop",
+                  "what to do when the ring buffer of a thread is full: "
+                  "drop (drop the record and count it) or block (wait for the flush thread)");
+DSN_DEFINE_validator(overload_policy, [](const char *policy) -> bool {
+    return strcmp(policy, "drop") == 0 || strcmp(policy, "block") == 0;
+});
+
+DSN_DEFINE_uint32("tools.async_logger",
+                  flush_interval_ms,
+                  10,
+                  "max interval in milliseconds for the flush thread to drain the ring buffers");
+
+// ------------------------------ log_ring ------------------------------
+
+log_ring::log_ring(size_t capacity) : _head(0), _tail(0), _closed(false)
+{
+    _capacity = 1;
+    while (_capacity < capacity) {
+        _capacity <<= 1;
+    }
+    _mask = _capacity - 1;
+    _buffer.reset(new char[_capacity]);
+}
+
+void log_ring::write_bytes(uint64_t pos, const void *src, size_t n)
+{
+    size_t offset = pos & _mask;
+    size_t first = std::min(n, _capacity - offset);
+    memcpy(_buffer.get() + offset, src, first);
+    memcpy(_buffer.get(), static_cast<const char *>(src) + first, n - first);
+}
+
+void log_ring::read_bytes(uint64_t pos, void *dst, size_t n) const
+{
+    size_t offset = pos & _mask;
+    size_t first = std::min(n, _capacity - offset);
+    memcpy(dst, _buffer.get() + offset, first);
+    memcpy(static_cast<char *>(dst) + first, _buffer.get(), n - first);
+}
+
+bool log_ring::try_push(dsn_log_level_t log_level, const char *data, uint32_t len)
+{
+    size_t need = sizeof(record_header) + len;
+    uint64_t head = _head.load(std::memory_order_relaxed);
+    uint64_t tail = _tail.load(std::memory_order_acquire);
+    if (need > _capacity - (head - tail)) {
+        return false;
+    }
+
+    record_header h;
+    h.len = len;
+    h.log_level = static_cast<uint32_t>(log_level);
+    write_bytes(head, &h, sizeof(h));
+    write_bytes(head + sizeof(h), data, len);
+    _head.store(head + need, std::memory_order_release);
+    return true;
+}
+
+template <typename TFunc>
+int log_ring::consume(TFunc &&func)
+{
+    uint64_t head = _head.load(std::memory_order_acquire);
+    uint64_t tail = _tail.load(std::memory_order_relaxed);
+    int count = 0;
+    while (tail < head) {
+        record_header h;
+        read_bytes(tail, &h, sizeof(h));
+
+        uint64_t data_pos = tail + sizeof(h);
+        size_t offset = data_pos & _mask;
+        if (offset + h.len <= _capacity) {
+            func(static_cast<dsn_log_level_t>(h.log_level), _buffer.get() + offset, h.len);
+        } else {
+            _scratch.resize(h.len);
+            read_bytes(data_pos, &_scratch[0], h.len);
+            func(static_cast<dsn_log_level_t>(h.log_level), _scratch.data(), h.len);
+        }
+
+        tail = data_pos + h.len;
+        // release the room as soon as possible for the blocked producer
+        _tail.store(tail, std::memory_order_release);
+        ++count;
+    }
+    return count;
+}
+
+// ------------------------------ async_logger ------------------------------
+
+namespace {
+
+std::atomic<uint64_t> s_next_logger_id(1);
+
+struct thread_ring_holder
+{
+    ~thread_ring_holder()
+    {
+        if (ring != nullptr) {
+            ring->close();
+        }
+    }
+
+    uint64_t logger_id = 0;
+    std::shared_ptr<log_ring> ring;
+};
+
+thread_local thread_ring_holder tls_ring;
+thread_local bool tls_is_flush_thread = false;
+
+// append the formatted string to out
+void append_vformat(std::string &out, const char *fmt, va_list args)
+{
+    size_t old_size = out.size();
+    char buf[1024];
+    va_list args2;
+    va_copy(args2, args);
+    int len = vsnprintf(buf, sizeof(buf), fmt, args);
+    if (len < 0) {
+        va_end(args2);
+        return;
+    }
+    if (static_cast<size_t>(len) < sizeof(buf)) {
+        out.append(buf, len);
+    } else {
+        out.resize(old_size + len + 1);
+        vsnprintf(&out[old_size], len + 1, fmt, args2);
+        out.resize(old_size + len);
+    }
+    va_end(args2);
+}
+
+} // anonymous namespace
+
+async_logger::async_logger(const char *log_dir)
+    : simple_logger(log_dir),
+      _id(s_next_logger_id.fetch_add(1)),
+      _block_on_overload(strcmp(FLAGS_overload_policy, "block") == 0),
+      _exit(false),
+      _dropped_count(0),
+      _reported_dropped_count(0)
+{
+    _flush_thread = std::thread(&async_logger::flush_thread, this);
+}
+
+async_logger::~async_logger(void)
+{
+    _exit.store(true);
+    _wakeup.signal();
+    _flush_thread.join();
+
+    utils::auto_lock<::dsn::utils::ex_lock> l(_lock);
+    drain_rings();
+}
+
+log_ring *async_logger::get_thread_ring()
+{
+    if (tls_ring.logger_id == _id) {
+        return tls_ring.ring.get();
+    }
+
+    // the thread used to log into another logger
+    if (tls_ring.ring != nullptr) {
+        tls_ring.ring->close();
+    }
+    tls_ring.logger_id = _id;
+    tls_ring.ring = std::make_shared<log_ring>(static_cast<size_t>(FLAGS_ring_buffer_kb) * 1024);
+
+    utils::auto_lock<::dsn::utils::ex_lock_nr> l(_rings_lock);
+    _rings.push_back(tls_ring.ring);
+    return tls_ring.ring.get();
+}
+
+void async_logger::push(dsn_log_level_t log_level, const std::string &record)
+{
+    log_ring *ring = tls_is_flush_thread ? nullptr : get_thread_ring();
+    // the flush thread can't wait for itself, and a huge record may never fit in the ring
+    if (ring == nullptr || record.size() + 64 > ring->capacity() / 2) {
+        utils::auto_lock<::dsn::utils::ex_lock> l(_lock);
+        drain_rings();
+        write_record(log_level, record.data(), static_cast<uint32_t>(record.size()));
+        return;
+    }
+
+    while (!ring->try_push(log_level, record.data(), static_cast<uint32_t>(record.size()))) {
+        if (!_block_on_overload) {
+            _dropped_count.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        _wakeup.signal();
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+
+    if (FLAGS_fast_flush || ring->used_bytes() > ring->capacity() / 2) {
+        _wakeup.signal();
+    }
+}
+
+static void format_record(std::string &record,
+                          const char *file,
+                          const char *function,
+                          const int line,
+                          dsn_log_level_t log_level)
+{
+    char header[256];
+    int len = format_log_header(header, sizeof(header), log_level);
+    record.assign(header, len);
+    if (!FLAGS_short_header) {
+        char location[512];
+        int len2 = snprintf(location, sizeof(location), "%s:%d:%s(): ", file, line, function);
+        if (len2 > 0) {
+            record.append(location, std::min(static_cast<size_t>(len2), sizeof(location) - 1));
+        }
+    }
+}
+
+void async_logger::dsn_logv(const char *file,
+                            const char *function,
+                            const int line,
+                            dsn_log_level_t log_level,
+                            const char *fmt,
+                            va_list args)
+{
+    if (log_level >= LOG_LEVEL_FATAL) {
+        flush();
+        simple_logger::dsn_logv(file, function, line, log_level, fmt, args);
+        return;
+    }
+
+    static thread_local std::string record;
+    format_record(record, file, function, line, log_level);
+    append_vformat(record, fmt, args);
+    record.push_back('\n');
+    push(log_level, record);
+}
+
+void async_logger::dsn_log(const char *file,
+                           const char *function,
+                           const int line,
+                           dsn_log_level_t log_level,
+                           const char *str)
+{
+    if (log_level >= LOG_LEVEL_FATAL) {
+        flush();
+        simple_logger::dsn_log(file, function, line, log_level, str);
+        return;
+    }
+
+    static thread_local std::string record;
+    format_record(record, file, function, line, log_level);
+    record.append(str);
+    record.push_back('\n');
+    push(log_level, record);
+}
+
+void async_logger::flush()
+{
+    utils::auto_lock<::dsn::utils::ex_lock> l(_lock);
+    drain_rings();
+    ::fflush(_log);
+    ::fflush(stdout);
+}
+
+void async_logger::write_record(dsn_log_level_t log_level, const char *data, uint32_t len)
+{
+    ::fwrite(data, 1, len, _log);
+    if (log_level >= _stderr_start_level) {
+        ::fwrite(data, 1, len, stdout);
+    }
+    if (++_lines >= 200000) {
+        create_log_file();
+    }
+}
+
+void async_logger::drain_rings()
+{
+    std::vector<std::shared_ptr<log_ring>> rings;
+    {
+        utils::auto_lock<::dsn::utils::ex_lock_nr> l(_rings_lock);
+        rings = _rings;
+    }
+
+    int count = 0;
+    for (auto &ring : rings) {
+        count += ring->consume([this](dsn_log_level_t log_level, const char *data, uint32_t len) {
+            write_record(log_level, data, len);
+        });
+    }
+
+    uint64_t dropped = _dropped_count.load(std::memory_order_relaxed);
+    if (dropped != _reported_dropped_count) {
+        char buf[128];
+        int len = snprintf(buf,
+                           sizeof(buf),
+                           "W async_logger: %" PRIu64 " log records dropped as ring is full\n",
+                           dropped - _reported_dropped_count);
+        write_record(LOG_LEVEL_WARNING, buf, static_cast<uint32_t>(len));
+        _reported_dropped_count = dropped;
+        ++count;
+    }
+
+    if (count > 0) {
+        ::fflush(_log);
+    }
+
+    // rings of the exited threads
+    utils::auto_lock<::dsn::utils::ex_lock_nr> l(_rings_lock);
+    _rings.erase(std::remove_if(_rings.begin(),
+                                _rings.end(),
+                                [](const std::shared_ptr<log_ring> &ring) {
+                                    return ring->closed() && ring->used_bytes() == 0;
+                                }),
+                 _rings.end());
+}
+
+void async_logger::flush_thread()
+{
+    tls_is_flush_thread = true;
+    while (!_exit.load()) {
+        _wakeup.wait(static_cast<int>(FLAGS_flush_interval_ms));
+
+        if (_dropped_counter.get() == nullptr && _dropped_count.load() > 0 &&
+            tools::is_engine_ready()) {
+            _dropped_counter.init_global_counter("replica",
+                                                 "server",
+                                                 "async_logger.dropped.count",
+                                                 COUNTER_TYPE_NUMBER,
+                                                 "log records dropped by async_logger");
+        }
+        if (_dropped_counter.get() != nullptr) {
+            _dropped_counter->set(_dropped_count.load());
+        }
+
+        utils::auto_lock<::dsn::utils::ex_lock> l(_lock);
+        drain_rings();
+    }
+}
+
+} // namespace tools
+} // namespace dsn
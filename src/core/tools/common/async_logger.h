@@ -0,0 +1,130 @@
+// Copyright (c) 2019, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <dsn/perf_counter/perf_counter_wrapper.h>
+#include <dsn/utility/synchronize.h>
+
+#include "simple_logger.h"
+
+namespace dsn {
+namespace tools {
+
+// a single-producer single-consumer ring of log records.
+// the producer is the owner thread, the consumer is whoever holds the lock of the logger.
+class log_ring
+{
+public:
+    explicit log_ring(size_t capacity);
+
+    size_t capacity() const { return _capacity; }
+
+    // returns false if there is no room for the record
+    bool try_push(dsn_log_level_t log_level, const char *data, uint32_t len);
+
+    // call func(log_level, data, len) for every record in the ring, returns the record count
+    template <typename TFunc>
+    int consume(TFunc &&func);
+
+    size_t used_bytes() const
+    {
+        return _head.load(std::memory_order_relaxed) - _tail.load(std::memory_order_relaxed);
+    }
+
+    void close() { _closed.store(true, std::memory_order_release); }
+
+    bool closed() const { return _closed.load(std::memory_order_acquire); }
+
+private:
+    struct record_header
+    {
+        uint32_t len;
+        uint32_t log_level;
+    };
+
+    void write_bytes(uint64_t pos, const void *src, size_t n);
+    void read_bytes(uint64_t pos, void *dst, size_t n) const;
+
+    std::unique_ptr<char[]> _buffer;
+    size_t _capacity;
+    size_t _mask;
+
+    // written by the producer
+    std::atomic<uint64_t> _head;
+    char _padding[64];
+    // written by the consumer
+    std::atomic<uint64_t> _tail;
+    std::atomic<bool> _closed;
+
+    // holds the records across the end of the buffer
+    std::string _scratch;
+};
+
+/*
+ * async_logger is a simple_logger whose callers only format the log line into a ring buffer owned
+ * by the calling thread, and a background thread drains all the rings in batch into the log files.
+ * log files are named, rotated and removed in the same way as simple_logger.
+ *
+ * when the ring of a thread is full, the record is either dropped (and counted) or the caller
+ * blocks until the background thread catches up, as configured by
+ * [tools.async_logger] overload_policy. fatal records and flush() drain all the rings and write
+ * synchronously, so that nothing is lost before a coredump.
+ */
+class async_logger : public simple_logger
+{
+public:
+    async_logger(const char *log_dir);
+    virtual ~async_logger(void);
+
+    virtual void dsn_logv(const char *file,
+                          const char *function,
+                          const int line,
+                          dsn_log_level_t log_level,
+                          const char *fmt,
+                          va_list args);
+
+    virtual void dsn_log(const char *file,
+                         const char *function,
+                         const int line,
+                         dsn_log_level_t log_level,
+                         const char *str);
+
+    virtual void flush();
+
+    uint64_t dropped_count() const { return _dropped_count.load(std::memory_order_relaxed); }
+
+private:
+    void push(dsn_log_level_t log_level, const std::string &record);
+    log_ring *get_thread_ring();
+
+    // should be called with _lock held
+    void write_record(dsn_log_level_t log_level, const char *data, uint32_t len);
+    void drain_rings();
+
+    void flush_thread();
+
+private:
+    const uint64_t _id;
+    const bool _block_on_overload;
+
+    ::dsn::utils::ex_lock_nr _rings_lock;
+    std::vector<std::shared_ptr<log_ring>> _rings;
+
+    std::thread _flush_thread;
+    ::dsn::utils::semaphore _wakeup;
+    std::atomic<bool> _exit;
+
+    std::atomic<uint64_t> _dropped_count;
+    uint64_t _reported_dropped_count;
+    dsn::perf_counter_wrapper _dropped_counter;
+};
+}
+}
@@ -38,8 +38,11 @@
 #include "lockp.std.h"
 #include "core/task/simple_task_queue.h"
 #include "core/task/hpc_task_queue.h"
+#include "core/task/work_stealing_task_queue.h"
+#include "core/task/timing_wheel_timer_service.h"
 #include "core/rpc/network.sim.h"
 #include "simple_logger.h"
+#include "async_logger.h"
 #include "core/rpc/dsn_message_parser.h"
 #include "core/rpc/thrift_message_parser.h"
 #include "core/rpc/raw_message_parser.h"
@@ -52,6 +55,7 @@ void register_common_providers()
     register_component_provider<task_worker>("dsn::task_worker");
     register_component_provider<screen_logger>("dsn::tools::screen_logger");
     register_component_provider<simple_logger>("dsn::tools::simple_logger");
+    register_component_provider<async_logger>("dsn::tools::async_logger");
 
     register_std_lock_providers();
 
@@ -60,7 +64,10 @@ void register_common_providers()
     register_component_provider<sim_network_provider>("dsn::tools::sim_network_provider");
     register_component_provider<simple_task_queue>("dsn::tools::simple_task_queue");
     register_component_provider<hpc_concurrent_task_queue>("dsn::tools::hpc_concurrent_task_queue");
+    register_component_provider<work_stealing_task_queue>("dsn::tools::work_stealing_task_queue");
     register_component_provider<simple_timer_service>("dsn::tools::simple_timer_service");
+    register_component_provider<timing_wheel_timer_service>(
+        "dsn::tools::timing_wheel_timer_service");
 
     register_message_header_parser<dsn_message_parser>(NET_HDR_DSN, {"RDSN"});
     register_message_header_parser<thrift_message_parser>(NET_HDR_THRIFT, {"THFT"});
@@ -25,6 +25,7 @@
  */
 
 #include "simple_logger.h"
+#include <algorithm>
 #include <sstream>
 #include <dsn/utility/filesystem.h>
 #include <dsn/utility/flags.h>
@@ -53,7 +54,7 @@ DSN_DEFINE_validator(stderr_start_level, [](const char *level) -> bool {
     return strcmp(level, "LOG_LEVEL_INVALID") != 0;
 });
 
-static void print_header(FILE *fp, dsn_log_level_t log_level)
+int format_log_header(char *buf, size_t size, dsn_log_level_t log_level)
 {
     static char s_level_char[] = "IDWEF";
 
@@ -66,36 +67,60 @@ static void print_header(FILE *fp, dsn_log_level_t log_level)
 
     int tid = ::dsn::utils::get_current_tid();
 
-    fprintf(fp, "%c%s (%" PRIu64 " %04x) ", s_level_char[log_level], str, ts, tid);
+    int len =
+        snprintf(buf, size, "%c%s (%" PRIu64 " %04x) ", s_level_char[log_level], str, ts, tid);
+    if (len < 0 || static_cast<size_t>(len) >= size) {
+        return len < 0 ? 0 : static_cast<int>(size - 1);
+    }
 
+    int len2;
     auto t = task::get_current_task_id();
     if (t) {
         if (nullptr != task::get_current_worker2()) {
-            fprintf(fp,
-                    "%6s.%7s%d.%016" PRIx64 ": ",
-                    task::get_current_node_name(),
-                    task::get_current_worker2()->pool_spec().name.c_str(),
-                    task::get_current_worker2()->index(),
-                    t);
+            len2 = snprintf(buf + len,
+                            size - len,
+                            "%6s.%7s%d.%016" PRIx64 ": ",
+                            task::get_current_node_name(),
+                            task::get_current_worker2()->pool_spec().name.c_str(),
+                            task::get_current_worker2()->index(),
+                            t);
         } else {
-            fprintf(fp,
-                    "%6s.%7s.%05d.%016" PRIx64 ": ",
-                    task::get_current_node_name(),
-                    "io-thrd",
-                    tid,
-                    t);
+            len2 = snprintf(buf + len,
+                            size - len,
+                            "%6s.%7s.%05d.%016" PRIx64 ": ",
+                            task::get_current_node_name(),
+                            "io-thrd",
+                            tid,
+                            t);
         }
     } else {
         if (nullptr != task::get_current_worker2()) {
-            fprintf(fp,
-                    "%6s.%7s%u: ",
-                    task::get_current_node_name(),
-                    task::get_current_worker2()->pool_spec().name.c_str(),
-                    task::get_current_worker2()->index());
+            len2 = snprintf(buf + len,
+                            size - len,
+                            "%6s.%7s%u: ",
+                            task::get_current_node_name(),
+                            task::get_current_worker2()->pool_spec().name.c_str(),
+                            task::get_current_worker2()->index());
         } else {
-            fprintf(fp, "%6s.%7s.%05d: ", task::get_current_node_name(), "io-thrd", tid);
+            len2 = snprintf(buf + len,
+                            size - len,
+                            "%6s.%7s.%05d: ",
+                            task::get_current_node_name(),
+                            "io-thrd",
+                            tid);
         }
     }
+    if (len2 < 0) {
+        return len;
+    }
+    return static_cast<int>(std::min(static_cast<size_t>(len + len2), size - 1));
+}
+
+static void print_header(FILE *fp, dsn_log_level_t log_level)
+{
+    char buf[256];
+    format_log_header(buf, sizeof(buf), log_level);
+    fputs(buf, fp);
 }
 
 screen_logger::screen_logger(bool short_header) : logging_provider("./")
@@ -33,6 +33,10 @@
 namespace dsn {
 namespace tools {
 
+// format the header of a log line into buf on the calling thread, returns the length of the header
+// (excluding the trailing '\0'), which is truncated if buf is too small.
+int format_log_header(char *buf, size_t size, dsn_log_level_t log_level);
+
 /*
  * screen_logger provides a logger which writes to terminal.
  */
@@ -88,10 +92,10 @@ public:
 
     virtual void flush();
 
-private:
+protected:
     void create_log_file();
 
-private:
+protected:
     std::string _log_dir;
     ::dsn::utils::ex_lock _lock; // use recursive lock to avoid dead lock when flush() is called
                                  // in signal handler if cored for bad logging format reason.
@@ -0,0 +1,349 @@
+// Copyright (c) 2019, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#include <dsn/toollet/trace_recorder.h>
+
+#include <algorithm>
+#include <cinttypes>
+#include <iomanip>
+#include <sstream>
+
+#include <dsn/tool-api/aio_task.h>
+#include <dsn/tool-api/command_manager.h>
+#include <dsn/utility/flags.h>
+#include <dsn/utility/process_utils.h>
+#include <dsn/utility/string_conv.h>
+#include <dsn/utility/synchronize.h>
+
+#include "trace_ring.h"
+
+namespace dsn {
+namespace tools {
+
+DSN_DEFINE_uint32("tools.trace_recorder",
+                  ring_size,
+                  4096,
+                  "count of the trace records kept for each thread, rounded up to a power of 2");
+DSN_DEFINE_validator(ring_size, [](uint32_t size) -> bool { return size > 0; });
+
+DSN_DEFINE_uint32("tools.trace_recorder",
+                  sample_interval,
+                  1,
+                  "record the events of one in every sample_interval traces, 0 to record nothing");
+
+namespace {
+
+std::atomic<uint32_t> s_sample_interval(1);
+
+::dsn::utils::ex_lock_nr s_rings_lock;
+std::vector<std::shared_ptr<trace_ring>> s_rings; // protected by s_rings_lock
+
+struct thread_ring_holder
+{
+    ~thread_ring_holder()
+    {
+        if (ring != nullptr) {
+            ring->release();
+        }
+    }
+
+    std::shared_ptr<trace_ring> ring;
+};
+
+thread_local thread_ring_holder tls_ring;
+
+trace_ring *get_thread_ring()
+{
+    if (dsn_likely(tls_ring.ring != nullptr)) {
+        return tls_ring.ring.get();
+    }
+
+    utils::auto_lock<::dsn::utils::ex_lock_nr> l(s_rings_lock);
+    for (const auto &ring : s_rings) {
+        if (ring->try_acquire()) {
+            tls_ring.ring = ring;
+            return ring.get();
+        }
+    }
+    tls_ring.ring = std::make_shared<trace_ring>(FLAGS_ring_size);
+    s_rings.push_back(tls_ring.ring);
+    return tls_ring.ring.get();
+}
+
+// the trace id inherited by the tasks other than rpc, see inherit_trace_id
+typedef uint64_extension_helper<trace_recorder, task> task_ext_for_trace_recorder;
+
+// the events are sampled by trace id, or by task id for the tasks without trace id
+inline bool is_sampled(uint64_t key)
+{
+    uint32_t interval = s_sample_interval.load(std::memory_order_relaxed);
+    if (interval <= 1) {
+        return interval == 1;
+    }
+    // the task ids are sequential, so they are mixed before sampling
+    return ((key * 0x9E3779B97F4A7C15ULL) >> 32) % interval == 0;
+}
+
+inline void
+record(trace_event_type type, int code, uint64_t task_id, uint64_t trace_id, uint64_t arg)
+{
+    trace_record r;
+    r.ts_ns = dsn_now_ns();
+    r.task_id = task_id;
+    r.trace_id = trace_id;
+    r.arg = arg;
+    r.tid = utils::get_current_tid();
+    r.code = static_cast<uint16_t>(code);
+    r.event_type = static_cast<uint8_t>(type);
+    r.node_id = tls_dsn.magic == 0xdeadbeef ? static_cast<uint8_t>(tls_dsn.node_id) : 0;
+    get_thread_ring()->append(r);
+}
+
+inline uint64_t get_trace_id(task *t)
+{
+    switch (t->spec().type) {
+    case TASK_TYPE_RPC_REQUEST:
+        return static_cast<rpc_request_task *>(t)->get_request()->header->trace_id;
+    case TASK_TYPE_RPC_RESPONSE:
+        return static_cast<rpc_response_task *>(t)->get_request()->header->trace_id;
+    default:
+        return task_ext_for_trace_recorder::get(t);
+    }
+}
+
+// a task inherits the trace id of the task which enqueues it, or the task id of that one if it
+// has no trace id, so that a task and the follow-up tasks of it are sampled together. an rpc
+// sent by them still starts a new trace, as the trace id of a request is generated when it's
+// sent.
+inline void inherit_trace_id(task *caller, task *callee)
+{
+    if (caller == nullptr || callee->spec().type == TASK_TYPE_RPC_REQUEST ||
+        callee->spec().type == TASK_TYPE_RPC_RESPONSE) {
+        return;
+    }
+    uint64_t &trace_id = task_ext_for_trace_recorder::get(callee);
+    if (trace_id == 0) {
+        trace_id = get_trace_id(caller);
+        if (trace_id == 0) {
+            trace_id = caller->id();
+        }
+    }
+}
+
+inline void record_task_event(trace_event_type type, task *t, uint64_t arg)
+{
+    uint64_t trace_id = get_trace_id(t);
+    if (is_sampled(trace_id != 0 ? trace_id : t->id())) {
+        record(type, t->code(), t->id(), trace_id, arg);
+    }
+}
+
+void trace_recorder_on_task_enqueue(task *caller, task *callee)
+{
+    inherit_trace_id(caller, callee);
+    record_task_event(TET_TASK_ENQUEUE, callee, tls_dsn.last_worker_queue_size);
+}
+
+void trace_recorder_on_task_begin(task *this_) { record_task_event(TET_TASK_BEGIN, this_, 0); }
+
+void trace_recorder_on_task_end(task *this_)
+{
+    record_task_event(TET_TASK_END, this_, static_cast<int>(this_->error()));
+}
+
+void trace_recorder_on_task_cancelled(task *this_)
+{
+    record_task_event(TET_TASK_CANCELLED, this_, 0);
+}
+
+void trace_recorder_on_aio_call(task *caller, aio_task *callee)
+{
+    inherit_trace_id(caller, callee);
+    record_task_event(TET_AIO_CALL, callee, callee->get_aio_context()->buffer_size);
+}
+
+void trace_recorder_on_aio_enqueue(aio_task *this_)
+{
+    record_task_event(TET_AIO_ENQUEUE, this_, tls_dsn.last_worker_queue_size);
+}
+
+void trace_recorder_on_rpc_call(task *caller, message_ex *req, rpc_response_task *callee)
+{
+    uint64_t trace_id = req->header->trace_id;
+    if (is_sampled(trace_id)) {
+        record(TET_RPC_CALL,
+               req->local_rpc_code,
+               callee ? callee->id() : 0,
+               trace_id,
+               req->header->client.timeout_ms);
+    }
+}
+
+void trace_recorder_on_rpc_request_enqueue(rpc_request_task *callee)
+{
+    record_task_event(TET_RPC_REQUEST_ENQUEUE, callee, tls_dsn.last_worker_queue_size);
+}
+
+void trace_recorder_on_rpc_reply(task *caller, message_ex *msg)
+{
+    uint64_t trace_id = msg->header->trace_id;
+    if (is_sampled(trace_id)) {
+        record(TET_RPC_REPLY, msg->local_rpc_code, caller ? caller->id() : 0, trace_id, 0);
+    }
+}
+
+void trace_recorder_on_rpc_response_enqueue(rpc_response_task *resp)
+{
+    record_task_event(TET_RPC_RESPONSE_ENQUEUE, resp, tls_dsn.last_worker_queue_size);
+}
+
+struct event_format
+{
+    const char *suffix; // appended to the name of the instant events
+    const char *phase;
+    const char *arg_name;
+};
+
+const event_format s_event_formats[TET_COUNT] = {
+    {"ENQUEUE", "i", "queue_size"},
+    {"", "B", nullptr},
+    {"", "E", nullptr},
+    {"CANCELLED", "i", nullptr},
+    {"AIO.CALL", "i", "size"},
+    {"AIO.ENQUEUE", "i", "queue_size"},
+    {"RPC.CALL", "i", "timeout_ms"},
+    {"RPC.REQUEST.ENQUEUE", "i", "queue_size"},
+    {"RPC.REPLY", "i", nullptr},
+    {"RPC.RESPONSE.ENQUEUE", "i", "queue_size"},
+};
+
+void format_record(const trace_record &r, std::ostream &out)
+{
+    const event_format &f = s_event_formats[r.event_type];
+    char ids[64];
+    snprintf(ids,
+             sizeof(ids),
+             "\"task_id\":\"%016" PRIx64 "\",\"trace_id\":\"%016" PRIx64 "\"",
+             r.task_id,
+             r.trace_id);
+
+    out << "{\"name\":\"" << task_code(r.code).to_string();
+    if (f.suffix[0] != '\0') {
+        out << "." << f.suffix;
+    }
+    out << "\",\"ph\":\"" << f.phase << "\"";
+    if (f.phase[0] == 'i') {
+        out << ",\"s\":\"t\"";
+    }
+    // the timestamps of chrome trace are in microseconds
+    out << ",\"ts\":" << r.ts_ns / 1000 << "." << std::setw(3) << std::setfill('0')
+        << r.ts_ns % 1000 << ",\"pid\":" << (int)r.node_id << ",\"tid\":" << r.tid
+        << ",\"args\":{" << ids;
+    if (r.event_type == TET_TASK_END) {
+        out << ",\"err\":\"" << error_code(static_cast<int>(r.arg)).to_string() << "\"";
+    } else if (f.arg_name != nullptr) {
+        out << ",\"" << f.arg_name << "\":" << r.arg;
+    }
+    out << "}}";
+}
+
+std::string trace_recorder_sample_interval(const std::vector<std::string> &args)
+{
+    if (args.empty()) {
+        return std::to_string(s_sample_interval.load());
+    }
+
+    uint64_t interval = 0;
+    if (!buf2uint64(args[0], interval) || interval > UINT32_MAX) {
+        return "ERR: invalid arguments";
+    }
+    s_sample_interval.store(static_cast<uint32_t>(interval));
+    ddebug("set sample interval of trace_recorder to %" PRIu64 " by remote command", interval);
+    return "OK";
+}
+
+} // anonymous namespace
+
+/*static*/ std::string trace_recorder::dump_chrome_trace()
+{
+    std::vector<std::shared_ptr<trace_ring>> rings;
+    {
+        utils::auto_lock<::dsn::utils::ex_lock_nr> l(s_rings_lock);
+        rings = s_rings;
+    }
+
+    std::vector<trace_record> records;
+    for (const auto &ring : rings) {
+        ring->copy_to(records);
+    }
+    std::stable_sort(
+        records.begin(), records.end(), [](const trace_record &l, const trace_record &r) {
+            return l.ts_ns < r.ts_ns;
+        });
+
+    std::ostringstream out;
+    out << "{\"traceEvents\":[";
+    for (size_t i = 0; i < records.size(); ++i) {
+        if (i != 0) {
+            out << ",\n";
+        }
+        format_record(records[i], out);
+    }
+    out << "]}\n";
+    return out.str();
+}
+
+void trace_recorder::install(service_spec &spec)
+{
+    s_sample_interval.store(FLAGS_sample_interval);
+    task_ext_for_trace_recorder::register_ext();
+
+    auto record = dsn_config_get_value_bool(
+        "task..default", "is_trace_record", true, "whether to record the events of tasks");
+
+    for (int i = 0; i <= dsn::task_code::max(); i++) {
+        if (i == TASK_CODE_INVALID)
+            continue;
+
+        std::string section_name =
+            std::string("task.") + std::string(dsn::task_code(i).to_string());
+        task_spec *spec = task_spec::get(i);
+        dassert(spec != nullptr, "task_spec cannot be null");
+
+        if (!dsn_config_get_value_bool(section_name.c_str(),
+                                       "is_trace_record",
+                                       record,
+                                       "whether to record the events of this kind of task"))
+            continue;
+
+        spec->on_task_enqueue.put_back(trace_recorder_on_task_enqueue, "trace_recorder");
+        spec->on_task_begin.put_back(trace_recorder_on_task_begin, "trace_recorder");
+        spec->on_task_end.put_back(trace_recorder_on_task_end, "trace_recorder");
+        spec->on_task_cancelled.put_back(trace_recorder_on_task_cancelled, "trace_recorder");
+        spec->on_aio_call.put_back(trace_recorder_on_aio_call, "trace_recorder");
+        spec->on_aio_enqueue.put_back(trace_recorder_on_aio_enqueue, "trace_recorder");
+        spec->on_rpc_call.put_back(trace_recorder_on_rpc_call, "trace_recorder");
+        spec->on_rpc_request_enqueue.put_back(trace_recorder_on_rpc_request_enqueue,
+                                              "trace_recorder");
+        spec->on_rpc_reply.put_back(trace_recorder_on_rpc_reply, "trace_recorder");
+        spec->on_rpc_response_enqueue.put_back(trace_recorder_on_rpc_response_enqueue,
+                                               "trace_recorder");
+    }
+
+    command_manager::instance().register_command(
+        {"trace-recorder.dump"},
+        "trace-recorder.dump - dump the recorded events in chrome trace event format",
+        "trace-recorder.dump",
+        [](const std::vector<std::string> &args) { return dump_chrome_trace(); });
+
+    command_manager::instance().register_command(
+        {"trace-recorder.sample-interval"},
+        "trace-recorder.sample-interval - get or set the sample interval of traces",
+        "trace-recorder.sample-interval [num], record one in every num traces, 0 to record nothing",
+        trace_recorder_sample_interval);
+}
+
+trace_recorder::trace_recorder(const char *name) : toollet(name) {}
+}
+}
@@ -0,0 +1,111 @@
+// Copyright (c) 2019, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace dsn {
+namespace tools {
+
+enum trace_event_type
+{
+    TET_TASK_ENQUEUE,
+    TET_TASK_BEGIN,
+    TET_TASK_END,
+    TET_TASK_CANCELLED,
+    TET_AIO_CALL,
+    TET_AIO_ENQUEUE,
+    TET_RPC_CALL,
+    TET_RPC_REQUEST_ENQUEUE,
+    TET_RPC_REPLY,
+    TET_RPC_RESPONSE_ENQUEUE,
+
+    TET_COUNT
+};
+
+// an event recorded by trace_recorder, which is formatted only when the records are dumped
+struct trace_record
+{
+    uint64_t ts_ns;
+    uint64_t task_id;
+    uint64_t trace_id;
+    // queue size for the enqueue events, buffer size for aio call, timeout for rpc call and
+    // error code for task end
+    uint64_t arg;
+    int32_t tid;
+    uint16_t code;      // task code of the task, or rpc code of the message
+    uint8_t event_type; // trace_event_type
+    uint8_t node_id;
+};
+static_assert(sizeof(trace_record) == 40, "trace_record should be compact");
+
+// a ring of trace records appended by the owner thread only, the oldest records are overwritten
+// when it's full. the readers copy the records without blocking the owner, and drop the ones which
+// might be overwritten during the copy.
+class trace_ring
+{
+public:
+    explicit trace_ring(size_t capacity) : _pos(0), _in_use(true)
+    {
+        _capacity = 1;
+        while (_capacity < capacity) {
+            _capacity <<= 1;
+        }
+        _mask = _capacity - 1;
+        _records.reset(new trace_record[_capacity]);
+    }
+
+    size_t capacity() const { return _capacity; }
+
+    // only called by the owner thread
+    void append(const trace_record &r)
+    {
+        uint64_t pos = _pos.load(std::memory_order_relaxed);
+        _records[pos & _mask] = r;
+        _pos.store(pos + 1, std::memory_order_release);
+    }
+
+    // append the records kept in the ring to out in the order they are recorded
+    void copy_to(std::vector<trace_record> &out) const
+    {
+        uint64_t end = _pos.load(std::memory_order_acquire);
+        uint64_t begin = end > _capacity ? end - _capacity : 0;
+        size_t first = out.size();
+        for (uint64_t i = begin; i < end; ++i) {
+            out.push_back(_records[i & _mask]);
+        }
+
+        // the record at pos is overwritten before pos is moved, so the records not after
+        // (new_end - capacity) may be partially overwritten
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t new_end = _pos.load(std::memory_order_relaxed);
+        if (new_end >= begin + _capacity) {
+            uint64_t dropped = std::min(new_end - _capacity + 1 - begin, end - begin);
+            out.erase(out.begin() + first, out.begin() + first + dropped);
+        }
+    }
+
+    // the ring of an exited thread is reused by a new thread, keeping the old records
+    bool try_acquire()
+    {
+        bool in_use = false;
+        return _in_use.compare_exchange_strong(in_use, true);
+    }
+    void release() { _in_use.store(false); }
+
+private:
+    std::unique_ptr<trace_record[]> _records;
+    size_t _capacity;
+    size_t _mask;
+    std::atomic<uint64_t> _pos;
+    std::atomic<bool> _in_use;
+};
+
+} // namespace tools
+} // namespace dsn
@@ -9,11 +9,24 @@
 #include <dsn/dist/fmt_logging.h>
 #include <dsn/utility/factory_store.h>
 #include <dsn/utility/filesystem.h>
+#include <dsn/utility/flags.h>
 
 namespace dsn {
 namespace dist {
 namespace block_service {
 
+DSN_DEFINE_uint32("replication",
+                  block_service_part_size_kb,
+                  4096,
+                  "part size in KB when uploading or downloading files of cold backup and bulk "
+                  "load, 0 means transferring a file in a single stream");
+DSN_DEFINE_int32("replication",
+                 block_service_max_concurrent_parts,
+                 4,
+                 "max count of parts of a file which are uploaded or downloaded concurrently");
+DSN_DEFINE_validator(block_service_max_concurrent_parts,
+                     [](int32_t count) -> bool { return count > 0; });
+
 block_service_registry::block_service_registry()
 {
     bool ans;
@@ -89,13 +102,18 @@ error_code block_service_manager::download_file(const std::string &remote_dir,
                                                 const std::string &local_dir,
                                                 const std::string &file_name,
                                                 block_filesystem *fs,
-                                                /*out*/ uint64_t &download_file_size)
+                                                /*out*/ uint64_t &download_file_size,
+                                                /*out*/ std::string &download_file_md5)
 {
     error_code download_err = ERR_OK;
     task_tracker tracker;
 
-    auto download_file_callback_func = [this, &download_err, &download_file_size](
-        const download_response &resp, block_file_ptr bf, const std::string &local_file_name) {
+    auto download_file_callback_func = [this,
+                                        &download_err,
+                                        &download_file_size,
+                                        &download_file_md5](const download_response &resp,
+                                                            block_file_ptr bf,
+                                                            const std::string &local_file_name) {
         if (resp.err != ERR_OK) {
             // during bulk load process, ERR_OBJECT_NOT_FOUND will be considered as a recoverable
             // error, however, if file damaged on remote file provider, bulk load should stop,
@@ -120,12 +138,15 @@ error_code block_service_manager::download_file(const std::string &remote_dir,
             return;
         }
 
-        std::string current_md5;
-        error_code e = utils::filesystem::md5sum(local_file_name, current_md5);
-        if (e != ERR_OK) {
-            derror_f("calculate file({}) md5 failed", local_file_name);
-            download_err = e;
-            return;
+        // the md5 calculated while downloading saves another pass over the local file
+        std::string current_md5 = resp.md5;
+        if (current_md5.empty()) {
+            error_code e = utils::filesystem::md5sum(local_file_name, current_md5);
+            if (e != ERR_OK) {
+                derror_f("calculate file({}) md5 failed", local_file_name);
+                download_err = e;
+                return;
+            }
         }
         if (current_md5 != bf->get_md5sum()) {
             derror_f("local file({}) is different from remote file({}), download failed, md5: "
@@ -142,12 +163,14 @@ error_code block_service_manager::download_file(const std::string &remote_dir,
                  resp.downloaded_size);
         download_err = ERR_OK;
         download_file_size = resp.downloaded_size;
+        download_file_md5 = current_md5;
     };
 
     auto create_file_cb = [this,
                            &local_dir,
                            &download_err,
                            &download_file_size,
+                           &download_file_md5,
                            &download_file_callback_func,
                            &tracker](const create_file_response &resp, const std::string &fname) {
         if (resp.err != ERR_OK) {
@@ -188,6 +211,7 @@ error_code block_service_manager::download_file(const std::string &remote_dir,
             } else {
                 download_err = ERR_OK;
                 download_file_size = bf->get_size();
+                download_file_md5 = current_md5;
                 ddebug_f("local file({}) has been downloaded, file size = {}",
                          local_file_name,
                          download_file_size);
@@ -196,7 +220,10 @@ error_code block_service_manager::download_file(const std::string &remote_dir,
         }
 
         // download or redownload file
-        bf->download(download_request{local_file_name, 0, -1},
+        download_request req{local_file_name, 0, -1};
+        req.part_size = static_cast<uint64_t>(FLAGS_block_service_part_size_kb) << 10;
+        req.max_concurrent_parts = FLAGS_block_service_max_concurrent_parts;
+        bf->download(req,
                      TASK_CODE_EXEC_INLINED,
                      std::bind(download_file_callback_func,
                                std::placeholders::_1,
@@ -32,12 +32,14 @@ public:
     // \return  ERR_FILE_OPERATION_FAILED: local file system error
     // \return  ERR_FS_INTERNAL: remote file system error
     // \return  ERR_CORRUPTION: file not exist or damaged
-    // if download file succeed, download_err = ERR_OK and set download_file_size
+    // if download file succeed, download_err = ERR_OK and set download_file_size and
+    // download_file_md5, so that the caller needn't read the file again to verify it
     error_code download_file(const std::string &remote_dir,
                              const std::string &local_dir,
                              const std::string &file_name,
                              block_filesystem *fs,
-                             /*out*/ uint64_t &download_file_size);
+                             /*out*/ uint64_t &download_file_size,
+                             /*out*/ std::string &download_file_md5);
 
 private:
     block_service_registry &_registry_holder;
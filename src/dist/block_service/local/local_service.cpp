@@ -1,4 +1,7 @@
+#include <atomic>
+#include <fcntl.h>
 #include <memory>
+#include <unistd.h>
 
 #include <dsn/utility/filesystem.h>
 #include <dsn/utility/error_code.h>
@@ -11,7 +14,8 @@
 #include <dsn/tool-api/task_tracker.h>
 #include "local_service.h"
 
-static const int max_length = 2048; // max data length read from file each time
+// part size used when the request doesn't ask for multi-part transferring
+static const uint64_t default_part_size = 4 << 20;
 
 namespace dsn {
 namespace dist {
@@ -27,6 +31,153 @@ struct file_metadata
     DEFINE_JSON_SERIALIZATION(size, md5)
 };
 
+// part_copier copies [offset, offset + length) of the source file to the beginning of the target
+// file in parts. the parts are copied in rounds of max_concurrent_parts, every part of a round is
+// copied by an individual task on THREAD_POOL_LOCAL_SERVICE, and the last finished part of a round
+// feeds the data of the whole round into the md5 hasher in order before starting the next round,
+// so the data is read only once and at most max_concurrent_parts parts are held in memory.
+class part_copier : public ref_counter
+{
+public:
+    typedef std::function<void(error_code err, uint64_t copied_size, const std::string &md5)>
+        callback;
+
+    part_copier(int src_fd,
+                int dst_fd,
+                uint64_t offset,
+                uint64_t length,
+                uint64_t part_size,
+                int32_t max_concurrent_parts,
+                callback &&cb)
+        : _src_fd(src_fd),
+          _dst_fd(dst_fd),
+          _offset(offset),
+          _length(length),
+          _part_size(part_size == 0 ? default_part_size : part_size),
+          _cb(std::move(cb)),
+          _copied_size(0),
+          _err(ERR_OK)
+    {
+        _parts.resize(part_size == 0 ? 1 : std::max(max_concurrent_parts, 1));
+    }
+
+    ~part_copier()
+    {
+        ::close(_src_fd);
+        ::close(_dst_fd);
+    }
+
+    void start() { start_round(); }
+
+private:
+    void start_round()
+    {
+        int count = 0;
+        for (auto &part : _parts) {
+            uint64_t pos = _copied_size + count * _part_size;
+            if (pos >= _length && count > 0) {
+                break;
+            }
+            part.pos = pos;
+            part.length = std::min(_part_size, _length - std::min(pos, _length));
+            ++count;
+        }
+
+        _running_parts.store(count);
+        _round_parts = count;
+        for (int i = 0; i < count; ++i) {
+            part_copier *self = this;
+            self->add_ref();
+            tasking::enqueue(LPC_LOCAL_SERVICE_CALL, nullptr, [self, i]() {
+                self->copy_part(self->_parts[i]);
+                if (self->_running_parts.fetch_sub(1) == 1) {
+                    self->on_round_done();
+                }
+                self->release_ref();
+            });
+        }
+    }
+
+    struct part
+    {
+        uint64_t pos;
+        uint64_t length;
+        std::string buffer;
+        bool failed;
+    };
+
+    void copy_part(part &p)
+    {
+        p.failed = false;
+        p.buffer.resize(p.length);
+        uint64_t done = 0;
+        while (done < p.length) {
+            ssize_t n = ::pread(_src_fd, &p.buffer[done], p.length - done, _offset + p.pos + done);
+            if (n <= 0) {
+                derror("read %" PRIu64 " bytes at offset %" PRIu64 " failed, err(%s)",
+                       p.length - done,
+                       _offset + p.pos + done,
+                       n == 0 ? "unexpected eof" : utils::safe_strerror(errno).c_str());
+                p.failed = true;
+                return;
+            }
+            done += n;
+        }
+
+        done = 0;
+        while (done < p.length) {
+            ssize_t n = ::pwrite(_dst_fd, p.buffer.data() + done, p.length - done, p.pos + done);
+            if (n < 0) {
+                derror("write %" PRIu64 " bytes at offset %" PRIu64 " failed, err(%s)",
+                       p.length - done,
+                       p.pos + done,
+                       utils::safe_strerror(errno).c_str());
+                p.failed = true;
+                return;
+            }
+            done += n;
+        }
+    }
+
+    void on_round_done()
+    {
+        for (int i = 0; i < _round_parts; ++i) {
+            part &p = _parts[i];
+            if (p.failed) {
+                _err = ERR_FS_INTERNAL;
+                break;
+            }
+            _hasher.update(p.buffer.data(), p.length);
+            _copied_size += p.length;
+            std::string().swap(p.buffer);
+        }
+
+        if (_err == ERR_OK && _copied_size < _length) {
+            start_round();
+            return;
+        }
+
+        std::string md5 = _err == ERR_OK ? _hasher.finalize() : std::string();
+        _cb(_err, _copied_size, md5);
+    }
+
+private:
+    const int _src_fd;
+    const int _dst_fd;
+    const uint64_t _offset;
+    const uint64_t _length;
+    const uint64_t _part_size;
+    callback _cb;
+
+    std::vector<part> _parts;
+    int _round_parts;
+    std::atomic<int> _running_parts;
+
+    uint64_t _copied_size;
+    utils::md5_hasher _hasher;
+    error_code _err;
+};
+
 std::string local_service::get_metafile(const std::string &filepath)
 {
     std::string dir_part = utils::filesystem::remove_file_name(filepath);
@@ -446,58 +597,66 @@ dsn::task_ptr local_file_object::upload(const upload_request &req,
     auto upload_file_func = [this, req, tsk]() {
         upload_response resp;
         resp.err = ERR_OK;
-        std::ifstream fin(req.input_local_name, std::ios_base::in);
-        if (!fin.is_open()) {
+        resp.uploaded_size = 0;
+
+        int64_t total_sz = 0;
+        int src_fd = -1;
+        if (!utils::filesystem::file_size(req.input_local_name, total_sz) ||
+            (src_fd = ::open(req.input_local_name.c_str(), O_RDONLY)) < 0) {
             dwarn("open source file %s for read failed, err(%s)",
                   req.input_local_name.c_str(),
                   utils::safe_strerror(errno).c_str());
             resp.err = ERR_FILE_OPERATION_FAILED;
         }
 
-        utils::filesystem::create_file(file_name());
-        std::ofstream fout(file_name(), std::ios_base::out | std::ios_base::trunc);
-        if (!fout.is_open()) {
-            dwarn("open target file %s for write failed, err(%s)",
-                  file_name().c_str(),
-                  utils::safe_strerror(errno).c_str());
-            resp.err = ERR_FS_INTERNAL;
-        }
-
+        int dst_fd = -1;
         if (resp.err == ERR_OK) {
-            dinfo("start to transfer from src_file(%s) to des_file(%s)",
-                  req.input_local_name.c_str(),
-                  file_name().c_str());
-            int64_t total_sz = 0;
-            char buf[max_length] = {'\0'};
-            while (!fin.eof()) {
-                fin.read(buf, max_length);
-                total_sz += fin.gcount();
-                fout.write(buf, fin.gcount());
-            }
-            dinfo("finish upload file, file = %s, total_size = %d", file_name().c_str(), total_sz);
-            fout.close();
-            fin.close();
-
-            resp.uploaded_size = static_cast<uint64_t>(total_sz);
-
-            // calc the md5sum by source file for simplicity
-            _size = total_sz;
-            error_code res = utils::filesystem::md5sum(req.input_local_name, _md5_value);
-            if (res == dsn::ERR_OK) {
-                _has_meta_synced = true;
-                store_metadata();
-            } else {
+            utils::filesystem::create_file(file_name());
+            dst_fd = ::open(file_name().c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+            if (dst_fd < 0) {
+                dwarn("open target file %s for write failed, err(%s)",
+                      file_name().c_str(),
+                      utils::safe_strerror(errno).c_str());
                 resp.err = ERR_FS_INTERNAL;
+                ::close(src_fd);
             }
-        } else {
-            if (fin.is_open())
-                fin.close();
-            if (fout.is_open())
-                fout.close();
         }
 
-        tsk->enqueue_with(resp);
-        release_ref();
+        if (resp.err != ERR_OK) {
+            tsk->enqueue_with(resp);
+            release_ref();
+            return;
+        }
+
+        dinfo("start to transfer from src_file(%s) to des_file(%s)",
+              req.input_local_name.c_str(),
+              file_name().c_str());
+        // the md5 is calculated while copying, so the source file is read only once
+        ref_ptr<part_copier> copier(new part_copier(
+            src_fd,
+            dst_fd,
+            0,
+            static_cast<uint64_t>(total_sz),
+            req.part_size,
+            req.max_concurrent_parts,
+            [this, tsk](error_code err, uint64_t copied_size, const std::string &md5) {
+                upload_response resp;
+                resp.err = err;
+                resp.uploaded_size = copied_size;
+                if (err == ERR_OK) {
+                    dinfo("finish upload file, file = %s, total_size = %" PRIu64,
+                          file_name().c_str(),
+                          copied_size);
+                    resp.md5 = md5;
+                    _size = copied_size;
+                    _md5_value = md5;
+                    _has_meta_synced = true;
+                    store_metadata();
+                }
+                tsk->enqueue_with(resp);
+                release_ref();
+            }));
+        copier->start();
     };
     ::dsn::tasking::enqueue(LPC_LOCAL_SERVICE_CALL, nullptr, std::move(upload_file_func));
 
@@ -509,13 +668,13 @@ dsn::task_ptr local_file_object::download(const download_request &req,
                                           const download_callback &cb,
                                           task_tracker *tracker)
 {
-    // download the whole file
     add_ref();
     download_future_ptr tsk(new download_future(code, cb, 0));
     tsk->set_tracker(tracker);
     auto download_file_func = [this, req, tsk]() {
         download_response resp;
         resp.err = ERR_OK;
+        resp.downloaded_size = 0;
         std::string target_file = req.output_local_name;
         if (target_file.empty()) {
             derror("download %s failed, because target name(%s) is invalid",
@@ -531,54 +690,75 @@ dsn::task_ptr local_file_object::download(const download_request &req,
             }
         }
 
+        int64_t file_sz = 0;
+        int src_fd = -1;
         if (resp.err == ERR_OK) {
-            std::ifstream fin(file_name(), std::ifstream::in);
-            if (!fin.is_open()) {
+            if (!utils::filesystem::file_size(file_name(), file_sz) ||
+                (src_fd = ::open(file_name().c_str(), O_RDONLY)) < 0) {
                 derror("open block file(%s) failed, err(%s)",
                        file_name().c_str(),
                        utils::safe_strerror(errno).c_str());
                 resp.err = ERR_FS_INTERNAL;
             }
+        }
 
-            std::ofstream fout(target_file, std::ios_base::out | std::ios_base::trunc);
-            if (!fout.is_open()) {
-                if (fin.is_open())
-                    fin.close();
+        int dst_fd = -1;
+        if (resp.err == ERR_OK) {
+            dst_fd = ::open(target_file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+            if (dst_fd < 0) {
                 derror("open target file(%s) failed, err(%s)",
                        target_file.c_str(),
                        utils::safe_strerror(errno).c_str());
                 resp.err = ERR_FILE_OPERATION_FAILED;
+                ::close(src_fd);
             }
+        }
 
-            if (resp.err == ERR_OK) {
-                dinfo("start to transfer, src_file(%s), des_file(%s)",
-                      file_name().c_str(),
-                      target_file.c_str());
-                int64_t total_sz = 0;
-                char buf[max_length] = {'\0'};
-                while (!fin.eof()) {
-                    fin.read(buf, max_length);
-                    total_sz += fin.gcount();
-                    fout.write(buf, fin.gcount());
-                }
-                dinfo("finish download file(%s), total_size = %d", target_file.c_str(), total_sz);
-                fout.close();
-                fin.close();
-                resp.downloaded_size = static_cast<uint64_t>(total_sz);
+        if (resp.err != ERR_OK) {
+            tsk->enqueue_with(resp);
+            release_ref();
+            return;
+        }
 
-                _size = total_sz;
-                if ((resp.err = utils::filesystem::md5sum(target_file, _md5_value)) != ERR_OK) {
-                    dwarn("download %s failed when calculate the md5sum of %s",
-                          file_name().c_str(),
-                          target_file.c_str());
+        uint64_t pos = std::min(req.remote_pos, static_cast<uint64_t>(file_sz));
+        uint64_t length = file_sz - pos;
+        if (req.remote_length >= 0 && static_cast<uint64_t>(req.remote_length) < length) {
+            length = static_cast<uint64_t>(req.remote_length);
+        }
+        bool whole_file = (pos == 0 && length == static_cast<uint64_t>(file_sz));
+
+        dinfo("start to transfer, src_file(%s), des_file(%s)",
+              file_name().c_str(),
+              target_file.c_str());
+        ref_ptr<part_copier> copier(new part_copier(
+            src_fd,
+            dst_fd,
+            pos,
+            length,
+            req.part_size,
+            req.max_concurrent_parts,
+            [this, tsk, target_file, whole_file](
+                error_code err, uint64_t copied_size, const std::string &md5) {
+                download_response resp;
+                resp.err = err;
+                resp.downloaded_size = copied_size;
+                if (err == ERR_OK) {
+                    dinfo("finish download file(%s), total_size = %" PRIu64,
+                          target_file.c_str(),
+                          copied_size);
+                    resp.md5 = md5;
+                    if (whole_file) {
+                        _size = copied_size;
+                        _md5_value = md5;
+                        _has_meta_synced = true;
+                    }
                 } else {
-                    _has_meta_synced = true;
+                    dwarn("download %s to %s failed", file_name().c_str(), target_file.c_str());
                 }
-            }
-        }
-
-        tsk->enqueue_with(resp);
-        release_ref();
+                tsk->enqueue_with(resp);
+                release_ref();
+            }));
+        copier->start();
     };
     ::dsn::tasking::enqueue(LPC_LOCAL_SERVICE_CALL, nullptr, std::move(download_file_func));
 
@@ -29,8 +29,9 @@ public:
     error_code test_download_file()
     {
         uint64_t download_size = 0;
+        std::string download_md5;
         return _block_service_manager.download_file(
-            PROVIDER, LOCAL_DIR, FILE_NAME, _fs.get(), download_size);
+            PROVIDER, LOCAL_DIR, FILE_NAME, _fs.get(), download_size, download_md5);
     }
 
     void create_local_file(const std::string &file_name)
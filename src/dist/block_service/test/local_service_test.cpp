@@ -0,0 +1,177 @@
+// Copyright (c) 2019, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#include <fstream>
+
+#include <dsn/utility/filesystem.h>
+#include <dsn/utility/rand.h>
+#include <dsn/utility/strings.h>
+#include <gtest/gtest.h>
+
+#include "dist/block_service/local/local_service.h"
+
+namespace dsn {
+namespace dist {
+namespace block_service {
+
+class local_service_test : public ::testing::Test
+{
+public:
+    void SetUp() override
+    {
+        utils::filesystem::remove_path(ROOT);
+        _fs.reset(new local_service(ROOT));
+        ASSERT_EQ(ERR_OK, _fs->initialize({}));
+
+        // not a multiple of the part size
+        std::string data;
+        data.resize(100 * 1024 + 123);
+        for (auto &c : data) {
+            c = static_cast<char>(rand::next_u32(0, 255));
+        }
+        std::ofstream out(LOCAL_FILE, std::ios::binary | std::ios::trunc);
+        out.write(data.data(), data.size());
+        out.close();
+        ASSERT_EQ(ERR_OK, utils::filesystem::md5sum(LOCAL_FILE, _data_md5));
+        _data = std::move(data);
+    }
+
+    void TearDown() override
+    {
+        utils::filesystem::remove_path(ROOT);
+        utils::filesystem::remove_path(LOCAL_FILE);
+        utils::filesystem::remove_path(DOWNLOADED_FILE);
+    }
+
+    block_file_ptr create_file(const std::string &name)
+    {
+        block_file_ptr file;
+        _fs->create_file(create_file_request{name, false},
+                         TASK_CODE_EXEC_INLINED,
+                         [&file](const create_file_response &resp) {
+                             EXPECT_EQ(ERR_OK, resp.err);
+                             file = resp.file_handle;
+                         })
+            ->wait();
+        return file;
+    }
+
+    upload_response upload(const block_file_ptr &file, uint64_t part_size, int32_t parts)
+    {
+        upload_request req{LOCAL_FILE};
+        req.part_size = part_size;
+        req.max_concurrent_parts = parts;
+
+        upload_response resp;
+        file->upload(req, TASK_CODE_EXEC_INLINED, [&resp](const upload_response &r) {
+                resp = r;
+            })->wait();
+        return resp;
+    }
+
+    download_response download(const block_file_ptr &file,
+                               uint64_t pos,
+                               int64_t length,
+                               uint64_t part_size,
+                               int32_t parts)
+    {
+        download_request req{DOWNLOADED_FILE, pos, length};
+        req.part_size = part_size;
+        req.max_concurrent_parts = parts;
+
+        download_response resp;
+        file->download(req, TASK_CODE_EXEC_INLINED, [&resp](const download_response &r) {
+                resp = r;
+            })->wait();
+        return resp;
+    }
+
+public:
+    std::unique_ptr<local_service> _fs;
+    std::string _data;
+    std::string _data_md5;
+
+    const std::string ROOT = "local_service_test_root";
+    const std::string LOCAL_FILE = "local_service_test_file";
+    const std::string DOWNLOADED_FILE = "local_service_test_file.downloaded";
+};
+
+TEST_F(local_service_test, upload_download_in_parts)
+{
+    struct test_case
+    {
+        uint64_t part_size;
+        int32_t parts;
+    } tests[] = {{0, 1}, {16 * 1024, 1}, {16 * 1024, 3}, {1024 * 1024, 4}, {4099, 0}};
+
+    for (const auto &test : tests) {
+        block_file_ptr file = create_file("/upload_download_in_parts");
+        ASSERT_TRUE(file != nullptr);
+
+        upload_response u_resp = upload(file, test.part_size, test.parts);
+        ASSERT_EQ(ERR_OK, u_resp.err);
+        ASSERT_EQ(_data.size(), u_resp.uploaded_size);
+        ASSERT_EQ(_data_md5, u_resp.md5);
+        ASSERT_EQ(_data_md5, file->get_md5sum());
+
+        // the metadata stored by upload is visible to a new handle
+        file = create_file("/upload_download_in_parts");
+        ASSERT_EQ(_data.size(), file->get_size());
+        ASSERT_EQ(_data_md5, file->get_md5sum());
+
+        download_response d_resp = download(file, 0, -1, test.part_size, test.parts);
+        ASSERT_EQ(ERR_OK, d_resp.err);
+        ASSERT_EQ(_data.size(), d_resp.downloaded_size);
+        ASSERT_EQ(_data_md5, d_resp.md5);
+        ASSERT_TRUE(utils::filesystem::verify_file(DOWNLOADED_FILE, _data_md5, _data.size()));
+    }
+}
+
+TEST_F(local_service_test, download_range)
+{
+    block_file_ptr file = create_file("/download_range");
+    ASSERT_EQ(ERR_OK, upload(file, 0, 1).err);
+
+    struct test_case
+    {
+        uint64_t pos;
+        int64_t length;
+        uint64_t expected_length;
+    } tests[] = {{0, 100, 100},
+                 {1000, 50000, 50000},
+                 {100 * 1024, -1, 123},
+                 {100 * 1024, 1000, 123},
+                 {_data.size(), -1, 0}};
+
+    for (const auto &test : tests) {
+        download_response resp = download(file, test.pos, test.length, 4096, 4);
+        ASSERT_EQ(ERR_OK, resp.err);
+        ASSERT_EQ(test.expected_length, resp.downloaded_size);
+        std::string expected = _data.substr(test.pos, test.expected_length);
+        ASSERT_EQ(utils::string_md5(expected.data(), expected.size()), resp.md5);
+
+        std::string downloaded;
+        ASSERT_EQ(ERR_OK, utils::filesystem::read_file(DOWNLOADED_FILE, downloaded));
+        ASSERT_EQ(expected, downloaded);
+    }
+
+    // a partial download doesn't change the metadata of the file
+    ASSERT_EQ(_data.size(), file->get_size());
+    ASSERT_EQ(_data_md5, file->get_md5sum());
+}
+
+TEST_F(local_service_test, upload_non_exist_file)
+{
+    block_file_ptr file = create_file("/upload_non_exist_file");
+    upload_request req{"local_service_test_non_exist_file"};
+    upload_response resp;
+    file->upload(req, TASK_CODE_EXEC_INLINED, [&resp](const upload_response &r) {
+            resp = r;
+        })->wait();
+    ASSERT_EQ(ERR_FILE_OPERATION_FAILED, resp.err);
+}
+
+} // namespace block_service
+} // namespace dist
+} // namespace dsn
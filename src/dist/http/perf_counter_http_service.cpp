@@ -2,11 +2,165 @@
 // This source code is licensed under the Apache License Version 2.0, which
 // can be found in the LICENSE file in the root directory of this source tree.
 
+#include <map>
+
 #include <dsn/utility/output_utils.h>
 #include "perf_counter_http_service.h"
 
 namespace dsn {
 
+namespace {
+
+// the name of metric family can only contain [a-zA-Z0-9_:] and can't start with a digit
+std::string prometheus_metric_name(const perf_counter_ptr &c)
+{
+    std::string name = std::string(c->section()) + "_" + c->name();
+    for (char &ch : name) {
+        if (!isalnum(static_cast<unsigned char>(ch)) && ch != '_') {
+            ch = '_';
+        }
+    }
+    if (isdigit(static_cast<unsigned char>(name[0]))) {
+        name.insert(0, "_");
+    }
+    return name;
+}
+
+std::string prometheus_escape(const std::string &str, bool escape_quote)
+{
+    std::string result;
+    result.reserve(str.size());
+    for (char ch : str) {
+        if (ch == '\\') {
+            result += "\\\\";
+        } else if (ch == '\n') {
+            result += "\\n";
+        } else if (ch == '"' && escape_quote) {
+            result += "\\\"";
+        } else {
+            result += ch;
+        }
+    }
+    return result;
+}
+
+struct prometheus_family
+{
+    std::string type;
+    std::string help;
+    std::ostringstream samples;
+};
+
+// the percentile counters which aren't backed by a histogram are exported as a summary
+void append_summary_samples(const perf_counter_ptr &c,
+                            const std::string &name,
+                            const std::string &labels,
+                            std::ostringstream &out)
+{
+    static const std::pair<dsn_perf_counter_percentile_type_t, const char *> quantiles[] = {
+        {COUNTER_PERCENTILE_50, "0.5"},
+        {COUNTER_PERCENTILE_90, "0.9"},
+        {COUNTER_PERCENTILE_95, "0.95"},
+        {COUNTER_PERCENTILE_99, "0.99"},
+        {COUNTER_PERCENTILE_999, "0.999"}};
+    for (const auto &q : quantiles) {
+        out << name << "{" << labels << ",quantile=\"" << q.second << "\"} "
+            << c->get_percentile(q.first) << "\n";
+    }
+}
+
+// the buckets of the histogram are exported at the boundaries of octaves, which are never crossed
+// by the buckets of perf_counter_number_histogram_atomic, so the cumulative counts are exact
+void append_histogram_samples(const std::vector<perf_counter::histogram_bucket> &buckets,
+                              int64_t sum,
+                              const std::string &name,
+                              const std::string &labels,
+                              std::ostringstream &out)
+{
+    static const int max_value_bits = 48;
+    uint64_t count = 0;
+    auto it = buckets.begin();
+    for (int k = 0; k <= max_value_bits; k++) {
+        int64_t le = (int64_t(1) << k) - 1;
+        for (; it != buckets.end() && it->upper_bound <= le; ++it) {
+            count += it->count;
+        }
+        out << name << "_bucket{" << labels << ",le=\"" << le << "\"} " << count << "\n";
+    }
+    for (; it != buckets.end(); ++it) {
+        count += it->count;
+    }
+    out << name << "_bucket{" << labels << ",le=\"+Inf\"} " << count << "\n";
+    out << name << "_sum{" << labels << "} " << sum << "\n";
+    out << name << "_count{" << labels << "} " << count << "\n";
+}
+
+} // anonymous namespace
+
+void perf_counter_http_service::get_prometheus_handler(const http_request &req,
+                                                       http_response &resp)
+{
+    // the families are sorted by name so that the output is stable
+    std::map<std::string, prometheus_family> families;
+    perf_counters::instance().iterate_counters([&families](const perf_counter_ptr &c) {
+        std::string name = prometheus_metric_name(c);
+        std::vector<perf_counter::histogram_bucket> buckets;
+        int64_t sum = 0;
+        bool has_histogram = false;
+        std::string type;
+        switch (c->type()) {
+        case COUNTER_TYPE_NUMBER:
+            type = "gauge";
+            break;
+        case COUNTER_TYPE_VOLATILE_NUMBER:
+        case COUNTER_TYPE_RATE:
+            type = "counter";
+            name += "_total";
+            break;
+        case COUNTER_TYPE_NUMBER_PERCENTILES:
+            has_histogram = c->get_histogram(buckets, sum);
+            type = has_histogram ? "histogram" : "summary";
+            break;
+        default:
+            return;
+        }
+
+        prometheus_family &family = families[name];
+        if (family.type.empty()) {
+            family.type = type;
+            family.help = prometheus_escape(c->dsptr(), false);
+        } else if (family.type != type) {
+            // counters of different types can't be in the same family
+            dwarn("skip counter %s for the conflict of metric type", c->full_name());
+            return;
+        }
+
+        std::string labels = "app=\"" + prometheus_escape(c->app(), true) + "\"";
+        if (c->type() == COUNTER_TYPE_NUMBER) {
+            family.samples << name << "{" << labels << "} " << c->get_value() << "\n";
+        } else if (c->type() != COUNTER_TYPE_NUMBER_PERCENTILES) {
+            // the cumulative value is exported, and the rate is computed by prometheus
+            family.samples << name << "{" << labels << "} " << c->get_cumulative_value() << "\n";
+        } else if (has_histogram) {
+            append_histogram_samples(buckets, sum, name, labels, family.samples);
+        } else {
+            append_summary_samples(c, name, labels, family.samples);
+        }
+    });
+
+    std::ostringstream out;
+    for (const auto &kv : families) {
+        if (!kv.second.help.empty()) {
+            out << "# HELP " << kv.first << " " << kv.second.help << "\n";
+        }
+        out << "# TYPE " << kv.first << " " << kv.second.type << "\n";
+        out << kv.second.samples.str();
+    }
+    resp.body = out.str();
+    resp.content_type = "text/plain; version=0.0.4";
+    resp.status_code = http_status_code::ok;
+}
+
 void perf_counter_http_service::get_perf_counter_handler(const http_request &req,
                                                          http_response &resp)
 {
@@ -30,6 +184,22 @@ void perf_counter_http_service::get_perf_counter_handler(const http_request &req
         if (COUNTER_TYPE_NUMBER_PERCENTILES == perf_counter->type()) {
             tp.add_row_name_and_data("p99", perf_counter->get_percentile(COUNTER_PERCENTILE_99));
             tp.add_row_name_and_data("p999", perf_counter->get_percentile(COUNTER_PERCENTILE_999));
+
+            // the buckets are shown as "[lower,upper]:count" once any value is set
+            std::vector<perf_counter::histogram_bucket> buckets;
+            int64_t sum = 0;
+            if (perf_counter->get_histogram(buckets, sum) && !buckets.empty()) {
+                uint64_t count = 0;
+                std::ostringstream buckets_out;
+                for (const auto &b : buckets) {
+                    buckets_out << (count == 0 ? "" : ",") << "[" << b.lower_bound << ","
+                                << b.upper_bound << "]:" << b.count;
+                    count += b.count;
+                }
+                tp.add_row_name_and_data("count", count);
+                tp.add_row_name_and_data("sum", sum);
+                tp.add_row_name_and_data("buckets", buckets_out.str());
+            }
         } else {
             tp.add_row_name_and_data("value", perf_counter->get_value());
         }
@@ -19,10 +19,20 @@ public:
                                    std::placeholders::_1,
                                    std::placeholders::_2),
                          "ip:port/perfCounter?name={perf_counter_name}");
+        register_handler("prometheus",
+                         std::bind(&perf_counter_http_service::get_prometheus_handler,
+                                   this,
+                                   std::placeholders::_1,
+                                   std::placeholders::_2),
+                         "ip:port/perfCounter/prometheus");
     }
 
     std::string path() const override { return "perfCounter"; }
 
     void get_perf_counter_handler(const http_request &req, http_response &resp);
+
+    // export all the counters in the text format of prometheus, reading the counters has no
+    // side effect, so any number of collectors can scrape the server at the same time
+    void get_prometheus_handler(const http_request &req, http_response &resp);
 };
 } // namespace dsn
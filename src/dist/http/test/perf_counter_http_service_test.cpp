@@ -62,4 +62,69 @@ TEST_F(perf_counter_http_service_test, get_perf_counter)
         ASSERT_EQ(fake_resp.body, fake_json);
     }
 }
+
+TEST_F(perf_counter_http_service_test, get_histogram)
+{
+    perf_counter_wrapper counter;
+    counter.init_global_counter(
+        "replica", "http", "histogram", COUNTER_TYPE_NUMBER_PERCENTILES, "histogram type");
+    counter->set(1);
+    counter->set(1);
+    counter->set(3);
+
+    std::string perf_counter_name;
+    perf_counter::build_full_name("replica", "http", "histogram", perf_counter_name);
+    http_request fake_req;
+    http_response fake_resp;
+    fake_req.query_args.emplace("name", perf_counter_name);
+    _perf_counter_http_service.get_perf_counter_handler(fake_req, fake_resp);
+
+    ASSERT_EQ(fake_resp.status_code, http_status_code::ok);
+    ASSERT_NE(std::string::npos, fake_resp.body.find(R"("count":"3")"));
+    ASSERT_NE(std::string::npos, fake_resp.body.find(R"("sum":"5")"));
+    ASSERT_NE(std::string::npos, fake_resp.body.find(R"("buckets":"[1,1]:2,[3,3]:1")"));
+}
+
+TEST_F(perf_counter_http_service_test, get_prometheus)
+{
+    perf_counter_wrapper number;
+    number.init_global_counter(
+        "prom.app", "http", "number.count", COUNTER_TYPE_NUMBER, "number type");
+    number->set(7);
+    perf_counter_wrapper rate;
+    rate.init_global_counter("prom.app", "http", "rate", COUNTER_TYPE_RATE, "rate type");
+    rate->add(12);
+    rate->get_value();
+    perf_counter_wrapper histogram;
+    histogram.init_global_counter(
+        "prom.app", "http", "latency", COUNTER_TYPE_NUMBER_PERCENTILES, "histogram type");
+    histogram->set(1);
+    histogram->set(3);
+    histogram->set(100);
+
+    http_request fake_req;
+    http_response fake_resp;
+    _perf_counter_http_service.get_prometheus_handler(fake_req, fake_resp);
+    ASSERT_EQ(fake_resp.status_code, http_status_code::ok);
+    ASSERT_EQ("text/plain; version=0.0.4", fake_resp.content_type);
+
+    const std::string &body = fake_resp.body;
+    for (const char *line : {"# HELP http_number_count number type\n",
+                             "# TYPE http_number_count gauge\n",
+                             "http_number_count{app=\"prom.app\"} 7\n",
+                             // the rate is exported as a counter of the cumulative value
+                             "# TYPE http_rate_total counter\n",
+                             "http_rate_total{app=\"prom.app\"} 12\n",
+                             "# TYPE http_latency histogram\n",
+                             "http_latency_bucket{app=\"prom.app\",le=\"0\"} 0\n",
+                             "http_latency_bucket{app=\"prom.app\",le=\"1\"} 1\n",
+                             "http_latency_bucket{app=\"prom.app\",le=\"3\"} 2\n",
+                             "http_latency_bucket{app=\"prom.app\",le=\"63\"} 2\n",
+                             "http_latency_bucket{app=\"prom.app\",le=\"127\"} 3\n",
+                             "http_latency_bucket{app=\"prom.app\",le=\"+Inf\"} 3\n",
+                             "http_latency_sum{app=\"prom.app\"} 104\n",
+                             "http_latency_count{app=\"prom.app\"} 3\n"}) {
+        ASSERT_NE(std::string::npos, body.find(line)) << line;
+    }
+}
 } // namespace dsn
@@ -0,0 +1,37 @@
+// Copyright (c) 2019, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include <dsn/tool-api/http_server.h>
+#include <dsn/toollet/trace_recorder.h>
+
+namespace dsn {
+
+class trace_http_service : public http_service
+{
+public:
+    trace_http_service()
+    {
+        // url: ip:port/trace, which can be loaded by chrome://tracing
+        register_handler("",
+                         std::bind(&trace_http_service::get_trace_handler,
+                                   this,
+                                   std::placeholders::_1,
+                                   std::placeholders::_2),
+                         "ip:port/trace");
+    }
+
+    std::string path() const override { return "trace"; }
+
+    // the events recorded by the trace_recorder toollet, which is empty if it's not enabled
+    void get_trace_handler(const http_request &req, http_response &resp)
+    {
+        resp.body = tools::trace_recorder::dump_chrome_trace();
+        resp.content_type = "application/json";
+        resp.status_code = http_status_code::ok;
+    }
+};
+
+} // namespace dsn
@@ -32,24 +32,62 @@
 namespace dsn {
 namespace replication {
 
+static std::atomic<uint64_t> s_next_table_version(1);
+
+thread_local partition_resolver_simple::routing_table_cache
+    partition_resolver_simple::s_table_cache;
+
 partition_resolver_simple::partition_resolver_simple(rpc_address meta_server, const char *app_name)
-    : partition_resolver(meta_server, app_name),
-      _app_id(-1),
-      _app_partition_count(-1),
-      _app_is_stateful(true)
+    : partition_resolver(meta_server, app_name)
+{
+    std::shared_ptr<routing_table> table(new routing_table());
+    table->app_id = -1;
+    table->partition_count = -1;
+    table->is_stateful = true;
+
+    zauto_lock l(_table_lock);
+    publish_table(std::move(table));
+}
+
+const partition_resolver_simple::routing_table &partition_resolver_simple::current_table() const
 {
+    uint64_t version = _table_version.load(std::memory_order_acquire);
+    routing_table_cache &cache = s_table_cache;
+    for (int i = 0; i < routing_table_cache::SLOT_COUNT; ++i) {
+        if (cache.versions[i] == version) {
+            return *cache.tables[i];
+        }
+    }
+
+    // the table is updated, or it's the first time for this thread to read it
+    int slot = cache.next_slot;
+    cache.next_slot = (slot + 1) % routing_table_cache::SLOT_COUNT;
+    {
+        zauto_lock l(_table_lock);
+        cache.tables[slot] = _table;
+    }
+    cache.versions[slot] = cache.tables[slot]->version;
+    return *cache.tables[slot];
+}
+
+void partition_resolver_simple::publish_table(std::shared_ptr<routing_table> &&table)
+{
+    table->version = s_next_table_version.fetch_add(1);
+    _table_version.store(table->version, std::memory_order_release);
+    _table = std::move(table);
 }
 
 void partition_resolver_simple::resolve(uint64_t partition_hash,
                                         std::function<void(resolve_result &&)> &&callback,
                                         int timeout_ms)
 {
+    const routing_table &table = current_table();
     int idx = -1;
-    if (_app_partition_count != -1) {
-        idx = get_partition_index(_app_partition_count, partition_hash);
+    if (table.partition_count != -1) {
+        idx = get_partition_index(table.partition_count, partition_hash);
         rpc_address target;
-        if (ERR_OK == get_address(idx, target)) {
-            callback(resolve_result{ERR_OK, target, {_app_id, idx}});
+        if (ERR_OK == get_address(table, idx, target)) {
+            callback(resolve_result{ERR_OK, target, {table.app_id, idx}});
             return;
         }
     }
@@ -78,17 +116,17 @@ void partition_resolver_simple::on_access_failure(int partition_index, error_cod
         &&
         err != ERR_BUSY //  busy (rpc busy or throttling busy)
         ) {
+        zauto_lock l(_table_lock);
         ddebug("clear partition configuration cache %d.%d due to access failure %s",
-               _app_id,
+               _table->app_id,
                partition_index,
                err.to_string());
 
-        {
-            zauto_write_lock l(_config_lock);
-            auto it = _config_cache.find(partition_index);
-            if (it != _config_cache.end()) {
-                _config_cache.erase(it);
-            }
+        if (partition_index < static_cast<int>(_table->configs.size()) &&
+            _table->configs[partition_index] != nullptr) {
+            std::shared_ptr<routing_table> table(new routing_table(*_table));
+            table->configs[partition_index] = nullptr;
+            publish_table(std::move(table));
         }
     }
 }
@@ -134,7 +172,8 @@ void partition_resolver_simple::end_request(request_context_ptr &&request,
     if (!called_by_timer && request->timeout_timer != nullptr)
         request->timeout_timer->cancel(false);
 
-    request->callback(resolve_result{err, addr, {_app_id, request->partition_index}});
+    request->callback(
+        resolve_result{err, addr, {current_table().app_id, request->partition_index}});
     request->completed = true;
 }
 
@@ -228,7 +267,7 @@ task_ptr partition_resolver_simple::query_config(int partition_index, int timeou
 {
     dinfo("%s.client: start query config, gpid = %d.%d, timeout_ms = %d",
           _app_name.c_str(),
-          _app_id,
+          current_table().app_id,
           partition_index,
           timeout_ms);
     task_spec *sp = task_spec::get(RPC_CM_QUERY_PARTITION_CONFIG_BY_INDEX);
@@ -252,6 +291,64 @@ task_ptr partition_resolver_simple::query_config(int partition_index, int timeou
         });
 }
 
+bool partition_resolver_simple::update_table(const configuration_query_by_index_response &resp)
+{
+    zauto_lock l(_table_lock);
+
+    if (_table->app_id != -1 && _table->app_id != resp.app_id) {
+        dassert(false,
+                "app id is changed (mostly the app was removed and created with the same "
+                "name), local Vs remote: %u vs %u ",
+                _table->app_id,
+                resp.app_id);
+    }
+    if (_table->partition_count != -1 && _table->partition_count != resp.partition_count) {
+        dassert(false,
+                "partition count is changed (mostly the app was removed and created with "
+                "the same name), local Vs remote: %u vs %u ",
+                _table->partition_count,
+                resp.partition_count);
+    }
+
+    std::shared_ptr<routing_table> table(new routing_table(*_table));
+    bool changed = (table->app_id != resp.app_id ||
+                    table->partition_count != resp.partition_count ||
+                    table->is_stateful != resp.is_stateful);
+    table->app_id = resp.app_id;
+    table->partition_count = resp.partition_count;
+    table->is_stateful = resp.is_stateful;
+    if (resp.partition_count > 0) {
+        table->configs.resize(resp.partition_count);
+    }
+
+    for (const auto &new_config : resp.partitions) {
+        dinfo("%s.client: query config reply, gpid = %d.%d, ballot = %" PRId64 ", primary = %s",
+              _app_name.c_str(),
+              new_config.pid.get_app_id(),
+              new_config.pid.get_partition_index(),
+              new_config.ballot,
+              new_config.primary.to_string());
+
+        int index = new_config.pid.get_partition_index();
+        if (index < 0 || index >= static_cast<int>(table->configs.size())) {
+            derror("%s.client: invalid partition index %d in query config reply",
+                   _app_name.c_str(),
+                   index);
+            continue;
+        }
+        auto &config = table->configs[index];
+        if (config == nullptr || !table->is_stateful || config->ballot < new_config.ballot) {
+            config = std::make_shared<const partition_configuration>(new_config);
+            changed = true;
+        }
+    }
+
+    if (changed) {
+        publish_table(std::move(table));
+    }
+    return changed;
+}
+
 void partition_resolver_simple::query_config_reply(error_code err,
                                                    dsn::message_ex *request,
                                                    dsn::message_ex *response,
@@ -263,57 +360,11 @@ void partition_resolver_simple::query_config_reply(error_code err,
         configuration_query_by_index_response resp;
         unmarshall(response, resp);
         if (resp.err == ERR_OK) {
-            zauto_write_lock l(_config_lock);
-
-            if (_app_id != -1 && _app_id != resp.app_id) {
-                dassert(false,
-                        "app id is changed (mostly the app was removed and created with the same "
-                        "name), local Vs remote: %u vs %u ",
-                        _app_id,
-                        resp.app_id);
-            }
-            if (_app_partition_count != -1 && _app_partition_count != resp.partition_count) {
-                dassert(false,
-                        "partition count is changed (mostly the app was removed and created with "
-                        "the same name), local Vs remote: %u vs %u ",
-                        _app_partition_count,
-                        resp.partition_count);
-            }
-            _app_id = resp.app_id;
-            _app_partition_count = resp.partition_count;
-            _app_is_stateful = resp.is_stateful;
-
-            for (auto it = resp.partitions.begin(); it != resp.partitions.end(); ++it) {
-                auto &new_config = *it;
-
-                dinfo("%s.client: query config reply, gpid = %d.%d, ballot = %" PRId64
-                      ", primary = %s",
-                      _app_name.c_str(),
-                      new_config.pid.get_app_id(),
-                      new_config.pid.get_partition_index(),
-                      new_config.ballot,
-                      new_config.primary.to_string());
-
-                auto it2 = _config_cache.find(new_config.pid.get_partition_index());
-                if (it2 == _config_cache.end()) {
-                    std::unique_ptr<partition_info> pi(new partition_info);
-                    pi->timeout_count = 0;
-                    pi->config = new_config;
-                    _config_cache.emplace(new_config.pid.get_partition_index(), std::move(pi));
-                } else if (_app_is_stateful && it2->second->config.ballot < new_config.ballot) {
-                    it2->second->timeout_count = 0;
-                    it2->second->config = new_config;
-                } else if (!_app_is_stateful) {
-                    it2->second->timeout_count = 0;
-                    it2->second->config = new_config;
-                } else {
-                    // nothing to do
-                }
-            }
+            update_table(resp);
         } else if (resp.err == ERR_OBJECT_NOT_FOUND) {
             derror("%s.client: query config reply, gpid = %d.%d, err = %s",
                    _app_name.c_str(),
-                   _app_id,
+                   current_table().app_id,
                    partition_index,
                    resp.err.to_string());
 
@@ -321,7 +372,7 @@ void partition_resolver_simple::query_config_reply(error_code err,
         } else {
             derror("%s.client: query config reply, gpid = %d.%d, err = %s",
                    _app_name.c_str(),
-                   _app_id,
+                   current_table().app_id,
                    partition_index,
                    resp.err.to_string());
 
@@ -330,7 +381,7 @@ void partition_resolver_simple::query_config_reply(error_code err,
     } else {
         derror("%s.client: query config reply, gpid = %d.%d, err = %s",
                _app_name.c_str(),
-               _app_id,
+               current_table().app_id,
                partition_index,
                err.to_string());
     }
@@ -364,13 +415,14 @@ void partition_resolver_simple::query_config_reply(error_code err,
         }
 
         if (!reqs2.empty()) {
-            if (_app_partition_count != -1) {
+            int partition_count = current_table().partition_count;
+            if (partition_count != -1) {
                 for (auto &req : reqs2) {
                     dassert(req->partition_index == -1,
                             "invalid partition_index, index = %d",
                             req->partition_index);
                     req->partition_index =
-                        get_partition_index(_app_partition_count, req->partition_hash);
+                        get_partition_index(partition_count, req->partition_hash);
                 }
             }
             handle_pending_requests(reqs2, client_err);
@@ -408,9 +460,10 @@ void partition_resolver_simple::handle_pending_requests(std::deque<request_conte
 }
 
 /*search in cache*/
-rpc_address partition_resolver_simple::get_address(const partition_configuration &config) const
+/*static*/ rpc_address partition_resolver_simple::get_address(const routing_table &table,
+                                                             const partition_configuration &config)
 {
-    if (_app_is_stateful) {
+    if (table.is_stateful) {
         return config.primary;
     } else {
         if (config.last_drops.size() == 0) {
@@ -421,24 +474,27 @@ rpc_address partition_resolver_simple::get_address(const partition_configuration
     }
 }
 
-error_code partition_resolver_simple::get_address(int partition_index, /*out*/ rpc_address &addr)
+/*static*/ error_code partition_resolver_simple::get_address(const routing_table &table,
+                                                            int partition_index,
+                                                            /*out*/ rpc_address &addr)
 {
-    // partition_configuration config;
-    {
-        zauto_read_lock l(_config_lock);
-        auto it = _config_cache.find(partition_index);
-        if (it != _config_cache.end()) {
-            // config = it->second->config;
-            addr = get_address(it->second->config);
-            if (addr.is_invalid()) {
-                return ERR_IO_PENDING;
-            } else {
-                return ERR_OK;
-            }
-        } else {
-            return ERR_OBJECT_NOT_FOUND;
-        }
+    if (partition_index < 0 || partition_index >= static_cast<int>(table.configs.size()) ||
+        table.configs[partition_index] == nullptr) {
+        return ERR_OBJECT_NOT_FOUND;
     }
+
+    addr = get_address(table, *table.configs[partition_index]);
+    if (addr.is_invalid()) {
+        return ERR_IO_PENDING;
+    } else {
+        return ERR_OK;
+    }
+}
+
+error_code partition_resolver_simple::get_address(int partition_index,
+                                                  /*out*/ rpc_address &addr) const
+{
+    return get_address(current_table(), partition_index, addr);
 }
 
 int partition_resolver_simple::get_partition_index(int partition_count, uint64_t partition_hash)
@@ -26,6 +26,10 @@
 
 #pragma once
 
+#include <atomic>
+#include <memory>
+#include <vector>
+
 #include <dsn/tool-api/task_tracker.h>
 #include <dsn/tool-api/zlocks.h>
 #include <dsn/service_api_c.h>
@@ -50,20 +54,46 @@ public:
 
     virtual int get_partition_index(int partition_count, uint64_t partition_hash) override;
 
-    int get_partition_count() const { return _app_partition_count; }
+    int get_partition_count() const { return current_table().partition_count; }
 
 private:
-    struct partition_info
+    // routing_table is an immutable snapshot of the partition configurations of the app. writers
+    // never modify a published table, but copy it, apply the changes and publish the new one, so
+    // the readers never wait for the writers. the configurations are shared among the tables, so
+    // a copy only costs a pointer per partition.
+    struct routing_table
+    {
+        uint64_t version; // unique among all the tables of all the resolvers
+        int app_id;
+        int partition_count;
+        bool is_stateful;
+        // indexed by partition index, nullptr if the configuration is unknown
+        std::vector<std::shared_ptr<const partition_configuration>> configs;
+    };
+    typedef std::shared_ptr<const routing_table> routing_table_ptr;
+
+    // the tables recently read by a thread. a reader only compares the version of the current
+    // table with the cached ones, without touching the reference count of the shared table,
+    // which would otherwise be a cache line written by all the readers.
+    struct routing_table_cache
     {
-        int timeout_count;
-        ::dsn::partition_configuration config;
+        static const int SLOT_COUNT = 4;
+        uint64_t versions[SLOT_COUNT] = {0};
+        routing_table_ptr tables[SLOT_COUNT];
+        int next_slot = 0;
     };
-    mutable dsn::zrwlock_nr _config_lock;
-    std::unordered_map<int, std::unique_ptr<partition_info>> _config_cache;
+    static thread_local routing_table_cache s_table_cache;
+
+    // get the current table, the reference is valid until the next call on the same thread
+    const routing_table &current_table() const;
+    // should be called with _table_lock held
+    void publish_table(std::shared_ptr<routing_table> &&table);
+    // apply the configurations from meta server, returns false if nothing changed
+    bool update_table(const configuration_query_by_index_response &resp);
 
-    int _app_id;
-    int _app_partition_count;
-    bool _app_is_stateful;
+    mutable zlock _table_lock; // serialize the writers
+    routing_table_ptr _table;
+    std::atomic<uint64_t> _table_version;
 
     typedef std::function<void(resolve_result &&)> callback_t;
     struct request_context : ref_counter, transient_object
@@ -98,8 +128,11 @@ private:
 
 private:
     // local routines
-    rpc_address get_address(const partition_configuration &config) const;
-    error_code get_address(int partition_index, /*out*/ rpc_address &addr);
+    static rpc_address get_address(const routing_table &table,
+                                   const partition_configuration &config);
+    static error_code
+    get_address(const routing_table &table, int partition_index, /*out*/ rpc_address &addr);
+    error_code get_address(int partition_index, /*out*/ rpc_address &addr) const;
     void handle_pending_requests(std::deque<request_context_ptr> &reqs, error_code err);
     void clear_all_pending_requests();
 
@@ -119,6 +152,8 @@ private:
                             dsn::message_ex *request,
                             dsn::message_ex *response,
                             int partition_index);
+
+    friend class partition_resolver_simple_test;
 };
 } // namespace replication
 } // namespace dsn
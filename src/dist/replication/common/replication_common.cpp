@@ -58,6 +58,10 @@ replication_options::replication_options()
     empty_write_disabled = false;
     duplication_enabled = true;
 
+    lazy_open_replicas = false;
+    lazy_open_warmup_concurrency = 2;
+    lazy_open_warmup_order = "primary_first";
+
     prepare_timeout_ms_for_secondaries = 1000;
     prepare_timeout_ms_for_potential_secondaries = 3000;
     prepare_decree_gap_for_debug_logging = 10000;
@@ -100,12 +104,16 @@ replication_options::replication_options()
     log_shared_file_size_mb = 32;
     log_shared_file_count_limit = 100;
     log_shared_batch_buffer_kb = 0;
+    log_shared_batch_buffer_count = 0;
+    log_shared_batch_buffer_flush_interval_ms = 0;
+    log_shared_replay_parallelism = 4;
     log_shared_force_flush = false;
     log_shared_pending_size_throttling_threshold_kb = 0;
     log_shared_pending_size_throttling_delay_ms = 0;
 
     config_sync_disabled = false;
     config_sync_interval_ms = 30000;
+    config_sync_full_interval_ms = 300000;
 
     mem_release_enabled = true;
     mem_release_check_interval_ms = 3600000;
@@ -275,6 +283,29 @@ void replication_options::initialize()
                                   empty_write_disabled,
                                   "whether to disable empty write, default is false");
 
+    lazy_open_replicas = dsn_config_get_value_bool(
+        "replication",
+        "lazy_open_replicas",
+        lazy_open_replicas,
+        "whether to defer opening the replicas which have nothing to replay in the shared log "
+        "on startup, they are reported to meta server from their metadata and opened on the "
+        "first access or by the background warm-up");
+    lazy_open_warmup_concurrency = (int)dsn_config_get_value_uint64(
+        "replication",
+        "lazy_open_warmup_concurrency",
+        lazy_open_warmup_concurrency,
+        "max count of the replicas being opened by the background warm-up if lazy_open_replicas "
+        "is true, 0 means opening only on the first access");
+    lazy_open_warmup_order = dsn_config_get_value_string(
+        "replication",
+        "lazy_open_warmup_order",
+        lazy_open_warmup_order.c_str(),
+        "order of the background warm-up: primary_first (primaries, then secondaries on meta "
+        "server, then the others) or gpid");
+    dassert(lazy_open_warmup_order == "primary_first" || lazy_open_warmup_order == "gpid",
+            "invalid lazy_open_warmup_order(%s) in config",
+            lazy_open_warmup_order.c_str());
+
     duplication_enabled = dsn_config_get_value_bool(
         "replication", "duplication_enabled", duplication_enabled, "is duplication enabled");
 
@@ -450,6 +481,24 @@ void replication_options::initialize()
                                          "log_shared_batch_buffer_kb",
                                          log_shared_batch_buffer_kb,
                                          "shared log buffer size (KB) for batching incoming logs");
+    log_shared_batch_buffer_count =
+        (int)dsn_config_get_value_uint64("replication",
+                                         "log_shared_batch_buffer_count",
+                                         log_shared_batch_buffer_count,
+                                         "shared log mutation count for batching incoming logs");
+    log_shared_batch_buffer_flush_interval_ms = (int)dsn_config_get_value_uint64(
+        "replication",
+        "log_shared_batch_buffer_flush_interval_ms",
+        log_shared_batch_buffer_flush_interval_ms,
+        "max time (ms) for incoming logs to linger in the shared log buffer, waiting for "
+        "log_shared_batch_buffer_kb or log_shared_batch_buffer_count to be reached, "
+        "0 means writing as soon as the previous write is done");
+    log_shared_replay_parallelism = (int)dsn_config_get_value_uint64(
+        "replication",
+        "log_shared_replay_parallelism",
+        log_shared_replay_parallelism,
+        "count of the tasks to decode and apply the shared log on startup, "
+        "0 or 1 means replaying in a single thread");
     log_shared_force_flush =
         dsn_config_get_value_bool("replication",
                                   "log_shared_force_flush",
@@ -476,6 +525,13 @@ void replication_options::initialize()
         "config_sync_interval_ms",
         config_sync_interval_ms,
         "every this period(ms) the replica syncs replica configuration with the meta server");
+    config_sync_full_interval_ms = (int)dsn_config_get_value_uint64(
+        "replication",
+        "config_sync_full_interval_ms",
+        config_sync_full_interval_ms,
+        "every this period(ms) the replica syncs the configurations of all the replicas and "
+        "reports the stored replicas to the meta server, in the other rounds only the "
+        "configurations changed since last sync are synced. 0 means always syncing all");
 
     mem_release_enabled = dsn_config_get_value_bool("replication",
                                                     "mem_release_enabled",
@@ -57,6 +57,10 @@ public:
     bool empty_write_disabled;
     bool duplication_enabled;
 
+    bool lazy_open_replicas;
+    int32_t lazy_open_warmup_concurrency;
+    std::string lazy_open_warmup_order;
+
     int32_t prepare_timeout_ms_for_secondaries;
     int32_t prepare_timeout_ms_for_potential_secondaries;
     int32_t prepare_decree_gap_for_debug_logging;
@@ -99,12 +103,16 @@ public:
     int32_t log_shared_file_size_mb;
     int32_t log_shared_file_count_limit;
     int32_t log_shared_batch_buffer_kb;
+    int32_t log_shared_batch_buffer_count;
+    int32_t log_shared_batch_buffer_flush_interval_ms;
+    int32_t log_shared_replay_parallelism;
     bool log_shared_force_flush;
     int32_t log_shared_pending_size_throttling_threshold_kb;
     int32_t log_shared_pending_size_throttling_delay_ms;
 
     bool config_sync_disabled;
     int32_t config_sync_interval_ms;
+    int32_t config_sync_full_interval_ms;
 
     bool mem_release_enabled;
     int32_t mem_release_check_interval_ms;
@@ -3492,6 +3492,25 @@ void configuration_query_by_node_request::__set_info(const replica_server_info &
     __isset.info = true;
 }
 
+void configuration_query_by_node_request::__set_config_epoch(const int64_t val)
+{
+    this->config_epoch = val;
+    __isset.config_epoch = true;
+}
+
+void configuration_query_by_node_request::__set_config_version(const int64_t val)
+{
+    this->config_version = val;
+    __isset.config_version = true;
+}
+
+void configuration_query_by_node_request::__set_refresh_partitions(
+    const std::vector<::dsn::gpid> &val)
+{
+    this->refresh_partitions = val;
+    __isset.refresh_partitions = true;
+}
+
 uint32_t configuration_query_by_node_request::read(::apache::thrift::protocol::TProtocol *iprot)
 {
 
@@ -3546,6 +3565,41 @@ uint32_t configuration_query_by_node_request::read(::apache::thrift::protocol::T
                 xfer += iprot->skip(ftype);
             }
             break;
+        case 4:
+            if (ftype == ::apache::thrift::protocol::T_I64) {
+                xfer += iprot->readI64(this->config_epoch);
+                this->__isset.config_epoch = true;
+            } else {
+                xfer += iprot->skip(ftype);
+            }
+            break;
+        case 5:
+            if (ftype == ::apache::thrift::protocol::T_I64) {
+                xfer += iprot->readI64(this->config_version);
+                this->__isset.config_version = true;
+            } else {
+                xfer += iprot->skip(ftype);
+            }
+            break;
+        case 6:
+            if (ftype == ::apache::thrift::protocol::T_LIST) {
+                {
+                    this->refresh_partitions.clear();
+                    uint32_t _size706;
+                    ::apache::thrift::protocol::TType _etype709;
+                    xfer += iprot->readListBegin(_etype709, _size706);
+                    this->refresh_partitions.resize(_size706);
+                    uint32_t _i710;
+                    for (_i710 = 0; _i710 < _size706; ++_i710) {
+                        xfer += this->refresh_partitions[_i710].read(iprot);
+                    }
+                    xfer += iprot->readListEnd();
+                }
+                this->__isset.refresh_partitions = true;
+            } else {
+                xfer += iprot->skip(ftype);
+            }
+            break;
         default:
             xfer += iprot->skip(ftype);
             break;
@@ -3588,6 +3642,31 @@ configuration_query_by_node_request::write(::apache::thrift::protocol::TProtocol
         xfer += this->info.write(oprot);
         xfer += oprot->writeFieldEnd();
     }
+    if (this->__isset.config_epoch) {
+        xfer += oprot->writeFieldBegin("config_epoch", ::apache::thrift::protocol::T_I64, 4);
+        xfer += oprot->writeI64(this->config_epoch);
+        xfer += oprot->writeFieldEnd();
+    }
+    if (this->__isset.config_version) {
+        xfer += oprot->writeFieldBegin("config_version", ::apache::thrift::protocol::T_I64, 5);
+        xfer += oprot->writeI64(this->config_version);
+        xfer += oprot->writeFieldEnd();
+    }
+    if (this->__isset.refresh_partitions) {
+        xfer += oprot->writeFieldBegin("refresh_partitions", ::apache::thrift::protocol::T_LIST, 6);
+        {
+            xfer += oprot->writeListBegin(::apache::thrift::protocol::T_STRUCT,
+                                          static_cast<uint32_t>(this->refresh_partitions.size()));
+            std::vector<::dsn::gpid>::const_iterator _iter716;
+            for (_iter716 = this->refresh_partitions.begin();
+                 _iter716 != this->refresh_partitions.end();
+                 ++_iter716) {
+                xfer += (*_iter716).write(oprot);
+            }
+            xfer += oprot->writeListEnd();
+        }
+        xfer += oprot->writeFieldEnd();
+    }
     xfer += oprot->writeFieldStop();
     xfer += oprot->writeStructEnd();
     return xfer;
@@ -3599,6 +3678,9 @@ void swap(configuration_query_by_node_request &a, configuration_query_by_node_re
     swap(a.node, b.node);
     swap(a.stored_replicas, b.stored_replicas);
     swap(a.info, b.info);
+    swap(a.config_epoch, b.config_epoch);
+    swap(a.config_version, b.config_version);
+    swap(a.refresh_partitions, b.refresh_partitions);
     swap(a.__isset, b.__isset);
 }
 
@@ -3608,6 +3690,9 @@ configuration_query_by_node_request::configuration_query_by_node_request(
     node = other108.node;
     stored_replicas = other108.stored_replicas;
     info = other108.info;
+    config_epoch = other108.config_epoch;
+    config_version = other108.config_version;
+    refresh_partitions = other108.refresh_partitions;
     __isset = other108.__isset;
 }
 configuration_query_by_node_request::configuration_query_by_node_request(
@@ -3616,6 +3701,9 @@ configuration_query_by_node_request::configuration_query_by_node_request(
     node = std::move(other109.node);
     stored_replicas = std::move(other109.stored_replicas);
     info = std::move(other109.info);
+    config_epoch = std::move(other109.config_epoch);
+    config_version = std::move(other109.config_version);
+    refresh_partitions = std::move(other109.refresh_partitions);
     __isset = std::move(other109.__isset);
 }
 configuration_query_by_node_request &configuration_query_by_node_request::
@@ -3624,6 +3712,9 @@ operator=(const configuration_query_by_node_request &other110)
     node = other110.node;
     stored_replicas = other110.stored_replicas;
     info = other110.info;
+    config_epoch = other110.config_epoch;
+    config_version = other110.config_version;
+    refresh_partitions = other110.refresh_partitions;
     __isset = other110.__isset;
     return *this;
 }
@@ -3633,6 +3724,9 @@ operator=(configuration_query_by_node_request &&other111)
     node = std::move(other111.node);
     stored_replicas = std::move(other111.stored_replicas);
     info = std::move(other111.info);
+    config_epoch = std::move(other111.config_epoch);
+    config_version = std::move(other111.config_version);
+    refresh_partitions = std::move(other111.refresh_partitions);
     __isset = std::move(other111.__isset);
     return *this;
 }
@@ -3647,6 +3741,15 @@ void configuration_query_by_node_request::printTo(std::ostream &out) const
     out << ", "
         << "info=";
     (__isset.info ? (out << to_string(info)) : (out << "<null>"));
+    out << ", "
+        << "config_epoch=";
+    (__isset.config_epoch ? (out << to_string(config_epoch)) : (out << "<null>"));
+    out << ", "
+        << "config_version=";
+    (__isset.config_version ? (out << to_string(config_version)) : (out << "<null>"));
+    out << ", "
+        << "refresh_partitions=";
+    (__isset.refresh_partitions ? (out << to_string(refresh_partitions)) : (out << "<null>"));
     out << ")";
 }
 
@@ -3669,6 +3772,25 @@ void configuration_query_by_node_response::__set_gc_replicas(const std::vector<r
     __isset.gc_replicas = true;
 }
 
+void configuration_query_by_node_response::__set_config_epoch(const int64_t val)
+{
+    this->config_epoch = val;
+    __isset.config_epoch = true;
+}
+
+void configuration_query_by_node_response::__set_config_version(const int64_t val)
+{
+    this->config_version = val;
+    __isset.config_version = true;
+}
+
+void configuration_query_by_node_response::__set_unchanged_partitions(
+    const std::vector<::dsn::gpid> &val)
+{
+    this->unchanged_partitions = val;
+    __isset.unchanged_partitions = true;
+}
+
 uint32_t configuration_query_by_node_response::read(::apache::thrift::protocol::TProtocol *iprot)
 {
 
@@ -3734,6 +3856,41 @@ uint32_t configuration_query_by_node_response::read(::apache::thrift::protocol::
                 xfer += iprot->skip(ftype);
             }
             break;
+        case 4:
+            if (ftype == ::apache::thrift::protocol::T_I64) {
+                xfer += iprot->readI64(this->config_epoch);
+                this->__isset.config_epoch = true;
+            } else {
+                xfer += iprot->skip(ftype);
+            }
+            break;
+        case 5:
+            if (ftype == ::apache::thrift::protocol::T_I64) {
+                xfer += iprot->readI64(this->config_version);
+                this->__isset.config_version = true;
+            } else {
+                xfer += iprot->skip(ftype);
+            }
+            break;
+        case 6:
+            if (ftype == ::apache::thrift::protocol::T_LIST) {
+                {
+                    this->unchanged_partitions.clear();
+                    uint32_t _size711;
+                    ::apache::thrift::protocol::TType _etype714;
+                    xfer += iprot->readListBegin(_etype714, _size711);
+                    this->unchanged_partitions.resize(_size711);
+                    uint32_t _i715;
+                    for (_i715 = 0; _i715 < _size711; ++_i715) {
+                        xfer += this->unchanged_partitions[_i715].read(iprot);
+                    }
+                    xfer += iprot->readListEnd();
+                }
+                this->__isset.unchanged_partitions = true;
+            } else {
+                xfer += iprot->skip(ftype);
+            }
+            break;
         default:
             xfer += iprot->skip(ftype);
             break;
@@ -3783,6 +3940,32 @@ configuration_query_by_node_response::write(::apache::thrift::protocol::TProtoco
         }
         xfer += oprot->writeFieldEnd();
     }
+    if (this->__isset.config_epoch) {
+        xfer += oprot->writeFieldBegin("config_epoch", ::apache::thrift::protocol::T_I64, 4);
+        xfer += oprot->writeI64(this->config_epoch);
+        xfer += oprot->writeFieldEnd();
+    }
+    if (this->__isset.config_version) {
+        xfer += oprot->writeFieldBegin("config_version", ::apache::thrift::protocol::T_I64, 5);
+        xfer += oprot->writeI64(this->config_version);
+        xfer += oprot->writeFieldEnd();
+    }
+    if (this->__isset.unchanged_partitions) {
+        xfer +=
+            oprot->writeFieldBegin("unchanged_partitions", ::apache::thrift::protocol::T_LIST, 6);
+        {
+            xfer += oprot->writeListBegin(::apache::thrift::protocol::T_STRUCT,
+                                          static_cast<uint32_t>(this->unchanged_partitions.size()));
+            std::vector<::dsn::gpid>::const_iterator _iter717;
+            for (_iter717 = this->unchanged_partitions.begin();
+                 _iter717 != this->unchanged_partitions.end();
+                 ++_iter717) {
+                xfer += (*_iter717).write(oprot);
+            }
+            xfer += oprot->writeListEnd();
+        }
+        xfer += oprot->writeFieldEnd();
+    }
     xfer += oprot->writeFieldStop();
     xfer += oprot->writeStructEnd();
     return xfer;
@@ -3794,6 +3977,9 @@ void swap(configuration_query_by_node_response &a, configuration_query_by_node_r
     swap(a.err, b.err);
     swap(a.partitions, b.partitions);
     swap(a.gc_replicas, b.gc_replicas);
+    swap(a.config_epoch, b.config_epoch);
+    swap(a.config_version, b.config_version);
+    swap(a.unchanged_partitions, b.unchanged_partitions);
     swap(a.__isset, b.__isset);
 }
 
@@ -3803,6 +3989,9 @@ configuration_query_by_node_response::configuration_query_by_node_response(
     err = other124.err;
     partitions = other124.partitions;
     gc_replicas = other124.gc_replicas;
+    config_epoch = other124.config_epoch;
+    config_version = other124.config_version;
+    unchanged_partitions = other124.unchanged_partitions;
     __isset = other124.__isset;
 }
 configuration_query_by_node_response::configuration_query_by_node_response(
@@ -3811,6 +4000,9 @@ configuration_query_by_node_response::configuration_query_by_node_response(
     err = std::move(other125.err);
     partitions = std::move(other125.partitions);
     gc_replicas = std::move(other125.gc_replicas);
+    config_epoch = std::move(other125.config_epoch);
+    config_version = std::move(other125.config_version);
+    unchanged_partitions = std::move(other125.unchanged_partitions);
     __isset = std::move(other125.__isset);
 }
 configuration_query_by_node_response &configuration_query_by_node_response::
@@ -3819,6 +4011,9 @@ operator=(const configuration_query_by_node_response &other126)
     err = other126.err;
     partitions = other126.partitions;
     gc_replicas = other126.gc_replicas;
+    config_epoch = other126.config_epoch;
+    config_version = other126.config_version;
+    unchanged_partitions = other126.unchanged_partitions;
     __isset = other126.__isset;
     return *this;
 }
@@ -3828,6 +4023,9 @@ operator=(configuration_query_by_node_response &&other127)
     err = std::move(other127.err);
     partitions = std::move(other127.partitions);
     gc_replicas = std::move(other127.gc_replicas);
+    config_epoch = std::move(other127.config_epoch);
+    config_version = std::move(other127.config_version);
+    unchanged_partitions = std::move(other127.unchanged_partitions);
     __isset = std::move(other127.__isset);
     return *this;
 }
@@ -3841,6 +4039,15 @@ void configuration_query_by_node_response::printTo(std::ostream &out) const
     out << ", "
         << "gc_replicas=";
     (__isset.gc_replicas ? (out << to_string(gc_replicas)) : (out << "<null>"));
+    out << ", "
+        << "config_epoch=";
+    (__isset.config_epoch ? (out << to_string(config_epoch)) : (out << "<null>"));
+    out << ", "
+        << "config_version=";
+    (__isset.config_version ? (out << to_string(config_version)) : (out << "<null>"));
+    out << ", "
+        << "unchanged_partitions=";
+    (__isset.unchanged_partitions ? (out << to_string(unchanged_partitions)) : (out << "<null>"));
     out << ")";
 }
 
@@ -0,0 +1,251 @@
+// Copyright (c) 2019, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "dist/replication/client/partition_resolver_simple.h"
+
+namespace dsn {
+namespace replication {
+
+class partition_resolver_simple_test : public ::testing::Test
+{
+public:
+    typedef partition_resolver_simple::resolve_result resolve_result;
+
+    void SetUp() override
+    {
+        _resolver = new partition_resolver_simple(rpc_address("127.0.0.1", 34601), "test_app");
+    }
+
+    // all the partitions of the app are served by the node with port 10000 + index
+    configuration_query_by_index_response make_response(int partition_count,
+                                                        int64_t ballot,
+                                                        bool is_stateful = true)
+    {
+        configuration_query_by_index_response resp;
+        resp.err = ERR_OK;
+        resp.app_id = APP_ID;
+        resp.partition_count = partition_count;
+        resp.is_stateful = is_stateful;
+        for (int i = 0; i < partition_count; ++i) {
+            partition_configuration config;
+            config.pid = gpid(APP_ID, i);
+            config.ballot = ballot;
+            if (is_stateful) {
+                config.primary = rpc_address("127.0.0.1", 10000 + i);
+            } else {
+                config.last_drops.push_back(rpc_address("127.0.0.1", 10000 + i));
+            }
+            resp.partitions.push_back(config);
+        }
+        return resp;
+    }
+
+    bool update_table(const configuration_query_by_index_response &resp)
+    {
+        return _resolver->update_table(resp);
+    }
+
+    // returns the error of resolve, only valid if the address is known
+    error_code resolve(uint64_t partition_hash, rpc_address &addr, gpid &pid)
+    {
+        error_code err = ERR_UNKNOWN;
+        _resolver->resolve(partition_hash,
+                           [&](resolve_result &&result) {
+                               err = result.err;
+                               addr = result.address;
+                               pid = result.pid;
+                           },
+                           1000);
+        return err;
+    }
+
+    uint64_t table_version() const { return _resolver->_table_version.load(); }
+
+public:
+    const int APP_ID = 3;
+    ref_ptr<partition_resolver_simple> _resolver;
+};
+
+TEST_F(partition_resolver_simple_test, resolve)
+{
+    ASSERT_TRUE(update_table(make_response(8, 1)));
+    ASSERT_EQ(8, _resolver->get_partition_count());
+
+    for (uint64_t hash = 0; hash < 32; ++hash) {
+        rpc_address addr;
+        gpid pid;
+        ASSERT_EQ(ERR_OK, resolve(hash, addr, pid));
+        ASSERT_EQ(gpid(APP_ID, hash % 8), pid);
+        ASSERT_EQ(rpc_address("127.0.0.1", 10000 + hash % 8), addr);
+    }
+}
+
+TEST_F(partition_resolver_simple_test, update_by_ballot)
+{
+    ASSERT_TRUE(update_table(make_response(4, 5)));
+    uint64_t version = table_version();
+
+    // stale or same configurations are ignored, and no table is published
+    auto resp = make_response(4, 5);
+    resp.partitions[1].primary = rpc_address("127.0.0.1", 20001);
+    ASSERT_FALSE(update_table(resp));
+    ASSERT_EQ(version, table_version());
+
+    // only the partitions with larger ballot are updated
+    resp = make_response(4, 5);
+    resp.partitions[1].ballot = 6;
+    resp.partitions[1].primary = rpc_address("127.0.0.1", 20001);
+    resp.partitions[2].ballot = 4;
+    resp.partitions[2].primary = rpc_address("127.0.0.1", 20002);
+    ASSERT_TRUE(update_table(resp));
+    ASSERT_NE(version, table_version());
+
+    rpc_address addr;
+    gpid pid;
+    ASSERT_EQ(ERR_OK, resolve(1, addr, pid));
+    ASSERT_EQ(rpc_address("127.0.0.1", 20001), addr);
+    ASSERT_EQ(ERR_OK, resolve(2, addr, pid));
+    ASSERT_EQ(rpc_address("127.0.0.1", 10002), addr);
+}
+
+TEST_F(partition_resolver_simple_test, on_access_failure)
+{
+    ASSERT_TRUE(update_table(make_response(4, 1)));
+    uint64_t version = table_version();
+
+    // errors which don't need reconfiguration keep the cache
+    _resolver->on_access_failure(1, ERR_BUSY);
+    ASSERT_EQ(version, table_version());
+
+    _resolver->on_access_failure(1, ERR_TIMEOUT);
+    ASSERT_NE(version, table_version());
+
+    // the partition is updated again even with the same ballot once it's cleared
+    ASSERT_TRUE(update_table(make_response(4, 1)));
+    rpc_address addr;
+    gpid pid;
+    ASSERT_EQ(ERR_OK, resolve(1, addr, pid));
+    ASSERT_EQ(rpc_address("127.0.0.1", 10001), addr);
+}
+
+TEST_F(partition_resolver_simple_test, stateless)
+{
+    ASSERT_TRUE(update_table(make_response(4, 1, false)));
+    // configurations of stateless apps are always updated
+    ASSERT_TRUE(update_table(make_response(4, 1, false)));
+
+    rpc_address addr;
+    gpid pid;
+    ASSERT_EQ(ERR_OK, resolve(3, addr, pid));
+    ASSERT_EQ(rpc_address("127.0.0.1", 10003), addr);
+}
+
+// readers always see a complete table while the configurations are updated concurrently
+TEST_F(partition_resolver_simple_test, concurrent_update)
+{
+    const int partition_count = 16;
+    ASSERT_TRUE(update_table(make_response(partition_count, 1)));
+
+    std::atomic<bool> stop(false);
+    std::atomic<int> error_count(0);
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; ++t) {
+        readers.emplace_back([&, t]() {
+            uint64_t hash = t;
+            while (!stop.load()) {
+                rpc_address addr;
+                gpid pid;
+                error_code err = resolve(hash, addr, pid);
+                int port = addr.port();
+                int index = static_cast<int>(hash % partition_count);
+                // the primary of a partition is switched between 10000 + i and 20000 + i
+                if (err != ERR_OK || pid.get_partition_index() != index ||
+                    (port != 10000 + index && port != 20000 + index)) {
+                    error_count.fetch_add(1);
+                }
+                ++hash;
+            }
+        });
+    }
+
+    for (int64_t ballot = 2; ballot < 1000; ++ballot) {
+        auto resp = make_response(partition_count, ballot);
+        if (ballot % 2 == 0) {
+            for (auto &config : resp.partitions) {
+                config.primary = rpc_address("127.0.0.1", 20000 + config.pid.get_partition_index());
+            }
+        }
+        EXPECT_TRUE(update_table(resp));
+    }
+    stop.store(true);
+    for (auto &t : readers) {
+        t.join();
+    }
+    ASSERT_EQ(0, error_count.load());
+}
+
+// measure the throughput of resolve with the address cached, which is the path of every client
+// request, with a writer updating the configurations now and then. it's a benchmark rather than a
+// unit test, run it with --gtest_also_run_disabled_tests
+TEST_F(partition_resolver_simple_test, DISABLED_resolve_benchmark)
+{
+    const int partition_count = 64;
+    const int resolves_per_thread = 1000000;
+    ASSERT_TRUE(update_table(make_response(partition_count, 1)));
+
+    for (int thread_count : {1, 2, 4, 8}) {
+        std::atomic<bool> stop(false);
+        std::thread writer([&]() {
+            int64_t ballot = 2;
+            while (!stop.load()) {
+                update_table(make_response(partition_count, ballot++));
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+        });
+
+        std::atomic<int> resolved(0);
+        std::vector<std::thread> readers;
+        auto start = std::chrono::steady_clock::now();
+        for (int t = 0; t < thread_count; ++t) {
+            readers.emplace_back([&, t]() {
+                int count = 0;
+                for (int i = 0; i < resolves_per_thread; ++i) {
+                    _resolver->resolve(static_cast<uint64_t>(t) * resolves_per_thread + i,
+                                       [&count](resolve_result &&result) {
+                                           if (result.err == ERR_OK) {
+                                               ++count;
+                                           }
+                                       },
+                                       1000);
+                }
+                resolved.fetch_add(count);
+            });
+        }
+        for (auto &t : readers) {
+            t.join();
+        }
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+                           std::chrono::steady_clock::now() - start)
+                           .count();
+        stop.store(true);
+        writer.join();
+
+        ASSERT_EQ(thread_count * resolves_per_thread, resolved.load());
+        printf("resolve benchmark: threads = %d, qps = %.0f\n",
+               thread_count,
+               static_cast<double>(resolved.load()) * 1000000 / std::max<int64_t>(elapsed, 1));
+    }
+}
+
+} // namespace replication
+} // namespace dsn
@@ -309,8 +309,9 @@ error_code replica_bulk_loader::download_sst_files(const std::string &app_name,
 
     // download metadata file synchronously
     uint64_t file_size = 0;
+    std::string file_md5;
     error_code err = _stub->_block_service_manager.download_file(
-        remote_dir, local_dir, bulk_load_constant::BULK_LOAD_METADATA, fs, file_size);
+        remote_dir, local_dir, bulk_load_constant::BULK_LOAD_METADATA, fs, file_size, file_md5);
     if (err != ERR_OK) {
         derror_replica("download bulk load metadata file failed, error = {}", err.to_string());
         return err;
@@ -330,12 +331,18 @@ error_code replica_bulk_loader::download_sst_files(const std::string &app_name,
         auto bulk_load_download_task = tasking::enqueue(
             LPC_BACKGROUND_BULK_LOAD, tracker(), [this, remote_dir, local_dir, f_meta, fs]() {
                 uint64_t f_size = 0;
+                std::string f_md5;
                 error_code ec = _stub->_block_service_manager.download_file(
-                    remote_dir, local_dir, f_meta.name, fs, f_size);
-                const std::string &file_name =
-                    utils::filesystem::path_combine(local_dir, f_meta.name);
+                    remote_dir, local_dir, f_meta.name, fs, f_size, f_md5);
+                // the md5 has been calculated while downloading, no need to read the file again
                 if (ec == ERR_OK &&
-                    !utils::filesystem::verify_file(file_name, f_meta.md5, f_meta.size)) {
+                    (f_md5 != f_meta.md5 || f_size != static_cast<uint64_t>(f_meta.size))) {
+                    derror_replica("file({}) is damaged, size: {} VS {}, md5: {} VS {}",
+                                   f_meta.name,
+                                   f_size,
+                                   f_meta.size,
+                                   f_md5,
+                                   f_meta.md5);
                     ec = ERR_CORRUPTION;
                 }
                 if (ec != ERR_OK) {
@@ -225,8 +225,9 @@ void load_from_private_log::start_from_log_file(log_file_ptr f)
     ddebug_replica("start loading from log file {}", f->path());
 
     _current = std::move(f);
-    _start_offset = 0;
-    _current_global_end_offset = _current->start_offset();
+    // skip the blocks in front of `_start_decree`
+    _start_offset = _current->seek_to_decree(_start_decree);
+    _current_global_end_offset = _current->start_offset() + _start_offset;
     _err_block_repeats_num = 0;
 }
 
@@ -88,7 +88,8 @@ public:
     size_t size() const { return _full_blocks_size + _blocks.crbegin()->size(); }
     size_t blob_count() const { return _full_blocks_blob_cnt + _blocks.crbegin()->data().size(); }
 
-    std::vector<mutation_ptr> mutations() const { return _mutations; }
+    const std::vector<mutation_ptr> &mutations() const { return _mutations; }
+    size_t mutation_count() const { return _mutations.size(); }
 
     // The callback registered for each write.
     const std::vector<aio_task_ptr> &callbacks() const { return _callbacks; }
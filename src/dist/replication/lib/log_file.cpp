@@ -29,13 +29,26 @@
 
 #include <dsn/utility/filesystem.h>
 #include <dsn/utility/crc.h>
+#include <dsn/utility/flags.h>
 #include <dsn/dist/fmt_logging.h>
 
 namespace dsn {
 namespace replication {
 
+DSN_DEFINE_bool("replication",
+                plog_mmap_read_enabled,
+                true,
+                "whether to read the private log through mmap for duplication and learning");
+
+DSN_DEFINE_uint32("replication",
+                  plog_index_interval_kb,
+                  256,
+                  "min interval in KB between two entries of the private log index, "
+                  "0 means the private log is not indexed");
+
 log_file::~log_file() { close(); }
-/*static */ log_file_ptr log_file::open_read(const char *path, /*out*/ error_code &err)
+/*static */ log_file_ptr
+log_file::open_read(const char *path, /*out*/ error_code &err, bool use_mmap /*= false*/)
 {
     char splitters[] = {'\\', '/', 0};
     std::string name = utils::get_last_component(std::string(path), splitters);
@@ -87,6 +100,7 @@ log_file::~log_file() { close(); }
     }
 
     auto lf = new log_file(path, hfile, index, start_offset, true);
+    lf->_use_mmap = use_mmap && FLAGS_plog_mmap_read_enabled;
     lf->reset_stream();
     blob hdr_blob;
     err = lf->read_next_log_block(hdr_blob);
@@ -154,6 +168,7 @@ log_file::log_file(
     _path = path;
     _index = index;
     _crc32 = 0;
+    _use_mmap = false;
     _last_write_time = 0;
     memset(&_header, 0, sizeof(_header));
 
@@ -173,7 +188,12 @@ void log_file::close()
     //_stream implicitly refer to _handle so it needs to be cleaned up first.
     // TODO: We need better abstraction to avoid those manual stuffs..
     _stream.reset(nullptr);
+    _mmap_stream.reset(nullptr);
     if (_handle) {
+        if (!_is_read) {
+            save_index_no_lock();
+        }
+
         error_code err = file::close(_handle);
         dassert(err == ERR_OK, "file::close failed, err = %s", err.to_string());
 
@@ -192,10 +212,15 @@ void log_file::flush() const
     }
 }
 
+error_code log_file::read_next(size_t size, /*out*/ blob &result)
+{
+    return _use_mmap ? _mmap_stream->read_next(size, result) : _stream->read_next(size, result);
+}
+
 error_code log_file::read_next_log_block(/*out*/ ::dsn::blob &bb)
 {
     dassert(_is_read, "log file must be of read mode");
-    auto err = _stream->read_next(sizeof(log_block_header), bb);
+    auto err = read_next(sizeof(log_block_header), bb);
     if (err != ERR_OK || bb.length() != sizeof(log_block_header)) {
         if (err == ERR_OK || err == ERR_HANDLE_EOF) {
             // if read_count is 0, then we meet the end of file
@@ -216,7 +241,7 @@ error_code log_file::read_next_log_block(/*out*/ ::dsn::blob &bb)
         return ERR_INVALID_DATA;
     }
 
-    err = _stream->read_next(hdr.length, bb);
+    err = read_next(hdr.length, bb);
     if (err != ERR_OK || hdr.length != bb.length()) {
         derror("read data block body failed, size = %d vs %d, err = %s",
                bb.length(),
@@ -268,6 +293,7 @@ aio_task_ptr log_file::commit_log_blocks(log_appender &pending,
 
     auto size = (long long)pending.size();
     size_t vec_size = pending.blob_count();
+    uint32_t crc_init = _crc32;
     std::vector<dsn_file_buffer_t> buffer_vector(vec_size);
     int buffer_idx = 0;
     for (log_block &block : pending.all_blocks()) {
@@ -298,6 +324,13 @@ aio_task_ptr log_file::commit_log_blocks(log_appender &pending,
 
     aio_task_ptr tsk;
     int64_t local_offset = pending.start_offset() - start_offset();
+    if (_decree_index != nullptr) {
+        decree max_decree = 0;
+        for (const mutation_ptr &mu : pending.mutations()) {
+            max_decree = std::max(max_decree, mu->get_decree());
+        }
+        _decree_index->add_block(local_offset, crc_init, max_decree, local_offset + size);
+    }
     if (callback) {
         tsk = file::write_vector(_handle,
                                  buffer_vector.data(),
@@ -322,9 +355,117 @@ aio_task_ptr log_file::commit_log_blocks(log_appender &pending,
     return tsk;
 }
 
+void log_file::enable_index(decree init_max_decree)
+{
+    dassert(!_is_read, "log file must be of write mode");
+    if (FLAGS_plog_index_interval_kb == 0) {
+        return;
+    }
+
+    zauto_lock lock(_write_lock);
+    _decree_index.reset(
+        new log_file_index(_start_offset, init_max_decree, FLAGS_plog_index_interval_kb * 1024));
+}
+
+void log_file::save_index() const
+{
+    zauto_lock lock(_write_lock);
+    if (_handle) {
+        save_index_no_lock();
+    }
+}
+
+void log_file::save_index_no_lock() const
+{
+    if (_decree_index == nullptr) {
+        return;
+    }
+    error_s es = _decree_index->save(_path);
+    if (!es.is_ok()) {
+        dwarn_f("save the index of log file {} failed: {}", _path, es);
+    }
+}
+
+size_t log_file::seek_to_decree(decree d)
+{
+    dassert(_is_read, "log file must be of read mode");
+    if (FLAGS_plog_index_interval_kb == 0) {
+        reset_stream(0);
+        return 0;
+    }
+
+    if (_decree_index == nullptr) {
+        _decree_index.reset(
+            new log_file_index(_start_offset, 0, FLAGS_plog_index_interval_kb * 1024));
+        error_s es = _decree_index->load(_path, end_offset() - start_offset());
+        if (!es.is_ok()) {
+            ddebug_f("rebuild the index of log file {}: {}", _path, es);
+            error_code err = rebuild_index();
+            if (err != ERR_OK) {
+                dwarn_f("log file {} is partially indexed as it's broken or being written: {}",
+                        _path,
+                        err.to_string());
+            }
+            save_index_no_lock();
+        }
+    }
+
+    const log_file_index::entry *e = _decree_index->seek(d);
+    size_t offset = e == nullptr ? 0 : static_cast<size_t>(e->local_offset);
+    reset_stream(offset);
+    if (e != nullptr) {
+        // continue the crc chain from the previous block
+        _crc32 = e->crc_init;
+    }
+    return offset;
+}
+
+error_code log_file::rebuild_index()
+{
+    decree init_max_decree = 0;
+    for (const auto &kv : _previous_log_max_decrees) {
+        init_max_decree = std::max(init_max_decree, kv.second.max_decree);
+    }
+    _decree_index.reset(new log_file_index(
+        _start_offset, init_max_decree, FLAGS_plog_index_interval_kb * 1024));
+
+    reset_stream(0);
+    int64_t local_offset = 0;
+    error_code err;
+    while (true) {
+        uint32_t crc_init = _crc32;
+        blob bb;
+        err = read_next_log_block(bb);
+        if (err != ERR_OK) {
+            break;
+        }
+
+        binary_reader reader(bb);
+        if (local_offset == 0) {
+            read_file_header(reader);
+        }
+        decree max_decree = 0;
+        while (!reader.is_eof()) {
+            mutation_ptr mu = mutation::read_from(reader, nullptr);
+            max_decree = std::max(max_decree, mu->get_decree());
+        }
+
+        int64_t end_offset = local_offset + sizeof(log_block_header) + bb.length();
+        _decree_index->add_block(local_offset, crc_init, max_decree, end_offset);
+        local_offset = end_offset;
+    }
+    return err == ERR_HANDLE_EOF ? ERR_OK : err;
+}
+
 void log_file::reset_stream(size_t offset /*default = 0*/)
 {
-    if (_stream == nullptr) {
+    if (_use_mmap) {
+        if (_mmap_stream == nullptr) {
+            _mmap_stream.reset(new mmap_streamer(_path, offset));
+        } else {
+            _mmap_stream->reset(offset);
+        }
+    } else if (_stream == nullptr) {
         _stream.reset(new file_streamer(_handle, offset));
     } else {
         _stream->reset(offset);
@@ -27,6 +27,7 @@
 #pragma once
 
 #include "log_block.h"
+#include "log_file_index.h"
 
 #include <dsn/tool-api/zlocks.h>
 
@@ -88,10 +89,14 @@ public:
     // 'path' should be in format of log.{index}.{start_offset}, where:
     //   - index: the index of the log file, start from 1
     //   - start_offset: start offset in the global space
+    // 'use_mmap' reads the file through mmap instead of aio if
+    // [replication] plog_mmap_read_enabled is set, which is preferred for the readers that may
+    // seek, e.g. duplication and learning
     // returns:
     //   - non-null if open succeed
     //   - null if open failed
-    static log_file_ptr open_read(const char *path, /*out*/ error_code &err);
+    static log_file_ptr
+    open_read(const char *path, /*out*/ error_code &err, bool use_mmap = false);
 
     // open the log file for write
     // the file path is '{dir}/log.{index}.{start_offset}'
@@ -100,7 +105,7 @@ public:
     //   - null if open failed
     static log_file_ptr create_write(const char *dir, int index, int64_t start_offset);
 
-    // close the log file
+    // close the log file, the index is saved if enabled
     void close();
 
     // flush the log file
@@ -121,6 +126,12 @@ public:
     //  - other io errors caused by file read operator
     error_code read_next_log_block(/*out*/ ::dsn::blob &bb);
 
+    // reset the stream to the log block from which the mutations with decree >= 'd' can be read,
+    // all the mutations before the block have smaller decrees.
+    // the index is loaded, or rebuilt if it's missing or broken.
+    // returns the local offset of the block, 0 if it should start from the beginning of the file
+    size_t seek_to_decree(decree d);
+
     //
     // write routines
     //
@@ -147,6 +158,13 @@ public:
                                         aio_handler &&callback,
                                         int hash);
 
+    // index the blocks written from now on, see log_file_index.
+    // 'init_max_decree' is the max decree of the mutations in the previous files.
+    // it's a no-op if [replication] plog_index_interval_kb is 0.
+    void enable_index(decree init_max_decree);
+    // save the index of the written blocks, e.g. when the file is rolled
+    void save_index() const;
+
     //
     // others
     //
@@ -188,6 +206,12 @@ private:
     // make private, user should create log_file through open_read() or open_write()
     log_file(const char *path, disk_file *handle, int index, int64_t start_offset, bool is_read);
 
+    error_code read_next(size_t size, /*out*/ blob &result);
+
+    // scan the whole file to rebuild the index
+    error_code rebuild_index();
+    void save_index_no_lock() const;
+
 private:
     friend class mock_log_file;
 
@@ -197,6 +221,9 @@ private:
         _end_offset; // end offset in the global space: end_offset = start_offset + file_size
     class file_streamer;
     std::unique_ptr<file_streamer> _stream;
+    class mmap_streamer;
+    std::unique_ptr<mmap_streamer> _mmap_stream;
+    bool _use_mmap;
     disk_file *_handle;        // file handle
     const bool _is_read;       // if opened for read or write
     std::string _path;         // file path
@@ -206,6 +233,10 @@ private:
 
     mutable zlock _write_lock;
 
+    // for write, the blocks committed so far, protected by _write_lock.
+    // for read, loaded on the first seek_to_decree().
+    std::unique_ptr<log_file_index> _decree_index;
+
     // this data is used for garbage collection, and is part of file header.
     // for read, the value is read from file header.
     // for write, the value is set by write_file_header().
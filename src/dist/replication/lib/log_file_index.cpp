@@ -0,0 +1,164 @@
+// Copyright (c) 2019, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#include "log_file_index.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#include <dsn/utility/crc.h>
+#include <dsn/utility/filesystem.h>
+#include <dsn/utility/process_utils.h>
+#include <fmt/format.h>
+
+namespace dsn {
+namespace replication {
+
+static const uint32_t LOG_INDEX_MAGIC = 0x58444950; // "PIDX"
+static const uint32_t LOG_INDEX_VERSION = 1;
+
+/*static*/ std::string log_file_index::index_path(const std::string &log_path)
+{
+    // keep the index out of the log directory, which is supposed to contain only log files
+    std::string dir = utils::filesystem::path_combine(
+        utils::filesystem::remove_file_name(log_path), "index");
+    return utils::filesystem::path_combine(dir, utils::filesystem::get_file_name(log_path)) +
+           ".idx";
+}
+
+log_file_index::log_file_index(int64_t start_offset,
+                               decree init_max_decree,
+                               uint32_t interval_bytes)
+    : _start_offset(start_offset),
+      _interval_bytes(interval_bytes),
+      _max_decree(init_max_decree),
+      _covered_size(0)
+{
+}
+
+void log_file_index::add_block(int64_t local_offset,
+                               uint32_t crc_init,
+                               decree max_decree,
+                               int64_t end_offset)
+{
+    // the first block holds the file header, which is where a reader starts anyway
+    int64_t last_offset = _entries.empty() ? 0 : _entries.back().local_offset;
+    if (local_offset > 0 && local_offset - last_offset >= _interval_bytes) {
+        entry e;
+        e.local_offset = local_offset;
+        e.prev_max_decree = _max_decree;
+        e.crc_init = crc_init;
+        e.reserved = 0;
+        _entries.push_back(e);
+    }
+    _max_decree = std::max(_max_decree, max_decree);
+    _covered_size = std::max(_covered_size, end_offset);
+}
+
+const log_file_index::entry *log_file_index::seek(decree d) const
+{
+    // prev_max_decree never decreases along the entries
+    auto it = std::partition_point(_entries.begin(), _entries.end(), [d](const entry &e) {
+        return e.prev_max_decree < d;
+    });
+    return it == _entries.begin() ? nullptr : &*(it - 1);
+}
+
+error_s log_file_index::save(const std::string &log_path) const
+{
+    std::string path = index_path(log_path);
+    std::string dir = utils::filesystem::remove_file_name(path);
+    if (!utils::filesystem::create_directory(dir)) {
+        return FMT_ERR(ERR_FILE_OPERATION_FAILED, "create directory {} failed", dir);
+    }
+
+    file_header hdr;
+    hdr.magic = LOG_INDEX_MAGIC;
+    hdr.version = LOG_INDEX_VERSION;
+    hdr.start_offset = _start_offset;
+    hdr.covered_size = _covered_size;
+    hdr.max_decree = _max_decree;
+    hdr.entry_count = static_cast<uint32_t>(_entries.size());
+    hdr.reserved = 0;
+
+    uint32_t crc = utils::crc32_calc(&hdr, sizeof(hdr), 0);
+    if (!_entries.empty()) {
+        crc = utils::crc32_calc(_entries.data(), _entries.size() * sizeof(entry), crc);
+    }
+
+    // the index may be saved by the writer and rebuilt by a reader at the same time
+    std::string tmp_path = fmt::format("{}.{}.tmp", path, utils::get_current_tid());
+    {
+        std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            return FMT_ERR(ERR_FILE_OPERATION_FAILED, "open {} failed", tmp_path);
+        }
+        out.write(reinterpret_cast<const char *>(&hdr), sizeof(hdr));
+        if (!_entries.empty()) {
+            out.write(reinterpret_cast<const char *>(_entries.data()),
+                      _entries.size() * sizeof(entry));
+        }
+        out.write(reinterpret_cast<const char *>(&crc), sizeof(crc));
+        out.close();
+        if (!out.good()) {
+            utils::filesystem::remove_path(tmp_path);
+            return FMT_ERR(ERR_FILE_OPERATION_FAILED, "write {} failed", tmp_path);
+        }
+    }
+
+    if (!utils::filesystem::rename_path(tmp_path, path)) {
+        utils::filesystem::remove_path(tmp_path);
+        return FMT_ERR(ERR_FILE_OPERATION_FAILED, "rename {} to {} failed", tmp_path, path);
+    }
+    return error_s::ok();
+}
+
+error_s log_file_index::load(const std::string &log_path, int64_t file_size)
+{
+    std::string path = index_path(log_path);
+    if (!utils::filesystem::file_exists(path)) {
+        return FMT_ERR(ERR_OBJECT_NOT_FOUND, "index file {} doesn't exist", path);
+    }
+
+    std::string buf;
+    error_code ec = utils::filesystem::read_file(path, buf);
+    if (ec != ERR_OK) {
+        return FMT_ERR(ec, "read index file {} failed", path);
+    }
+    if (buf.size() < sizeof(file_header) + sizeof(uint32_t)) {
+        return FMT_ERR(ERR_INVALID_DATA, "index file {} is too short", path);
+    }
+
+    file_header hdr;
+    memcpy(&hdr, buf.data(), sizeof(hdr));
+    if (hdr.magic != LOG_INDEX_MAGIC || hdr.version != LOG_INDEX_VERSION ||
+        hdr.start_offset != _start_offset) {
+        return FMT_ERR(ERR_INVALID_DATA, "invalid header of index file {}", path);
+    }
+
+    size_t body_size = sizeof(hdr) + hdr.entry_count * sizeof(entry);
+    if (buf.size() != body_size + sizeof(uint32_t)) {
+        return FMT_ERR(ERR_INVALID_DATA, "size mismatch of index file {}", path);
+    }
+    uint32_t crc;
+    memcpy(&crc, buf.data() + body_size, sizeof(crc));
+    if (crc != utils::crc32_calc(buf.data(), body_size, 0)) {
+        return FMT_ERR(ERR_INVALID_DATA, "crc checking of index file {} failed", path);
+    }
+
+    _entries.resize(hdr.entry_count);
+    if (hdr.entry_count > 0) {
+        memcpy(_entries.data(), buf.data() + sizeof(hdr), hdr.entry_count * sizeof(entry));
+    }
+    _max_decree = hdr.max_decree;
+    _covered_size = std::min(hdr.covered_size, file_size);
+    while (!_entries.empty() && _entries.back().local_offset >= file_size) {
+        _entries.pop_back();
+    }
+    return error_s::ok();
+}
+
+} // namespace replication
+} // namespace dsn
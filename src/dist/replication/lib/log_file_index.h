@@ -0,0 +1,86 @@
+// Copyright (c) 2019, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <dsn/dist/replication/replication_other_types.h>
+#include <dsn/utility/errors.h>
+
+namespace dsn {
+namespace replication {
+
+// log_file_index is a sparse index of a private log file, which maps decrees to the offsets of
+// log blocks, so that a reader can start from the block around a given decree instead of the
+// beginning of the file.
+//
+// every entry points to the start of a log block, and records:
+//   - the max decree of all the mutations before the block, including the previous files
+//   - the crc of the previous block, which is the initial value to verify the crc chain from
+//     the block on
+// entries are added at most once every [replication] plog_index_interval_kb bytes.
+//
+// the index is saved to {log_dir}/index/log.{index}.{start_offset}.idx when the log file is
+// rolled or closed. it's only a hint: a missing or broken index is rebuilt by scanning the log
+// file, and an index covering a prefix of the log file is still valid for the prefix.
+class log_file_index
+{
+public:
+    struct entry
+    {
+        int64_t local_offset;
+        decree prev_max_decree;
+        uint32_t crc_init;
+        uint32_t reserved;
+    };
+
+    // the sidecar path of the log file
+    static std::string index_path(const std::string &log_path);
+
+    log_file_index(int64_t start_offset, decree init_max_decree, uint32_t interval_bytes);
+
+    // append a log block which starts at `local_offset` and ends at `end_offset`, `max_decree` is
+    // the max decree of the mutations in it.
+    // blocks must be added in the order of offset.
+    void add_block(int64_t local_offset, uint32_t crc_init, decree max_decree, int64_t end_offset);
+
+    // returns the entry to start reading the mutations with decree >= d, all the mutations before
+    // it are smaller than d.
+    // returns nullptr if it should start from the beginning of the file.
+    const entry *seek(decree d) const;
+
+    // bytes of the log file covered by this index
+    int64_t covered_size() const { return _covered_size; }
+
+    const std::vector<entry> &entries() const { return _entries; }
+
+    error_s save(const std::string &log_path) const;
+
+    // entries beyond `file_size` are dropped, in case the index was saved before the log blocks
+    // are persisted.
+    error_s load(const std::string &log_path, int64_t file_size);
+
+private:
+    struct file_header
+    {
+        uint32_t magic;
+        uint32_t version;
+        int64_t start_offset;
+        int64_t covered_size;
+        decree max_decree;
+        uint32_t entry_count;
+        uint32_t reserved;
+    };
+
+    int64_t _start_offset; // start offset of the log file in the global space
+    uint32_t _interval_bytes;
+    decree _max_decree; // max decree of all the added blocks
+    int64_t _covered_size;
+    std::vector<entry> _entries;
+};
+
+} // namespace replication
+} // namespace dsn
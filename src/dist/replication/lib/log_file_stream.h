@@ -30,6 +30,13 @@
 
 #include "log_file.h"
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <dsn/utility/safe_strerror_posix.h>
+
 namespace dsn {
 namespace replication {
 
@@ -192,5 +199,87 @@ private:
     disk_file *_file_handle;
 };
 
+// log_file::mmap_streamer reads the log file through a read-only mapping of the whole file,
+// so that seeking is free and no data is copied.
+// the returned blobs share the ownership of the mapping, they are still valid after the mapping
+// is replaced or the streamer is destroyed. the mapping is extended on demand if the file grows,
+// e.g. when the log file being written is read for duplication.
+class log_file::mmap_streamer
+{
+public:
+    explicit mmap_streamer(const std::string &path, size_t file_offset)
+        : _fd(::open(path.c_str(), O_RDONLY)), _size(0), _offset(file_offset)
+    {
+        if (_fd < 0) {
+            derror("open log file %s for mmap failed, err = %s",
+                   path.c_str(),
+                   utils::safe_strerror(errno).c_str());
+        }
+    }
+    ~mmap_streamer()
+    {
+        if (_fd >= 0) {
+            ::close(_fd);
+        }
+    }
+
+    void reset(size_t file_offset) { _offset = file_offset; }
+
+    // the same as file_streamer::read_next
+    error_code read_next(size_t size, /*out*/ blob &result)
+    {
+        if (_offset + size > _size) {
+            error_code err = remap();
+            if (err != ERR_OK) {
+                result = blob();
+                return err;
+            }
+        }
+
+        size_t len = _offset >= _size ? 0 : std::min(size, _size - _offset);
+        if (len == 0) {
+            result = blob();
+        } else {
+            result = blob(_mapping, static_cast<int>(_offset), static_cast<unsigned int>(len));
+        }
+        _offset += len;
+        return len == size ? ERR_OK : ERR_HANDLE_EOF;
+    }
+
+private:
+    error_code remap()
+    {
+        if (_fd < 0) {
+            return ERR_FILE_OPERATION_FAILED;
+        }
+        struct stat st;
+        if (::fstat(_fd, &st) != 0) {
+            return ERR_FILE_OPERATION_FAILED;
+        }
+        size_t size = static_cast<size_t>(st.st_size);
+        if (size <= _size) {
+            return ERR_OK;
+        }
+
+        void *addr = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, _fd, 0);
+        if (addr == MAP_FAILED) {
+            derror("mmap log file failed, size = %zu, err = %s",
+                   size,
+                   utils::safe_strerror(errno).c_str());
+            return ERR_FILE_OPERATION_FAILED;
+        }
+        ::madvise(addr, size, MADV_SEQUENTIAL);
+        _mapping = std::shared_ptr<char>(static_cast<char *>(addr),
+                                         [size](char *p) { ::munmap(p, size); });
+        _size = size;
+        return ERR_OK;
+    }
+
+    int _fd;
+    std::shared_ptr<char> _mapping;
+    size_t _size; // mapped bytes
+    size_t _offset;
+};
+
 } // namespace replication
 } // namespace dsn
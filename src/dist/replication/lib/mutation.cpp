@@ -51,6 +51,7 @@ mutation::mutation()
     strcpy(_name, "0.0.0.0");
     _appro_data_bytes = sizeof(mutation_header);
     _create_ts_ns = dsn_now_ns();
+    memset(_milestone_ts_ns, 0, sizeof(_milestone_ts_ns));
     _tid = ++s_tid;
 }
 
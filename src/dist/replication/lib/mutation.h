@@ -50,6 +50,19 @@ namespace replication {
 class mutation;
 typedef dsn::ref_ptr<mutation> mutation_ptr;
 
+// the milestones of a mutation on primary, which are used to break the write latency down
+enum mutation_milestone
+{
+    MM_PREPARE_BEGIN, // dequeued from the mutation_queue
+    MM_PREPARED,      // inserted into the prepare list, the prepares are sent right after
+    MM_LOGGED,        // written into the shared log
+    MM_ACKED,         // the last prepare ack is received
+    MM_COMMIT_BEGIN,
+    MM_APPLIED,
+
+    MM_COUNT
+};
+
 // mutation is the 2pc unit of PacificA, which wraps one or more client requests and add
 // header informations related to PacificA algorithm for them.
 // both header and client request content are put into "data" member.
@@ -88,6 +101,20 @@ public:
         return dsn_now_ms() + gap_ms >= _prepare_ts_ms + timeout_ms;
     }
     uint64_t create_ts_ns() const { return _create_ts_ns; }
+    // 0 if the milestone is not reached
+    uint64_t milestone_ts_ns(mutation_milestone m) const { return _milestone_ts_ns[m]; }
+    void set_milestone(mutation_milestone m, uint64_t ts_ns) { _milestone_ts_ns[m] = ts_ns; }
+    void set_milestone(mutation_milestone m) { set_milestone(m, dsn_now_ns()); }
+    // the nodes and the time they acked the prepare
+    const std::vector<std::pair<rpc_address, uint64_t>> &prepare_acks() const
+    {
+        return _prepare_acks;
+    }
+    void add_prepare_ack(rpc_address node, uint64_t ts_ns)
+    {
+        _prepare_acks.emplace_back(node, ts_ns);
+        set_milestone(MM_ACKED, ts_ns);
+    }
     ballot get_ballot() const { return data.header.ballot; }
     decree get_decree() const { return data.header.decree; }
 
@@ -167,6 +194,10 @@ private:
     uint64_t _tid;          // trace id, unique in process
     static std::atomic<uint64_t> s_tid;
     bool _is_sync_to_child; // for partition split
+
+    // for the write latency breakdown on primary
+    uint64_t _milestone_ts_ns[MM_COUNT];
+    std::vector<std::pair<rpc_address, uint64_t>> _prepare_acks;
 };
 
 class replica;
@@ -37,6 +37,41 @@
 namespace dsn {
 namespace replication {
 
+mutation_log_shared::mutation_log_shared(const std::string &dir,
+                                         int32_t max_log_file_mb,
+                                         bool force_flush,
+                                         perf_counter_wrapper *write_size_counter,
+                                         uint32_t batch_buffer_bytes,
+                                         uint32_t batch_buffer_max_count,
+                                         uint64_t batch_buffer_flush_interval_ms)
+    : mutation_log(dir, max_log_file_mb, dsn::gpid(), nullptr),
+      _is_writing(false),
+      _pending_write_start_time_ms(0),
+      _linger_timer_scheduled(false),
+      _force_flush(force_flush),
+      _write_size_counter(write_size_counter),
+      _batch_buffer_bytes(batch_buffer_bytes),
+      _batch_buffer_max_count(batch_buffer_max_count),
+      _batch_buffer_flush_interval_ms(batch_buffer_flush_interval_ms),
+      _is_syncing(false)
+{
+    // app counters can only be created within a service app, e.g. not in the log tools
+    if (task::get_current_node2() != nullptr) {
+        _counter_batch_mutations.init_app_counter("eon.replica_stub",
+                                                  "shared.log.batch.mutations",
+                                                  COUNTER_TYPE_NUMBER_PERCENTILES,
+                                                  "mutation count of each shared log write");
+        _counter_fsync_latency_us.init_app_counter("eon.replica_stub",
+                                                   "shared.log.fsync.latency(us)",
+                                                   COUNTER_TYPE_NUMBER_PERCENTILES,
+                                                   "latency of each shared log fsync");
+        _counter_mutations_per_fsync.init_app_counter("eon.replica_stub",
+                                                      "shared.log.mutations.per.fsync",
+                                                      COUNTER_TYPE_NUMBER_PERCENTILES,
+                                                      "mutation count made durable by each fsync");
+    }
+}
+
 ::dsn::task_ptr mutation_log_shared::append(mutation_ptr &mu,
                                             dsn::task_code callback_code,
                                             dsn::task_tracker *tracker,
@@ -55,6 +90,7 @@ namespace replication {
     // init pending buffer
     if (nullptr == _pending_write) {
         _pending_write = std::make_shared<log_appender>(mark_new_offset(0, true).second);
+        _pending_write_start_time_ms = dsn_now_ms();
     }
     _pending_write->append_mutation(mu, cb);
 
@@ -63,9 +99,10 @@ namespace replication {
 
     // start to write if possible
     if (!_is_writing.load(std::memory_order_acquire)) {
-        write_pending_mutations(true);
+        int64_t lingering_size = _pending_write->size();
+        bool started = try_write_pending_mutations();
         if (pending_size) {
-            *pending_size = 0;
+            *pending_size = started ? 0 : lingering_size;
         }
     } else {
         if (pending_size) {
@@ -76,6 +113,51 @@ namespace replication {
     return cb;
 }
 
+bool mutation_log_shared::pending_batch_ready() const
+{
+    if (_batch_buffer_flush_interval_ms == 0) {
+        return true;
+    }
+    return (_batch_buffer_bytes > 0 &&
+            static_cast<uint32_t>(_pending_write->size()) >= _batch_buffer_bytes) ||
+           (_batch_buffer_max_count > 0 &&
+            static_cast<uint32_t>(_pending_write->mutation_count()) >= _batch_buffer_max_count) ||
+           _pending_write_start_time_ms + _batch_buffer_flush_interval_ms <= dsn_now_ms();
+}
+
+bool mutation_log_shared::try_write_pending_mutations()
+{
+    if (pending_batch_ready()) {
+        write_pending_mutations(true);
+        return true;
+    }
+
+    if (!_linger_timer_scheduled) {
+        _linger_timer_scheduled = true;
+        uint64_t deadline_ms = _pending_write_start_time_ms + _batch_buffer_flush_interval_ms;
+        uint64_t now_ms = dsn_now_ms();
+        uint64_t delay_ms = deadline_ms > now_ms ? deadline_ms - now_ms : 0;
+        tasking::enqueue(LPC_MUTATION_LOG_PENDING_TIMER,
+                         &_tracker,
+                         [this]() { on_linger_timeout(); },
+                         0,
+                         std::chrono::milliseconds(delay_ms));
+    }
+    _slock.unlock();
+    return false;
+}
+
+void mutation_log_shared::on_linger_timeout()
+{
+    _slock.lock();
+    _linger_timer_scheduled = false;
+    if (!_is_writing.load(std::memory_order_acquire) && _pending_write) {
+        try_write_pending_mutations();
+    } else {
+        _slock.unlock();
+    }
+}
+
 void mutation_log_shared::flush() { flush_internal(-1); }
 
 void mutation_log_shared::flush_once() { flush_internal(1); }
@@ -84,7 +166,15 @@ void mutation_log_shared::flush_internal(int max_count)
 {
     int count = 0;
     while (max_count <= 0 || count < max_count) {
-        if (_is_writing.load(std::memory_order_acquire)) {
+        // _is_writing must be read before _is_syncing, as a written batch is queued for fsync
+        // before _is_writing is cleared
+        bool is_writing = _is_writing.load(std::memory_order_acquire);
+        bool is_syncing = false;
+        {
+            zauto_lock l(_sync_lock);
+            is_syncing = _is_syncing;
+        }
+        if (is_writing || is_syncing) {
             _tracker.wait_outstanding_tasks();
         } else {
             _slock.lock();
@@ -97,7 +187,7 @@ void mutation_log_shared::flush_internal(int max_count)
                 _slock.unlock();
                 break;
             }
-            // !_is_writing && _pending_write, start next write
+            // !_is_writing && _pending_write, start next write without lingering
             write_pending_mutations(true);
             count++;
         }
@@ -141,45 +231,108 @@ void mutation_log_shared::commit_pending_mutations(log_file_ptr &lf,
             if (err == ERR_OK) {
                 dcheck_eq(sz, pending->size());
 
-                if (_force_flush) {
-                    // flush to ensure that shared log data synced to disk
-                    //
-                    // FIXME : the file could have been closed
-                    lf->flush();
-                }
-
                 if (_write_size_counter) {
                     (*_write_size_counter)->add(sz);
                 }
+                if (_counter_batch_mutations.get() != nullptr) {
+                    _counter_batch_mutations->set(pending->mutation_count());
+                }
             } else {
                 derror("write shared log failed, err = %s", err.to_string());
             }
 
+            // queue the batch for fsync before the writing is done, so that flush() always sees
+            // the batch either writing or syncing
+            bool run_syncer = _force_flush && queue_written_batch(lf, pending, err, sz);
+
             // here we use _is_writing instead of _issued_write.expired() to check writing done,
             // because the following callbacks may run before "block" released, which may cause
             // the next init_prepare() not starting the write.
-            _is_writing.store(false, std::memory_order_relaxed);
+            _is_writing.store(false, std::memory_order_release);
 
-            // notify the callbacks
-            // ATTENTION: callback may be called before this code block executed done.
-            for (auto &c : pending->callbacks()) {
-                c->enqueue(err, sz);
+            if (!_force_flush) {
+                // notify the callbacks
+                // ATTENTION: callback may be called before this code block executed done.
+                for (auto &c : pending->callbacks()) {
+                    c->enqueue(err, sz);
+                }
             }
 
-            // start to write next if possible
+            // start to write next if possible, which overlaps with the fsync of this batch
             if (err == ERR_OK) {
                 _slock.lock();
 
                 if (!_is_writing.load(std::memory_order_acquire) && _pending_write) {
-                    write_pending_mutations(true);
+                    try_write_pending_mutations();
                 } else {
                     _slock.unlock();
                 }
             }
+
+            if (run_syncer) {
+                // flush to ensure that shared log data synced to disk before notifying
+                sync_written_batches();
+            }
         },
         0);
 }
 
+bool mutation_log_shared::queue_written_batch(log_file_ptr lf,
+                                              std::shared_ptr<log_appender> pending,
+                                              error_code err,
+                                              size_t sz)
+{
+    zauto_lock l(_sync_lock);
+    _sync_queue.push_back(written_batch{std::move(lf), std::move(pending), err, sz});
+    if (_is_syncing) {
+        // the current syncer will take this batch in its next round
+        return false;
+    }
+    _is_syncing = true;
+    return true;
+}
+
+void mutation_log_shared::sync_written_batches()
+{
+    while (true) {
+        std::vector<written_batch> batches;
+        {
+            zauto_lock l(_sync_lock);
+            if (_sync_queue.empty()) {
+                _is_syncing = false;
+                return;
+            }
+            batches.swap(_sync_queue);
+        }
+
+        // one fsync for all the batches written to the same file
+        uint64_t start_ns = dsn_now_ns();
+        size_t mutation_count = 0;
+        log_file *synced_file = nullptr;
+        for (auto &b : batches) {
+            if (b.err != ERR_OK) {
+                continue;
+            }
+            mutation_count += b.pending->mutation_count();
+            if (b.lf.get() != synced_file) {
+                // FIXME : the file could have been closed
+                b.lf->flush();
+                synced_file = b.lf.get();
+            }
+        }
+        if (mutation_count > 0 && _counter_fsync_latency_us.get() != nullptr) {
+            _counter_fsync_latency_us->set((dsn_now_ns() - start_ns) / 1000);
+            _counter_mutations_per_fsync->set(mutation_count);
+        }
+
+        for (auto &b : batches) {
+            for (auto &c : b.pending->callbacks()) {
+                c->enqueue(b.err, b.size);
+            }
+        }
+    }
+}
+
 ////////////////////////////////////////////////////
 
 mutation_log_private::mutation_log_private(const std::string &dir,
@@ -444,6 +597,7 @@ mutation_log::mutation_log(const std::string &dir, int32_t max_log_file_mb, gpid
     _min_log_file_size_in_bytes = _max_log_file_size_in_bytes / 10;
     _owner_replica = r;
     _private_gpid = gpid;
+    _replay_parallelism = 0;
 
     if (r) {
         dassert(_private_gpid == r->get_gpid(),
@@ -631,26 +785,31 @@ error_code mutation_log::open(replay_callback read_callback,
     // replay with the found files
     std::map<int, log_file_ptr> replay_logs(replay_begin, replay_end);
     int64_t end_offset = 0;
-    err = replay(
-        replay_logs,
-        [this, read_callback](int log_length, mutation_ptr &mu) {
-            bool ret = true;
-
-            if (read_callback) {
-                ret = read_callback(log_length,
-                                    mu); // actually replica::replay_mutation(mu, true|false);
-            }
+    // the max decrees are updated concurrently only for different gpids, which are registered
+    // in _shared_log_info_map before
+    replay_callback callback = [this, read_callback](int log_length, mutation_ptr &mu) {
+        bool ret = true;
+
+        if (read_callback) {
+            ret = read_callback(log_length,
+                                mu); // actually replica::replay_mutation(mu, true|false);
+        }
 
-            if (ret) {
-                this->update_max_decree_no_lock(mu->data.header.pid, mu->data.header.decree);
-                if (this->_is_private) {
-                    this->update_max_commit_on_disk_no_lock(mu->data.header.last_committed_decree);
-                }
+        if (ret) {
+            this->update_max_decree_no_lock(mu->data.header.pid, mu->data.header.decree);
+            if (this->_is_private) {
+                this->update_max_commit_on_disk_no_lock(mu->data.header.last_committed_decree);
             }
+        }
 
-            return ret;
-        },
-        end_offset);
+        return ret;
+    };
+    if (_replay_parallelism > 1) {
+        dassert(!_is_private, "private log should be replayed sequentially");
+        err = replay_parallel(replay_logs, callback, _replay_parallelism, end_offset);
+    } else {
+        err = replay(replay_logs, callback, end_offset);
+    }
 
     if (ERR_OK == err) {
         _global_start_offset =
@@ -720,6 +879,9 @@ error_code mutation_log::create_new_log_file()
     ddebug("create new log file %s succeed, time_used = %" PRIu64 " ns",
            logf->path().c_str(),
            dsn_now_ns() - start);
+    if (_is_private) {
+        logf->enable_index(_private_log_info.max_decree);
+    }
 
     // update states
     _last_file_index++;
@@ -730,6 +892,9 @@ error_code mutation_log::create_new_log_file()
 
     // switch the current log file
     // the old log file may be hold by _log_files or aio_task
+    if (_current_log_file != nullptr) {
+        _current_log_file->save_index();
+    }
     _current_log_file = logf;
 
     // create new pending buffer because we need write file header
@@ -1309,6 +1474,9 @@ int mutation_log::garbage_collection(gpid gpid,
             break;
         }
 
+        // the index is only a hint, no matter if it fails
+        dsn::utils::filesystem::remove_path(log_file_index::index_path(fpath));
+
         // delete succeed
         ddebug_f("gc_private @ {}: log file {} is removed", _private_gpid, fpath);
         deleted++;
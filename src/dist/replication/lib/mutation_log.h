@@ -116,6 +116,11 @@ public:
     // thread safe
     void close();
 
+    // replay the log with `parallelism` tasks on open(), see replay_parallel().
+    // 0 or 1 means replaying in the calling thread.
+    // should only be set for the shared log before open().
+    void set_replay_parallelism(int parallelism) { _replay_parallelism = parallelism; }
+
     //
     // replay
     //
@@ -312,6 +317,17 @@ private:
                              replay_callback callback,
                              /*out*/ int64_t &end_offset);
 
+    // the same as replay(log_files, ...) except that it works as a pipeline:
+    //   - the calling thread reads the log blocks and checks the crc, a window of blocks ahead
+    //   - `parallelism` tasks decode the blocks of the window
+    //   - `parallelism` tasks apply the decoded mutations, each of which owns a disjoint set of
+    //     gpids, so that the mutations of a gpid are still applied in the order of the log
+    // so `callback` must be safe to be called concurrently for different gpids.
+    static error_code replay_parallel(std::map<int, log_file_ptr> &log_files,
+                                      replay_callback callback,
+                                      int parallelism,
+                                      /*out*/ int64_t &end_offset);
+
     // update max decree without lock
     void update_max_decree_no_lock(gpid gpid, decree d);
 
@@ -339,6 +355,7 @@ protected:
     int64_t _max_log_file_size_in_bytes;
     int64_t _min_log_file_size_in_bytes;
     bool _force_flush;
+    int _replay_parallelism;
 
     dsn::task_tracker _tracker;
 
@@ -382,16 +399,19 @@ typedef dsn::ref_ptr<mutation_log> mutation_log_ptr;
 class mutation_log_shared : public mutation_log
 {
 public:
+    // Parameters:
+    //  - batch_buffer_bytes, batch_buffer_max_count, batch_buffer_flush_interval_ms
+    //    Group commit: when batch_buffer_flush_interval_ms > 0, the pending mutations linger
+    //    for at most that long until they reach batch_buffer_bytes or batch_buffer_max_count
+    //    (0 means no limit), and are written as one batch. 0 means writing as soon as the
+    //    previous write is done.
     mutation_log_shared(const std::string &dir,
                         int32_t max_log_file_mb,
                         bool force_flush,
-                        perf_counter_wrapper *write_size_counter = nullptr)
-        : mutation_log(dir, max_log_file_mb, dsn::gpid(), nullptr),
-          _is_writing(false),
-          _force_flush(force_flush),
-          _write_size_counter(write_size_counter)
-    {
-    }
+                        perf_counter_wrapper *write_size_counter = nullptr,
+                        uint32_t batch_buffer_bytes = 0,
+                        uint32_t batch_buffer_max_count = 0,
+                        uint64_t batch_buffer_flush_interval_ms = 0);
 
     virtual ~mutation_log_shared() override
     {
@@ -420,6 +440,25 @@ private:
 
     void commit_pending_mutations(log_file_ptr &lf, std::shared_ptr<log_appender> &pending);
 
+    // whether the pending batch is large or old enough to be written, must hold _slock
+    bool pending_batch_ready() const;
+
+    // start the next write if the pending batch is ready, otherwise wait for the linger timer.
+    // must hold _slock, which is released in this function.
+    // returns true if the write is started
+    bool try_write_pending_mutations();
+
+    void on_linger_timeout();
+
+    // queue the written batch for fsync, returns true if the caller has to run the syncer,
+    // or false if the running syncer will take it
+    bool queue_written_batch(log_file_ptr lf,
+                             std::shared_ptr<log_appender> pending,
+                             error_code err,
+                             size_t sz);
+    // fsync the queued batches in group, and notify their callbacks after fsync
+    void sync_written_batches();
+
     // flush at most count times
     // if count <= 0, means flush until all data is on disk
     void flush_internal(int max_count);
@@ -429,9 +468,32 @@ private:
     mutable zlock _slock;
     std::atomic_bool _is_writing;
     std::shared_ptr<log_appender> _pending_write;
+    uint64_t _pending_write_start_time_ms;
+    bool _linger_timer_scheduled;
 
     bool _force_flush;
     perf_counter_wrapper *_write_size_counter;
+
+    uint32_t _batch_buffer_bytes;
+    uint32_t _batch_buffer_max_count;
+    uint64_t _batch_buffer_flush_interval_ms;
+
+    // group fsync - batches written but not synced yet, the write of the next batch can be
+    // issued while the previous ones are being synced
+    struct written_batch
+    {
+        log_file_ptr lf;
+        std::shared_ptr<log_appender> pending;
+        error_code err;
+        size_t size;
+    };
+    zlock _sync_lock;
+    std::vector<written_batch> _sync_queue;
+    bool _is_syncing;
+
+    perf_counter_wrapper _counter_batch_mutations;
+    perf_counter_wrapper _counter_fsync_latency_us;
+    perf_counter_wrapper _counter_mutations_per_fsync;
 };
 
 class mutation_log_private : public mutation_log, private replica_base
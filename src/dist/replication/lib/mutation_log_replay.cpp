@@ -4,6 +4,7 @@
 
 #include "dist/replication/lib/mutation_log.h"
 #include "dist/replication/lib/mutation_log_utils.h"
+#include <dsn/tool-api/async_calls.h>
 #include <dsn/utility/fail_point.h>
 #include <dsn/utility/errors.h>
 #include <dsn/dist/fmt_logging.h>
@@ -106,7 +107,8 @@ namespace replication {
     std::map<int, log_file_ptr> logs;
     for (auto &fpath : log_files) {
         error_code err;
-        log_file_ptr log = log_file::open_read(fpath.c_str(), err);
+        // the learned files are read through mmap
+        log_file_ptr log = log_file::open_read(fpath.c_str(), err, true);
         if (log == nullptr) {
             if (err == ERR_HANDLE_EOF || err == ERR_INCOMPLETE_DATA ||
                 err == ERR_INVALID_PARAMETERS) {
@@ -192,5 +194,282 @@ namespace replication {
     return err;
 }
 
+namespace {
+
+// a log block which is read and crc-checked, waiting to be decoded and applied
+struct replay_block_item
+{
+    blob body;           // excluding the log_block_header
+    int64_t body_offset; // global offset of the body
+    int header_size;     // size of the log_file_header ahead of the mutations
+
+    // filled by decoding, <log_length, mutation>
+    std::vector<std::pair<int, mutation_ptr>> mutations;
+    // the mutations after the error are dropped
+    error_s err;
+    int64_t err_offset;
+};
+
+typedef std::vector<replay_block_item> replay_window;
+
+// the bytes of blocks read ahead for decoding and applying
+static const size_t REPLAY_WINDOW_BYTES = 16 * 1024 * 1024;
+
+// reads the blocks of the log files in order, and handles the errors of reading in the same way
+// as mutation_log::replay(log_files, ...)
+class replay_block_reader
+{
+public:
+    replay_block_reader(std::map<int, log_file_ptr> &logs, int64_t start_offset)
+        : _logs(logs),
+          _current(logs.begin()),
+          _file_started(false),
+          _local_offset(0),
+          _end_offset(start_offset),
+          _err(ERR_OK),
+          _done(false)
+    {
+    }
+
+    // read the blocks into `window` until it's large enough or there are no more blocks
+    void read_window(/*out*/ replay_window &window)
+    {
+        size_t bytes = 0;
+        while (!_done && bytes < REPLAY_WINDOW_BYTES) {
+            if (!_file_started && !start_next_file()) {
+                break;
+            }
+
+            log_file_ptr &log = _current->second;
+            blob bb;
+            error_code err = log->read_next_log_block(bb);
+            if (err != ERR_OK) {
+                finish_current_file(err);
+                continue;
+            }
+
+            // the blob from aio streamer refers to the reused buffer
+            if (bb.buffer() == nullptr) {
+                bb = blob::create_from_bytes(bb.data(), bb.length());
+            }
+
+            replay_block_item item;
+            item.body_offset = log->start_offset() + _local_offset + sizeof(log_block_header);
+            item.header_size = _local_offset == 0 ? log->get_file_header_size() : 0;
+            item.body = std::move(bb);
+            item.err_offset = 0;
+            _local_offset += sizeof(log_block_header) + item.body.length();
+            _end_offset = log->start_offset() + _local_offset;
+            bytes += item.body.length();
+            window.emplace_back(std::move(item));
+        }
+    }
+
+    // the error of the last file, see mutation_log::replay(log_files, ...)
+    error_code error() const { return _err; }
+
+    // end of the last complete block
+    int64_t end_offset() const { return _end_offset; }
+
+private:
+    bool start_next_file()
+    {
+        if (_current == _logs.end()) {
+            _done = true;
+            return false;
+        }
+
+        log_file_ptr &log = _current->second;
+        if (log->start_offset() != _end_offset) {
+            derror("offset mismatch in log file offset and global offset %" PRId64 " vs %" PRId64,
+                   log->start_offset(),
+                   _end_offset);
+            _err = ERR_INVALID_DATA;
+            _done = true;
+            return false;
+        }
+
+        ddebug("start to replay mutation log %s, offset = [%" PRId64 ", %" PRId64
+               "), size = %" PRId64,
+               log->path().c_str(),
+               log->start_offset(),
+               log->end_offset(),
+               log->end_offset() - log->start_offset());
+        log->reset_stream();
+        _local_offset = 0;
+        _file_started = true;
+        return true;
+    }
+
+    void finish_current_file(error_code err)
+    {
+        _current->second->close();
+        _current++;
+        _file_started = false;
+        _err = err;
+
+        if (err == ERR_HANDLE_EOF) {
+            // do nothing
+        } else if (err == ERR_INCOMPLETE_DATA) {
+            // the correctness is relying on the check of start_offset of the next file
+            dwarn("delay handling error: %s", err.to_string());
+        } else {
+            _done = true;
+        }
+    }
+
+    std::map<int, log_file_ptr> &_logs;
+    std::map<int, log_file_ptr>::iterator _current;
+    bool _file_started;
+    int64_t _local_offset; // of the current file
+    int64_t _end_offset;
+    error_code _err;
+    bool _done;
+};
+
+void decode_block(replay_block_item &item)
+{
+    binary_reader reader(item.body.range(item.header_size));
+    int64_t offset = item.body_offset + item.header_size;
+    while (!reader.is_eof()) {
+        auto old_size = reader.get_remaining_size();
+        mutation_ptr mu = mutation::read_from(reader, nullptr);
+        dassert(nullptr != mu, "");
+        mu->set_logged();
+
+        if (mu->data.header.log_offset != offset) {
+            item.err = FMT_ERR(ERR_INVALID_DATA,
+                               "offset mismatch in log entry and mutation {} vs {}",
+                               offset,
+                               mu->data.header.log_offset);
+            item.err_offset = offset;
+            return;
+        }
+
+        int log_length = old_size - reader.get_remaining_size();
+        item.mutations.emplace_back(log_length, std::move(mu));
+        offset += log_length;
+    }
+}
+
+// apply the mutations of the gpids which belong to `shard`, in the order of the log
+void apply_window(replay_window &window,
+                  int shard,
+                  int shard_count,
+                  mutation_log::replay_callback &callback)
+{
+    std::hash<gpid> hasher;
+    for (replay_block_item &item : window) {
+        for (auto &pr : item.mutations) {
+            if (hasher(pr.second->data.header.pid) % shard_count == shard) {
+                callback(pr.first, pr.second);
+            }
+        }
+        if (!item.err.is_ok()) {
+            break;
+        }
+    }
+}
+
+} // anonymous namespace
+
+/*static*/ error_code mutation_log::replay_parallel(std::map<int, log_file_ptr> &logs,
+                                                    replay_callback callback,
+                                                    int parallelism,
+                                                    /*out*/ int64_t &end_offset)
+{
+    int64_t g_start_offset = 0;
+    int64_t g_end_offset = 0;
+    if (logs.size() > 0) {
+        g_start_offset = logs.begin()->second->start_offset();
+        g_end_offset = logs.rbegin()->second->end_offset();
+    }
+
+    error_s error = log_utils::check_log_files_continuity(logs);
+    if (!error.is_ok()) {
+        derror_f("check_log_files_continuity failed: {}", error);
+        return error.code();
+    }
+
+    replay_block_reader reader(logs, g_start_offset);
+    std::unique_ptr<replay_window> to_read(new replay_window());
+    std::unique_ptr<replay_window> to_decode;
+    std::unique_ptr<replay_window> to_apply;
+    const replay_block_item *failed_block = nullptr;
+
+    reader.read_window(*to_read);
+    while (!to_read->empty() || to_decode != nullptr) {
+        // step the pipeline: reading -> decoding -> applying
+        to_apply = std::move(to_decode);
+        to_decode = to_read->empty() ? nullptr : std::move(to_read);
+        to_read.reset(new replay_window());
+
+        // apply the decoded window, and decode the next window in the meantime
+        std::vector<task_ptr> tasks;
+        for (int index = 0; index < parallelism; index++) {
+            tasks.push_back(tasking::create_task(
+                LPC_REPLICATION_INIT_LOAD,
+                nullptr,
+                [&, index]() {
+                    if (to_decode != nullptr) {
+                        for (size_t i = index; i < to_decode->size(); i += parallelism) {
+                            decode_block((*to_decode)[i]);
+                        }
+                    }
+                    if (to_apply != nullptr) {
+                        apply_window(*to_apply, index, parallelism, callback);
+                    }
+                },
+                index));
+            tasks.back()->enqueue();
+        }
+
+        // read ahead the window after the next
+        reader.read_window(*to_read);
+        for (auto &t : tasks) {
+            t->wait();
+        }
+
+        if (to_apply != nullptr) {
+            for (const replay_block_item &item : *to_apply) {
+                if (!item.err.is_ok()) {
+                    failed_block = &item;
+                    break;
+                }
+            }
+            if (failed_block != nullptr) {
+                break;
+            }
+        }
+    }
+
+    error_code err;
+    if (failed_block != nullptr) {
+        derror_f("replay mutation log failed: {}", failed_block->err);
+        err = failed_block->err.code();
+        end_offset = failed_block->err_offset;
+    } else {
+        err = reader.error();
+        end_offset = reader.end_offset();
+    }
+
+    if (err == ERR_OK || err == ERR_HANDLE_EOF) {
+        // the log may still be written when used for learning
+        dassert(g_end_offset <= end_offset,
+                "make sure the global end offset is correct: %" PRId64 " vs %" PRId64,
+                g_end_offset,
+                end_offset);
+        err = ERR_OK;
+    } else if (err == ERR_INCOMPLETE_DATA) {
+        // ignore the last incomplate block
+        err = ERR_OK;
+    } else {
+        // bad error
+        derror("replay mutation log failed: %s", err.to_string());
+    }
+
+    return err;
+}
+
 } // namespace replication
 } // namespace dsn
@@ -40,7 +40,7 @@ namespace log_utils {
     });
 
     error_code ec;
-    file = log_file::open_read(path.data(), ec);
+    file = log_file::open_read(path.data(), ec, true);
     if (ec != ERR_OK) {
         return FMT_ERR(ec, "failed to open the log file ({})", path);
     }
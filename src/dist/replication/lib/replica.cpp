@@ -90,6 +90,7 @@ replica::replica(
 
     // init table level latency perf counters
     init_table_level_latency_counters();
+    _write_latency_tracker = make_unique<write_latency_tracker>(_app_info.app_name);
 
     counter_str = fmt::format("backup_request_qps@{}", _app_info.app_name);
     _counter_backup_request_qps.init_app_counter(
@@ -226,6 +227,9 @@ void replica::execute_mutation(mutation_ptr &mu)
 
     error_code err = ERR_OK;
     decree d = mu->data.header.decree;
+    if (status() == partition_status::PS_PRIMARY) {
+        mu->set_milestone(MM_COMMIT_BEGIN);
+    }
 
     switch (status()) {
     case partition_status::PS_INACTIVE:
@@ -246,6 +250,7 @@ void replica::execute_mutation(mutation_ptr &mu)
                 _app->last_committed_decree(),
                 d);
         err = _app->apply_mutation(mu);
+        mu->set_milestone(MM_APPLIED);
     } break;
 
     case partition_status::PS_SECONDARY:
@@ -314,6 +319,9 @@ void replica::execute_mutation(mutation_ptr &mu)
 
     // update table level latency perf-counters for primary partition
     if (partition_status::PS_PRIMARY == status()) {
+        if (err == ERR_OK) {
+            _write_latency_tracker->on_mutation_applied(mu, name());
+        }
         uint64_t now_ns = dsn_now_ns();
         for (auto update : mu->data.updates) {
             // If the corresponding perf counter exist, count the duration of this operation.
@@ -55,6 +55,7 @@
 #include "prepare_list.h"
 #include "replica_context.h"
 #include "throttling_controller.h"
+#include "write_latency_tracker.h"
 
 namespace dsn {
 namespace replication {
@@ -551,6 +552,7 @@ private:
     perf_counter_wrapper _counter_recent_write_throttling_delay_count;
     perf_counter_wrapper _counter_recent_write_throttling_reject_count;
     std::vector<perf_counter *> _counters_table_level_latency;
+    std::unique_ptr<write_latency_tracker> _write_latency_tracker;
     perf_counter_wrapper _counter_dup_disabled_non_idempotent_write_count;
     perf_counter_wrapper _counter_backup_request_qps;
 
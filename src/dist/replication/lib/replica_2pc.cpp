@@ -30,6 +30,7 @@
 #include "replica_stub.h"
 #include <dsn/dist/replication/replication_app_base.h>
 #include <dsn/dist/fmt_logging.h>
+#include <dsn/utility/fail_point.h>
 
 namespace dsn {
 namespace replication {
@@ -126,6 +127,9 @@ void replica::init_prepare(mutation_ptr &mu, bool reconciliation, bool pop_all_c
     uint8_t count = 0;
     const auto request_count = mu->client_requests.size();
     mu->data.header.last_committed_decree = last_committed_decree();
+    if (!reconciliation) {
+        mu->set_milestone(MM_PREPARE_BEGIN);
+    }
 
     dsn_log_level_t level = LOG_LEVEL_INFORMATION;
     if (mu->data.header.decree == invalid_decree) {
@@ -190,6 +194,7 @@ void replica::init_prepare(mutation_ptr &mu, bool reconciliation, bool pop_all_c
     }
 
     // remote prepare
+    mu->set_milestone(MM_PREPARED);
     mu->set_prepare_ts();
     mu->set_left_secondary_ack_count((unsigned int)_primary_states.membership.secondaries.size());
     for (auto it = _primary_states.membership.secondaries.begin();
@@ -269,6 +274,8 @@ void replica::send_prepare_message(::dsn::rpc_address addr,
                                    bool pop_all_committed_mutations,
                                    int64_t learn_signature)
 {
+    FAIL_POINT_INJECT_F("replica_send_prepare_message", [](dsn::string_view) {});
+
     dsn::message_ex *msg = dsn::message_ex::create_request(
         RPC_PREPARE, timeout_milliseconds, get_gpid().thread_hash());
     replica_configuration rconfig;
@@ -492,6 +499,7 @@ void replica::on_append_log_completed(mutation_ptr &mu, error_code err, size_t s
         switch (status()) {
         case partition_status::PS_PRIMARY:
             if (err == ERR_OK) {
+                mu->set_milestone(MM_LOGGED);
                 do_possible_commit_on_primary(mu);
             } else {
                 handle_local_failure(err);
@@ -588,6 +596,7 @@ void replica::on_prepare_reply(std::pair<mutation_ptr, partition_status::type> p
                 resp.decree,
                 mu->data.header.decree);
 
+        _write_latency_tracker->on_prepare_ack(mu, node);
         switch (target_status) {
         case partition_status::PS_SECONDARY:
             dassert(_primary_states.check_exist(node, partition_status::PS_SECONDARY),
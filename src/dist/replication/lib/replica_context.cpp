@@ -34,6 +34,7 @@
  */
 
 #include <dsn/utility/filesystem.h>
+#include <dsn/utility/flags.h>
 #include <dsn/utility/utils.h>
 
 #include "replica_context.h"
@@ -46,6 +47,9 @@
 namespace dsn {
 namespace replication {
 
+DSN_DECLARE_uint32(block_service_part_size_kb);
+DSN_DECLARE_int32(block_service_max_concurrent_parts);
+
 void primary_context::cleanup(bool clean_pending_mutations)
 {
     do_cleanup_pending_mutations(clean_pending_mutations);
@@ -934,6 +938,8 @@ void cold_backup_context::on_upload(const dist::block_service::block_file_ptr &f
 {
     dist::block_service::upload_request req;
     req.input_local_name = full_path_local_file;
+    req.part_size = static_cast<uint64_t>(FLAGS_block_service_part_size_kb) << 10;
+    req.max_concurrent_parts = FLAGS_block_service_max_concurrent_parts;
 
     add_ref();
 
@@ -948,6 +954,23 @@ void cold_backup_context::on_upload(const dist::block_service::block_file_ptr &f
                 dassert(_file_infos.at(local_filename).first ==
                             static_cast<int64_t>(resp.uploaded_size),
                         "");
+                // the md5 calculated while uploading comes from the data actually sent
+                const std::string &expected_md5 = _file_infos.at(local_filename).second;
+                if (!resp.md5.empty() && resp.md5 != expected_md5) {
+                    derror("%s: checkpoint file changed while uploading, file = %s, "
+                           "md5 = %s vs %s",
+                           name,
+                           full_path_local_file.c_str(),
+                           resp.md5.c_str(),
+                           expected_md5.c_str());
+                    fail_upload("checkpoint file changed while uploading");
+                    if (_owner_replica != nullptr) {
+                        _owner_replica->get_replica_stub()
+                            ->_counter_cold_backup_recent_upload_file_fail_count->increment();
+                    }
+                    release_ref();
+                    return;
+                }
                 ddebug("%s: upload checkpoint file complete, file = %s",
                        name,
                        full_path_local_file.c_str());
@@ -4,6 +4,7 @@
 
 #include <nlohmann/json.hpp>
 #include <fmt/format.h>
+#include <dsn/perf_counter/perf_counters.h>
 #include "replica_http_service.h"
 #include "duplication/duplication_sync_timer.h"
 
@@ -55,5 +56,62 @@ void replica_http_service::query_duplication_handler(const http_request &req, ht
     resp.body = json.dump();
 }
 
+void replica_http_service::query_write_latency_handler(const http_request &req,
+                                                       http_response &resp)
+{
+    std::string app_name;
+    for (const auto &p : req.query_args) {
+        if (p.first == "app_name") {
+            app_name = p.second;
+        } else {
+            resp.status_code = http_status_code::bad_request;
+            resp.body = fmt::format("invalid argument {}", p.first);
+            return;
+        }
+    }
+
+    // the counters are named as "table.level.write.<stage>.latency(ns)@<app_name>"
+    static const std::string prefix = write_latency_tracker::counter_name_prefix();
+    static const std::string suffix = ".latency(ns)@";
+    nlohmann::json json = nlohmann::json::object();
+    perf_counters::instance().iterate_counters([&](const perf_counter_ptr &c) {
+        std::string name = c->name();
+        size_t pos = name.find(suffix);
+        if (strcmp(c->section(), "eon.replica") != 0 || name.compare(0, prefix.size(), prefix) ||
+            pos == std::string::npos) {
+            return;
+        }
+        std::string stage = name.substr(prefix.size(), pos - prefix.size());
+        std::string app = name.substr(pos + suffix.size());
+        if (!app_name.empty() && app != app_name) {
+            return;
+        }
+
+        nlohmann::json stage_json{{"p50", c->get_percentile(COUNTER_PERCENTILE_50)},
+                                  {"p90", c->get_percentile(COUNTER_PERCENTILE_90)},
+                                  {"p99", c->get_percentile(COUNTER_PERCENTILE_99)},
+                                  {"p999", c->get_percentile(COUNTER_PERCENTILE_999)}};
+        std::vector<perf_counter::histogram_bucket> buckets;
+        int64_t sum = 0;
+        if (c->get_histogram(buckets, sum)) {
+            uint64_t count = 0;
+            for (const auto &b : buckets) {
+                count += b.count;
+            }
+            stage_json["count"] = count;
+            stage_json["sum"] = sum;
+        }
+        json[app][stage] = std::move(stage_json);
+    });
+
+    if (!app_name.empty() && json.empty()) {
+        resp.status_code = http_status_code::not_found;
+        resp.body = fmt::format("no primary for app [app_name={}]", app_name);
+        return;
+    }
+    resp.status_code = http_status_code::ok;
+    resp.body = json.dump();
+}
+
 } // namespace replication
 } // namespace dsn
@@ -20,12 +20,21 @@ public:
                                    std::placeholders::_1,
                                    std::placeholders::_2),
                          "ip:port/replica/duplication?appid=<appid>");
+        register_handler("write_latency",
+                         std::bind(&replica_http_service::query_write_latency_handler,
+                                   this,
+                                   std::placeholders::_1,
+                                   std::placeholders::_2),
+                         "ip:port/replica/write_latency[?app_name=<app_name>]");
     }
 
     std::string path() const override { return "replica"; }
 
     void query_duplication_handler(const http_request &req, http_response &resp);
 
+    // the percentiles of each stage of the writes on the primaries of each table
+    void query_write_latency_handler(const http_request &req, http_response &resp);
+
 private:
     replica_stub *_stub;
 };
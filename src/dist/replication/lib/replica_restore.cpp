@@ -115,12 +115,17 @@ error_code replica::download_checkpoint(const configuration_restore_request &req
             &tracker,
             [this, &err, remote_chkpt_dir, local_chkpt_dir, f_meta, fs]() {
                 uint64_t f_size = 0;
+                std::string f_md5;
                 error_code download_err = _stub->_block_service_manager.download_file(
-                    remote_chkpt_dir, local_chkpt_dir, f_meta.name, fs, f_size);
-                const std::string file_name =
-                    utils::filesystem::path_combine(local_chkpt_dir, f_meta.name);
+                    remote_chkpt_dir, local_chkpt_dir, f_meta.name, fs, f_size, f_md5);
                 if (download_err == ERR_OK &&
-                    !utils::filesystem::verify_file(file_name, f_meta.md5, f_meta.size)) {
+                    (f_md5 != f_meta.md5 || f_size != static_cast<uint64_t>(f_meta.size))) {
+                    derror_replica("file({}) is damaged, size: {} VS {}, md5: {} VS {}",
+                                   f_meta.name,
+                                   f_size,
+                                   f_meta.size,
+                                   f_md5,
+                                   f_meta.md5);
                     download_err = ERR_CORRUPTION;
                 }
 
@@ -160,12 +165,14 @@ error_code replica::get_backup_metadata(block_filesystem *fs,
 {
     // download metadata file
     uint64_t download_file_size = 0;
+    std::string download_file_md5;
     error_code err =
         _stub->_block_service_manager.download_file(remote_chkpt_dir,
                                                     local_chkpt_dir,
                                                     cold_backup_constant::BACKUP_METADATA,
                                                     fs,
-                                                    download_file_size);
+                                                    download_file_size,
+                                                    download_file_md5);
     if (err != ERR_OK) {
         derror_replica("download backup_metadata failed, file({}), reason({})",
                        utils::filesystem::path_combine(remote_chkpt_dir,
@@ -47,6 +47,7 @@
 #include <dsn/utility/string_conv.h>
 #include <dsn/tool-api/command_manager.h>
 #include <dsn/dist/replication/replication_app_base.h>
+#include <algorithm>
 #include <vector>
 #include <deque>
 #include <dsn/dist/fmt_logging.h>
@@ -93,6 +94,9 @@ replica_stub::replica_stub(replica_state_subscriber subscriber /*= nullptr*/,
     _is_long_subscriber = is_long_subscriber;
     _failure_detector = nullptr;
     _state = NS_Disconnected;
+    _config_sync_epoch = 0;
+    _config_sync_version = 0;
+    _last_full_config_sync_ms = 0;
     _log = nullptr;
     _primary_address_str[0] = '\0';
     install_perf_counters();
@@ -119,6 +123,25 @@ void replica_stub::install_perf_counters()
                                                      "closing.replica(Count)",
                                                      COUNTER_TYPE_NUMBER,
                                                      "# in replica_stub._closing_replicas");
+    _counter_replicas_deferred_count.init_app_counter("eon.replica_stub",
+                                                      "deferred.replica(Count)",
+                                                      COUNTER_TYPE_NUMBER,
+                                                      "# in replica_stub._deferred_replicas");
+    _counter_replicas_time_to_serving_ms.init_app_counter(
+        "eon.replica_stub",
+        "replicas.time.to.serving(ms)",
+        COUNTER_TYPE_NUMBER,
+        "time from the process start to the replicas are attached to replica_stub");
+    _counter_replicas_time_to_warmup_done_ms.init_app_counter(
+        "eon.replica_stub",
+        "replicas.time.to.warmup.done(ms)",
+        COUNTER_TYPE_NUMBER,
+        "time from the process start to all the deferred replicas are opened");
+    _counter_replicas_lazy_open_latency_ms.init_app_counter(
+        "eon.replica_stub",
+        "replicas.lazy.open.latency(ms)",
+        COUNTER_TYPE_NUMBER_PERCENTILES,
+        "latency of opening a deferred replica");
     _counter_replicas_commit_qps.init_app_counter("eon.replica_stub",
                                                   "replicas.commit.qps",
                                                   COUNTER_TYPE_RATE,
@@ -419,7 +442,10 @@ void replica_stub::initialize(const replication_options &opts, bool clear /* = f
     _log = new mutation_log_shared(_options.slog_dir,
                                    _options.log_shared_file_size_mb,
                                    _options.log_shared_force_flush,
-                                   &_counter_shared_log_recent_write_size);
+                                   &_counter_shared_log_recent_write_size,
+                                   _options.log_shared_batch_buffer_kb * 1024,
+                                   _options.log_shared_batch_buffer_count,
+                                   _options.log_shared_batch_buffer_flush_interval_ms);
     ddebug("slog_dir = %s", _options.slog_dir.c_str());
 
     // init rps
@@ -435,6 +461,7 @@ void replica_stub::initialize(const replication_options &opts, bool clear /* = f
     }
 
     replicas rps;
+    deferred_replica_metas deferred;
     utils::ex_lock rps_lock;
     std::deque<task_ptr> load_tasks;
     uint64_t start_time = dsn_now_ms();
@@ -449,9 +476,22 @@ void replica_stub::initialize(const replication_options &opts, bool clear /* = f
         load_tasks.push_back(tasking::create_task(
             LPC_REPLICATION_INIT_LOAD,
             &_tracker,
-            [this, dir, &rps, &rps_lock] {
+            [this, dir, &rps, &deferred, &rps_lock] {
                 ddebug("process dir %s", dir.c_str());
 
+                if (_options.lazy_open_replicas) {
+                    gpid pid;
+                    deferred_replica_meta meta;
+                    if (load_deferred_replica_meta(dir, pid, meta)) {
+                        utils::auto_lock<utils::ex_lock> l(rps_lock);
+                        dassert(rps.find(pid) == rps.end() && deferred.find(pid) == deferred.end(),
+                                "conflict replica dir: %s",
+                                dir.c_str());
+                        deferred.emplace(pid, std::move(meta));
+                        return;
+                    }
+                }
+
                 auto r = replica::load(this, dir.c_str());
                 if (r != nullptr) {
                     ddebug("%s@%s: load replica '%s' success, <durable, commit> = <%" PRId64
@@ -471,6 +511,10 @@ void replica_stub::initialize(const replication_options &opts, bool clear /* = f
                                 r->dir().c_str(),
                                 rps[r->get_gpid()]->dir().c_str());
                     }
+                    dassert(deferred.find(r->get_gpid()) == deferred.end(),
+                            "conflict replica dir: %s <--> %s",
+                            r->dir().c_str(),
+                            deferred[r->get_gpid()].dir.c_str());
 
                     rps[r->get_gpid()] = r;
                 }
@@ -485,8 +529,10 @@ void replica_stub::initialize(const replication_options &opts, bool clear /* = f
 
     dir_list.clear();
     load_tasks.clear();
-    ddebug("load replicas succeed, replica_count = %d, time_used = %" PRIu64 " ms",
+    ddebug("load replicas succeed, replica_count = %d, deferred_count = %d, "
+           "time_used = %" PRIu64 " ms",
            static_cast<int>(rps.size()),
+           static_cast<int>(deferred.size()),
            finish_time - start_time);
 
     // init shared prepare log
@@ -496,62 +542,97 @@ void replica_stub::initialize(const replication_options &opts, bool clear /* = f
     for (auto it = rps.begin(); it != rps.end(); ++it) {
         replay_condition[it->first] = it->second->last_committed_decree();
     }
+    for (auto it = deferred.begin(); it != deferred.end(); ++it) {
+        replay_condition[it->first] = it->second.init_info.init_durable_decree;
+    }
 
+    // called concurrently for different replicas if replayed in parallel
+    std::atomic<int64_t> replay_bytes(0);
+    std::atomic<int64_t> replay_mutations(0);
     start_time = dsn_now_ms();
+    _log->set_replay_parallelism(_options.log_shared_replay_parallelism);
     error_code err = _log->open(
-        [&rps](int log_length, mutation_ptr &mu) {
+        [&rps, &deferred, &replay_bytes, &replay_mutations](int log_length, mutation_ptr &mu) {
+            replay_bytes.fetch_add(log_length, std::memory_order_relaxed);
+            replay_mutations.fetch_add(1, std::memory_order_relaxed);
             auto it = rps.find(mu->data.header.pid);
             if (it != rps.end()) {
                 return it->second->replay_mutation(mu, false);
-            } else {
-                return false;
             }
+
+            auto it2 = deferred.find(mu->data.header.pid);
+            if (it2 != deferred.end() && deferred_replica_needs_replay(it2->second, mu)) {
+                it2->second.need_replay = true;
+            }
+            return false;
         },
         [this](error_code err) { this->handle_log_failure(err); },
         replay_condition);
     finish_time = dsn_now_ms();
 
     if (err == ERR_OK) {
-        ddebug("replay shared log succeed, time_used = %" PRIu64 " ms", finish_time - start_time);
+        uint64_t time_used_ms = std::max<uint64_t>(finish_time - start_time, 1);
+        ddebug("replay shared log succeed, time_used = %" PRIu64 " ms, parallelism = %d, "
+               "size = %.2f MB, mutations = %" PRId64 ", throughput = %.2f MB/s, %.0f mutations/s",
+               finish_time - start_time,
+               _options.log_shared_replay_parallelism,
+               replay_bytes.load() / 1048576.0,
+               replay_mutations.load(),
+               replay_bytes.load() / 1048576.0 * 1000 / time_used_ms,
+               replay_mutations.load() * 1000.0 / time_used_ms);
     } else {
         derror("replay shared log failed, err = %s, time_used = %" PRIu64 " ms, clear all logs ...",
                err.to_string(),
                finish_time - start_time);
 
-        // we must delete or update meta server the error for all replicas
-        // before we fix the logs
-        // otherwise, the next process restart may consider the replicas'
-        // state complete
+        clear_replicas_on_log_failure(rps, deferred);
+    }
 
-        // delete all replicas
-        // TODO: checkpoint latest state and update on meta server so learning is cheaper
-        for (auto it = rps.begin(); it != rps.end(); ++it) {
-            it->second->close();
-            // move to '.err' directory
-            const char *dir = it->second->dir().c_str();
-            char rename_dir[1024];
-            sprintf(rename_dir, "%s.%" PRIu64 ".err", dir, dsn_now_us());
-            bool ret = dsn::utils::filesystem::rename_path(dir, rename_dir);
-            dassert(ret, "init_replica: failed to move directory '%s' to '%s'", dir, rename_dir);
-            dwarn("init_replica: {replica_dir_op} succeed to move directory '%s' to '%s'",
-                  dir,
-                  rename_dir);
-            _counter_replicas_recent_replica_move_error_count->increment();
-        }
-        rps.clear();
-
-        // restart log service
-        _log->close();
-        _log = nullptr;
-        if (!utils::filesystem::remove_path(_options.slog_dir)) {
-            dassert(false, "remove directory %s failed", _options.slog_dir.c_str());
+    // the deferred replicas with mutations to replay in the shared log must be opened now, and
+    // the shared log is replayed again only for them
+    replicas promoted_rps;
+    for (auto it = deferred.begin(); it != deferred.end();) {
+        if (!it->second.need_replay) {
+            ++it;
+            continue;
+        }
+
+        std::string dir = it->second.dir;
+        it = deferred.erase(it);
+        load_tasks.push_back(
+            tasking::create_task(LPC_REPLICATION_INIT_LOAD,
+                                 &_tracker,
+                                 [this, dir, &promoted_rps, &rps_lock] {
+                                     auto r = replica::load(this, dir.c_str());
+                                     if (r != nullptr) {
+                                         utils::auto_lock<utils::ex_lock> l(rps_lock);
+                                         promoted_rps[r->get_gpid()] = r;
+                                     }
+                                 },
+                                 load_tasks.size()));
+        load_tasks.back()->enqueue();
+    }
+    for (auto &tsk : load_tasks) {
+        tsk->wait();
+    }
+    load_tasks.clear();
+
+    if (!promoted_rps.empty()) {
+        start_time = dsn_now_ms();
+        error_code rerr = replay_shared_log_for(promoted_rps);
+        ddebug("replay shared log for the deferred replicas which can't be deferred done, "
+               "err = %s, replica_count = %d, time_used = %" PRIu64 " ms",
+               rerr.to_string(),
+               static_cast<int>(promoted_rps.size()),
+               dsn_now_ms() - start_time);
+
+        rps.insert(promoted_rps.begin(), promoted_rps.end());
+        if (rerr != ERR_OK) {
+            derror("replay shared log for the deferred replicas failed, err = %s, clear all logs "
+                   "...",
+                   rerr.to_string());
+            clear_replicas_on_log_failure(rps, deferred);
         }
-        _log = new mutation_log_shared(_options.slog_dir,
-                                       _options.log_shared_file_size_mb,
-                                       _options.log_shared_force_flush,
-                                       &_counter_shared_log_recent_write_size);
-        auto lerr = _log->open(nullptr, [this](error_code err) { this->handle_log_failure(err); });
-        dassert(lerr == ERR_OK, "restart log service must succeed");
     }
 
     bool is_log_complete = true;
@@ -651,6 +732,20 @@ void replica_stub::initialize(const replication_options &opts, bool clear /* = f
         _fs_manager.add_replica(kv.first, kv.second->dir());
     }
 
+    attach_deferred_replicas(deferred);
+    _counter_replicas_time_to_serving_ms->set(dsn_now_ms() - utils::process_start_millis());
+    ddebug("attach replicas done, replica_count = %d, deferred_count = %d",
+           static_cast<int>(_replicas.size()),
+           static_cast<int>(_deferred_replicas.size()));
+
+    if (!_deferred_replicas.empty() && _options.lazy_open_warmup_concurrency > 0) {
+        _lazy_open_warmup_timer_task =
+            tasking::enqueue_timer(LPC_LAZY_OPEN_REPLICA_WARMUP,
+                                   &_tracker,
+                                   [this]() { on_lazy_open_warmup(); },
+                                   std::chrono::seconds(1));
+    }
+
     _nfs = std::move(dsn::nfs_node::create());
     _nfs->start();
 
@@ -797,6 +892,8 @@ void replica_stub::on_client_write(gpid id, dsn::message_ex *request)
     if (rep != nullptr) {
         rep->on_client_write(request);
     } else {
+        // the client will retry after the deferred replica is opened
+        open_deferred_replica(id);
         response_client(id, false, request, partition_status::PS_INVALID, ERR_OBJECT_NOT_FOUND);
     }
 }
@@ -819,6 +916,7 @@ void replica_stub::on_client_read(gpid id, dsn::message_ex *request)
     if (rep != nullptr) {
         rep->on_client_read(request);
     } else {
+        open_deferred_replica(id);
         response_client(id, true, request, partition_status::PS_INVALID, ERR_OBJECT_NOT_FOUND);
     }
 }
@@ -1093,6 +1191,9 @@ void replica_stub::on_group_check(group_check_rpc rpc)
             response.err = ERR_OK;
             response.learner_signature = invalid_signature;
         } else {
+            // it's removed from the group by the primary, but would be added back as a learner
+            // soon, which is much cheaper if it's opened
+            open_deferred_replica(request.config.pid);
             response.err = ERR_OBJECT_NOT_FOUND;
         }
     }
@@ -1233,14 +1334,40 @@ void replica_stub::query_configuration_by_node()
     configuration_query_by_node_request req;
     req.node = _primary_address;
 
-    // TODO: send stored replicas may cost network, we shouldn't config the frequency
-    get_local_replicas(req.stored_replicas);
-    req.__isset.stored_replicas = true;
+    uint64_t full_interval_ms = static_cast<uint64_t>(_options.config_sync_full_interval_ms);
+    bool full_sync = _config_sync_version == 0 || full_interval_ms == 0 ||
+                     dsn_now_ms() >= _last_full_config_sync_ms + full_interval_ms;
+    if (full_sync) {
+        get_local_replicas(req.stored_replicas);
+        req.__isset.stored_replicas = true;
+    } else {
+        // only the changed configurations are synced, except for the replicas which are not
+        // serving yet, as they may be waiting for the configuration sync to move on
+        req.__set_config_epoch(_config_sync_epoch);
+        req.__set_config_version(_config_sync_version);
+        req.__isset.refresh_partitions = true;
+        zauto_read_lock l(_replicas_lock);
+        for (const auto &kv : _replicas) {
+            partition_status::type status = kv.second->status();
+            if (status != partition_status::PS_PRIMARY &&
+                status != partition_status::PS_SECONDARY) {
+                req.refresh_partitions.push_back(kv.first);
+            }
+        }
+        for (const auto &kv : _deferred_replicas) {
+            req.refresh_partitions.push_back(kv.first);
+        }
+    }
 
     ::dsn::marshall(msg, req);
 
-    ddebug("send query node partitions request to meta server, stored_replicas_count = %d",
-           (int)req.stored_replicas.size());
+    ddebug("send query node partitions request to meta server, full_sync = %s, "
+           "stored_replicas_count = %d, config_version = %" PRId64
+           ", refresh_partitions_count = %d",
+           full_sync ? "true" : "false",
+           (int)req.stored_replicas.size(),
+           req.config_version,
+           (int)req.refresh_partitions.size());
 
     rpc_address target(_failure_detector->get_servers());
     _config_query_task =
@@ -1312,14 +1439,54 @@ void replica_stub::on_node_query_reply(error_code err,
         }
 
         ddebug("process query node partitions response for resp.err = ERR_OK, "
-               "partitions_count(%d), gc_replicas_count(%d)",
+               "partitions_count(%d), unchanged_partitions_count(%d), gc_replicas_count(%d)",
                (int)resp.partitions.size(),
+               (int)resp.unchanged_partitions.size(),
                (int)resp.gc_replicas.size());
 
         replicas rs;
+        bool need_full_sync = false;
         {
             zauto_read_lock l(_replicas_lock);
             rs = _replicas;
+            for (const gpid &pid : resp.unchanged_partitions) {
+                // the replica isn't served by this node any more, which should be handled in a
+                // full sync
+                if (rs.erase(pid) == 0 && _deferred_replicas.count(pid) == 0) {
+                    need_full_sync = true;
+                }
+            }
+        }
+
+        if (resp.__isset.config_version && resp.__isset.config_epoch && !need_full_sync) {
+            _config_sync_epoch = resp.config_epoch;
+            _config_sync_version = resp.config_version;
+            if (!resp.__isset.unchanged_partitions) {
+                _last_full_config_sync_ms = dsn_now_ms();
+            }
+        } else {
+            // the meta server doesn't support delta config sync
+            _config_sync_version = 0;
+        }
+
+        if (_options.lazy_open_replicas) {
+            // the status on meta server is used to order the warm-up
+            zauto_write_lock l(_replicas_lock);
+            for (const auto &req : resp.partitions) {
+                auto it = _deferred_replicas.find(req.config.pid);
+                if (it == _deferred_replicas.end()) {
+                    continue;
+                }
+                if (req.config.primary == _primary_address) {
+                    it->second = partition_status::PS_PRIMARY;
+                } else if (std::find(req.config.secondaries.begin(),
+                                     req.config.secondaries.end(),
+                                     _primary_address) != req.config.secondaries.end()) {
+                    it->second = partition_status::PS_SECONDARY;
+                } else {
+                    it->second = partition_status::PS_INACTIVE;
+                }
+            }
         }
 
         for (auto it = resp.partitions.begin(); it != resp.partitions.end(); ++it) {
@@ -1339,6 +1506,12 @@ void replica_stub::on_node_query_reply(error_code err,
                 it->first.thread_hash());
         }
 
+        if (need_full_sync) {
+            ddebug("some unchanged partitions are not found on replica server, query all the "
+                   "partitions again");
+            query_configuration_by_node();
+        }
+
         // handle the replicas which need to be gc
         if (resp.__isset.gc_replicas) {
             for (replica_info &rep : resp.gc_replicas) {
@@ -1385,6 +1558,11 @@ void replica_stub::on_node_query_reply_scatter(replica_stub_ptr this_,
     replica_ptr replica = get_replica(req.config.pid);
     if (replica != nullptr) {
         replica->on_config_sync(req.info, req.config);
+    } else if (open_deferred_replica(req.config.pid)) {
+        // keep it on meta server, it will be synced on the next round after opened
+        ddebug("%s@%s: replica is deferred on replica server, open it",
+               req.config.pid.to_string(),
+               _primary_address_str);
     } else {
         if (req.config.primary == _primary_address) {
             ddebug("%s@%s: replica not exists on replica server, which is primary, remove it "
@@ -1456,6 +1634,7 @@ void replica_stub::on_meta_server_disconnected()
         return;
 
     _state = NS_Disconnected;
+    _config_sync_version = 0;
 
     replicas rs;
     {
@@ -1543,6 +1722,9 @@ void replica_stub::on_gc_replica(replica_stub_ptr this_, gpid id)
             return;
         closed_info = iter->second;
         _closed_replicas.erase(iter);
+        if (_deferred_replicas.erase(id) > 0) {
+            _counter_replicas_deferred_count->set(_deferred_replicas.size());
+        }
         _fs_manager.remove_replica(id);
     }
 
@@ -1573,6 +1755,216 @@ void replica_stub::on_gc_replica(replica_stub_ptr this_, gpid id)
     }
 }
 
+/*static*/ bool replica_stub::load_deferred_replica_meta(const std::string &dir,
+                                                        /*out*/ gpid &pid,
+                                                        /*out*/ deferred_replica_meta &meta)
+{
+    char splitters[] = {'\\', '/', 0};
+    std::string name = utils::get_last_component(dir, splitters);
+    char app_type[128];
+    int32_t app_id, pidx;
+    if (3 != sscanf(name.c_str(), "%d.%d.%s", &app_id, &pidx, app_type)) {
+        return false;
+    }
+
+    replica_app_info info2(&meta.info);
+    std::string path = utils::filesystem::path_combine(dir, ".app-info");
+    if (info2.load(path.c_str()) != ERR_OK || meta.info.app_type != app_type) {
+        return false;
+    }
+
+    // leave the replicas with the old .info to replica::load, which converts it
+    if (!utils::filesystem::file_exists(utils::filesystem::path_combine(dir, ".init-info")) ||
+        meta.init_info.load(dir) != ERR_OK) {
+        return false;
+    }
+
+    pid = gpid(app_id, pidx);
+    meta.dir = dir;
+    return true;
+}
+
+/*static*/ bool replica_stub::deferred_replica_needs_replay(const deferred_replica_meta &meta,
+                                                          const mutation_ptr &mu)
+{
+    // the same conditions as replica::replay_mutation() to skip a mutation, except that the
+    // durable decree is the one on the last open, which is not newer than the actual one
+    return mu->data.header.log_offset >= meta.init_info.init_offset_in_shared_log &&
+           mu->data.header.decree > meta.init_info.init_durable_decree;
+}
+
+error_code replica_stub::replay_shared_log_for(const replicas &rps)
+{
+    std::vector<std::string> log_files;
+    for (const auto &kv : _log->get_log_file_map()) {
+        log_files.push_back(kv.second->path());
+    }
+
+    int64_t end_offset = 0;
+    return mutation_log::replay(log_files,
+                                [this, &rps](int log_length, mutation_ptr &mu) {
+                                    auto it = rps.find(mu->data.header.pid);
+                                    if (it == rps.end() ||
+                                        !it->second->replay_mutation(mu, false)) {
+                                        return false;
+                                    }
+                                    _log->update_max_decree(mu->data.header.pid,
+                                                            mu->data.header.decree);
+                                    return true;
+                                },
+                                end_offset);
+}
+
+void replica_stub::clear_replicas_on_log_failure(replicas &rps, deferred_replica_metas &deferred)
+{
+    // we must delete or update meta server the error for all replicas
+    // before we fix the logs
+    // otherwise, the next process restart may consider the replicas'
+    // state complete
+
+    // delete all replicas
+    // TODO: checkpoint latest state and update on meta server so learning is cheaper
+    for (auto it = rps.begin(); it != rps.end(); ++it) {
+        it->second->close();
+        // move to '.err' directory
+        const char *dir = it->second->dir().c_str();
+        char rename_dir[1024];
+        sprintf(rename_dir, "%s.%" PRIu64 ".err", dir, dsn_now_us());
+        bool ret = dsn::utils::filesystem::rename_path(dir, rename_dir);
+        dassert(ret, "init_replica: failed to move directory '%s' to '%s'", dir, rename_dir);
+        dwarn("init_replica: {replica_dir_op} succeed to move directory '%s' to '%s'",
+              dir,
+              rename_dir);
+        _counter_replicas_recent_replica_move_error_count->increment();
+    }
+    rps.clear();
+
+    // the deferred replicas may also have lost some mutations in the shared log
+    for (auto it = deferred.begin(); it != deferred.end(); ++it) {
+        const char *dir = it->second.dir.c_str();
+        char rename_dir[1024];
+        sprintf(rename_dir, "%s.%" PRIu64 ".err", dir, dsn_now_us());
+        bool ret = dsn::utils::filesystem::rename_path(dir, rename_dir);
+        dassert(ret, "init_replica: failed to move directory '%s' to '%s'", dir, rename_dir);
+        dwarn("init_replica: {replica_dir_op} succeed to move directory '%s' to '%s'",
+              dir,
+              rename_dir);
+        _counter_replicas_recent_replica_move_error_count->increment();
+    }
+    deferred.clear();
+
+    // restart log service
+    _log->close();
+    _log = nullptr;
+    if (!utils::filesystem::remove_path(_options.slog_dir)) {
+        dassert(false, "remove directory %s failed", _options.slog_dir.c_str());
+    }
+    _log = new mutation_log_shared(_options.slog_dir,
+                                   _options.log_shared_file_size_mb,
+                                   _options.log_shared_force_flush,
+                                   &_counter_shared_log_recent_write_size,
+                                   _options.log_shared_batch_buffer_kb * 1024,
+                                   _options.log_shared_batch_buffer_count,
+                                   _options.log_shared_batch_buffer_flush_interval_ms);
+    auto lerr = _log->open(nullptr, [this](error_code err) { this->handle_log_failure(err); });
+    dassert(lerr == ERR_OK, "restart log service must succeed");
+}
+
+void replica_stub::attach_deferred_replicas(deferred_replica_metas &deferred)
+{
+    // the decrees reported to meta server are the durable decree on the last open until they are
+    // opened
+    zauto_write_lock l(_replicas_lock);
+    for (auto &kv : deferred) {
+        replica_info info;
+        info.pid = kv.first;
+        info.ballot = kv.second.init_info.init_ballot;
+        info.status = partition_status::PS_INACTIVE;
+        info.last_committed_decree = kv.second.init_info.init_durable_decree;
+        info.last_prepared_decree = kv.second.init_info.init_durable_decree;
+        info.last_durable_decree = kv.second.init_info.init_durable_decree;
+        info.app_type = kv.second.info.app_type;
+        dsn::error_code tag_err = _fs_manager.get_disk_tag(kv.second.dir, info.disk_tag);
+        if (dsn::ERR_OK != tag_err) {
+            dwarn("get disk tag of %s failed: %s", kv.second.dir.c_str(), tag_err.to_string());
+        }
+
+        _closed_replicas.emplace(kv.first, std::make_pair(std::move(kv.second.info), info));
+        _deferred_replicas.emplace(kv.first, partition_status::PS_INACTIVE);
+        _fs_manager.add_replica(kv.first, kv.second.dir);
+    }
+    _counter_replicas_deferred_count->set(_deferred_replicas.size());
+}
+
+bool replica_stub::open_deferred_replica(gpid id)
+{
+    app_info info;
+    {
+        zauto_read_lock l(_replicas_lock);
+        if (_deferred_replicas.find(id) == _deferred_replicas.end()) {
+            return false;
+        }
+        if (_opening_replicas.find(id) != _opening_replicas.end()) {
+            return true;
+        }
+        auto it = _closed_replicas.find(id);
+        if (it == _closed_replicas.end()) {
+            return false;
+        }
+        info = it->second.first;
+    }
+
+    ddebug("%s@%s: open deferred replica on access", id.to_string(), _primary_address_str);
+    begin_open_replica(info, id, nullptr, nullptr);
+    return true;
+}
+
+std::vector<std::pair<gpid, app_info>> replica_stub::pick_lazy_open_warmup_replicas()
+{
+    std::vector<std::pair<gpid, app_info>> to_open;
+    zauto_read_lock l(_replicas_lock);
+    int slots = _options.lazy_open_warmup_concurrency - static_cast<int>(_opening_replicas.size());
+    if (slots <= 0 || _deferred_replicas.empty()) {
+        return to_open;
+    }
+
+    // <rank, gpid>, the smaller one is opened earlier
+    std::vector<std::pair<int, gpid>> candidates;
+    bool primary_first = _options.lazy_open_warmup_order == "primary_first";
+    for (const auto &kv : _deferred_replicas) {
+        if (_opening_replicas.find(kv.first) != _opening_replicas.end()) {
+            continue;
+        }
+        int rank = 0;
+        if (primary_first) {
+            rank = kv.second == partition_status::PS_PRIMARY
+                       ? 0
+                       : (kv.second == partition_status::PS_SECONDARY ? 1 : 2);
+        }
+        candidates.emplace_back(rank, kv.first);
+    }
+
+    size_t count = std::min(candidates.size(), static_cast<size_t>(slots));
+    std::partial_sort(candidates.begin(), candidates.begin() + count, candidates.end());
+    for (size_t i = 0; i < count; ++i) {
+        auto it = _closed_replicas.find(candidates[i].second);
+        if (it != _closed_replicas.end()) {
+            to_open.emplace_back(it->first, it->second.first);
+        }
+    }
+    return to_open;
+}
+
+void replica_stub::on_lazy_open_warmup()
+{
+    for (const auto &kv : pick_lazy_open_warmup_replicas()) {
+        ddebug("%s@%s: open deferred replica by warm-up",
+               kv.first.to_string(),
+               _primary_address_str);
+        begin_open_replica(kv.second, kv.first, nullptr, nullptr);
+    }
+}
+
 void replica_stub::on_gc()
 {
     uint64_t start = dsn_now_ns();
@@ -1888,6 +2280,7 @@ void replica_stub::open_replica(const app_info &app,
                                 std::shared_ptr<group_check_request> req,
                                 std::shared_ptr<configuration_update_request> req2)
 {
+    uint64_t start_time = dsn_now_ms();
     std::string dir = get_replica_dir(app.app_type.c_str(), id, false);
     replica_ptr rep = nullptr;
     if (!dir.empty()) {
@@ -1933,9 +2326,14 @@ void replica_stub::open_replica(const app_info &app,
         auto ret = _opening_replicas.erase(id);
         dassert(ret > 0, "replica %s is not in _opening_replicas", id.to_string());
         _counter_replicas_opening_count->decrement();
+        if (_deferred_replicas.erase(id) > 0) {
+            _counter_replicas_deferred_count->set(_deferred_replicas.size());
+        }
         return;
     }
 
+    bool is_deferred = false;
+    bool is_warmup_done = false;
     {
         zauto_write_lock l(_replicas_lock);
         auto ret = _opening_replicas.erase(id);
@@ -1948,6 +2346,28 @@ void replica_stub::open_replica(const app_info &app,
         _counter_replicas_count->increment();
 
         _closed_replicas.erase(id);
+
+        is_deferred = _deferred_replicas.erase(id) > 0;
+        is_warmup_done = is_deferred && _deferred_replicas.empty();
+        _counter_replicas_deferred_count->set(_deferred_replicas.size());
+    }
+
+    if (is_deferred) {
+        uint64_t time_used_ms = dsn_now_ms() - start_time;
+        _counter_replicas_lazy_open_latency_ms->set(time_used_ms);
+        ddebug("%s: open deferred replica done, time_used = %" PRIu64 " ms",
+               rep->name(),
+               time_used_ms);
+        if (is_warmup_done) {
+            uint64_t time_to_done_ms = dsn_now_ms() - utils::process_start_millis();
+            _counter_replicas_time_to_warmup_done_ms->set(time_to_done_ms);
+            ddebug("all the deferred replicas are opened, time_used_since_process_start = %" PRIu64
+                   " ms",
+                   time_to_done_ms);
+        } else if (_options.lazy_open_warmup_concurrency > 0) {
+            // open the next one without waiting for the timer
+            on_lazy_open_warmup();
+        }
     }
 
     if (nullptr != req) {
@@ -2451,6 +2871,11 @@ void replica_stub::close()
         _mem_release_timer_task = nullptr;
     }
 
+    if (_lazy_open_warmup_timer_task != nullptr) {
+        _lazy_open_warmup_timer_task->cancel(true);
+        _lazy_open_warmup_timer_task = nullptr;
+    }
+
     {
         zauto_write_lock l(_replicas_lock);
         while (!_closing_replicas.empty()) {
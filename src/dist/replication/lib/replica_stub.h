@@ -37,6 +37,7 @@
 #include <dsn/perf_counter/perf_counter_wrapper.h>
 #include <dsn/dist/failure_detector_multimaster.h>
 #include <dsn/dist/nfs_node.h>
+#include <dsn/dist/replication/replication_app_base.h>
 
 #include "dist/replication/common/replication_common.h"
 #include "dist/replication/common/fs_manager.h"
@@ -231,10 +232,11 @@ private:
                                      const configuration_update_request &config);
     void on_node_query_reply_scatter2(replica_stub_ptr this_, gpid id);
     void remove_replica_on_meta_server(const app_info &info, const partition_configuration &config);
-    ::dsn::task_ptr begin_open_replica(const app_info &app,
-                                       gpid id,
-                                       std::shared_ptr<group_check_request> req,
-                                       std::shared_ptr<configuration_update_request> req2);
+    // virtual for test
+    virtual ::dsn::task_ptr begin_open_replica(const app_info &app,
+                                               gpid id,
+                                               std::shared_ptr<group_check_request> req,
+                                               std::shared_ptr<configuration_update_request> req2);
     void open_replica(const app_info &app,
                       gpid id,
                       std::shared_ptr<group_check_request> req,
@@ -253,6 +255,40 @@ private:
     replica_life_cycle get_replica_life_cycle(gpid id);
     void on_gc_replica(replica_stub_ptr this_, gpid id);
 
+    // lazy open, see [replication] lazy_open_replicas
+    // metadata of a replica whose opening is deferred
+    struct deferred_replica_meta
+    {
+        std::string dir;
+        app_info info;
+        replica_init_info init_info;
+        // whether there are mutations to replay in the shared log, in which case it can't be
+        // deferred. only set by the task replaying the mutations of this replica
+        bool need_replay = false;
+    };
+    typedef std::map<gpid, deferred_replica_meta> deferred_replica_metas;
+    // load the metadata of the replica from .app-info and .init-info, without opening the app or
+    // the private log
+    static bool load_deferred_replica_meta(const std::string &dir,
+                                           /*out*/ gpid &pid,
+                                           /*out*/ deferred_replica_meta &meta);
+    // whether the mutation in the shared log has to be replayed by the deferred replica
+    static bool deferred_replica_needs_replay(const deferred_replica_meta &meta,
+                                              const mutation_ptr &mu);
+    // replay the shared log again only for the replicas, which are loaded after the first replay
+    error_code replay_shared_log_for(const replicas &rps);
+    // move all the replicas to '.err' directories and restart the shared log, when the shared
+    // log fails to be replayed
+    void clear_replicas_on_log_failure(replicas &rps, deferred_replica_metas &deferred);
+    // register the deferred replicas as closed ones
+    void attach_deferred_replicas(deferred_replica_metas &deferred);
+    // open the replica in background if it is deferred, returns false if it isn't
+    bool open_deferred_replica(gpid id);
+    // the deferred replicas to open by the warm-up, in the configured order, so that at most
+    // lazy_open_warmup_concurrency replicas are under opening
+    std::vector<std::pair<gpid, app_info>> pick_lazy_open_warmup_replicas();
+    void on_lazy_open_warmup();
+
     void response_client(gpid id,
                          bool is_read,
                          dsn::message_ex *request,
@@ -296,6 +332,7 @@ private:
     friend class duplication_test_base;
     friend class replica_test;
     friend class replica_disk_test;
+    friend class replica_lazy_open_test;
 
     typedef std::unordered_map<gpid, ::dsn::task_ptr> opening_replicas;
     typedef std::unordered_map<gpid, std::tuple<task_ptr, replica_ptr, app_info, replica_info>>
@@ -309,6 +346,13 @@ private:
     closing_replicas _closing_replicas;
     closed_replicas _closed_replicas;
 
+    // replicas which are registered from their metadata on startup but not opened yet, they are
+    // also in _closed_replicas, so that they are reported to meta server and opened in the same
+    // way as the closed ones.
+    // <gpid, status on meta server>, the status is used to order the warm-up
+    typedef std::unordered_map<gpid, partition_status::type> deferred_replicas;
+    deferred_replicas _deferred_replicas;
+
     mutation_log_ptr _log;
     ::dsn::rpc_address _primary_address;
     char _primary_address_str[64];
@@ -316,6 +360,11 @@ private:
     ::dsn::dist::slave_failure_detector_with_multimaster *_failure_detector;
     mutable zlock _state_lock;
     volatile replica_node_state _state;
+    // the config version of meta server synced last time, protected by _state_lock.
+    // version 0 means the next config sync should be a full one.
+    int64_t _config_sync_epoch;
+    int64_t _config_sync_version;
+    uint64_t _last_full_config_sync_ms;
 
     // constants
     replication_options _options;
@@ -328,6 +377,7 @@ private:
     ::dsn::task_ptr _gc_timer_task;
     ::dsn::task_ptr _disk_stat_timer_task;
     ::dsn::task_ptr _mem_release_timer_task;
+    ::dsn::task_ptr _lazy_open_warmup_timer_task;
 
     std::unique_ptr<duplication_sync_timer> _duplication_sync_timer;
 
@@ -379,6 +429,10 @@ private:
     perf_counter_wrapper _counter_replicas_count;
     perf_counter_wrapper _counter_replicas_opening_count;
     perf_counter_wrapper _counter_replicas_closing_count;
+    perf_counter_wrapper _counter_replicas_deferred_count;
+    perf_counter_wrapper _counter_replicas_time_to_serving_ms;
+    perf_counter_wrapper _counter_replicas_time_to_warmup_done_ms;
+    perf_counter_wrapper _counter_replicas_lazy_open_latency_ms;
     perf_counter_wrapper _counter_replicas_commit_qps;
 
     perf_counter_wrapper _counter_replicas_learning_count;
@@ -0,0 +1,132 @@
+// Copyright (c) 2019, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#include "write_latency_tracker.h"
+
+#include <algorithm>
+
+#include <dsn/dist/fmt_logging.h>
+#include <dsn/perf_counter/perf_counters.h>
+#include <dsn/utility/flags.h>
+
+namespace dsn {
+namespace replication {
+
+DSN_DEFINE_uint64("replication",
+                  slow_mutation_threshold_ms,
+                  1000,
+                  "the mutations whose latency on primary exceeds the threshold are logged with "
+                  "their stages, 0 to disable");
+
+static const char *s_stage_names[WLS_COUNT] = {
+    "queue", "prepare", "log", "secondary_ack", "replicate", "commit", "apply", "total"};
+
+/*static*/ const char *write_latency_tracker::stage_name(write_latency_stage stage)
+{
+    return s_stage_names[stage];
+}
+
+/*static*/ std::string write_latency_tracker::counter_name(write_latency_stage stage,
+                                                           const std::string &app_name)
+{
+    return fmt::format("{}{}.latency(ns)@{}", counter_name_prefix(), stage_name(stage), app_name);
+}
+
+write_latency_tracker::write_latency_tracker(const std::string &app_name)
+{
+    for (int i = 0; i < WLS_COUNT; i++) {
+        std::string name = counter_name(static_cast<write_latency_stage>(i), app_name);
+        _stage_counters[i] = perf_counters::instance().get_app_counter(
+            "eon.replica", name.c_str(), COUNTER_TYPE_NUMBER_PERCENTILES, name.c_str(), true);
+    }
+    std::string name = fmt::format("{}slow.count@{}", counter_name_prefix(), app_name);
+    _slow_mutation_counter = perf_counters::instance().get_app_counter(
+        "eon.replica", name.c_str(), COUNTER_TYPE_VOLATILE_NUMBER, name.c_str(), true);
+}
+
+void write_latency_tracker::on_prepare_ack(mutation_ptr &mu, rpc_address node)
+{
+    uint64_t prepared_ts_ns = mu->milestone_ts_ns(MM_PREPARED);
+    if (prepared_ts_ns == 0) {
+        return;
+    }
+    uint64_t now_ns = dsn_now_ns();
+    mu->add_prepare_ack(node, now_ns);
+    _stage_counters[WLS_SECONDARY_ACK]->set(now_ns > prepared_ts_ns ? now_ns - prepared_ts_ns
+                                                                     : 0);
+}
+
+void write_latency_tracker::on_mutation_applied(const mutation_ptr &mu, const char *replica_name)
+{
+    // the mutations prepared again by reconciliation are skipped
+    uint64_t prepare_begin_ts_ns = mu->milestone_ts_ns(MM_PREPARE_BEGIN);
+    uint64_t prepared_ts_ns = mu->milestone_ts_ns(MM_PREPARED);
+    uint64_t commit_begin_ts_ns = mu->milestone_ts_ns(MM_COMMIT_BEGIN);
+    uint64_t applied_ts_ns = mu->milestone_ts_ns(MM_APPLIED);
+    if (prepare_begin_ts_ns == 0 || prepared_ts_ns == 0 || commit_begin_ts_ns == 0 ||
+        applied_ts_ns == 0) {
+        return;
+    }
+
+    uint64_t stages[WLS_COUNT] = {0};
+    bool reached[WLS_COUNT] = {false};
+    auto set_stage = [&](write_latency_stage stage, uint64_t begin_ts_ns, uint64_t end_ts_ns) {
+        stages[stage] = end_ts_ns > begin_ts_ns ? end_ts_ns - begin_ts_ns : 0;
+        reached[stage] = true;
+    };
+
+    set_stage(WLS_QUEUE, mu->create_ts_ns(), prepare_begin_ts_ns);
+    set_stage(WLS_PREPARE, prepare_begin_ts_ns, prepared_ts_ns);
+    // the mutation is ready for commit when it's logged and acked by all
+    uint64_t ready_ts_ns = prepared_ts_ns;
+    uint64_t logged_ts_ns = mu->milestone_ts_ns(MM_LOGGED);
+    if (logged_ts_ns != 0) {
+        set_stage(WLS_LOG, prepared_ts_ns, logged_ts_ns);
+        ready_ts_ns = std::max(ready_ts_ns, logged_ts_ns);
+    }
+    uint64_t acked_ts_ns = mu->milestone_ts_ns(MM_ACKED);
+    if (acked_ts_ns != 0) {
+        set_stage(WLS_REPLICATE, prepared_ts_ns, acked_ts_ns);
+        ready_ts_ns = std::max(ready_ts_ns, acked_ts_ns);
+    }
+    set_stage(WLS_COMMIT, ready_ts_ns, commit_begin_ts_ns);
+    set_stage(WLS_APPLY, commit_begin_ts_ns, applied_ts_ns);
+    set_stage(WLS_TOTAL, mu->create_ts_ns(), applied_ts_ns);
+
+    for (int i = 0; i < WLS_COUNT; i++) {
+        // the acks are counted once they are received
+        if (reached[i] && i != WLS_SECONDARY_ACK) {
+            _stage_counters[i]->set(stages[i]);
+        }
+    }
+
+    if (FLAGS_slow_mutation_threshold_ms == 0 ||
+        stages[WLS_TOTAL] < FLAGS_slow_mutation_threshold_ms * 1000000) {
+        return;
+    }
+    _slow_mutation_counter->increment();
+
+    std::string acks;
+    for (const auto &ack : mu->prepare_acks()) {
+        acks += fmt::format(" {}:{}", ack.first.to_string(), (ack.second - prepared_ts_ns) / 1000);
+    }
+    dwarn_f("[{}] slow mutation {}: request_count = {}, appro_data_bytes = {}, "
+            "total = {}us, queue = {}us, prepare = {}us, log = {}us, replicate = {}us, "
+            "commit = {}us, apply = {}us, acks(us) ={}",
+            replica_name,
+            mu->name(),
+            mu->client_requests.size(),
+            mu->appro_data_bytes(),
+            stages[WLS_TOTAL] / 1000,
+            stages[WLS_QUEUE] / 1000,
+            stages[WLS_PREPARE] / 1000,
+            stages[WLS_LOG] / 1000,
+            stages[WLS_REPLICATE] / 1000,
+            stages[WLS_COMMIT] / 1000,
+            stages[WLS_APPLY] / 1000,
+            acks.empty() ? " none" : acks);
+}
+
+} // namespace replication
+} // namespace dsn
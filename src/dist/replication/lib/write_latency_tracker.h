@@ -0,0 +1,58 @@
+// Copyright (c) 2019, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include <dsn/perf_counter/perf_counter.h>
+
+#include "mutation.h"
+
+namespace dsn {
+namespace replication {
+
+// the stages which the latency of a write on primary is broken down into
+enum write_latency_stage
+{
+    WLS_QUEUE,         // waiting in the mutation_queue
+    WLS_PREPARE,       // checking and inserting into the prepare list
+    WLS_LOG,           // writing the shared log
+    WLS_SECONDARY_ACK, // from sending the prepare to the ack, for each secondary or learner
+    WLS_REPLICATE,     // from sending the prepares to the last ack
+    WLS_COMMIT,        // from ready for commit to commit, waiting for the former mutations
+    WLS_APPLY,         // applying to the app
+    WLS_TOTAL,
+
+    WLS_COUNT
+};
+
+// Aggregates the stages of the writes on primary into the percentile counters of the table, which
+// are shared by all the replicas of the same table on this server, like the table level latency
+// counters. The mutations slower than [replication] slow_mutation_threshold_ms are logged with
+// all their stages.
+class write_latency_tracker
+{
+public:
+    explicit write_latency_tracker(const std::string &app_name);
+
+    // called on primary when a secondary or learner acks the prepare of the mutation
+    void on_prepare_ack(mutation_ptr &mu, rpc_address node);
+
+    // called on primary after the mutation is applied
+    void on_mutation_applied(const mutation_ptr &mu, const char *replica_name);
+
+    static const char *stage_name(write_latency_stage stage);
+
+    // the name of the counter of the stage in the table
+    static std::string counter_name(write_latency_stage stage, const std::string &app_name);
+
+    // the prefix of the names of all the stage counters
+    static const char *counter_name_prefix() { return "table.level.write."; }
+
+private:
+    perf_counter_ptr _stage_counters[WLS_COUNT];
+    perf_counter_ptr _slow_mutation_counter;
+};
+
+} // namespace replication
+} // namespace dsn
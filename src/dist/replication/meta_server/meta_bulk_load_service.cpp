@@ -176,6 +176,7 @@ void bulk_load_service::do_start_app_bulk_load(std::shared_ptr<app_state> app,
             {
                 zauto_write_lock l(app_lock());
                 app->is_bulk_loading = true;
+                _state->increase_app_config_version(*app);
             }
             {
                 zauto_write_lock l(_lock);
@@ -1088,6 +1089,7 @@ void bulk_load_service::update_app_not_bulk_loading_on_remote_storage(
         _state->get_app_path(*app), std::move(value), [app, this]() {
             zauto_write_lock l(app_lock());
             app->is_bulk_loading = false;
+            _state->increase_app_config_version(*app);
             ddebug_f("app({}) update app is_bulk_loading to false", app->app_name);
         });
 }
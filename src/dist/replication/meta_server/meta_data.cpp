@@ -365,6 +365,7 @@ void app_state_helper::on_init_partitions()
     context.msg = nullptr;
 
     context.prefered_dropped = -1;
+    context.config_version = 0;
     contexts.assign(owner->partition_count, context);
 
     std::vector<partition_configuration> &partitions = owner->partitions;
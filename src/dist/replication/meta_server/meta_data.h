@@ -211,6 +211,11 @@ public:
     // TODO: a more clear implementation
     int32_t prefered_dropped;
     //]
+
+    // server_state's config version when the configuration of the partition is changed last
+    // time, see server_state::on_config_sync
+    int64_t config_version;
+
 public:
     void check_size();
     void cancel_sync();
@@ -293,9 +298,15 @@ public:
     std::vector<config_context> contexts;
     dsn::message_ex *pending_response;
     std::vector<restore_state> restore_states;
+    // server_state's config version when the app info is changed last time, which is synced
+    // together with the configurations of all the partitions
+    int64_t config_version;
+    // protects the app info and the partition configurations of the app for the queries which
+    // don't hold server_state::_lock, see the lock order in server_state.h
+    mutable zrwlock_nr lock;
 
 public:
-    app_state_helper() : owner(nullptr), partitions_in_progress(0)
+    app_state_helper() : owner(nullptr), partitions_in_progress(0), config_version(0)
     {
         contexts.clear();
         pending_response = nullptr;
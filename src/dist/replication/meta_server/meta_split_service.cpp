@@ -104,6 +104,7 @@ void meta_split_service::do_app_partition_split(std::shared_ptr<app_state> app,
                  app->partition_count * 2);
 
         zauto_write_lock l(app_lock());
+        zauto_write_lock app_l(app->helpers->lock);
         app->partition_count *= 2;
         app->helpers->contexts.resize(app->partition_count);
         app->partitions.resize(app->partition_count);
@@ -115,6 +116,7 @@ void meta_split_service::do_app_partition_split(std::shared_ptr<app_state> app,
                 app->partitions[i].pid = gpid(app->app_id, i);
             }
         }
+        _state->increase_app_config_version(*app);
 
         auto &response = rpc.response();
         response.err = ERR_OK;
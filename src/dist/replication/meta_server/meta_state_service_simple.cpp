@@ -37,13 +37,26 @@
 #include "meta_state_service_simple.h"
 #include <dsn/tool-api/task.h>
 #include <dsn/tool-api/async_calls.h>
+#include <dsn/utility/crc.h>
 #include <dsn/utility/filesystem.h>
+#include <dsn/utility/flags.h>
+#include <dsn/utility/string_conv.h>
+#include <fmt/format.h>
 
+#include <algorithm>
+#include <set>
 #include <stack>
+#include <unistd.h>
 #include <utility>
 
 namespace dsn {
 namespace dist {
+DSN_DEFINE_uint64("meta_server",
+                  meta_state_service_simple_snapshot_threshold_kb,
+                  64 * 1024,
+                  "the log of meta_state_service_simple is compacted into a snapshot once it "
+                  "grows beyond this size, 0 means never");
+
 // path: /, /n1/n2, /n1/n2/, /n2/n2/n3
 std::string meta_state_service_simple::normalize_path(const std::string &s)
 {
@@ -82,6 +95,7 @@ void meta_state_service_simple::write_log(blob &&log_blob,
                                           task_ptr task)
 {
     _log_lock.lock();
+    disk_file *log = _log;
     uint64_t log_offset = _offset;
     _offset += log_blob.length();
     auto continuation_task = std::unique_ptr<operation>(new operation(false, [=](bool log_succeed) {
@@ -90,9 +104,13 @@ void meta_state_service_simple::write_log(blob &&log_blob,
     }));
     auto continuation_task_ptr = continuation_task.get();
     _task_queue.emplace(move(continuation_task));
+    if (!_snapshotting && FLAGS_meta_state_service_simple_snapshot_threshold_kb > 0 &&
+        _offset >= FLAGS_meta_state_service_simple_snapshot_threshold_kb * 1024) {
+        roll_log();
+    }
     _log_lock.unlock();
 
-    file::write(_log,
+    file::write(log,
                 log_blob.data(),
                 log_blob.length(),
                 log_offset,
@@ -230,72 +248,343 @@ error_code meta_state_service_simple::apply_transaction(
     return ERR_OK;
 }
 
+static const std::string LOG_FILE_NAME = "meta_state_service.log";
+static const std::string SNAPSHOT_FILE_NAME = "meta_state_service.snapshot";
+
+// parse the generation from the file name "{prefix}.{gen}"
+static bool parse_generation(const std::string &name, const std::string &prefix, int64_t &gen)
+{
+    if (name == LOG_FILE_NAME && prefix == LOG_FILE_NAME) {
+        gen = 0;
+        return true;
+    }
+    return name.size() > prefix.size() + 1 && name.compare(0, prefix.size(), prefix) == 0 &&
+           name[prefix.size()] == '.' && buf2int64(name.substr(prefix.size() + 1), gen);
+}
+
+std::string meta_state_service_simple::log_path(int64_t gen) const
+{
+    std::string path = utils::filesystem::path_combine(_work_dir, LOG_FILE_NAME);
+    // generation 0 keeps the name of the log before snapshot is supported
+    return gen == 0 ? path : fmt::format("{}.{}", path, gen);
+}
+
+std::string meta_state_service_simple::snapshot_path(int64_t gen) const
+{
+    return fmt::format(
+        "{}.{}", utils::filesystem::path_combine(_work_dir, SNAPSHOT_FILE_NAME), gen);
+}
+
+error_code meta_state_service_simple::replay_log(const std::string &path,
+                                                 /*out*/ uint64_t &valid_size,
+                                                 /*out*/ uint64_t &failed_count)
+{
+    valid_size = 0;
+    FILE *fd = fopen(path.c_str(), "rb");
+    if (fd == nullptr) {
+        derror("open log file %s failed", path.c_str());
+        return ERR_FILE_OPERATION_FAILED;
+    }
+    for (;;) {
+        log_header header;
+        if (fread(&header, sizeof(log_header), 1, fd) != 1) {
+            break;
+        }
+        if (header.magic != log_header::default_magic) {
+            break;
+        }
+        std::shared_ptr<char> buffer(dsn::utils::make_shared_array<char>(header.size));
+        if (fread(buffer.get(), header.size, 1, fd) != 1) {
+            break;
+        }
+        valid_size += sizeof(header) + header.size;
+        binary_reader reader(blob(buffer, (int)header.size));
+        int op_type;
+        reader.read(op_type);
+
+        std::string node;
+        error_code err;
+        switch (static_cast<operation_type>(op_type)) {
+        case operation_type::create_node: {
+            blob data;
+            create_node_log::parse(reader, node, data);
+            err = create_node_internal(node, data);
+            break;
+        }
+        case operation_type::delete_node: {
+            bool recursively_delete;
+            delete_node_log::parse(reader, node, recursively_delete);
+            err = delete_node_internal(node, recursively_delete);
+            break;
+        }
+        case operation_type::set_data: {
+            blob data;
+            set_data_log::parse(reader, node, data);
+            err = set_data_internal(node, data);
+            break;
+        }
+        default:
+            // The log is complete but its content is modified by cosmic ray. This is
+            // unacceptable
+            dassert(false, "meta state server log corrupted");
+        }
+        if (err != ERR_OK) {
+            dwarn("replay operation %d on node %s in %s failed: %s",
+                  op_type,
+                  node.c_str(),
+                  path.c_str(),
+                  err.to_string());
+            ++failed_count;
+        }
+    }
+    fclose(fd);
+    return ERR_OK;
+}
+
+error_code meta_state_service_simple::load_snapshot(const std::string &path)
+{
+    std::string content;
+    error_code err = utils::filesystem::read_file(path, content);
+    if (err != ERR_OK) {
+        return err;
+    }
+
+    snapshot_header header;
+    if (content.size() < sizeof(header)) {
+        return ERR_INVALID_DATA;
+    }
+    memcpy(&header, content.data(), sizeof(header));
+    if (header.magic != snapshot_header::default_magic || header.version != 1 ||
+        content.size() != sizeof(header) + header.body_size ||
+        header.body_crc !=
+            utils::crc32_calc(content.data() + sizeof(header), header.body_size, 0)) {
+        return ERR_INVALID_DATA;
+    }
+
+    // nodes are sorted by path in snapshot, so parents are always created before children
+    binary_reader reader(blob::create_from_bytes(content.substr(sizeof(header))));
+    for (uint64_t i = 0; i < header.node_count; ++i) {
+        std::string node;
+        blob data;
+        unmarshall(reader, node, DSF_THRIFT_BINARY);
+        unmarshall(reader, data, DSF_THRIFT_BINARY);
+        err = create_node_internal(node, data);
+        dassert(err == ERR_OK,
+                "create node %s from snapshot failed: %s",
+                node.c_str(),
+                err.to_string());
+    }
+    return ERR_OK;
+}
+
 error_code meta_state_service_simple::initialize(const std::vector<std::string> &args)
 {
     const char *work_dir =
         args.empty() ? service_app::current_service_app_info().data_dir.c_str() : args[0].c_str();
+    _work_dir = work_dir;
+
+    _snapshot_size.init_app_counter("eon.meta_state_service",
+                                    "snapshot_size",
+                                    COUNTER_TYPE_NUMBER,
+                                    "size(bytes) of the latest snapshot");
+    _snapshot_duration_ms.init_app_counter("eon.meta_state_service",
+                                           "snapshot_duration_ms",
+                                           COUNTER_TYPE_NUMBER,
+                                           "time(ms) used by writing the latest snapshot");
+    _replay_duration_ms.init_app_counter("eon.meta_state_service",
+                                         "replay_duration_ms",
+                                         COUNTER_TYPE_NUMBER,
+                                         "time(ms) used by loading the snapshot and the logs");
+
+    uint64_t start_ms = dsn_now_ms();
+    std::vector<int64_t> snapshot_gens;
+    std::set<int64_t> log_gens;
+    int64_t max_log_gen = 0;
+    std::vector<std::string> files;
+    utils::filesystem::get_subfiles(_work_dir, files, false);
+    for (const std::string &file : files) {
+        std::string name = utils::filesystem::get_file_name(file);
+        int64_t gen;
+        if (parse_generation(name, SNAPSHOT_FILE_NAME, gen)) {
+            snapshot_gens.push_back(gen);
+        } else if (parse_generation(name, LOG_FILE_NAME, gen)) {
+            log_gens.insert(gen);
+            max_log_gen = std::max(max_log_gen, gen);
+        }
+    }
 
-    _offset = 0;
-    std::string log_path = dsn::utils::filesystem::path_combine(work_dir, "meta_state_service.log");
-    if (utils::filesystem::file_exists(log_path)) {
-        if (FILE *fd = fopen(log_path.c_str(), "rb")) {
-            for (;;) {
-                log_header header;
-                if (fread(&header, sizeof(log_header), 1, fd) != 1) {
-                    break;
-                }
-                if (header.magic != log_header::default_magic) {
-                    break;
-                }
-                std::shared_ptr<char> buffer(dsn::utils::make_shared_array<char>(header.size));
-                if (fread(buffer.get(), header.size, 1, fd) != 1) {
-                    break;
-                }
-                _offset += sizeof(header) + header.size;
-                binary_reader reader(blob(buffer, (int)header.size));
-                int op_type;
-                reader.read(op_type);
-
-                switch (static_cast<operation_type>(op_type)) {
-                case operation_type::create_node: {
-                    std::string node;
-                    blob data;
-                    create_node_log::parse(reader, node, data);
-                    create_node_internal(node, data);
-                    break;
-                }
-                case operation_type::delete_node: {
-                    std::string node;
-                    bool recursively_delete;
-                    delete_node_log::parse(reader, node, recursively_delete);
-                    delete_node_internal(node, recursively_delete);
-                    break;
-                }
-                case operation_type::set_data: {
-                    std::string node;
-                    blob data;
-                    set_data_log::parse(reader, node, data);
-                    set_data_internal(node, data);
-                    break;
-                }
-                default:
-                    // The log is complete but its content is modified by cosmic ray. This is
-                    // unacceptable
-                    dassert(false, "meta state server log corrupted");
-                }
+    // the state in the latest valid snapshot contains the logs of all the previous generations
+    int64_t start_gen = 0;
+    std::sort(snapshot_gens.begin(), snapshot_gens.end(), std::greater<int64_t>());
+    for (int64_t gen : snapshot_gens) {
+        error_code err = load_snapshot(snapshot_path(gen));
+        if (err == ERR_OK) {
+            ddebug("load snapshot %s succeed", snapshot_path(gen).c_str());
+            start_gen = gen;
+            break;
+        }
+        derror("load snapshot %s failed: %s", snapshot_path(gen).c_str(), err.to_string());
+    }
+
+    _log_gen = std::max(max_log_gen, start_gen);
+
+    // the logs of the generations from the loaded snapshot on should be all kept, otherwise the
+    // operations in the missing ones are lost, e.g. the latest snapshot is corrupted after the
+    // older logs are removed. a new work dir has neither logs nor snapshots.
+    if (!snapshot_gens.empty() || !log_gens.empty()) {
+        for (int64_t gen = start_gen; gen <= _log_gen; ++gen) {
+            if (log_gens.find(gen) == log_gens.end()) {
+                derror("log %s is missing, which is not covered by any valid snapshot",
+                       log_path(gen).c_str());
+                return ERR_INVALID_DATA;
             }
-            fclose(fd);
         }
     }
 
-    _log = file::open(log_path.c_str(), O_RDWR | O_CREAT | O_BINARY, 0666);
+    _offset = 0;
+    uint64_t failed_count = 0;
+    for (int64_t gen = start_gen; gen <= _log_gen; ++gen) {
+        error_code err = replay_log(log_path(gen), _offset, failed_count);
+        if (err != ERR_OK) {
+            return err;
+        }
+    }
+    remove_obsolete_files(start_gen);
+    _replay_duration_ms->set(dsn_now_ms() - start_ms);
+    ddebug("meta state service initialized from generation %" PRId64 " to %" PRId64
+           ", failed_operations = %" PRIu64 ", time_used = %" PRIu64 " ms",
+           start_gen,
+           _log_gen,
+           failed_count,
+           dsn_now_ms() - start_ms);
+
+    _log = file::open(log_path(_log_gen).c_str(), O_RDWR | O_CREAT | O_BINARY, 0666);
     if (!_log) {
-        derror("open file failed: %s", log_path.c_str());
+        derror("open file failed: %s", log_path(_log_gen).c_str());
         return ERR_FILE_OPERATION_FAILED;
     }
     return ERR_OK;
 }
 
+void meta_state_service_simple::roll_log()
+{
+    std::string path = log_path(_log_gen + 1);
+    disk_file *new_log = file::open(path.c_str(), O_RDWR | O_CREAT | O_BINARY, 0666);
+    if (!new_log) {
+        // keep appending to the current log, and retry on the next write
+        derror("open file failed: %s", path.c_str());
+        return;
+    }
+
+    disk_file *old_log = _log;
+    _log = new_log;
+    _offset = 0;
+    int64_t gen = ++_log_gen;
+    _snapshotting = true;
+
+    // the operations are applied in the order of logging, so the marker is executed after all the
+    // operations of the previous generations are applied and before any of the new generation
+    dassert(!_task_queue.empty(), "the operation which triggers rolling should be queued");
+    _task_queue.emplace(new operation(true, [this, old_log, gen](bool) {
+        file::close(old_log);
+
+        // only copy the state here, which is cheap as the data blobs are shared, and leave the
+        // heavy work to the background
+        auto nodes = std::make_shared<std::vector<std::pair<std::string, blob>>>();
+        {
+            zauto_lock l(_state_lock);
+            nodes->reserve(_quick_map.size());
+            for (const auto &kv : _quick_map) {
+                if (kv.first != "/") {
+                    nodes->emplace_back(kv.first, kv.second->data);
+                }
+            }
+        }
+        tasking::enqueue(LPC_META_STATE_SERVICE_SIMPLE_SNAPSHOT,
+                         &_tracker,
+                         [this, nodes, gen]() { write_snapshot(gen, *nodes); });
+    }));
+}
+
+void meta_state_service_simple::write_snapshot(int64_t gen,
+                                               std::vector<std::pair<std::string, blob>> &nodes)
+{
+    uint64_t start_ms = dsn_now_ms();
+    std::sort(nodes.begin(),
+              nodes.end(),
+              [](const std::pair<std::string, blob> &l, const std::pair<std::string, blob> &r) {
+                  return l.first < r.first;
+              });
+
+    binary_writer writer;
+    for (const auto &node : nodes) {
+        marshall(writer, node.first, DSF_THRIFT_BINARY);
+        marshall(writer, node.second, DSF_THRIFT_BINARY);
+    }
+    blob body = writer.get_buffer();
+
+    snapshot_header header;
+    header.magic = snapshot_header::default_magic;
+    header.version = 1;
+    header.node_count = nodes.size();
+    header.body_size = body.length();
+    header.body_crc = utils::crc32_calc(body.data(), body.length(), 0);
+
+    std::string path = snapshot_path(gen);
+    std::string tmp_path = path + ".tmp";
+    bool succeed = false;
+    if (FILE *fd = fopen(tmp_path.c_str(), "wb")) {
+        succeed = fwrite(&header, sizeof(header), 1, fd) == 1 &&
+                  (body.length() == 0 || fwrite(body.data(), body.length(), 1, fd) == 1) &&
+                  fflush(fd) == 0 && fsync(fileno(fd)) == 0;
+        succeed = (fclose(fd) == 0) && succeed;
+    }
+    if (succeed) {
+        succeed = utils::filesystem::rename_path(tmp_path, path);
+    }
+
+    if (succeed) {
+        remove_obsolete_files(gen);
+        uint64_t size = sizeof(header) + body.length();
+        _snapshot_size->set(size);
+        _snapshot_duration_ms->set(dsn_now_ms() - start_ms);
+        ddebug("write snapshot %s succeed, node_count = %d, size = %" PRIu64
+               ", time_used = %" PRIu64 " ms",
+               path.c_str(),
+               (int)nodes.size(),
+               size,
+               dsn_now_ms() - start_ms);
+    } else {
+        // the logs are kept, and the next snapshot covers them
+        derror("write snapshot %s failed", path.c_str());
+        utils::filesystem::remove_path(tmp_path);
+    }
+
+    zauto_lock l(_log_lock);
+    _snapshotting = false;
+}
+
+void meta_state_service_simple::remove_obsolete_files(int64_t gen)
+{
+    std::vector<std::string> files;
+    utils::filesystem::get_subfiles(_work_dir, files, false);
+    for (const std::string &file : files) {
+        std::string name = utils::filesystem::get_file_name(file);
+        int64_t file_gen;
+        // a temporary snapshot is left if the meta server crashes while writing it
+        bool is_tmp_snapshot =
+            name.compare(0, SNAPSHOT_FILE_NAME.size(), SNAPSHOT_FILE_NAME) == 0 &&
+            name.size() > 4 && name.compare(name.size() - 4, 4, ".tmp") == 0;
+        if (is_tmp_snapshot || ((parse_generation(name, LOG_FILE_NAME, file_gen) ||
+                                 parse_generation(name, SNAPSHOT_FILE_NAME, file_gen)) &&
+                                file_gen < gen)) {
+            if (!utils::filesystem::remove_path(file)) {
+                dwarn("remove obsolete file %s failed", file.c_str());
+            }
+        }
+    }
+}
+
 std::shared_ptr<meta_state_service::transaction_entries>
 meta_state_service_simple::new_transaction_entries(unsigned int capacity)
 {
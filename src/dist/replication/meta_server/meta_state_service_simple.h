@@ -36,6 +36,7 @@
 #include <queue>
 #include <dsn/tool-api/zlocks.h>
 #include <dsn/dist/meta_state_service.h>
+#include <dsn/perf_counter/perf_counter_wrapper.h>
 #include "dist/replication/common/replication_common.h"
 
 namespace dsn {
@@ -43,7 +44,17 @@ namespace dist {
 DEFINE_TASK_CODE_AIO(LPC_META_STATE_SERVICE_SIMPLE_INTERNAL,
                      TASK_PRIORITY_HIGH,
                      THREAD_POOL_DEFAULT);
-
+DEFINE_TASK_CODE(LPC_META_STATE_SERVICE_SIMPLE_SNAPSHOT, TASK_PRIORITY_LOW, THREAD_POOL_DEFAULT);
+
+// all the operations are appended to the log before applied to the state tree in memory.
+//
+// the log is split into generations: "meta_state_service.log" is generation 0, and
+// "meta_state_service.log.{N}" is generation N. once the current generation grows beyond
+// [meta_server] meta_state_service_simple_snapshot_threshold_kb, a new generation is started, and
+// the state tree with all the operations of the previous generations applied is saved as
+// "meta_state_service.snapshot.{N}" in the background, after which the logs and snapshots of the
+// previous generations are removed.
+// on initialize, the latest snapshot is loaded and the logs from its generation on are replayed.
 class meta_state_service_simple : public meta_state_service
 {
 public:
@@ -52,7 +63,9 @@ public:
           _quick_map({std::make_pair("/", &_root)}),
           _log_lock(true),
           _log(nullptr),
-          _offset(0)
+          _offset(0),
+          _log_gen(0),
+          _snapshotting(false)
     {
     }
 
@@ -119,6 +132,16 @@ private:
         static const int default_magic = 0xdeadbeef;
         log_header() : magic(default_magic), size(0) {}
     };
+
+    struct snapshot_header
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t node_count;
+        uint64_t body_size;
+        uint32_t body_crc;
+        static const uint32_t default_magic = 0x534d5353; // "SSMS"
+    };
 #pragma pack(pop)
 
     struct state_node
@@ -245,6 +268,22 @@ private:
     void
     write_log(blob &&log_blob, std::function<error_code(void)> internal_operation, task_ptr task);
 
+    std::string log_path(int64_t gen) const;
+    std::string snapshot_path(int64_t gen) const;
+    // replay the operations in the log file, `valid_size` is the size of the complete entries.
+    // the operations which failed when they were executed are logged as well, so they fail again
+    // in replay, and are counted in `failed_count`
+    error_code replay_log(const std::string &path,
+                          /*out*/ uint64_t &valid_size,
+                          /*out*/ uint64_t &failed_count);
+    error_code load_snapshot(const std::string &path);
+    // start a new generation of log, and save the snapshot of the previous generations after
+    // all the operations of them are applied. user should hold _log_lock
+    void roll_log();
+    void write_snapshot(int64_t gen, std::vector<std::pair<std::string, blob>> &nodes);
+    // remove the logs and the snapshots of the generations before `gen`
+    void remove_obsolete_files(int64_t gen);
+
     error_code create_node_internal(const std::string &node, const blob &blob);
     error_code delete_node_internal(const std::string &node, bool recursive);
     error_code set_data_internal(const std::string &node, const blob &blob);
@@ -263,6 +302,13 @@ private:
     zlock _log_lock;
     disk_file *_log;
     uint64_t _offset;
+    int64_t _log_gen;
+    bool _snapshotting;
+    std::string _work_dir;
+
+    perf_counter_wrapper _snapshot_size;
+    perf_counter_wrapper _snapshot_duration_ms;
+    perf_counter_wrapper _replay_duration_ms;
 
     dsn::task_tracker _tracker;
 };
@@ -999,6 +999,8 @@ bool simple_load_balancer::construct_replica(meta_view view, const gpid &pid, in
 {
     partition_configuration &pc = *get_config(*view.apps, pid);
     config_context &cc = *get_config_context(*view.apps, pid);
+    // the queries read the configuration only under the lock of the app
+    zrwlock_nr &app_lock = view.apps->at(pid.get_app_id())->helpers->lock;
 
     dassert(replica_count(pc) == 0,
             "replica count of gpid(%d.%d) must be 0",
@@ -1020,6 +1022,7 @@ bool simple_load_balancer::construct_replica(meta_view view, const gpid &pid, in
     dassert(server.ballot != invalid_ballot,
             "the ballot of server must not be invalid_ballot, node = %s",
             server.node.to_string());
+    zauto_write_lock l(app_lock);
     pc.primary = server.node;
     pc.ballot = server.ballot;
     pc.partition_flags = 0;
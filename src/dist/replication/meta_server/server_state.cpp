@@ -39,6 +39,9 @@
 #include <dsn/tool-api/task.h>
 #include <dsn/tool-api/command_manager.h>
 #include <dsn/tool-api/async_calls.h>
+#include <dsn/utility/time_utils.h>
+#include <dsn/utility/defer.h>
+#include <dsn/utility/flags.h>
 #include <sstream>
 #include <cinttypes>
 #include <string>
@@ -54,11 +57,19 @@ using namespace dsn;
 namespace dsn {
 namespace replication {
 
+DSN_DEFINE_uint32("meta_server",
+                  max_inflight_partition_syncs,
+                  256,
+                  "max count of the partition nodes being read from remote storage concurrently "
+                  "when the meta server loads the apps");
+
 static const char *lock_state = "lock";
 static const char *unlock_state = "unlock";
 
 server_state::server_state()
     : _meta_svc(nullptr),
+      _config_epoch(0),
+      _config_version(0),
       _add_secondary_enable_flow_control(false),
       _add_secondary_max_count_for_one_node(0),
       _cli_dump_handle(nullptr),
@@ -192,6 +203,14 @@ void server_state::initialize(meta_service *meta_svc, const std::string &apps_ro
         "recent_partition_change_writable_count",
         COUNTER_TYPE_VOLATILE_NUMBER,
         "partition change to writable count in the recent period");
+    _global_lock_wait_ns.init_app_counter("eon.server_state",
+                                          "global_lock_wait_ns",
+                                          COUNTER_TYPE_NUMBER_PERCENTILES,
+                                          "time waiting for the global lock of server_state");
+    _app_lock_wait_ns.init_app_counter("eon.server_state",
+                                       "app_lock_wait_ns",
+                                       COUNTER_TYPE_NUMBER_PERCENTILES,
+                                       "time waiting for the lock of an app by the queries");
 }
 
 bool server_state::spin_wait_staging(int timeout_seconds)
@@ -239,18 +258,18 @@ void server_state::transition_staging_state(std::shared_ptr<app_state> &app)
 
     app_status::type old_status = app->status;
     if (app->status == app_status::AS_CREATING) {
-        app->status = app_status::AS_AVAILABLE;
+        set_app_status(*app, app_status::AS_AVAILABLE);
         configuration_create_app_response resp;
         resp.err = dsn::ERR_OK;
         resp.appid = app->app_id;
         send_response(_meta_svc, app->helpers->pending_response, resp);
     } else if (app->status == app_status::AS_DROPPING) {
-        app->status = app_status::AS_DROPPED;
+        set_app_status(*app, app_status::AS_DROPPED);
         configuration_drop_app_response resp;
         resp.err = dsn::ERR_OK;
         send_response(_meta_svc, app->helpers->pending_response, resp);
     } else if (app->status == app_status::AS_RECALLING) {
-        app->status = app_status::AS_AVAILABLE;
+        set_app_status(*app, app_status::AS_AVAILABLE);
         configuration_recall_app_response resp;
         resp.err = dsn::ERR_OK;
         resp.info = *app;
@@ -261,6 +280,7 @@ void server_state::transition_staging_state(std::shared_ptr<app_state> &app)
                 app->get_logname(),
                 enum_to_string(app->status));
     }
+    increase_app_config_version(*app);
 
     ddebug("app(%s) transfer from %s to %s",
            app->get_logname(),
@@ -558,13 +578,61 @@ dsn::error_code server_state::sync_apps_from_remote_storage()
     dsn::task_tracker tracker;
 
     dist::meta_state_service *storage = _meta_svc->get_remote_storage();
-    auto sync_partition = [this, storage, &err, &tracker](
+
+    // the partition nodes are read in parallel, with at most
+    // max_inflight_partition_syncs requests outstanding
+    struct partition_to_sync
+    {
+        std::shared_ptr<app_state> app;
+        int partition_id;
+        std::string partition_path;
+    };
+    zlock pending_lock;
+    std::deque<partition_to_sync> pending_partitions;
+    uint32_t inflight_partitions = 0;
+    std::function<void(partition_to_sync &&)> get_partition;
+
+    auto sync_next_partitions = [&]() {
+        for (;;) {
+            partition_to_sync p;
+            {
+                zauto_lock l(pending_lock);
+                if (pending_partitions.empty() ||
+                    inflight_partitions >= std::max(FLAGS_max_inflight_partition_syncs, 1u)) {
+                    return;
+                }
+                p = std::move(pending_partitions.front());
+                pending_partitions.pop_front();
+                ++inflight_partitions;
+            }
+            get_partition(std::move(p));
+        }
+    };
+
+    auto sync_partition = [&](
         std::shared_ptr<app_state> &app, int partition_id, const std::string &partition_path) {
+        {
+            zauto_lock l(pending_lock);
+            pending_partitions.push_back(partition_to_sync{app, partition_id, partition_path});
+        }
+        sync_next_partitions();
+    };
+
+    get_partition = [&](partition_to_sync &&p) {
+        std::shared_ptr<app_state> app = std::move(p.app);
+        int partition_id = p.partition_id;
+        std::string partition_path = std::move(p.partition_path);
         storage->get_data(
             partition_path,
             LPC_META_CALLBACK,
-            [this, app, partition_id, partition_path, &err](error_code ec,
-                                                            const blob &value) mutable {
+            [&, app, partition_id, partition_path](error_code ec, const blob &value) mutable {
+                auto release_inflight = dsn::defer([&]() {
+                    {
+                        zauto_lock l(pending_lock);
+                        --inflight_partitions;
+                    }
+                    sync_next_partitions();
+                });
                 if (ec == ERR_OK) {
                     partition_configuration pc;
                     dsn::json::json_forwarder<partition_configuration>::decode(value, pc);
@@ -716,6 +784,11 @@ void server_state::initialize_node_state()
 
 error_code server_state::initialize_data_structure()
 {
+    // the config versions of all the partitions are reset after loading the apps, so the versions
+    // synced by the replica servers before are meaningless
+    _config_epoch = static_cast<int64_t>(utils::get_current_physical_time_ns());
+    _config_version = 0;
+
     error_code err = sync_apps_from_remote_storage();
     if (err == ERR_OBJECT_NOT_FOUND) {
         if (_meta_svc->get_meta_options().recover_from_replica_server) {
@@ -758,12 +831,28 @@ void server_state::on_config_sync(configuration_query_by_node_rpc rpc)
 
     bool reject_this_request = false;
     response.__isset.gc_replicas = false;
-    ddebug("got config sync request from %s, stored_replicas_count(%d)",
+    ddebug("got config sync request from %s, stored_replicas_count(%d), config_version(%" PRId64
+           ")",
            request.node.to_string(),
-           (int)request.stored_replicas.size());
+           (int)request.stored_replicas.size(),
+           request.__isset.config_version ? request.config_version : -1);
 
     {
-        zauto_read_lock l(_lock);
+        zauto_read_lock l;
+        lock_read(l);
+
+        // only the partitions changed since the version the replica server synced last time are
+        // returned in delta mode, the others are listed in unchanged_partitions
+        bool is_delta = request.__isset.config_epoch && request.__isset.config_version &&
+                        request.config_epoch == _config_epoch &&
+                        request.config_version <= _config_version;
+        std::set<gpid> refresh_partitions;
+        if (is_delta && request.__isset.refresh_partitions) {
+            refresh_partitions.insert(request.refresh_partitions.begin(),
+                                      request.refresh_partitions.end());
+        }
+        response.__set_config_epoch(_config_epoch);
+        response.__set_config_version(_config_version);
 
         // sync the partitions to the replica server
         node_state *ns = get_node_state(_nodes, request.node, false);
@@ -772,8 +861,11 @@ void server_state::on_config_sync(configuration_query_by_node_rpc rpc)
             response.err = ERR_OBJECT_NOT_FOUND;
         } else {
             response.err = ERR_OK;
-            unsigned int i = 0;
-            response.partitions.resize(ns->partition_count());
+            if (is_delta) {
+                response.__isset.unchanged_partitions = true;
+            } else {
+                response.partitions.reserve(ns->partition_count());
+            }
             ns->for_each_partition([&, this](const gpid &pid) {
                 std::shared_ptr<app_state> app = get_app(pid.get_app_id());
                 dassert(app != nullptr, "invalid app_id, app_id = %d", pid.get_app_id());
@@ -784,19 +876,27 @@ void server_state::on_config_sync(configuration_query_by_node_rpc rpc)
                 // request
                 if (cc.stage == config_status::pending_remote_sync) {
                     configuration_update_request *req = cc.pending_sync_request.get();
-                    if (req->node == request.node)
+                    if (req->node == request.node) {
+                        reject_this_request = true;
                         return false;
+                    }
+                }
+
+                if (is_delta &&
+                    std::max(cc.config_version, app->helpers->config_version) <=
+                        request.config_version &&
+                    refresh_partitions.find(pid) == refresh_partitions.end()) {
+                    response.unchanged_partitions.push_back(pid);
+                    return true;
                 }
 
-                response.partitions[i].info = *app;
-                response.partitions[i].config = app->partitions[pid.get_partition_index()];
-                response.partitions[i].host_node = request.node;
-                ++i;
+                response.partitions.emplace_back();
+                configuration_update_request &update = response.partitions.back();
+                update.info = *app;
+                update.config = app->partitions[pid.get_partition_index()];
+                update.host_node = request.node;
                 return true;
             });
-            if (i < response.partitions.size()) {
-                reject_this_request = true;
-            }
         }
 
         // handle the stored replicas & the gc replicas
@@ -882,38 +982,47 @@ void server_state::on_config_sync(configuration_query_by_node_rpc rpc)
     if (reject_this_request) {
         response.err = ERR_BUSY;
         response.partitions.clear();
+        response.unchanged_partitions.clear();
     }
-    ddebug("send config sync response to %s, err(%s), partitions_count(%d), gc_replicas_count(%d)",
+    ddebug("send config sync response to %s, err(%s), partitions_count(%d), "
+           "unchanged_partitions_count(%d), gc_replicas_count(%d)",
            request.node.to_string(),
            response.err.to_string(),
            (int)response.partitions.size(),
+           (int)response.unchanged_partitions.size(),
            (int)response.gc_replicas.size());
 }
 
 bool server_state::query_configuration_by_gpid(dsn::gpid id,
                                                /*out*/ partition_configuration &config)
 {
-    zauto_read_lock l(_lock);
-    const partition_configuration *pc = get_config(_all_apps, id);
-    if (pc != nullptr) {
-        config = *pc;
-        return true;
+    std::shared_ptr<app_state> app = get_app_without_state_lock(id.get_app_id());
+    if (app == nullptr) {
+        return false;
     }
-    return false;
+
+    zauto_read_lock l;
+    lock_app_read(*app, l);
+    if (id.get_partition_index() < 0 || id.get_partition_index() >= app->partition_count) {
+        return false;
+    }
+    config = app->partitions[id.get_partition_index()];
+    return true;
 }
 
 void server_state::query_configuration_by_index(
     const configuration_query_by_index_request &request,
     /*out*/ configuration_query_by_index_response &response)
 {
-    zauto_read_lock l(_lock);
-    auto iter = _exist_apps.find(request.app_name.c_str());
-    if (iter == _exist_apps.end()) {
+    // only hold the lock of the app, see the lock order in server_state.h
+    std::shared_ptr<app_state> app = get_app_without_state_lock(request.app_name);
+    if (app == nullptr) {
         response.err = ERR_OBJECT_NOT_FOUND;
         return;
     }
 
-    std::shared_ptr<app_state> &app = iter->second;
+    zauto_read_lock l;
+    lock_app_read(*app, l);
     if (app->status != app_status::AS_AVAILABLE) {
         derror("invalid status(%s) in exist app(%s), app_id(%d)",
                enum_to_string(app->status),
@@ -1078,6 +1187,7 @@ void server_state::create_app(dsn::message_ex *msg)
             app->helpers->pending_response = msg;
             app->helpers->partitions_in_progress.store(info.partition_count);
 
+            zauto_write_lock apps_l(_apps_lock);
             _all_apps.emplace(app->app_id, app);
             _exist_apps.emplace(request.app_name, app);
         }
@@ -1096,7 +1206,10 @@ void server_state::do_app_drop(std::shared_ptr<app_state> &app)
     auto after_mark_app_dropped = [this, app](error_code ec) mutable {
         if (ERR_OK == ec) {
             zauto_write_lock l(_lock);
-            _exist_apps.erase(app->app_name);
+            {
+                zauto_write_lock apps_l(_apps_lock);
+                _exist_apps.erase(app->app_name);
+            }
             for (int i = 0; i < app->partition_count; ++i) {
                 drop_partition(app, i);
             }
@@ -1136,8 +1249,9 @@ void server_state::drop_app(dsn::message_ex *msg)
             switch (app->status) {
             case app_status::AS_AVAILABLE:
                 do_dropping = true;
-                app->status = app_status::AS_DROPPING;
+                set_app_status(*app, app_status::AS_DROPPING);
                 app->drop_second = dsn_now_ms() / 1000;
+                increase_app_config_version(*app);
                 if (request.options.__isset.reserve_seconds &&
                     request.options.reserve_seconds > 0) {
                     app->expire_second = app->drop_second + request.options.reserve_seconds;
@@ -1222,14 +1336,19 @@ void server_state::recall_app(dsn::message_ex *msg)
                     response.err = ERR_INVALID_PARAMETERS;
                 } else {
                     do_recalling = true;
-                    target_app->app_name = new_app_name;
-                    target_app->status = app_status::AS_RECALLING;
+                    {
+                        zauto_write_lock app_l(target_app->helpers->lock);
+                        target_app->app_name = new_app_name;
+                        target_app->status = app_status::AS_RECALLING;
+                    }
+                    increase_app_config_version(*target_app);
                     dassert(target_app->helpers->partitions_in_progress.load() == 0,
                             "partition_in_progress_cnt = %d",
                             target_app->helpers->partitions_in_progress.load());
                     target_app->helpers->partitions_in_progress.store(target_app->partition_count);
                     target_app->helpers->pending_response = msg;
 
+                    zauto_write_lock apps_l(_apps_lock);
                     _exist_apps.emplace(target_app->app_name, target_app);
                 }
             }
@@ -1248,7 +1367,8 @@ void server_state::list_apps(const configuration_list_apps_request &request,
                              configuration_list_apps_response &response)
 {
     dinfo("list app request, status(%d)", request.status);
-    zauto_read_lock l(_lock);
+    zauto_read_lock l;
+    lock_read(l);
     for (auto &kv : _all_apps) {
         app_state &app = *(kv.second);
         if (request.status == app_status::AS_INVALID || request.status == app.status) {
@@ -1454,7 +1574,11 @@ void server_state::update_configuration_locally(
     // we assume config in config_request stores the proper new config
     // as we sync to remote storage according to it
     std::string old_config_str = boost::lexical_cast<std::string>(old_cfg);
-    old_cfg = config_request->config;
+    {
+        zauto_write_lock app_l(app.helpers->lock);
+        old_cfg = config_request->config;
+    }
+    increase_partition_config_version(app, gpid.get_partition_index());
     auto find_name = _config_type_VALUES_TO_NAMES.find(config_request->type);
     if (find_name != _config_type_VALUES_TO_NAMES.end()) {
         ddebug("meta update config ok: type(%s), old_config=%s, %s",
@@ -1523,7 +1647,8 @@ task_ptr server_state::update_configuration_on_remote(
 void server_state::on_update_configuration_on_remote_reply(
     error_code ec, std::shared_ptr<configuration_update_request> &config_request)
 {
-    zauto_write_lock l(_lock);
+    zauto_write_lock l;
+    lock_write(l);
     dsn::gpid &gpid = config_request->config.pid;
     std::shared_ptr<app_state> app = get_app(gpid.get_app_id());
     config_context &cc = app->helpers->contexts[gpid.get_partition_index()];
@@ -1584,7 +1709,11 @@ void server_state::recall_partition(std::shared_ptr<app_state> &app, int pidx)
     auto on_recall_partition = [this, app, pidx](dsn::error_code error) mutable {
         if (error == dsn::ERR_OK) {
             zauto_write_lock l(_lock);
-            app->partitions[pidx].partition_flags &= (~pc_flags::dropped);
+            {
+                zauto_write_lock app_l(app->helpers->lock);
+                app->partitions[pidx].partition_flags &= (~pc_flags::dropped);
+            }
+            increase_partition_config_version(*app, pidx);
             process_one_partition(app);
         } else if (error == dsn::ERR_TIMEOUT) {
             tasking::enqueue(LPC_META_STATE_HIGH,
@@ -1600,7 +1729,10 @@ void server_state::recall_partition(std::shared_ptr<app_state> &app, int pidx)
     partition_configuration &pc = app->partitions[pidx];
     dassert((pc.partition_flags & pc_flags::dropped), "");
 
-    pc.partition_flags = 0;
+    {
+        zauto_write_lock app_l(app->helpers->lock);
+        pc.partition_flags = 0;
+    }
     blob json_partition = dsn::json::json_forwarder<partition_configuration>::encode(pc);
     std::string partition_path = get_partition_path(pc.pid);
     _meta_svc->get_remote_storage()->set_data(
@@ -1768,7 +1900,8 @@ void server_state::downgrade_stateless_nodes(std::shared_ptr<app_state> &app,
 void server_state::on_update_configuration(
     std::shared_ptr<configuration_update_request> &cfg_request, dsn::message_ex *msg)
 {
-    zauto_write_lock l(_lock);
+    zauto_write_lock l;
+    lock_write(l);
     dsn::gpid &gpid = cfg_request->config.pid;
     std::shared_ptr<app_state> app = get_app(gpid.get_app_id());
     partition_configuration &pc = app->partitions[gpid.get_partition_index()];
@@ -1934,7 +2067,10 @@ server_state::construct_apps(const std::vector<query_app_info_response> &query_a
                        replica_nodes[i].to_string(),
                        info.app_id,
                        boost::lexical_cast<std::string>(info).c_str());
-                _all_apps.emplace(app->app_id, app);
+                {
+                    zauto_write_lock apps_l(_apps_lock);
+                    _all_apps.emplace(app->app_id, app);
+                }
                 max_app_id = std::max(app->app_id, max_app_id);
             } else {
                 app_info *old_info = iter->second.get();
@@ -1970,8 +2106,10 @@ server_state::construct_apps(const std::vector<query_app_info_response> &query_a
             dropped_holder.status = app_status::AS_DROPPING;
             dropped_holder.expire_second = dsn_now_ms() / 1000;
 
+            zauto_write_lock apps_l(_apps_lock);
             _all_apps.emplace(app_id, app_state::create(dropped_holder));
         } else {
+            zauto_write_lock app_l(iter->second->helpers->lock);
             app_info *app_info = iter->second.get();
             app_info->status = (app_status::AS_AVAILABLE == app_info->status)
                                    ? app_status::AS_CREATING
@@ -1986,6 +2124,7 @@ server_state::construct_apps(const std::vector<query_app_info_response> &query_a
         std::shared_ptr<app_state> &app = _all_apps[app_id];
         std::string old_name = app->app_name;
         while (checked_names.find(app->app_name) != checked_names.end()) {
+            zauto_write_lock app_l(app->helpers->lock);
             app->app_name = app->app_name + "__" + boost::lexical_cast<std::string>(app_id);
         }
         if (app->app_name != old_name) {
@@ -2306,7 +2445,8 @@ bool server_state::check_all_partitions()
     int total_partitions = 0;
     meta_function_level::type level = _meta_svc->get_function_level();
 
-    zauto_write_lock l(_lock);
+    zauto_write_lock l;
+    lock_write(l);
 
     update_partition_perf_counter();
 
@@ -2546,16 +2686,42 @@ void server_state::check_consistency(const dsn::gpid &gpid)
 
 void server_state::lock_read(zauto_read_lock &other)
 {
+    uint64_t start = dsn_now_ns();
     zauto_read_lock l(_lock);
+    _global_lock_wait_ns->set(dsn_now_ns() - start);
     l.swap(other);
 }
 
 void server_state::lock_write(zauto_write_lock &other)
 {
+    uint64_t start = dsn_now_ns();
     zauto_write_lock l(_lock);
+    _global_lock_wait_ns->set(dsn_now_ns() - start);
+    l.swap(other);
+}
+
+void server_state::lock_app_read(const app_state &app, zauto_read_lock &other) const
+{
+    uint64_t start = dsn_now_ns();
+    zauto_read_lock l(app.helpers->lock);
+    _app_lock_wait_ns->set(dsn_now_ns() - start);
     l.swap(other);
 }
 
+std::shared_ptr<app_state> server_state::get_app_without_state_lock(const std::string &name) const
+{
+    zauto_read_lock l(_apps_lock);
+    auto iter = _exist_apps.find(name);
+    return iter == _exist_apps.end() ? nullptr : iter->second;
+}
+
+std::shared_ptr<app_state> server_state::get_app_without_state_lock(int32_t app_id) const
+{
+    zauto_read_lock l(_apps_lock);
+    auto iter = _all_apps.find(app_id);
+    return iter == _all_apps.end() ? nullptr : iter->second;
+}
+
 void server_state::do_update_app_info(const std::string &app_path,
                                       const app_info &info,
                                       const std::function<void(error_code ec)> &cb)
@@ -2644,6 +2810,7 @@ void server_state::set_app_envs(const app_env_rpc &env_rpc)
         for (int idx = 0; idx < keys.size(); idx++) {
             app->envs[keys[idx]] = values[idx];
         }
+        increase_app_config_version(*app);
         std::string new_envs = dsn::utils::kv_map_to_string(app->envs, ',', '=');
         ddebug("app envs changed: old_envs = {%s}, new_envs = {%s}",
                old_envs.c_str(),
@@ -2717,6 +2884,7 @@ void server_state::del_app_envs(const app_env_rpc &env_rpc)
         for (const auto &key : keys) {
             app->envs.erase(key);
         }
+        increase_app_config_version(*app);
         std::string new_envs = dsn::utils::kv_map_to_string(app->envs, ',', '=');
         ddebug("app envs changed: old_envs = {%s}, new_envs = {%s}",
                old_envs.c_str(),
@@ -2815,6 +2983,7 @@ void server_state::clear_app_envs(const app_env_rpc &env_rpc)
                     app->envs.erase(key);
                 }
             }
+            increase_app_config_version(*app);
             std::string new_envs = dsn::utils::kv_map_to_string(app->envs, ',', '=');
             ddebug("app envs changed: old_envs = {%s}, new_envs = {%s}",
                    old_envs.c_str(),
@@ -120,6 +120,7 @@ public:
     error_code initialize_data_structure();
     void register_cli_commands();
 
+    // acquire the global lock and record the time waiting for it
     void lock_read(zauto_read_lock &other);
     void lock_write(zauto_write_lock &other);
     const meta_view get_meta_view() { return {&_all_apps, &_nodes}; }
@@ -137,6 +138,9 @@ public:
             return nullptr;
         return iter->second;
     }
+    // could be called without holding _lock
+    std::shared_ptr<app_state> get_app_without_state_lock(const std::string &name) const;
+    std::shared_ptr<app_state> get_app_without_state_lock(int32_t app_id) const;
 
     void query_configuration_by_index(const configuration_query_by_index_request &request,
                                       /*out*/ configuration_query_by_index_response &response);
@@ -292,11 +296,32 @@ private:
     void process_one_partition(std::shared_ptr<app_state> &app);
     void transition_staging_state(std::shared_ptr<app_state> &app);
 
+    // the config version is increased whenever the configuration of a partition or the info of an
+    // app is changed, with which the replica servers could sync only the changed partitions.
+    // user should hold the write lock of _lock.
+    void increase_partition_config_version(app_state &app, int pidx)
+    {
+        app.helpers->contexts[pidx].config_version = ++_config_version;
+    }
+    void increase_app_config_version(app_state &app)
+    {
+        app.helpers->config_version = ++_config_version;
+    }
+    // acquire the lock of the app and record the time waiting for it
+    void lock_app_read(const app_state &app, zauto_read_lock &other) const;
+    // user should hold the write lock of _lock
+    void set_app_status(app_state &app, app_status::type status)
+    {
+        zauto_write_lock l(app.helpers->lock);
+        app.status = status;
+    }
+
 private:
     friend class replication_checker;
     friend class test::test_checker;
     friend class meta_service_test_app;
     friend class meta_test_base;
+    friend class meta_state_load_test;
     friend class meta_duplication_service_test;
     friend class meta_load_balance_test;
     friend class meta_duplication_service;
@@ -309,9 +334,26 @@ private:
     meta_service *_meta_svc;
     std::string _apps_root;
 
+    // lock order: _lock -> _apps_lock -> app_state_helper::lock
+    //
+    // _lock protects all the states of server_state, and all the writers hold its write lock.
+    // the queries of the configurations of a single app, which are the most frequent requests
+    // to the meta server, don't hold _lock so that they are not blocked by the updates of other
+    // apps and the balancer:
+    //   - _apps_lock protects the membership of _exist_apps & _all_apps, the writers hold it
+    //     together with the write lock of _lock when adding or removing apps.
+    //   - app_state_helper::lock protects the app info and the partition configurations of an
+    //     app, the writers hold it together with the write lock of _lock when changing them.
+    // a query holds _apps_lock and the lock of the app one after another, never both.
     mutable zrwlock_nr _lock;
+    mutable zrwlock_nr _apps_lock;
     node_mapper _nodes;
 
+    // the versions of configurations are only comparable in the same epoch, which is renewed
+    // every time the meta server is started or becomes the leader
+    int64_t _config_epoch;
+    int64_t _config_version;
+
     // available apps, dropping apps, creating apps: name -> app_state
     std::map<std::string, std::shared_ptr<app_state>> _exist_apps;
     //_exist_apps + dropped apps: app_id -> app_state
@@ -338,6 +380,8 @@ private:
     perf_counter_wrapper _recent_update_config_count;
     perf_counter_wrapper _recent_partition_change_unwritable_count;
     perf_counter_wrapper _recent_partition_change_writable_count;
+    perf_counter_wrapper _global_lock_wait_ns;
+    perf_counter_wrapper _app_lock_wait_ns;
 };
 
 } // namespace replication
@@ -127,6 +127,7 @@ std::pair<dsn::error_code, std::shared_ptr<app_state>> server_state::restore_app
             app->helpers->pending_response = msg;
             app->helpers->partitions_in_progress.store(info.partition_count);
 
+            zauto_write_lock apps_l(_apps_lock);
             _all_apps.emplace(app->app_id, app);
             _exist_apps.emplace(info.app_name, app);
         }
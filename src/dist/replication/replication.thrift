@@ -246,11 +246,21 @@ struct replica_server_info
     2:i64 total_capacity_mb;
 }
 
+// delta config sync:
+// a node which has synced with meta server sends the config_epoch and config_version of the last
+// response, and meta server replies only the partitions changed after config_version, along with
+// the unchanged_partitions which are still served by the node. meta server replies all the
+// partitions if config_epoch doesn't match, e.g. meta server has been restarted or switched.
+// the fields are optional so that an old node or an old meta server just works in full sync.
 struct configuration_query_by_node_request
 {
     1:dsn.rpc_address  node;
     2:optional list<replica_info> stored_replicas;
     3:optional replica_server_info info;
+    4:optional i64 config_epoch;
+    5:optional i64 config_version;
+    // the node needs the configurations of these partitions even if they are unchanged
+    6:optional list<dsn.gpid> refresh_partitions;
 }
 
 struct configuration_query_by_node_response
@@ -258,6 +268,10 @@ struct configuration_query_by_node_response
     1:dsn.error_code err;
     2:list<configuration_update_request> partitions;
     3:optional list<replica_info> gc_replicas;
+    4:optional i64 config_epoch;
+    5:optional i64 config_version;
+    // only set in a delta response
+    6:optional list<dsn.gpid> unchanged_partitions;
 }
 
 struct create_app_options
@@ -0,0 +1,111 @@
+// Copyright (c) 2019, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#include <gtest/gtest.h>
+
+#include "meta_test_base.h"
+
+namespace dsn {
+namespace replication {
+
+class meta_config_sync_test : public meta_test_base
+{
+public:
+    void SetUp() override
+    {
+        meta_test_base::SetUp();
+        create_app(APP_NAME, PARTITION_COUNT);
+        auto app = find_app(APP_NAME);
+
+        node_state ns;
+        for (int i = 0; i < PARTITION_COUNT; ++i) {
+            ns.put_partition(gpid(app->app_id, i), true);
+        }
+        mock_node_state(NODE, ns);
+    }
+
+    void TearDown() override { drop_app(APP_NAME); }
+
+    configuration_query_by_node_response
+    config_sync(const configuration_query_by_node_response *last = nullptr,
+                const std::vector<gpid> &refresh_partitions = {})
+    {
+        auto request = make_unique<configuration_query_by_node_request>();
+        request->node = NODE;
+        if (last != nullptr) {
+            request->__set_config_epoch(last->config_epoch);
+            request->__set_config_version(last->config_version);
+            request->__set_refresh_partitions(refresh_partitions);
+        }
+
+        configuration_query_by_node_rpc rpc(std::move(request), RPC_CM_CONFIG_SYNC);
+        _ss->on_config_sync(rpc);
+        return rpc.response();
+    }
+
+public:
+    const std::string APP_NAME = "config_sync_test";
+    const int PARTITION_COUNT = 4;
+    const rpc_address NODE = rpc_address("127.0.0.1", 10086);
+};
+
+TEST_F(meta_config_sync_test, full_and_delta)
+{
+    // all the partitions are returned without the version synced last time
+    auto resp = config_sync();
+    ASSERT_EQ(ERR_OK, resp.err);
+    ASSERT_EQ(PARTITION_COUNT, resp.partitions.size());
+    ASSERT_FALSE(resp.__isset.unchanged_partitions);
+    ASSERT_TRUE(resp.__isset.config_version);
+
+    // nothing changed
+    auto delta = config_sync(&resp);
+    ASSERT_EQ(ERR_OK, delta.err);
+    ASSERT_TRUE(delta.partitions.empty());
+    ASSERT_TRUE(delta.__isset.unchanged_partitions);
+    ASSERT_EQ(PARTITION_COUNT, delta.unchanged_partitions.size());
+    ASSERT_EQ(resp.config_version, delta.config_version);
+
+    // the partitions asked explicitly are always returned
+    auto app = find_app(APP_NAME);
+    delta = config_sync(&resp, {gpid(app->app_id, 1)});
+    ASSERT_EQ(1, delta.partitions.size());
+    ASSERT_EQ(gpid(app->app_id, 1), delta.partitions[0].config.pid);
+    ASSERT_EQ(PARTITION_COUNT - 1, delta.unchanged_partitions.size());
+
+    // the change of app info is synced with all the partitions of the app
+    ASSERT_EQ(ERR_OK, update_app_envs(APP_NAME, {"test.key"}, {"test.value"}).err);
+    delta = config_sync(&resp);
+    ASSERT_EQ(PARTITION_COUNT, delta.partitions.size());
+    ASSERT_TRUE(delta.unchanged_partitions.empty());
+    ASSERT_LT(resp.config_version, delta.config_version);
+    ASSERT_EQ("test.value", delta.partitions[0].info.envs["test.key"]);
+
+    delta = config_sync(&delta);
+    ASSERT_TRUE(delta.partitions.empty());
+    ASSERT_EQ(PARTITION_COUNT, delta.unchanged_partitions.size());
+}
+
+TEST_F(meta_config_sync_test, fallback_to_full)
+{
+    auto resp = config_sync();
+    ASSERT_EQ(ERR_OK, resp.err);
+
+    // the versions synced from another meta server are not comparable
+    configuration_query_by_node_response stale = resp;
+    stale.config_epoch = resp.config_epoch + 1;
+    auto full = config_sync(&stale);
+    ASSERT_EQ(PARTITION_COUNT, full.partitions.size());
+    ASSERT_FALSE(full.__isset.unchanged_partitions);
+    ASSERT_EQ(resp.config_epoch, full.config_epoch);
+
+    stale = resp;
+    stale.config_version = resp.config_version + 1;
+    full = config_sync(&stale);
+    ASSERT_EQ(PARTITION_COUNT, full.partitions.size());
+    ASSERT_FALSE(full.__isset.unchanged_partitions);
+}
+
+} // namespace replication
+} // namespace dsn
@@ -0,0 +1,68 @@
+// Copyright (c) 2019, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#include <dsn/utility/flags.h>
+#include <gtest/gtest.h>
+
+#include "meta_test_base.h"
+
+namespace dsn {
+namespace replication {
+
+DSN_DECLARE_uint32(max_inflight_partition_syncs);
+
+class meta_state_load_test : public meta_test_base
+{
+public:
+    void SetUp() override
+    {
+        meta_test_base::SetUp();
+        create_app(APP_NAME, PARTITION_COUNT);
+        create_app(OTHER_APP_NAME, PARTITION_COUNT);
+        _old_max_inflight = FLAGS_max_inflight_partition_syncs;
+    }
+
+    void TearDown() override
+    {
+        FLAGS_max_inflight_partition_syncs = _old_max_inflight;
+        drop_app(APP_NAME);
+        drop_app(OTHER_APP_NAME);
+    }
+
+    // load the apps from remote storage into a new server_state
+    std::shared_ptr<server_state> load_apps()
+    {
+        auto ss = std::make_shared<server_state>();
+        ss->initialize(_ms.get(), _ms->_cluster_root + "/apps");
+        EXPECT_EQ(ERR_OK, ss->sync_apps_from_remote_storage());
+        return ss;
+    }
+
+public:
+    const std::string APP_NAME = "state_load_test";
+    const std::string OTHER_APP_NAME = "state_load_test_other";
+    const int PARTITION_COUNT = 16;
+    uint32_t _old_max_inflight;
+};
+
+TEST_F(meta_state_load_test, bounded_partition_syncs)
+{
+    for (uint32_t max_inflight : {1, 3, 1024}) {
+        FLAGS_max_inflight_partition_syncs = max_inflight;
+        auto ss = load_apps();
+        for (const std::string &name : {APP_NAME, OTHER_APP_NAME}) {
+            auto expected = find_app(name);
+            auto app = ss->get_app(name);
+            ASSERT_NE(nullptr, app);
+            ASSERT_EQ(PARTITION_COUNT, app->partitions.size());
+            for (int i = 0; i < PARTITION_COUNT; ++i) {
+                ASSERT_EQ(expected->partitions[i].pid, app->partitions[i].pid);
+                ASSERT_EQ(expected->partitions[i].ballot, app->partitions[i].ballot);
+            }
+        }
+    }
+}
+
+} // namespace replication
+} // namespace dsn
@@ -0,0 +1,87 @@
+// Copyright (c) 2019, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#include <chrono>
+#include <future>
+
+#include <gtest/gtest.h>
+
+#include "meta_test_base.h"
+
+namespace dsn {
+namespace replication {
+
+class meta_state_lock_test : public meta_test_base
+{
+public:
+    void SetUp() override
+    {
+        meta_test_base::SetUp();
+        create_app(APP_NAME, PARTITION_COUNT);
+        create_app(OTHER_APP_NAME, PARTITION_COUNT);
+    }
+
+    void TearDown() override
+    {
+        drop_app(APP_NAME);
+        drop_app(OTHER_APP_NAME);
+    }
+
+    // query the configurations of the app in another thread
+    std::future<bool> async_query(const std::string &app_name)
+    {
+        return std::async(std::launch::async, [this, app_name]() {
+            configuration_query_by_index_request request;
+            configuration_query_by_index_response response;
+            request.app_name = app_name;
+            _ss->query_configuration_by_index(request, response);
+            if (response.err != ERR_OK || response.partitions.size() != PARTITION_COUNT) {
+                return false;
+            }
+
+            partition_configuration config;
+            return _ss->query_configuration_by_gpid(gpid(response.app_id, 1), config) &&
+                   config.pid == gpid(response.app_id, 1);
+        });
+    }
+
+public:
+    const std::string APP_NAME = "state_lock_test";
+    const std::string OTHER_APP_NAME = "state_lock_test_other";
+    const int PARTITION_COUNT = 4;
+};
+
+TEST_F(meta_state_lock_test, query_without_global_lock)
+{
+    std::future<bool> query;
+    zauto_write_lock l;
+    _ss->lock_write(l);
+
+    // the queries of configurations are served while the global lock is held by a writer
+    query = async_query(APP_NAME);
+    ASSERT_EQ(std::future_status::ready, query.wait_for(std::chrono::seconds(10)));
+    ASSERT_TRUE(query.get());
+}
+
+TEST_F(meta_state_lock_test, query_blocked_by_app_lock)
+{
+    auto app = find_app(APP_NAME);
+    std::future<bool> query;
+    {
+        zauto_write_lock l(app->helpers->lock);
+        query = async_query(APP_NAME);
+
+        // the updates of an app don't block the queries of other apps
+        auto other_query = async_query(OTHER_APP_NAME);
+        ASSERT_EQ(std::future_status::ready, other_query.wait_for(std::chrono::seconds(10)));
+        ASSERT_TRUE(other_query.get());
+
+        ASSERT_EQ(std::future_status::timeout, query.wait_for(std::chrono::milliseconds(100)));
+    }
+    ASSERT_EQ(std::future_status::ready, query.wait_for(std::chrono::seconds(10)));
+    ASSERT_TRUE(query.get());
+}
+
+} // namespace replication
+} // namespace dsn
@@ -3,12 +3,15 @@
 // can be found in the LICENSE file in the root directory of this source tree.
 
 #include <gtest/gtest.h>
+#include <dsn/utility/flags.h>
 
 #include "replica_test_base.h"
 
 namespace dsn {
 namespace replication {
 
+DSN_DECLARE_uint32(plog_index_interval_kb);
+
 class log_file_test : public replica_test_base
 {
 public:
@@ -69,5 +72,94 @@ TEST_F(log_file_test, commit_log_blocks)
     ASSERT_EQ(tsk->get_aio_context()->file_offset, appender->start_offset() - _start_offset);
 }
 
+TEST_F(log_file_test, seek_to_decree)
+{
+    uint32_t old_interval = FLAGS_plog_index_interval_kb;
+    FLAGS_plog_index_interval_kb = 16;
+    _logf->enable_index(0);
+
+    // file header
+    binary_writer writer;
+    replica_log_info_map init_max_decrees;
+    init_max_decrees[get_gpid()] = replica_log_info(0, _start_offset);
+    _logf->write_file_header(writer, init_max_decrees);
+    log_block header_block;
+    header_block.add(writer.get_buffer());
+    int64_t offset = _start_offset + header_block.size();
+    _logf->commit_log_block(
+             header_block, _start_offset, LPC_WRITE_REPLICATION_LOG_PRIVATE, nullptr, nullptr, 0)
+        ->wait();
+
+    // 100 batches of 10 mutations
+    decree d = 1;
+    for (int i = 0; i < 100; i++) {
+        log_appender appender(offset);
+        for (int j = 0; j < 10; j++) {
+            appender.append_mutation(create_test_mutation(d++, std::string(1024, 'a')), nullptr);
+        }
+        _logf->commit_log_blocks(
+                 appender, LPC_WRITE_REPLICATION_LOG_PRIVATE, nullptr, nullptr, 0)
+            ->wait();
+        offset += appender.size();
+    }
+    _logf->close();
+    std::string index_path = log_file_index::index_path(_logf->path());
+    ASSERT_TRUE(utils::filesystem::file_exists(index_path));
+
+    auto read_from_decree = [this](decree start_decree, size_t &start_offset) {
+        error_code err;
+        log_file_ptr lf = log_file::open_read(_logf->path().c_str(), err, true);
+        EXPECT_EQ(err, ERR_OK);
+        start_offset = lf->seek_to_decree(start_decree);
+
+        std::vector<decree> decrees;
+        size_t local_offset = start_offset;
+        int64_t end_offset;
+        while (true) {
+            error_s es = mutation_log::replay_block(lf,
+                                                    [&decrees](int, mutation_ptr &mu) -> bool {
+                                                        decrees.push_back(mu->get_decree());
+                                                        return true;
+                                                    },
+                                                    local_offset,
+                                                    end_offset);
+            if (!es.is_ok()) {
+                EXPECT_EQ(es.code(), ERR_HANDLE_EOF);
+                break;
+            }
+            local_offset = static_cast<size_t>(end_offset - lf->start_offset());
+        }
+        return decrees;
+    };
+
+    for (decree start_decree : {1, 500, 1000}) {
+        size_t start_offset = 0;
+        std::vector<decree> decrees = read_from_decree(start_decree, start_offset);
+        ASSERT_FALSE(decrees.empty());
+        ASSERT_LE(decrees.front(), start_decree);
+        ASSERT_EQ(decrees.back(), 1000);
+        ASSERT_EQ(decrees.size(), static_cast<size_t>(1000 - decrees.front() + 1));
+        if (start_decree == 1) {
+            ASSERT_EQ(start_offset, 0);
+        } else {
+            // the blocks in front are skipped
+            ASSERT_GT(start_offset, 0);
+            ASSERT_GT(decrees.front(), 1);
+        }
+    }
+
+    // the index is rebuilt if it's missing
+    size_t start_offset_with_index = 0;
+    read_from_decree(500, start_offset_with_index);
+    ASSERT_TRUE(utils::filesystem::remove_path(index_path));
+    size_t start_offset_rebuilt = 0;
+    std::vector<decree> decrees = read_from_decree(500, start_offset_rebuilt);
+    ASSERT_EQ(start_offset_with_index, start_offset_rebuilt);
+    ASSERT_LE(decrees.front(), 500);
+    ASSERT_TRUE(utils::filesystem::file_exists(index_path));
+
+    FLAGS_plog_index_interval_kb = old_interval;
+}
+
 } // namespace replication
 } // namespace dsn
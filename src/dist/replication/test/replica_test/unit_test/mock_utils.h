@@ -258,6 +258,25 @@ public:
 
     void set_log(mutation_log_ptr log) { _log = log; }
 
+    // records the replicas to open and marks them as under opening, without opening them
+    ::dsn::task_ptr begin_open_replica(const app_info &app,
+                                       gpid id,
+                                       std::shared_ptr<group_check_request> req,
+                                       std::shared_ptr<configuration_update_request> req2) override
+    {
+        if (!mock_open_replica) {
+            return replica_stub::begin_open_replica(app, id, req, req2);
+        }
+        zauto_write_lock l(_replicas_lock);
+        _opening_replicas[id] = nullptr;
+        _closed_replicas.erase(id);
+        begin_open_replicas.emplace_back(id, app);
+        return nullptr;
+    }
+
+    bool mock_open_replica = false;
+    std::vector<std::pair<gpid, app_info>> begin_open_replicas;
+
     int32_t get_bulk_load_downloading_count() const { return _bulk_load_downloading_count.load(); }
     void set_bulk_load_downloading_count(int32_t count)
     {
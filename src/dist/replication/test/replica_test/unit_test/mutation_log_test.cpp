@@ -27,6 +27,9 @@
 #include "dist/replication/lib/mutation_log.h"
 #include "dist/replication/test/replica_test/unit_test/replica_test_base.h"
 
+#include <chrono>
+#include <thread>
+
 #include <dsn/utility/filesystem.h>
 #include <gtest/gtest.h>
 
@@ -495,5 +498,199 @@ TEST_F(mutation_log_test, replay_start_decree)
     ASSERT_EQ(mlog->get_log_file_map().size(), 3);
 }
 
+TEST_F(mutation_log_test, shared_log_group_commit)
+{
+    std::vector<mutation_ptr> mutations;
+    std::atomic<int> callback_count(0);
+    dsn::task_tracker tracker;
+
+    { // writing logs with force flush, lingering at most 10ms for 64 mutations
+        mutation_log_ptr mlog = new mutation_log_shared(_log_dir, 4, true, nullptr, 0, 64, 10);
+        ASSERT_EQ(ERR_OK, mlog->open(nullptr, nullptr));
+        mlog->on_partition_reset(get_gpid(), 0);
+
+        for (int i = 0; i < 1000; i++) {
+            mutation_ptr mu = create_test_mutation("hello!", 2 + i);
+            mutations.push_back(mu);
+            mlog->append(mu,
+                         LPC_AIO_IMMEDIATE_CALLBACK,
+                         &tracker,
+                         [&callback_count](error_code err, size_t) {
+                             EXPECT_EQ(ERR_OK, err);
+                             ++callback_count;
+                         },
+                         0);
+        }
+        mlog->flush();
+        tracker.wait_outstanding_tasks();
+        ASSERT_EQ(1000, callback_count.load());
+        mlog->close();
+    }
+
+    { // reading logs
+        mutation_log_ptr mlog = new mutation_log_shared(_log_dir, 4, false);
+        // the replica should be registered before replaying
+        mlog->set_valid_start_offset_on_open(get_gpid(), 0);
+
+        int mutation_index = -1;
+        mlog->open(
+            [&mutations, &mutation_index](int log_length, mutation_ptr &mu) -> bool {
+                mutation_ptr wmu = mutations[++mutation_index];
+                EXPECT_EQ(wmu->data.header, mu->data.header);
+                ASSERT_BLOB_EQ(wmu->data.updates[0].data, mu->data.updates[0].data);
+                return true;
+            },
+            nullptr);
+        ASSERT_EQ(mutation_index + 1, (int)mutations.size());
+
+        // each batch is written as one log block, and no block contains more than 64 mutations
+        int block_count = 0;
+        for (auto &kv : mlog->get_log_file_map()) {
+            log_file_ptr lf = kv.second;
+            size_t offset = 0;
+            int64_t end_offset;
+            while (true) {
+                int block_mutation_count = 0;
+                error_s es = mutation_log::replay_block(
+                    lf,
+                    [&block_mutation_count](int, mutation_ptr &) -> bool {
+                        ++block_mutation_count;
+                        return true;
+                    },
+                    offset,
+                    end_offset);
+                if (!es.is_ok()) {
+                    ASSERT_EQ(ERR_HANDLE_EOF, es.code());
+                    break;
+                }
+                ASSERT_LE(block_mutation_count, 64);
+                ++block_count;
+                offset = static_cast<size_t>(end_offset - lf->start_offset());
+            }
+        }
+        ASSERT_GE(block_count, 1000 / 64);
+        mlog->close();
+    }
+}
+
+TEST_F(mutation_log_test, shared_log_group_commit_linger)
+{
+    const uint64_t linger_ms = 10;
+    std::atomic<uint64_t> callback_ts_ms(0);
+    dsn::task_tracker tracker;
+
+    mutation_log_ptr mlog = new mutation_log_shared(_log_dir, 4, true, nullptr, 0, 64, linger_ms);
+    ASSERT_EQ(ERR_OK, mlog->open(nullptr, nullptr));
+    mlog->on_partition_reset(get_gpid(), 0);
+
+    // a single mutation doesn't fill the batch, so it's written once it lingers for 10ms,
+    // without anyone flushing the log
+    uint64_t start_ts_ms = dsn_now_ms();
+    mutation_ptr mu = create_test_mutation("hello!", 2);
+    mlog->append(mu,
+                 LPC_AIO_IMMEDIATE_CALLBACK,
+                 &tracker,
+                 [&callback_ts_ms](error_code err, size_t) {
+                     EXPECT_EQ(ERR_OK, err);
+                     callback_ts_ms.store(dsn_now_ms());
+                 },
+                 0);
+    for (int i = 0; i < 1000 && callback_ts_ms.load() == 0; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ASSERT_NE(0, callback_ts_ms.load());
+    ASSERT_GE(callback_ts_ms.load() - start_ts_ms, linger_ms);
+
+    tracker.wait_outstanding_tasks();
+    mlog->close();
+}
+
+TEST_F(mutation_log_test, shared_log_group_commit_flush)
+{
+    std::atomic<int> callback_count(0);
+    dsn::task_tracker tracker;
+
+    mutation_log_ptr mlog = new mutation_log_shared(_log_dir, 4, true, nullptr, 0, 64, 10);
+    ASSERT_EQ(ERR_OK, mlog->open(nullptr, nullptr));
+    mlog->on_partition_reset(get_gpid(), 0);
+
+    // with force flush, the callbacks are notified only after the batch is synced, so they must
+    // have been issued when flush() returns
+    for (int i = 0; i < 100; i++) {
+        mutation_ptr mu = create_test_mutation("hello!", 2 + i);
+        mlog->append(mu,
+                     LPC_AIO_IMMEDIATE_CALLBACK,
+                     &tracker,
+                     [&callback_count](error_code err, size_t) {
+                         EXPECT_EQ(ERR_OK, err);
+                         ++callback_count;
+                     },
+                     0);
+        mlog->flush();
+        tracker.wait_outstanding_tasks();
+        ASSERT_EQ(i + 1, callback_count.load());
+    }
+
+    mlog->close();
+}
+
+TEST_F(mutation_log_test, shared_log_parallel_replay)
+{
+    // ~100KB per mutation, so that there are multiple files and replay windows
+    const int partition_count = 8;
+    const int mutation_count = 40;
+    const std::string data(1000, 'a');
+    dsn::task_tracker tracker;
+
+    { // writing logs of multiple replicas
+        mutation_log_ptr mlog = new mutation_log_shared(_log_dir, 4, false);
+        ASSERT_EQ(ERR_OK, mlog->open(nullptr, nullptr));
+        for (int p = 0; p < partition_count; p++) {
+            mlog->on_partition_reset(gpid(1, p), 0);
+        }
+
+        for (int i = 1; i <= mutation_count; i++) {
+            for (int p = 0; p < partition_count; p++) {
+                mutation_ptr mu = create_test_mutation(data, i);
+                mu->data.header.pid = gpid(1, p);
+                mlog->append(mu, LPC_AIO_IMMEDIATE_CALLBACK, &tracker, nullptr, 0);
+            }
+        }
+        mlog->flush();
+        tracker.wait_outstanding_tasks();
+        ASSERT_GT(mlog->get_log_file_map().size(), 1);
+        mlog->close();
+    }
+
+    { // replaying with 4 tasks
+        mutation_log_ptr mlog = new mutation_log_shared(_log_dir, 4, false);
+        mlog->set_replay_parallelism(4);
+
+        // the callback is called concurrently only for different replicas
+        std::map<gpid, std::vector<decree>> replayed;
+        for (int p = 0; p < partition_count; p++) {
+            mlog->set_valid_start_offset_on_open(gpid(1, p), 0);
+            replayed[gpid(1, p)] = std::vector<decree>();
+        }
+        ASSERT_EQ(ERR_OK,
+                  mlog->open(
+                      [&replayed](int log_length, mutation_ptr &mu) -> bool {
+                          replayed.at(mu->data.header.pid).push_back(mu->get_decree());
+                          return true;
+                      },
+                      nullptr));
+
+        for (int p = 0; p < partition_count; p++) {
+            const std::vector<decree> &decrees = replayed[gpid(1, p)];
+            ASSERT_EQ(mutation_count, decrees.size());
+            for (int i = 0; i < mutation_count; i++) {
+                ASSERT_EQ(i + 1, decrees[i]);
+            }
+            ASSERT_EQ(mutation_count, mlog->max_decree(gpid(1, p)));
+        }
+        mlog->close();
+    }
+}
+
 } // namespace replication
 } // namespace dsn
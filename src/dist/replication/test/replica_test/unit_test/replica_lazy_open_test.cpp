@@ -0,0 +1,364 @@
+// Copyright (c) 2017-present, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#include <fmt/format.h>
+#include <gtest/gtest.h>
+
+#include "replica_test_base.h"
+
+namespace dsn {
+namespace replication {
+
+class replica_lazy_open_test : public replica_test_base
+{
+public:
+    typedef replica_stub::deferred_replica_meta deferred_meta;
+    typedef replica_stub::deferred_replica_metas deferred_metas;
+
+    const std::string _dir{"./test-lazy-open"};
+
+    void SetUp() override
+    {
+        utils::filesystem::remove_path(_dir);
+        utils::filesystem::create_directory(_dir);
+        stub->mock_open_replica = true;
+    }
+
+    void TearDown() override
+    {
+        // the replicas marked as under opening by the mock have no open task
+        stub->_opening_replicas.clear();
+        utils::filesystem::remove_path(_dir);
+    }
+
+    // creates the dir of a replica closed with the durable decree
+    std::string create_replica_dir(gpid pid, decree durable_decree, int64_t offset_in_shared_log)
+    {
+        std::string dir = utils::filesystem::path_combine(
+            _dir, fmt::format("{}.{}.replica", pid.get_app_id(), pid.get_partition_index()));
+        utils::filesystem::create_directory(dir);
+
+        app_info info;
+        info.app_id = pid.get_app_id();
+        info.app_name = "lazy_open_test";
+        info.app_type = "replica";
+        info.partition_count = 8;
+        replica_app_info info2(&info);
+        std::string path = utils::filesystem::path_combine(dir, ".app-info");
+        EXPECT_EQ(ERR_OK, info2.store(path.c_str()));
+
+        replica_init_info init_info;
+        init_info.init_ballot = 3;
+        init_info.init_durable_decree = durable_decree;
+        init_info.init_offset_in_shared_log = offset_in_shared_log;
+        EXPECT_EQ(ERR_OK, init_info.store(dir));
+        return dir;
+    }
+
+    deferred_metas create_deferred_replicas(int count)
+    {
+        deferred_metas metas;
+        for (int i = 0; i < count; ++i) {
+            gpid pid;
+            deferred_meta meta;
+            std::string dir = create_replica_dir(gpid(1, i), 10, 0);
+            EXPECT_TRUE(load_deferred_replica_meta(dir, pid, meta));
+            metas.emplace(pid, std::move(meta));
+        }
+        return metas;
+    }
+
+    mutation_ptr create_slog_mutation(gpid pid, decree d)
+    {
+        mutation_ptr mu(new mutation());
+        mu->data.header.ballot = 1;
+        mu->data.header.decree = d;
+        mu->data.header.pid = pid;
+        // nothing is committed, so that replaying it never applies it to the app
+        mu->data.header.last_committed_decree = 0;
+        mu->data.header.log_offset = 0;
+        mu->data.updates.emplace_back(mutation_update());
+        mu->data.updates.back().code = RPC_REPLICATION_WRITE_EMPTY;
+        mu->data.updates.back().data = blob::create_from_bytes("hello");
+        mu->client_requests.push_back(nullptr);
+        return mu;
+    }
+
+    // a replica which is loaded but not replayed yet
+    replica_ptr create_loaded_replica(gpid pid, const std::string &dir)
+    {
+        auto r = create_mock_replica(
+            stub.get(), pid.get_app_id(), pid.get_partition_index(), dir.c_str());
+        replica_configuration config;
+        config.pid = pid;
+        config.ballot = 1;
+        config.status = partition_status::PS_INACTIVE;
+        r->set_replica_config(config);
+        r->init_private_log(new mock_mutation_log_private(pid, r.get()));
+        return replica_ptr(r.release());
+    }
+
+    static bool load_deferred_replica_meta(const std::string &dir, gpid &pid, deferred_meta &meta)
+    {
+        return replica_stub::load_deferred_replica_meta(dir, pid, meta);
+    }
+    static bool deferred_replica_needs_replay(const deferred_meta &meta, const mutation_ptr &mu)
+    {
+        return replica_stub::deferred_replica_needs_replay(meta, mu);
+    }
+    error_code replay_shared_log_for(const replicas &rps)
+    {
+        return stub->replay_shared_log_for(rps);
+    }
+    void clear_replicas_on_log_failure(replicas &rps, deferred_metas &deferred)
+    {
+        stub->clear_replicas_on_log_failure(rps, deferred);
+    }
+    void attach_deferred_replicas(deferred_metas &deferred)
+    {
+        stub->attach_deferred_replicas(deferred);
+    }
+    bool open_deferred_replica(gpid id) { return stub->open_deferred_replica(id); }
+    void on_lazy_open_warmup() { stub->on_lazy_open_warmup(); }
+    std::vector<gpid> pick_lazy_open_warmup_replicas()
+    {
+        std::vector<gpid> pids;
+        for (const auto &kv : stub->pick_lazy_open_warmup_replicas()) {
+            pids.push_back(kv.first);
+        }
+        return pids;
+    }
+    std::vector<gpid> begin_open_replicas()
+    {
+        std::vector<gpid> pids;
+        for (const auto &kv : stub->begin_open_replicas) {
+            pids.push_back(kv.first);
+        }
+        return pids;
+    }
+
+    replica_stub::deferred_replicas &deferred_replicas() { return stub->_deferred_replicas; }
+    replica_stub::closed_replicas &closed_replicas() { return stub->_closed_replicas; }
+    replica_stub::opening_replicas &opening_replicas() { return stub->_opening_replicas; }
+    mutation_log_ptr shared_log() { return stub->_log; }
+    int64_t deferred_count() { return stub->_counter_replicas_deferred_count->get_integer_value(); }
+    int64_t move_error_count()
+    {
+        return stub->_counter_replicas_recent_replica_move_error_count->get_cumulative_value();
+    }
+};
+
+TEST_F(replica_lazy_open_test, load_deferred_replica_meta)
+{
+    gpid pid;
+    deferred_meta meta;
+    std::string dir = create_replica_dir(gpid(1, 2), 10, 100);
+    ASSERT_TRUE(load_deferred_replica_meta(dir, pid, meta));
+    ASSERT_EQ(gpid(1, 2), pid);
+    ASSERT_EQ(dir, meta.dir);
+    ASSERT_EQ("replica", meta.info.app_type);
+    ASSERT_EQ("lazy_open_test", meta.info.app_name);
+    ASSERT_EQ(3, meta.init_info.init_ballot);
+    ASSERT_EQ(10, meta.init_info.init_durable_decree);
+    ASSERT_EQ(100, meta.init_info.init_offset_in_shared_log);
+    ASSERT_FALSE(meta.need_replay);
+
+    // the app type doesn't match the dir name
+    std::string dir2 = utils::filesystem::path_combine(_dir, "1.3.pegasus");
+    ASSERT_TRUE(utils::filesystem::rename_path(create_replica_dir(gpid(1, 3), 10, 100), dir2));
+    ASSERT_FALSE(load_deferred_replica_meta(dir2, pid, meta));
+
+    // without .init-info, it's left to replica::load
+    std::string dir3 = create_replica_dir(gpid(1, 4), 10, 100);
+    std::string init_info_path = utils::filesystem::path_combine(dir3, ".init-info");
+    ASSERT_TRUE(utils::filesystem::remove_path(init_info_path));
+    ASSERT_FALSE(load_deferred_replica_meta(dir3, pid, meta));
+
+    // not a replica dir
+    std::string dir4 = utils::filesystem::path_combine(_dir, "slog");
+    ASSERT_TRUE(utils::filesystem::create_directory(dir4));
+    ASSERT_FALSE(load_deferred_replica_meta(dir4, pid, meta));
+}
+
+TEST_F(replica_lazy_open_test, deferred_replica_needs_replay)
+{
+    gpid pid;
+    deferred_meta meta;
+    ASSERT_TRUE(load_deferred_replica_meta(create_replica_dir(gpid(1, 1), 10, 100), pid, meta));
+
+    // decree and offset in the shared log are both newer than the ones on the last open
+    mutation_ptr mu = create_slog_mutation(pid, 11);
+    mu->data.header.log_offset = 100;
+    ASSERT_TRUE(deferred_replica_needs_replay(meta, mu));
+
+    // durable already
+    mu = create_slog_mutation(pid, 10);
+    mu->data.header.log_offset = 200;
+    ASSERT_FALSE(deferred_replica_needs_replay(meta, mu));
+
+    // logged before the last open
+    mu = create_slog_mutation(pid, 11);
+    mu->data.header.log_offset = 99;
+    ASSERT_FALSE(deferred_replica_needs_replay(meta, mu));
+}
+
+TEST_F(replica_lazy_open_test, replay_shared_log_for_promoted_replicas)
+{
+    const std::string slog_dir = utils::filesystem::path_combine(_dir, "slog");
+    const gpid promoted_pid(1, 1);
+    const gpid other_pid(1, 2);
+
+    { // writing logs of 2 replicas
+        mutation_log_ptr mlog = new mutation_log_shared(slog_dir, 4, false);
+        ASSERT_EQ(ERR_OK, mlog->open(nullptr, nullptr));
+        for (decree d = 1; d <= 3; ++d) {
+            mutation_ptr mu = create_slog_mutation(promoted_pid, d);
+            mlog->append(mu, LPC_AIO_IMMEDIATE_CALLBACK, nullptr, nullptr, 0);
+            mu = create_slog_mutation(other_pid, d);
+            mlog->append(mu, LPC_AIO_IMMEDIATE_CALLBACK, nullptr, nullptr, 0);
+        }
+        mlog->flush();
+        mlog->close();
+    }
+
+    // the first replay, in which the deferred replica only finds it needs replay
+    mutation_log_ptr mlog = new mutation_log_shared(slog_dir, 4, false);
+    mlog->set_valid_start_offset_on_open(promoted_pid, 0);
+    mlog->set_valid_start_offset_on_open(other_pid, 0);
+    ASSERT_EQ(ERR_OK, mlog->open([](int, mutation_ptr &) { return false; }, nullptr));
+    ASSERT_EQ(0, mlog->max_decree(promoted_pid));
+    stub->set_log(mlog);
+
+    // the second replay, only for the promoted replica
+    replica_ptr r = create_loaded_replica(promoted_pid, _dir);
+    replicas promoted_rps;
+    promoted_rps[promoted_pid] = r;
+    ASSERT_EQ(ERR_OK, replay_shared_log_for(promoted_rps));
+
+    ASSERT_EQ(3, static_cast<mock_replica *>(r.get())->get_plist()->max_decree());
+    ASSERT_EQ(3, shared_log()->max_decree(promoted_pid));
+    ASSERT_EQ(0, shared_log()->max_decree(other_pid));
+}
+
+TEST_F(replica_lazy_open_test, clear_replicas_on_log_failure)
+{
+    stub->options().slog_dir = utils::filesystem::path_combine(_dir, "slog");
+    mutation_log_ptr mlog = new mutation_log_shared(stub->options().slog_dir, 4, false);
+    ASSERT_EQ(ERR_OK, mlog->open(nullptr, nullptr));
+    stub->set_log(mlog);
+
+    // a promoted replica and a deferred one
+    replicas rps;
+    std::string dir = create_replica_dir(gpid(1, 1), 10, 0);
+    rps[gpid(1, 1)] = create_loaded_replica(gpid(1, 1), dir);
+    deferred_metas deferred;
+    gpid pid;
+    deferred_meta meta;
+    ASSERT_TRUE(load_deferred_replica_meta(create_replica_dir(gpid(1, 2), 10, 0), pid, meta));
+    std::string deferred_dir = meta.dir;
+    deferred.emplace(pid, std::move(meta));
+
+    int64_t old_move_error_count = move_error_count();
+    clear_replicas_on_log_failure(rps, deferred);
+
+    ASSERT_TRUE(rps.empty());
+    ASSERT_TRUE(deferred.empty());
+    ASSERT_FALSE(utils::filesystem::directory_exists(dir));
+    ASSERT_FALSE(utils::filesystem::directory_exists(deferred_dir));
+    std::vector<std::string> sub_dirs;
+    ASSERT_TRUE(utils::filesystem::get_subdirectories(_dir, sub_dirs, false));
+    int err_dir_count = 0;
+    for (const auto &sub_dir : sub_dirs) {
+        if (sub_dir.substr(sub_dir.length() - 4) == ".err") {
+            ++err_dir_count;
+        }
+    }
+    ASSERT_EQ(2, err_dir_count);
+    ASSERT_EQ(2, move_error_count() - old_move_error_count);
+
+    // the shared log is restarted
+    ASSERT_NE(mlog.get(), shared_log().get());
+    ASSERT_TRUE(shared_log()->get_log_file_map().size() <= 1);
+}
+
+TEST_F(replica_lazy_open_test, attach_deferred_replicas)
+{
+    deferred_metas metas = create_deferred_replicas(3);
+    attach_deferred_replicas(metas);
+
+    ASSERT_EQ(3, deferred_replicas().size());
+    ASSERT_EQ(3, deferred_count());
+    for (int i = 0; i < 3; ++i) {
+        gpid pid(1, i);
+        ASSERT_EQ(partition_status::PS_INACTIVE, deferred_replicas()[pid]);
+
+        // reported to meta server from the metadata
+        auto it = closed_replicas().find(pid);
+        ASSERT_NE(closed_replicas().end(), it);
+        ASSERT_EQ("lazy_open_test", it->second.first.app_name);
+        ASSERT_EQ(pid, it->second.second.pid);
+        ASSERT_EQ(3, it->second.second.ballot);
+        ASSERT_EQ(partition_status::PS_INACTIVE, it->second.second.status);
+        ASSERT_EQ(10, it->second.second.last_committed_decree);
+        ASSERT_EQ(10, it->second.second.last_durable_decree);
+    }
+}
+
+TEST_F(replica_lazy_open_test, open_deferred_replica)
+{
+    deferred_metas metas = create_deferred_replicas(2);
+    attach_deferred_replicas(metas);
+
+    // not deferred
+    ASSERT_FALSE(open_deferred_replica(gpid(1, 5)));
+    ASSERT_TRUE(begin_open_replicas().empty());
+
+    ASSERT_TRUE(open_deferred_replica(gpid(1, 1)));
+    ASSERT_EQ(std::vector<gpid>({gpid(1, 1)}), begin_open_replicas());
+    ASSERT_EQ("lazy_open_test", stub->begin_open_replicas.back().second.app_name);
+
+    // under opening, not opened again
+    ASSERT_TRUE(open_deferred_replica(gpid(1, 1)));
+    ASSERT_EQ(1, begin_open_replicas().size());
+    ASSERT_EQ(1, opening_replicas().size());
+    // it's deferred until it's opened
+    ASSERT_EQ(2, deferred_count());
+}
+
+TEST_F(replica_lazy_open_test, lazy_open_warmup_order)
+{
+    deferred_metas metas = create_deferred_replicas(4);
+    attach_deferred_replicas(metas);
+    // the status on meta server
+    deferred_replicas()[gpid(1, 0)] = partition_status::PS_INACTIVE;
+    deferred_replicas()[gpid(1, 1)] = partition_status::PS_SECONDARY;
+    deferred_replicas()[gpid(1, 2)] = partition_status::PS_PRIMARY;
+    deferred_replicas()[gpid(1, 3)] = partition_status::PS_PRIMARY;
+
+    stub->options().lazy_open_warmup_concurrency = 2;
+    stub->options().lazy_open_warmup_order = "gpid";
+    ASSERT_EQ(std::vector<gpid>({gpid(1, 0), gpid(1, 1)}), pick_lazy_open_warmup_replicas());
+
+    stub->options().lazy_open_warmup_order = "primary_first";
+    on_lazy_open_warmup();
+    ASSERT_EQ(std::vector<gpid>({gpid(1, 2), gpid(1, 3)}), begin_open_replicas());
+
+    // no more than lazy_open_warmup_concurrency replicas are under opening
+    on_lazy_open_warmup();
+    ASSERT_EQ(2, begin_open_replicas().size());
+
+    // one of them is opened
+    opening_replicas().erase(gpid(1, 2));
+    deferred_replicas().erase(gpid(1, 2));
+    on_lazy_open_warmup();
+    ASSERT_EQ(std::vector<gpid>({gpid(1, 2), gpid(1, 3), gpid(1, 1)}), begin_open_replicas());
+
+    // disabled
+    stub->options().lazy_open_warmup_concurrency = 0;
+    opening_replicas().clear();
+    ASSERT_TRUE(pick_lazy_open_warmup_replicas().empty());
+}
+
+} // namespace replication
+} // namespace dsn
@@ -5,12 +5,54 @@
 #include <gtest/gtest.h>
 
 #include <dsn/utility/fail_point.h>
+#include <dsn/utility/flags.h>
+#include <nlohmann/json.hpp>
 #include "replica_test_base.h"
+#include "dist/replication/lib/replica_http_service.h"
 #include <dsn/utility/defer.h>
 
 namespace dsn {
 namespace replication {
 
+DSN_DECLARE_uint64(slow_mutation_threshold_ms);
+
+// a shared log which completes the appends only when asked to, on the calling thread
+class manual_mutation_log_shared : public mutation_log_shared
+{
+public:
+    explicit manual_mutation_log_shared(const std::string &dir)
+        : mutation_log_shared(dir, 1000, false)
+    {
+    }
+
+    task_ptr append(mutation_ptr &mu,
+                    task_code callback_code,
+                    task_tracker *tracker,
+                    aio_handler &&callback,
+                    int hash = 0,
+                    int64_t *pending_size = nullptr) override
+    {
+        if (pending_size != nullptr) {
+            *pending_size = 0;
+        }
+        _callbacks.push_back(std::move(callback));
+        return tasking::create_task(callback_code, nullptr, []() {}, hash);
+    }
+
+    void complete_appends(error_code err)
+    {
+        std::vector<aio_handler> callbacks;
+        callbacks.swap(_callbacks);
+        for (auto &callback : callbacks) {
+            callback(err, 0);
+        }
+    }
+
+private:
+    std::vector<aio_handler> _callbacks;
+};
+typedef dsn::ref_ptr<manual_mutation_log_shared> manual_mutation_log_shared_ptr;
+
 class replica_test : public replica_test_base
 {
 public:
@@ -36,6 +78,83 @@ public:
         return _mock_replica->_counter_backup_request_qps->get_integer_value();
     }
 
+    write_latency_tracker *get_write_latency_tracker()
+    {
+        return _mock_replica->_write_latency_tracker.get();
+    }
+
+    int64_t get_write_stage_count(write_latency_stage stage)
+    {
+        std::string name = write_latency_tracker::counter_name(stage, _app_info.app_name);
+        auto counter = perf_counters::instance().get_app_counter(
+            "eon.replica", name.c_str(), COUNTER_TYPE_NUMBER_PERCENTILES, "", false);
+        std::vector<perf_counter::histogram_bucket> buckets;
+        int64_t sum = 0;
+        EXPECT_TRUE(counter->get_histogram(buckets, sum));
+        int64_t count = 0;
+        for (const auto &b : buckets) {
+            count += b.count;
+        }
+        return count;
+    }
+
+    int64_t get_slow_mutation_count()
+    {
+        std::string name = std::string(write_latency_tracker::counter_name_prefix()) +
+                           "slow.count@" + _app_info.app_name;
+        auto counter = perf_counters::instance().get_app_counter(
+            "eon.replica", name.c_str(), COUNTER_TYPE_VOLATILE_NUMBER, "", false);
+        return counter->get_cumulative_value();
+    }
+
+    // set the milestones of the mutation as if each stage takes `stage_ms`
+    mutation_ptr create_applied_mutation(uint64_t stage_ms)
+    {
+        mutation_ptr mu = new mutation();
+        uint64_t ts_ns = mu->create_ts_ns();
+        for (int i = MM_PREPARE_BEGIN; i < MM_COUNT; i++) {
+            ts_ns += stage_ms * 1000000;
+            if (i == MM_ACKED) {
+                mu->add_prepare_ack(rpc_address("127.0.0.1", 34801), ts_ns);
+            } else {
+                mu->set_milestone(static_cast<mutation_milestone>(i), ts_ns);
+            }
+        }
+        return mu;
+    }
+
+    // prepare a write on the primary as on_client_write does, with an empty write as the request
+    mutation_ptr prepare_empty_write()
+    {
+        mutation_ptr mu = _mock_replica->new_mutation(invalid_decree);
+        mu->add_client_request(RPC_REPLICATION_WRITE_EMPTY, nullptr);
+        _mock_replica->init_prepare(mu, false);
+        return mu;
+    }
+
+    // the reply of the secondary to the prepare of the mutation
+    void reply_prepare(mutation_ptr &mu, rpc_address secondary)
+    {
+        prepare_ack ack;
+        ack.pid = pid;
+        ack.err = ERR_OK;
+        ack.ballot = mu->data.header.ballot;
+        ack.decree = mu->get_decree();
+        ack.last_committed_decree_in_app = 0;
+        ack.last_committed_decree_in_prepare_list = 0;
+
+        message_ptr request = message_ex::create_request(RPC_PREPARE);
+        request->to_address = secondary;
+        message_ptr received_request = request->copy(true, true);
+        message_ptr reply = received_request->create_response();
+        marshall(reply.get(), ack);
+        message_ptr received_reply = reply->copy(true, true);
+        _mock_replica->on_prepare_reply(std::make_pair(mu, partition_status::PS_SECONDARY),
+                                        ERR_OK,
+                                        request.get(),
+                                        received_reply.get());
+    }
+
     void mock_app_info()
     {
         _app_info.app_id = 2;
@@ -81,5 +200,122 @@ TEST_F(replica_test, backup_request_qps)
     ASSERT_GT(get_table_level_backup_request_qps(), 0);
 }
 
+TEST_F(replica_test, write_latency_breakdown)
+{
+    uint64_t old_threshold_ms = FLAGS_slow_mutation_threshold_ms;
+    auto cleanup = dsn::defer([=]() { FLAGS_slow_mutation_threshold_ms = old_threshold_ms; });
+    FLAGS_slow_mutation_threshold_ms = 100;
+
+    int64_t old_counts[WLS_COUNT];
+    for (int i = 0; i < WLS_COUNT; i++) {
+        old_counts[i] = get_write_stage_count(static_cast<write_latency_stage>(i));
+    }
+    int64_t old_slow_count = get_slow_mutation_count();
+
+    write_latency_tracker *tracker = get_write_latency_tracker();
+    mutation_ptr acked_mu = new mutation();
+    tracker->on_prepare_ack(acked_mu, rpc_address("127.0.0.1", 34802));
+    ASSERT_TRUE(acked_mu->prepare_acks().empty());
+    acked_mu->set_milestone(MM_PREPARED, acked_mu->create_ts_ns());
+    tracker->on_prepare_ack(acked_mu, rpc_address("127.0.0.1", 34802));
+    ASSERT_EQ(1, acked_mu->prepare_acks().size());
+    ASSERT_NE(0, acked_mu->milestone_ts_ns(MM_ACKED));
+
+    tracker->on_mutation_applied(create_applied_mutation(1), _mock_replica->name());
+    ASSERT_EQ(old_slow_count, get_slow_mutation_count());
+
+    tracker->on_mutation_applied(create_applied_mutation(100), _mock_replica->name());
+    ASSERT_EQ(old_slow_count + 1, get_slow_mutation_count());
+
+    // the mutations prepared again by reconciliation are not counted
+    mutation_ptr reconciled_mu = create_applied_mutation(100);
+    reconciled_mu->set_milestone(MM_PREPARE_BEGIN, 0);
+    tracker->on_mutation_applied(reconciled_mu, _mock_replica->name());
+    ASSERT_EQ(old_slow_count + 1, get_slow_mutation_count());
+
+    for (int i = 0; i < WLS_COUNT; i++) {
+        // the secondary ack is counted when it's received
+        int64_t expected = i == WLS_SECONDARY_ACK ? 1 : 2;
+        ASSERT_EQ(old_counts[i] + expected,
+                  get_write_stage_count(static_cast<write_latency_stage>(i)))
+            << write_latency_tracker::stage_name(static_cast<write_latency_stage>(i));
+    }
+
+    replica_http_service http_svc(stub.get());
+    http_request req;
+    http_response resp;
+    req.query_args.emplace("app_name", _app_info.app_name);
+    http_svc.query_write_latency_handler(req, resp);
+    ASSERT_EQ(http_status_code::ok, resp.status_code);
+    nlohmann::json json = nlohmann::json::parse(resp.body);
+    ASSERT_EQ(1, json.size());
+    for (int i = 0; i < WLS_COUNT; i++) {
+        const auto &stage_json =
+            json[_app_info.app_name][write_latency_tracker::stage_name(
+                static_cast<write_latency_stage>(i))];
+        ASSERT_TRUE(stage_json.is_object());
+        ASSERT_EQ(old_counts[i] + (i == WLS_SECONDARY_ACK ? 1 : 2),
+                  stage_json["count"].get<int64_t>());
+    }
+
+    req.query_args["app_name"] = "not_exist";
+    http_svc.query_write_latency_handler(req, resp);
+    ASSERT_EQ(http_status_code::not_found, resp.status_code);
+}
+
+TEST_F(replica_test, write_milestones_of_2pc)
+{
+    // the prepares are not sent, the secondary acks them by reply_prepare instead
+    fail::setup();
+    fail::cfg("replica_send_prepare_message", "return()");
+    auto cleanup = dsn::defer([]() { fail::teardown(); });
+
+    rpc_address secondary("127.0.0.1", 34802);
+    partition_configuration pc;
+    pc.pid = pid;
+    pc.ballot = 1;
+    pc.max_replica_count = 3;
+    pc.primary = stub->primary_address();
+    pc.secondaries.push_back(secondary);
+    _mock_replica->set_primary_partition_configuration(pc);
+    _mock_replica->init_private_log(new mock_mutation_log_private(pid, _mock_replica));
+    manual_mutation_log_shared_ptr shared_log = new manual_mutation_log_shared("./");
+    stub->set_log(shared_log);
+
+    int64_t old_counts[WLS_COUNT];
+    for (int i = 0; i < WLS_COUNT; i++) {
+        old_counts[i] = get_write_stage_count(static_cast<write_latency_stage>(i));
+    }
+
+    mutation_ptr mu = prepare_empty_write();
+    ASSERT_EQ(1, mu->get_decree());
+    ASSERT_NE(0, mu->milestone_ts_ns(MM_PREPARE_BEGIN));
+    ASSERT_NE(0, mu->milestone_ts_ns(MM_PREPARED));
+    ASSERT_EQ(0, mu->milestone_ts_ns(MM_LOGGED));
+
+    shared_log->complete_appends(ERR_OK);
+    ASSERT_NE(0, mu->milestone_ts_ns(MM_LOGGED));
+    ASSERT_EQ(0, mu->milestone_ts_ns(MM_ACKED));
+    ASSERT_EQ(0, _mock_replica->last_committed_decree());
+
+    // the mutation is committed once the last ack is received
+    reply_prepare(mu, secondary);
+    ASSERT_EQ(1, _mock_replica->last_committed_decree());
+    ASSERT_EQ(1, mu->prepare_acks().size());
+
+    uint64_t last_ts_ns = mu->create_ts_ns();
+    for (int i = MM_PREPARE_BEGIN; i < MM_COUNT; i++) {
+        uint64_t ts_ns = mu->milestone_ts_ns(static_cast<mutation_milestone>(i));
+        ASSERT_NE(0, ts_ns) << "milestone " << i;
+        ASSERT_LE(last_ts_ns, ts_ns) << "milestone " << i;
+        last_ts_ns = ts_ns;
+    }
+
+    for (int i = 0; i < WLS_COUNT; i++) {
+        ASSERT_EQ(old_counts[i] + 1, get_write_stage_count(static_cast<write_latency_stage>(i)))
+            << write_latency_tracker::stage_name(static_cast<write_latency_stage>(i));
+    }
+}
+
 } // namespace replication
 } // namespace dsn
@@ -33,6 +33,7 @@
  */
 #include <dsn/tool-api/async_calls.h>
 #include <dsn/dist/replication/replication.codes.h>
+#include <dsn/utility/flags.h>
 
 #include <boost/algorithm/string.hpp>
 #include <boost/lexical_cast.hpp>
@@ -41,10 +42,24 @@
 #include "zookeeper_session_mgr.h"
 #include "zookeeper_session.h"
 #include "zookeeper_error.h"
+#include "meta_state_write_batcher.h"
 
 namespace dsn {
 namespace dist {
 
+DSN_DEFINE_uint32("zookeeper",
+                  max_batch_ops,
+                  64,
+                  "max count of the create/set operations sent in one zoo_amulti, "
+                  "0 or 1 to disable the batching");
+DSN_DEFINE_uint64("zookeeper",
+                  max_batch_bytes,
+                  512 * 1024,
+                  "max bytes of the create/set operations sent in one zoo_amulti, "
+                  "which should be less than jute.maxbuffer of zookeeper");
+
+DEFINE_TASK_CODE(LPC_META_STATE_ZOOKEEPER_BATCH, TASK_PRIORITY_HIGH, THREAD_POOL_DEFAULT)
+
 class zoo_transaction : public meta_state_service::transaction_entries
 {
 public:
@@ -148,6 +163,7 @@ meta_state_service_zookeeper::meta_state_service_zookeeper() : ref_counter() { _
 meta_state_service_zookeeper::~meta_state_service_zookeeper()
 {
     _tracker.wait_outstanding_tasks();
+    _batcher.reset();
     if (_session) {
         _session->detach(this);
         _session = nullptr;
@@ -168,6 +184,21 @@ error_code meta_state_service_zookeeper::initialize(const std::vector<std::strin
             return ERR_TIMEOUT;
     }
 
+    if (FLAGS_max_batch_ops > 1) {
+        _batcher.reset(new meta_state_write_batcher(
+            this,
+            [this](const std::shared_ptr<transaction_entries> &entries,
+                   task_code cb_code,
+                   const err_callback &cb_transaction,
+                   dsn::task_tracker *tracker) {
+                return submit_transaction_internal(
+                    entries, cb_code, cb_transaction, tracker, false);
+            },
+            LPC_META_STATE_ZOOKEEPER_BATCH,
+            FLAGS_max_batch_ops,
+            FLAGS_max_batch_bytes));
+    }
+
     ddebug("init meta_state_service_zookeeper succeed");
 
     // Notice: this reference is released in finalize
@@ -207,6 +238,10 @@ task_ptr meta_state_service_zookeeper::create_node(const std::string &node,
     error_code_future_ptr tsk(new error_code_future(cb_code, cb_create, 0));
     tsk->set_tracker(tracker);
     dinfo("call create, node(%s)", node.c_str());
+    if (_batcher != nullptr) {
+        _batcher->create_node(node, value, tsk);
+        return tsk;
+    }
     VISIT_INIT(tsk, zookeeper_session::ZOO_OPERATION::ZOO_CREATE, node);
     input->_value = value;
     input->_flags = 0;
@@ -220,6 +255,16 @@ task_ptr meta_state_service_zookeeper::submit_transaction(
     task_code cb_code,
     const err_callback &cb_transaction,
     dsn::task_tracker *tracker)
+{
+    return submit_transaction_internal(entries, cb_code, cb_transaction, tracker, true);
+}
+
+task_ptr meta_state_service_zookeeper::submit_transaction_internal(
+    const std::shared_ptr<transaction_entries> &entries,
+    task_code cb_code,
+    const err_callback &cb_transaction,
+    dsn::task_tracker *tracker,
+    bool in_order)
 {
     error_code_future_ptr tsk(new error_code_future(cb_code, cb_transaction, 0));
     tsk->set_tracker(tracker);
@@ -235,7 +280,11 @@ task_ptr meta_state_service_zookeeper::submit_transaction(
     zoo_transaction *t = dynamic_cast<zoo_transaction *>(entries.get());
     input->_pkt = t->packet();
 
-    _session->visit(op);
+    if (in_order) {
+        issue_in_order([this, op]() { _session->visit(op); });
+    } else {
+        _session->visit(op);
+    }
     return tsk;
 }
 
@@ -248,7 +297,7 @@ task_ptr meta_state_service_zookeeper::delete_empty_node(const std::string &node
     tsk->set_tracker(tracker);
     dinfo("call delete, node(%s)", node.c_str());
     VISIT_INIT(tsk, zookeeper_session::ZOO_OPERATION::ZOO_DELETE, node);
-    _session->visit(op);
+    issue_in_order([this, op]() { _session->visit(op); });
     return tsk;
 }
 
@@ -316,7 +365,7 @@ task_ptr meta_state_service_zookeeper::get_data(const std::string &node,
     dinfo("call get, node(%s)", node.c_str());
     VISIT_INIT(tsk, zookeeper_session::ZOO_OPERATION::ZOO_GET, node);
     input->_is_set_watch = 0;
-    _session->visit(op);
+    issue_in_order([this, op]() { _session->visit(op); });
     return tsk;
 }
 
@@ -329,6 +378,10 @@ task_ptr meta_state_service_zookeeper::set_data(const std::string &node,
     error_code_future_ptr tsk(new error_code_future(cb_code, cb_set_data, 0));
     tsk->set_tracker(tracker);
     dinfo("call set, node(%s)", node.c_str());
+    if (_batcher != nullptr) {
+        _batcher->set_data(node, value, tsk);
+        return tsk;
+    }
     VISIT_INIT(tsk, zookeeper_session::ZOO_OPERATION::ZOO_SET, node);
 
     input->_value = value;
@@ -346,7 +399,7 @@ task_ptr meta_state_service_zookeeper::node_exist(const std::string &node,
     dinfo("call node_exist, node(%s)", node.c_str());
     VISIT_INIT(tsk, zookeeper_session::ZOO_OPERATION::ZOO_EXISTS, node);
     input->_is_set_watch = 0;
-    _session->visit(op);
+    issue_in_order([this, op]() { _session->visit(op); });
     return tsk;
 }
 
@@ -360,10 +413,20 @@ task_ptr meta_state_service_zookeeper::get_children(const std::string &node,
     dinfo("call get children, node(%s)", node.c_str());
     VISIT_INIT(tsk, zookeeper_session::ZOO_OPERATION::ZOO_GETCHILDREN, node);
     input->_is_set_watch = 0;
-    _session->visit(op);
+    issue_in_order([this, op]() { _session->visit(op); });
     return tsk;
 }
 
+void meta_state_service_zookeeper::issue_in_order(std::function<void()> &&issue)
+{
+    if (_batcher != nullptr) {
+        // the operation must not overtake the writes queued in the batcher
+        _batcher->run_in_order(std::move(issue));
+    } else {
+        issue();
+    }
+}
+
 /*static*/
 /* this function runs in zookeeper do-completion thread */
 void meta_state_service_zookeeper::on_zoo_session_evt(ref_this _this, int zoo_state)
@@ -44,6 +44,7 @@ namespace dsn {
 namespace dist {
 
 class zookeeper_session;
+class meta_state_write_batcher;
 class meta_state_service_zookeeper : public meta_state_service, public ref_counter
 {
 public:
@@ -105,6 +106,16 @@ public:
 private:
     typedef ref_ptr<meta_state_service_zookeeper> ref_this;
 
+    // in_order is false if the transaction is sent by _batcher, which keeps the order itself
+    task_ptr submit_transaction_internal(
+        const std::shared_ptr<meta_state_service::transaction_entries> &entries,
+        task_code cb_code,
+        const err_callback &cb_transaction,
+        task_tracker *tracker,
+        bool in_order);
+    // issues an operation to the session after the writes queued in _batcher
+    void issue_in_order(std::function<void()> &&issue);
+
     bool _first_call;
     int _zoo_state;
     zookeeper_session *_session;
@@ -112,6 +123,9 @@ private:
 
     dsn::task_tracker _tracker;
 
+    // groups the create/set operations into zoo_amulti, null if the batching is disabled
+    std::unique_ptr<meta_state_write_batcher> _batcher;
+
     static void on_zoo_session_evt(ref_this ptr, int zoo_state);
     static void visit_zookeeper_internal(ref_this ptr,
                                          task_ptr callback,
@@ -0,0 +1,165 @@
+// Copyright (c) 2019, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#include <dsn/c/api_utilities.h>
+
+#include "meta_state_write_batcher.h"
+
+namespace dsn {
+namespace dist {
+
+meta_state_write_batcher::meta_state_write_batcher(meta_state_service *service,
+                                                   transaction_submitter submitter,
+                                                   task_code cb_code,
+                                                   uint32_t max_batch_ops,
+                                                   uint64_t max_batch_bytes)
+    : _service(service),
+      _submitter(std::move(submitter)),
+      _cb_code(cb_code),
+      _max_batch_ops(std::max(max_batch_ops, 1u)),
+      _max_batch_bytes(max_batch_bytes),
+      _batch_in_flight(false),
+      _submitted_transactions(0)
+{
+}
+
+meta_state_write_batcher::~meta_state_write_batcher() { _tracker.wait_outstanding_tasks(); }
+
+void meta_state_write_batcher::create_node(const std::string &node,
+                                           const blob &value,
+                                           const error_code_future_ptr &tsk)
+{
+    enqueue(pending_write{true, node, value, tsk, nullptr});
+}
+
+void meta_state_write_batcher::set_data(const std::string &node,
+                                        const blob &value,
+                                        const error_code_future_ptr &tsk)
+{
+    enqueue(pending_write{false, node, value, tsk, nullptr});
+}
+
+void meta_state_write_batcher::run_in_order(std::function<void()> &&issue)
+{
+    enqueue(pending_write{false, std::string(), blob(), nullptr, std::move(issue)});
+}
+
+void meta_state_write_batcher::enqueue(pending_write &&w)
+{
+    {
+        zauto_lock l(_lock);
+        _pending.emplace_back(std::move(w));
+        if (_batch_in_flight) {
+            return;
+        }
+        _batch_in_flight = true;
+    }
+    send_next_batch();
+}
+
+void meta_state_write_batcher::send_next_batch()
+{
+    std::vector<pending_write> batch;
+    while (batch.empty()) {
+        std::vector<std::function<void()>> issues;
+        {
+            zauto_lock l(_lock);
+            // the leading non-batched operations are issued at once, as the writes before them
+            // are acked. _batch_in_flight is kept meanwhile, so that the operations enqueued
+            // concurrently wait for them
+            while (!_pending.empty() && _pending.front().issue) {
+                issues.emplace_back(std::move(_pending.front().issue));
+                _pending.pop_front();
+            }
+            uint64_t batch_bytes = 0;
+            while (issues.empty() && !_pending.empty() && batch.size() < _max_batch_ops) {
+                const pending_write &w = _pending.front();
+                // a non-batched operation ends the batch
+                if (w.issue) {
+                    break;
+                }
+                uint64_t bytes = w.node.size() + w.value.length();
+                // a write larger than max_batch_bytes is sent alone
+                if (!batch.empty() && batch_bytes + bytes > _max_batch_bytes) {
+                    break;
+                }
+                batch_bytes += bytes;
+                batch.emplace_back(std::move(_pending.front()));
+                _pending.pop_front();
+            }
+            if (batch.empty() && issues.empty()) {
+                _batch_in_flight = false;
+                return;
+            }
+        }
+
+        for (auto &issue : issues) {
+            issue();
+        }
+    }
+
+    dinfo("send a batch of %d writes to meta state service", (int)batch.size());
+    auto entries = make_transaction(batch);
+    ++_submitted_transactions;
+    _submitter(entries,
+               _cb_code,
+               [this, batch, entries](error_code ec) {
+                   on_batch_done(batch, entries, ec);
+                   send_next_batch();
+               },
+               &_tracker);
+}
+
+void meta_state_write_batcher::send_alone(const pending_write &w)
+{
+    std::vector<pending_write> batch(1, w);
+    auto entries = make_transaction(batch);
+    ++_submitted_transactions;
+    _submitter(entries,
+               _cb_code,
+               [this, batch, entries](error_code ec) { on_batch_done(batch, entries, ec); },
+               &_tracker);
+}
+
+std::shared_ptr<meta_state_service::transaction_entries>
+meta_state_write_batcher::make_transaction(const std::vector<pending_write> &batch)
+{
+    auto entries = _service->new_transaction_entries(batch.size());
+    for (const pending_write &w : batch) {
+        error_code err = w.is_create ? entries->create_node(w.node, w.value)
+                                     : entries->set_data(w.node, w.value);
+        dassert(err == ERR_OK, "append to transaction failed, err = %s", err.to_string());
+    }
+    return entries;
+}
+
+void meta_state_write_batcher::on_batch_done(
+    const std::vector<pending_write> &batch,
+    const std::shared_ptr<meta_state_service::transaction_entries> &entries,
+    error_code ec)
+{
+    if (ec == ERR_OK) {
+        for (const pending_write &w : batch) {
+            w.tsk->enqueue_with(ERR_OK);
+        }
+        return;
+    }
+
+    for (unsigned int i = 0; i < batch.size(); ++i) {
+        // the writes before the failed one are rolled back, and the writes after it are not
+        // executed, they are marked as ERR_OK or ERR_INCONSISTENT_STATE
+        error_code err = entries->get_result(i);
+        if (err != ERR_OK && err != ERR_INCONSISTENT_STATE) {
+            batch[i].tsk->enqueue_with(err);
+        } else if (batch.size() > 1) {
+            send_alone(batch[i]);
+        } else {
+            // the transaction is failed as a whole, e.g. the session of zookeeper is expired
+            batch[i].tsk->enqueue_with(ec);
+        }
+    }
+}
+
+} // namespace dist
+} // namespace dsn
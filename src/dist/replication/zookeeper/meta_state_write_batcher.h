@@ -0,0 +1,96 @@
+// Copyright (c) 2019, Xiaomi, Inc.  All rights reserved.
+// This source code is licensed under the Apache License Version 2.0, which
+// can be found in the LICENSE file in the root directory of this source tree.
+
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <vector>
+
+#include <dsn/dist/meta_state_service.h>
+#include <dsn/tool-api/async_calls.h>
+#include <dsn/tool-api/task_tracker.h>
+#include <dsn/tool-api/zlocks.h>
+
+namespace dsn {
+namespace dist {
+
+// Groups the independent create_node/set_data operations issued to a meta_state_service into
+// transactions, so that a burst of small writes costs a few round trips instead of one for each.
+//
+// Only one batch is in flight at a time. Operations issued meanwhile are queued and sent
+// together as the next batch once it is acked, so the operations reach the service in the order
+// they are issued. A batch is atomic on the service, so if it fails, the operation which causes
+// the failure gets its own error and the others are resent alone, that is to say, the result of
+// each operation is the same as if it's not batched.
+//
+// The other operations of the service must not overtake the queued writes either, so they are
+// issued through run_in_order.
+class meta_state_write_batcher
+{
+public:
+    // sends a transaction to the service, it must not be reordered by the batcher itself
+    typedef std::function<task_ptr(const std::shared_ptr<meta_state_service::transaction_entries> &,
+                                   task_code,
+                                   const err_callback &,
+                                   task_tracker *)>
+        transaction_submitter;
+
+    // the callbacks of batches are executed in the thread pool of cb_code
+    meta_state_write_batcher(meta_state_service *service,
+                             transaction_submitter submitter,
+                             task_code cb_code,
+                             uint32_t max_batch_ops,
+                             uint64_t max_batch_bytes);
+    ~meta_state_write_batcher();
+
+    // the tsk is enqueued with the result of the operation
+    void create_node(const std::string &node, const blob &value, const error_code_future_ptr &tsk);
+    void set_data(const std::string &node, const blob &value, const error_code_future_ptr &tsk);
+
+    // issues a non-batched operation once the writes queued before it are sent and acked, or at
+    // once if there is none
+    void run_in_order(std::function<void()> &&issue);
+
+    // count of the transactions submitted to the service, including the resent ones
+    uint64_t submitted_transactions() const { return _submitted_transactions.load(); }
+
+private:
+    struct pending_write
+    {
+        bool is_create;
+        std::string node;
+        blob value;
+        error_code_future_ptr tsk;
+        // a non-batched operation if not empty, the fields above are unused then
+        std::function<void()> issue;
+    };
+
+    void enqueue(pending_write &&w);
+    void send_next_batch();
+    void send_alone(const pending_write &w);
+    std::shared_ptr<meta_state_service::transaction_entries>
+    make_transaction(const std::vector<pending_write> &batch);
+    void on_batch_done(const std::vector<pending_write> &batch,
+                       const std::shared_ptr<meta_state_service::transaction_entries> &entries,
+                       error_code ec);
+
+private:
+    meta_state_service *_service;
+    transaction_submitter _submitter;
+    task_code _cb_code;
+    uint32_t _max_batch_ops;
+    uint64_t _max_batch_bytes;
+
+    zlock _lock;
+    std::deque<pending_write> _pending; // protected by _lock
+    bool _batch_in_flight;              // protected by _lock
+
+    std::atomic<uint64_t> _submitted_transactions;
+    dsn::task_tracker _tracker;
+};
+
+} // namespace dist
+} // namespace dsn
@@ -47,6 +47,10 @@ zookeeper_session::zoo_atomic_packet::zoo_atomic_packet(unsigned int size)
 
     _ops = (zoo_op_t *)malloc(sizeof(zoo_op_t) * size);
     _results = (zoo_op_result_t *)malloc(sizeof(zoo_op_result_t) * size);
+    // the results are untouched if the packet isn't executed, e.g. the connection is lost
+    for (unsigned int i = 0; i < size; ++i) {
+        _results[i].err = ZRUNTIMEINCONSISTENCY;
+    }
 
     _paths.resize(size);
     _datas.resize(size);
@@ -1,12 +1,16 @@
 #include <dsn/dist/meta_state_service.h>
+#include <dsn/utility/filesystem.h>
+#include <dsn/utility/flags.h>
 #include <boost/lexical_cast.hpp>
 
 #include <gtest/gtest.h>
 #include <chrono>
 #include <thread>
+#include <unistd.h>
 
 #include "dist/replication/meta_server/meta_state_service_simple.h"
 #include "dist/replication/zookeeper/meta_state_service_zookeeper.h"
+#include "dist/replication/zookeeper/meta_state_write_batcher.h"
 
 using namespace dsn;
 using namespace dsn::dist;
@@ -35,7 +39,7 @@ void provider_basic_test(const service_creator_func &service_creator,
         service->create_node("/1/1", META_STATE_SERVICE_SIMPLE_TEST_CALLBACK, expect_ok)->wait();
         service->get_children("/1",
                               META_STATE_SERVICE_SIMPLE_TEST_CALLBACK,
-                              [](error_code ec, const std::vector<std::string> &children) {
+                              [&](error_code ec, const std::vector<std::string> &children) {
                                   dassert(ec == ERR_OK && children.size() == 1 &&
                                               *children.begin() == "1",
                                           "unexpected child");
@@ -160,7 +164,7 @@ void provider_basic_test(const service_creator_func &service_creator,
         service
             ->get_children("/2",
                            META_STATE_SERVICE_SIMPLE_TEST_CALLBACK,
-                           [](error_code ec, const std::vector<std::string> &children) {
+                           [&](error_code ec, const std::vector<std::string> &children) {
                                ASSERT_TRUE(children.size() == 1 && children[0] == "2");
                            })
             ->wait();
@@ -245,9 +249,6 @@ void provider_recursively_create_delete_test(const service_creator_func &creator
     deleter(service);
 }
 
-#undef expect_ok
-#undef expect_err
-
 TEST(meta_state_service, simple)
 {
     auto simple_service_creator = [] {
@@ -261,6 +262,333 @@ TEST(meta_state_service, simple)
     provider_recursively_create_delete_test(simple_service_creator, simple_service_deleter);
 }
 
+namespace dsn {
+namespace dist {
+DSN_DECLARE_uint64(meta_state_service_simple_snapshot_threshold_kb);
+} // namespace dist
+} // namespace dsn
+
+// whether the snapshot is saved and the first generation of log is removed
+static bool is_snapshotted(const std::string &work_dir)
+{
+    std::vector<std::string> files;
+    utils::filesystem::get_subfiles(work_dir, files, false);
+    bool has_snapshot = false;
+    for (const std::string &file : files) {
+        std::string name = utils::filesystem::get_file_name(file);
+        if (name == "meta_state_service.log") {
+            return false;
+        }
+        if (name.find("meta_state_service.snapshot.") == 0 &&
+            name.find(".tmp") == std::string::npos) {
+            has_snapshot = true;
+        }
+    }
+    return has_snapshot;
+}
+
+TEST(meta_state_service, simple_snapshot)
+{
+    const std::string work_dir = "meta_state_service_simple_snapshot_test";
+    utils::filesystem::remove_path(work_dir);
+    ASSERT_TRUE(utils::filesystem::create_directory(work_dir));
+    uint64_t old_threshold = FLAGS_meta_state_service_simple_snapshot_threshold_kb;
+    FLAGS_meta_state_service_simple_snapshot_threshold_kb = 4;
+
+    const int node_count = 200;
+    {
+        meta_state_service_simple service;
+        ASSERT_EQ(ERR_OK, service.initialize({work_dir}));
+        service.create_node("/s", META_STATE_SERVICE_SIMPLE_TEST_CALLBACK, expect_ok)->wait();
+        for (int i = 0; i < node_count; ++i) {
+            service
+                .create_node("/s/" + std::to_string(i),
+                             META_STATE_SERVICE_SIMPLE_TEST_CALLBACK,
+                             expect_ok,
+                             blob::create_from_bytes(std::string(100, 'a' + i % 26)))
+                ->wait();
+        }
+        service
+            .set_data("/s/0",
+                      blob::create_from_bytes("updated"),
+                      META_STATE_SERVICE_SIMPLE_TEST_CALLBACK,
+                      expect_ok)
+            ->wait();
+        service.delete_node("/s/1", false, META_STATE_SERVICE_SIMPLE_TEST_CALLBACK, expect_ok)
+            ->wait();
+
+        for (int i = 0; i < 100 && !is_snapshotted(work_dir); ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+        ASSERT_TRUE(is_snapshotted(work_dir));
+    }
+
+    // restart from the snapshot and the tail of the logs
+    {
+        meta_state_service_simple service;
+        ASSERT_EQ(ERR_OK, service.initialize({work_dir}));
+        service
+            .get_children("/s",
+                          META_STATE_SERVICE_SIMPLE_TEST_CALLBACK,
+                          [&](error_code ec, const std::vector<std::string> &children) {
+                              ASSERT_EQ(ERR_OK, ec);
+                              ASSERT_EQ(node_count - 1, children.size());
+                          })
+            ->wait();
+        service
+            .get_data("/s/0",
+                      META_STATE_SERVICE_SIMPLE_TEST_CALLBACK,
+                      [](error_code ec, const blob &value) {
+                          ASSERT_EQ(ERR_OK, ec);
+                          ASSERT_EQ("updated", value.to_string());
+                      })
+            ->wait();
+        service.node_exist("/s/1", META_STATE_SERVICE_SIMPLE_TEST_CALLBACK, expect_err)->wait();
+        service
+            .get_data("/s/" + std::to_string(node_count - 1),
+                      META_STATE_SERVICE_SIMPLE_TEST_CALLBACK,
+                      [&](error_code ec, const blob &value) {
+                          ASSERT_EQ(ERR_OK, ec);
+                          ASSERT_EQ(std::string(100, 'a' + (node_count - 1) % 26),
+                                    value.to_string());
+                      })
+            ->wait();
+    }
+
+    FLAGS_meta_state_service_simple_snapshot_threshold_kb = old_threshold;
+    utils::filesystem::remove_path(work_dir);
+}
+
+TEST(meta_state_service, simple_corrupted_snapshot)
+{
+    const std::string work_dir = "meta_state_service_simple_corrupted_snapshot_test";
+    utils::filesystem::remove_path(work_dir);
+    ASSERT_TRUE(utils::filesystem::create_directory(work_dir));
+    uint64_t old_threshold = FLAGS_meta_state_service_simple_snapshot_threshold_kb;
+    FLAGS_meta_state_service_simple_snapshot_threshold_kb = 4;
+
+    {
+        meta_state_service_simple service;
+        ASSERT_EQ(ERR_OK, service.initialize({work_dir}));
+        service.create_node("/s", META_STATE_SERVICE_SIMPLE_TEST_CALLBACK, expect_ok)->wait();
+        for (int i = 0; i < 200; ++i) {
+            service
+                .create_node("/s/" + std::to_string(i),
+                             META_STATE_SERVICE_SIMPLE_TEST_CALLBACK,
+                             expect_ok,
+                             blob::create_from_bytes(std::string(100, 'a')))
+                ->wait();
+        }
+        for (int i = 0; i < 100 && !is_snapshotted(work_dir); ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+        ASSERT_TRUE(is_snapshotted(work_dir));
+    }
+    FLAGS_meta_state_service_simple_snapshot_threshold_kb = old_threshold;
+
+    // corrupt the latest snapshot, whose older logs have been removed
+    std::vector<std::string> files;
+    utils::filesystem::get_subfiles(work_dir, files, false);
+    const std::string snapshot_prefix = "meta_state_service.snapshot.";
+    std::string latest_snapshot;
+    int64_t latest_gen = -1;
+    for (const std::string &file : files) {
+        std::string name = utils::filesystem::get_file_name(file);
+        if (name.find(snapshot_prefix) == 0 && name.find(".tmp") == std::string::npos) {
+            int64_t gen = std::stoll(name.substr(snapshot_prefix.size()));
+            if (gen > latest_gen) {
+                latest_gen = gen;
+                latest_snapshot = file;
+            }
+        }
+    }
+    ASSERT_FALSE(latest_snapshot.empty());
+    int64_t snapshot_size = 0;
+    ASSERT_TRUE(utils::filesystem::file_size(latest_snapshot, snapshot_size));
+    ASSERT_EQ(0, truncate(latest_snapshot.c_str(), snapshot_size - 1));
+
+    // the service refuses to start from the tail of the logs only
+    {
+        meta_state_service_simple service;
+        ASSERT_EQ(ERR_INVALID_DATA, service.initialize({work_dir}));
+    }
+    ASSERT_TRUE(utils::filesystem::file_exists(latest_snapshot));
+
+    utils::filesystem::remove_path(work_dir);
+}
+
+static meta_state_write_batcher::transaction_submitter submitter_of(meta_state_service &service)
+{
+    return [&service](const std::shared_ptr<meta_state_service::transaction_entries> &entries,
+                      task_code cb_code,
+                      const err_callback &cb_transaction,
+                      task_tracker *tracker) {
+        return service.submit_transaction(entries, cb_code, cb_transaction, tracker);
+    };
+}
+
+TEST(meta_state_service, write_batcher)
+{
+    const std::string work_dir = "meta_state_write_batcher_test";
+    utils::filesystem::remove_path(work_dir);
+    ASSERT_TRUE(utils::filesystem::create_directory(work_dir));
+
+    meta_state_service_simple service;
+    ASSERT_EQ(ERR_OK, service.initialize({work_dir}));
+    service.create_node("/b", META_STATE_SERVICE_SIMPLE_TEST_CALLBACK, expect_ok)->wait();
+
+    std::vector<error_code_future_ptr> tasks;
+    std::vector<error_code> results;
+    auto new_task = [&]() {
+        int index = tasks.size();
+        results.push_back(ERR_UNKNOWN);
+        tasks.emplace_back(new error_code_future(
+            META_STATE_SERVICE_SIMPLE_TEST_CALLBACK,
+            [&results, index](error_code ec) { results[index] = ec; },
+            0));
+        return tasks.back();
+    };
+
+    const int node_count = 100;
+    results.reserve(node_count + 3);
+    {
+        meta_state_write_batcher batcher(&service,
+                                         submitter_of(service),
+                                         META_STATE_SERVICE_SIMPLE_TEST_CALLBACK,
+                                         16,
+                                         64 * 1024);
+        for (int i = 0; i < node_count; ++i) {
+            batcher.create_node(
+                "/b/" + std::to_string(i), blob::create_from_bytes("v1"), new_task());
+        }
+        // the operations fail alone, and the others in the same batch succeed
+        batcher.create_node("/b/5", blob(), new_task());
+        batcher.set_data("/b/not_exist", blob(), new_task());
+        // the operations are executed in order
+        batcher.set_data("/b/" + std::to_string(node_count - 1),
+                         blob::create_from_bytes("v2"),
+                         new_task());
+
+        for (auto &t : tasks) {
+            t->wait();
+        }
+        ASSERT_LT(batcher.submitted_transactions(), tasks.size());
+    }
+
+    for (int i = 0; i < node_count; ++i) {
+        ASSERT_EQ(ERR_OK, results[i]);
+    }
+    ASSERT_EQ(ERR_NODE_ALREADY_EXIST, results[node_count]);
+    ASSERT_EQ(ERR_OBJECT_NOT_FOUND, results[node_count + 1]);
+    ASSERT_EQ(ERR_OK, results[node_count + 2]);
+
+    service
+        .get_children("/b",
+                      META_STATE_SERVICE_SIMPLE_TEST_CALLBACK,
+                      [&](error_code ec, const std::vector<std::string> &children) {
+                          ASSERT_EQ(ERR_OK, ec);
+                          ASSERT_EQ(node_count, children.size());
+                      })
+        ->wait();
+    service
+        .get_data("/b/" + std::to_string(node_count - 1),
+                  META_STATE_SERVICE_SIMPLE_TEST_CALLBACK,
+                  [](error_code ec, const blob &value) {
+                      ASSERT_EQ(ERR_OK, ec);
+                      ASSERT_EQ("v2", value.to_string());
+                  })
+        ->wait();
+
+    utils::filesystem::remove_path(work_dir);
+}
+
+TEST(meta_state_service, write_batcher_in_order)
+{
+    const std::string work_dir = "meta_state_write_batcher_in_order_test";
+    utils::filesystem::remove_path(work_dir);
+    ASSERT_TRUE(utils::filesystem::create_directory(work_dir));
+
+    meta_state_service_simple service;
+    ASSERT_EQ(ERR_OK, service.initialize({work_dir}));
+    service.create_node("/b", META_STATE_SERVICE_SIMPLE_TEST_CALLBACK, expect_ok)->wait();
+
+    std::vector<error_code_future_ptr> tasks;
+    std::vector<error_code> results;
+    auto new_task = [&]() {
+        int index = tasks.size();
+        results.push_back(ERR_UNKNOWN);
+        tasks.emplace_back(new error_code_future(
+            META_STATE_SERVICE_SIMPLE_TEST_CALLBACK,
+            [&results, index](error_code ec) { results[index] = ec; },
+            0));
+        return tasks.back();
+    };
+
+    const int node_count = 100;
+    results.reserve(node_count + 4);
+    blob got_value;
+    {
+        meta_state_write_batcher batcher(&service,
+                                         submitter_of(service),
+                                         META_STATE_SERVICE_SIMPLE_TEST_CALLBACK,
+                                         16,
+                                         64 * 1024);
+        for (int i = 0; i < node_count; ++i) {
+            batcher.create_node(
+                "/b/" + std::to_string(i), blob::create_from_bytes("v1"), new_task());
+        }
+        // the non-batched operations see the creates queued before them, instead of overtaking
+        // them
+        const std::string last_node = "/b/" + std::to_string(node_count - 1);
+        error_code_future_ptr get_task = new_task();
+        batcher.run_in_order([&service, &got_value, last_node, get_task]() {
+            service.get_data(last_node,
+                             META_STATE_SERVICE_SIMPLE_TEST_CALLBACK,
+                             [&got_value, get_task](error_code ec, const blob &value) {
+                                 got_value = value;
+                                 get_task->enqueue_with(ec);
+                             });
+        });
+        error_code_future_ptr delete_task = new_task();
+        batcher.run_in_order([&service, last_node, delete_task]() {
+            service.delete_node(last_node,
+                                false,
+                                META_STATE_SERVICE_SIMPLE_TEST_CALLBACK,
+                                [delete_task](error_code ec) { delete_task->enqueue_with(ec); });
+        });
+        // and the writes queued after them are not sent before them
+        batcher.create_node(last_node, blob::create_from_bytes("v2"), new_task());
+        batcher.create_node("/b/0", blob(), new_task());
+
+        for (auto &t : tasks) {
+            t->wait();
+        }
+    }
+
+    for (int i = 0; i < node_count; ++i) {
+        ASSERT_EQ(ERR_OK, results[i]);
+    }
+    ASSERT_EQ(ERR_OK, results[node_count]);
+    ASSERT_EQ("v1", got_value.to_string());
+    ASSERT_EQ(ERR_OK, results[node_count + 1]);
+    ASSERT_EQ(ERR_OK, results[node_count + 2]);
+    ASSERT_EQ(ERR_NODE_ALREADY_EXIST, results[node_count + 3]);
+
+    service
+        .get_data("/b/" + std::to_string(node_count - 1),
+                  META_STATE_SERVICE_SIMPLE_TEST_CALLBACK,
+                  [](error_code ec, const blob &value) {
+                      ASSERT_EQ(ERR_OK, ec);
+                      ASSERT_EQ("v2", value.to_string());
+                  })
+        ->wait();
+
+    utils::filesystem::remove_path(work_dir);
+}
+
+#undef expect_ok
+#undef expect_err
+
 TEST(meta_state_service, zookeeper)
 {
     auto zookeeper_service_creator = [] {